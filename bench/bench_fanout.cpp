@@ -0,0 +1,113 @@
+#include <benchmark/benchmark.h>
+#include <gst/gst.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "gstreamer/fanout_ring.hpp"
+#include "http/stream_hub.h"
+
+namespace {
+
+constexpr int kGop = 30;
+constexpr int kReaderThreads = 4;
+
+std::vector<GstBuffer*> make_gop() {
+    gst_init(nullptr, nullptr);
+    std::vector<GstBuffer*> gop;
+    for (int i = 0; i < kGop; ++i) {
+        GstBuffer* buffer = gst_buffer_new_allocate(nullptr, 1316, nullptr);
+        if (i != 0) {
+            GST_BUFFER_FLAG_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+        }
+        gop.push_back(buffer);
+    }
+    return gop;
+}
+
+void free_gop(std::vector<GstBuffer*>& gop) {
+    for (GstBuffer* buffer : gop) {
+        gst_buffer_unref(buffer);
+    }
+}
+
+} // namespace
+
+// Producer cost of one publish while `readers` cursors (arg 0) are being
+// advanced concurrently by a few consumer threads. Should stay flat from 1 to 10k.
+static void BM_RingPublish(benchmark::State& state) {
+    const auto readers = static_cast<std::size_t>(state.range(0));
+    auto gop = make_gop();
+    FanoutRing ring(1024);
+
+    std::vector<std::unique_ptr<FanoutReader>> cursors;
+    for (std::size_t i = 0; i < readers; ++i) {
+        cursors.push_back(std::make_unique<FanoutReader>(ring, 512));
+    }
+    std::atomic<bool> done{false};
+    std::vector<std::thread> consumers;
+    for (int t = 0; t < kReaderThreads; ++t) {
+        consumers.emplace_back([&, t] {
+            while (!done.load(std::memory_order_relaxed)) {
+                for (std::size_t i = t; i < cursors.size(); i += kReaderThreads) {
+                    while (GstBuffer* buffer = cursors[i]->next()) {
+                        gst_buffer_unref(buffer);
+                    }
+                }
+            }
+        });
+    }
+
+    std::size_t n = 0;
+    for (auto _ : state) {
+        ring.publish(gop[n++ % kGop]);
+    }
+
+    done = true;
+    for (auto& consumer : consumers) {
+        consumer.join();
+    }
+    std::uint64_t skipped = 0;
+    for (const auto& cursor : cursors) {
+        skipped += cursor->skipped();
+    }
+    state.counters["readers"] = static_cast<double>(readers);
+    state.counters["skipped_per_reader"] = static_cast<double>(skipped) / readers;
+    free_gop(gop);
+}
+BENCHMARK(BM_RingPublish)->RangeMultiplier(10)->Range(1, 10000)->ArgName("readers");
+
+// Same through StreamHub, with every viewer parked on the sleeper list so that
+// each publish also pays for the wake-ups it triggers.
+static void BM_HubPublishIdleViewers(benchmark::State& state) {
+    const auto viewers = static_cast<std::size_t>(state.range(0));
+    auto gop = make_gop();
+    auto hub = std::make_shared<StreamHub>();
+
+    std::vector<std::shared_ptr<StreamSubscriber>> subscribers;
+    std::atomic<std::uint64_t> wakes{0};
+    for (std::size_t i = 0; i < viewers; ++i) {
+        subscribers.push_back(hub->subscribe());
+        subscribers.back()->start([&wakes] { wakes.fetch_add(1, std::memory_order_relaxed); });
+    }
+
+    std::size_t n = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        for (auto& subscriber : subscribers) {
+            while (subscriber->next().size() > 0) {
+                subscriber->release();
+            }
+        }
+        state.ResumeTiming();
+        hub->publish(gop[n++ % kGop]);
+    }
+
+    for (auto& subscriber : subscribers) {
+        subscriber->stop();
+    }
+    state.counters["viewers"] = static_cast<double>(viewers);
+    state.counters["wakes"] = static_cast<double>(wakes.load());
+    free_gop(gop);
+}
+BENCHMARK(BM_HubPublishIdleViewers)->RangeMultiplier(10)->Range(1, 10000)->ArgName("viewers");
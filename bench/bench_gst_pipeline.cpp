@@ -0,0 +1,197 @@
+// Headless pipeline benchmarks: videotestsrc num-buffers=N into fakesink
+// sync=false, so nothing waits on a clock or a display. For machine-readable
+// results, run e.g.
+//   benchPipelines --benchmark_filter=BM_Pipeline --benchmark_format=json
+// frames/s and per-frame latency percentiles are reported as counters.
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "gstreamer/gst_pipeline.hpp"
+#include "gstreamer/main_loop_thread.hpp"
+#include "destroy_on_loop.hpp"
+#include "latency_histogram.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kFrames = 300;
+
+// `element` runs under the name "dut", between a 720p NV12 source and fakesink.
+std::string throughput_desc(const char* element) {
+    return std::string("videotestsrc num-buffers=") + std::to_string(kFrames) +
+           " ! video/x-raw,format=NV12,width=1280,height=720,framerate=30/1 ! " + element +
+           " name=dut ! fakesink sync=false";
+}
+
+// Time each buffer spends in the element: stamped on its sink pad, matched by
+// PTS on its src pad. Encoders that hold frames back (lookahead, B-frames)
+// show it here.
+class FrameLatency {
+public:
+    explicit FrameLatency(GstElement* element) {
+        sink_ = gst_element_get_static_pad(element, "sink");
+        src_ = gst_element_get_static_pad(element, "src");
+        sink_probe_ = gst_pad_add_probe(sink_, GST_PAD_PROBE_TYPE_BUFFER, &FrameLatency::entered, this, nullptr);
+        src_probe_ = gst_pad_add_probe(src_, GST_PAD_PROBE_TYPE_BUFFER, &FrameLatency::left, this, nullptr);
+    }
+
+    ~FrameLatency() {
+        gst_pad_remove_probe(sink_, sink_probe_);
+        gst_pad_remove_probe(src_, src_probe_);
+        gst_object_unref(sink_);
+        gst_object_unref(src_);
+    }
+
+    // First buffer into the element: when the pipeline is up and streaming.
+    Clock::time_point first() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return first_;
+    }
+
+    LatencyHistogram& histogram() { return histogram_; }
+
+private:
+    static GstPadProbeReturn entered(GstPad*, GstPadProbeInfo* info, gpointer data) {
+        auto* self = static_cast<FrameLatency*>(data);
+        const auto now = Clock::now();
+        std::lock_guard<std::mutex> lock(self->mutex_);
+        if (self->first_ == Clock::time_point{}) {
+            self->first_ = now;
+        }
+        self->in_flight_[GST_BUFFER_PTS(GST_PAD_PROBE_INFO_BUFFER(info))] = now;
+        return GST_PAD_PROBE_OK;
+    }
+
+    static GstPadProbeReturn left(GstPad*, GstPadProbeInfo* info, gpointer data) {
+        auto* self = static_cast<FrameLatency*>(data);
+        const auto now = Clock::now();
+        std::lock_guard<std::mutex> lock(self->mutex_);
+        const auto it = self->in_flight_.find(GST_BUFFER_PTS(GST_PAD_PROBE_INFO_BUFFER(info)));
+        if (it != self->in_flight_.end()) {
+            self->histogram_.record(std::chrono::duration_cast<std::chrono::nanoseconds>(now - it->second).count());
+            self->in_flight_.erase(it);
+        }
+        return GST_PAD_PROBE_OK;
+    }
+
+    GstPad* sink_;
+    GstPad* src_;
+    gulong sink_probe_;
+    gulong src_probe_;
+    std::mutex mutex_;
+    Clock::time_point first_;
+    std::unordered_map<GstClockTime, Clock::time_point> in_flight_;
+    LatencyHistogram histogram_;
+};
+
+} // namespace
+
+// kFrames frames through `element`, from the first buffer entering it to EOS.
+static void BM_PipelineThroughput(benchmark::State& state, const char* element) {
+    auto loop = std::make_unique<MainLoopThread>();
+    const auto desc = throughput_desc(element);
+    LatencyHistogram latency;
+    for (auto _ : state) {
+        auto pipeline = std::make_unique<GstPipelineWrapper>(desc.c_str(), loop->context());
+        if (!pipeline->valid()) {
+            destroy_on_loop(std::move(pipeline));
+            state.SkipWithError("pipeline could not be built");
+            break;
+        }
+        GstElement* dut = pipeline->element("dut");
+        auto frames = std::make_unique<FrameLatency>(dut);
+        gst_object_unref(dut);
+        pipeline->start_async();
+        const auto ended = pipeline->end_of_stream_async().get();
+        const auto elapsed = Clock::now() - frames->first();
+        pipeline->stop_async().wait();
+        latency.merge(frames->histogram());
+        frames.reset();
+        destroy_on_loop(std::move(pipeline));
+        if (ended.status != LifecycleEvent::Status::Eos) {
+            state.SkipWithError(ended.message.c_str());
+            break;
+        }
+        state.SetIterationTime(std::chrono::duration<double>(elapsed).count());
+    }
+    loop.reset();
+
+    state.SetItemsProcessed(state.iterations() * kFrames);
+    state.counters["fps"] = benchmark::Counter(static_cast<double>(state.iterations() * kFrames),
+                                               benchmark::Counter::kIsRate);
+    state.counters["p50_ms"] = latency.percentile(0.50) / 1e6;
+    state.counters["p99_ms"] = latency.percentile(0.99) / 1e6;
+    state.counters["max_ms"] = latency.max() / 1e6;
+}
+BENCHMARK_CAPTURE(BM_PipelineThroughput, identity, "identity")
+    ->UseManualTime()->Unit(benchmark::kMillisecond)->Iterations(5);
+BENCHMARK_CAPTURE(BM_PipelineThroughput, mypassthrough, "mypassthrough")
+    ->UseManualTime()->Unit(benchmark::kMillisecond)->Iterations(5);
+BENCHMARK_CAPTURE(BM_PipelineThroughput, mypassthrough_contrast, "mypassthrough contrast=1.2 n-threads=0")
+    ->UseManualTime()->Unit(benchmark::kMillisecond)->Iterations(5);
+BENCHMARK_CAPTURE(BM_PipelineThroughput, x264_ultrafast, "x264enc speed-preset=ultrafast tune=zerolatency")
+    ->UseManualTime()->Unit(benchmark::kMillisecond)->Iterations(3);
+BENCHMARK_CAPTURE(BM_PipelineThroughput, x264_veryfast, "x264enc speed-preset=veryfast")
+    ->UseManualTime()->Unit(benchmark::kMillisecond)->Iterations(3);
+BENCHMARK_CAPTURE(BM_PipelineThroughput, x264_medium, "x264enc speed-preset=medium")
+    ->UseManualTime()->Unit(benchmark::kMillisecond)->Iterations(3);
+
+namespace {
+
+const char* kMinimalDesc = "videotestsrc ! fakesink sync=false";
+const char* kEncodeDesc =
+    "videotestsrc ! video/x-raw,width=1280,height=720 "
+    "! x264enc speed-preset=ultrafast tune=zerolatency ! fakesink sync=false";
+
+} // namespace
+
+// GstPipelineWrapper construction (parse, bus watch) then NULL->PLAYING, until
+// the pipeline reports PLAYING.
+static void BM_WrapperStartup(benchmark::State& state, const char* desc) {
+    auto loop = std::make_unique<MainLoopThread>();
+    for (auto _ : state) {
+        const auto start = Clock::now();
+        auto pipeline = std::make_unique<GstPipelineWrapper>(desc, loop->context());
+        const auto reached = pipeline->start_async().get();
+        state.SetIterationTime(std::chrono::duration<double>(Clock::now() - start).count());
+        pipeline->stop_async().wait();
+        destroy_on_loop(std::move(pipeline));
+        if (reached.status != LifecycleEvent::Status::Reached) {
+            state.SkipWithError(reached.message.c_str());
+            break;
+        }
+    }
+    loop.reset();
+}
+BENCHMARK_CAPTURE(BM_WrapperStartup, minimal, kMinimalDesc)
+    ->UseManualTime()->Unit(benchmark::kMillisecond)->Iterations(20);
+BENCHMARK_CAPTURE(BM_WrapperStartup, x264, kEncodeDesc)
+    ->UseManualTime()->Unit(benchmark::kMillisecond)->Iterations(20);
+
+// PLAYING->NULL then destruction of the wrapper.
+static void BM_WrapperTeardown(benchmark::State& state, const char* desc) {
+    auto loop = std::make_unique<MainLoopThread>();
+    for (auto _ : state) {
+        auto pipeline = std::make_unique<GstPipelineWrapper>(desc, loop->context());
+        const auto reached = pipeline->start_async().get();
+        if (reached.status != LifecycleEvent::Status::Reached) {
+            pipeline->stop_async().wait();
+            destroy_on_loop(std::move(pipeline));
+            state.SkipWithError(reached.message.c_str());
+            break;
+        }
+        const auto start = Clock::now();
+        pipeline->stop_async().wait();
+        destroy_on_loop(std::move(pipeline));
+        state.SetIterationTime(std::chrono::duration<double>(Clock::now() - start).count());
+    }
+    loop.reset();
+}
+BENCHMARK_CAPTURE(BM_WrapperTeardown, minimal, kMinimalDesc)
+    ->UseManualTime()->Unit(benchmark::kMillisecond)->Iterations(20);
+BENCHMARK_CAPTURE(BM_WrapperTeardown, x264, kEncodeDesc)
+    ->UseManualTime()->Unit(benchmark::kMillisecond)->Iterations(20);
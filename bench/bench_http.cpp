@@ -0,0 +1,303 @@
+// HTTP server benchmarks. Every server listens on an ephemeral port. For
+// machine-readable results, run e.g.
+//   benchHttp --benchmark_filter=BM_Load --benchmark_format=json
+// latency percentiles are reported as counters (p50_us, p99_us, p999_us, ...).
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <boost/asio.hpp>
+#include <boost/beast.hpp>
+#include "http/server.h"
+#include "load_generator.hpp"
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+using tcp = boost::asio::ip::tcp;
+
+namespace {
+
+// One blocking keep-alive client: sends `requests` GETs back to back.
+void run_client(const std::string& port, int requests) {
+    boost::asio::io_context ioc;
+    tcp::resolver resolver(ioc);
+    beast::tcp_stream stream(ioc);
+    stream.connect(resolver.resolve("127.0.0.1", port));
+
+    http::request<http::empty_body> req{http::verb::get, "/", 11};
+    req.set(http::field::host, "127.0.0.1");
+    beast::flat_buffer buffer;
+    http::response<http::string_body> res;
+    for (int i = 0; i < requests; ++i) {
+        http::write(stream, req);
+        res = {};
+        http::read(stream, buffer, res);
+    }
+    beast::error_code ec;
+    stream.socket().shutdown(tcp::socket::shutdown_both, ec);
+}
+
+// Opens `connections` connections one after the other, each carrying a single
+// "Connection: close" request. Waits for the server to close first, so that
+// TIME_WAIT lands on its side rather than eating the client's ephemeral ports.
+void run_short_client(const tcp::endpoint& endpoint, int connections) {
+    boost::asio::io_context ioc;
+    http::request<http::empty_body> req{http::verb::get, "/", 11};
+    req.set(http::field::host, "127.0.0.1");
+    req.keep_alive(false);
+    for (int i = 0; i < connections; ++i) {
+        beast::tcp_stream stream(ioc);
+        stream.connect(endpoint);
+        http::write(stream, req);
+        beast::flat_buffer buffer;
+        http::response<http::string_body> res;
+        http::read(stream, buffer, res);
+        beast::error_code ec;
+        http::read(stream, buffer, res, ec);
+    }
+}
+
+// Opens connections back to back until `stop` is set, one request each, and
+// counts the replies that were not 200.
+void run_flood_client(const tcp::endpoint& endpoint, const std::atomic<bool>& stop, std::atomic<int>& rejected) {
+    boost::asio::io_context ioc;
+    http::request<http::empty_body> req{http::verb::get, "/", 11};
+    req.set(http::field::host, "127.0.0.1");
+    req.keep_alive(false);
+    while (!stop) {
+        beast::tcp_stream stream(ioc);
+        beast::error_code ec;
+        stream.connect(endpoint, ec);
+        if (ec) {
+            continue;
+        }
+        http::write(stream, req, ec);
+        beast::flat_buffer buffer;
+        http::response<http::string_body> res;
+        http::read(stream, buffer, res, ec);
+        if (!ec && res.result() != http::status::ok) {
+            ++rejected;
+        }
+        http::read(stream, buffer, res, ec);
+    }
+}
+
+void report(benchmark::State& state, const LoadResult& result) {
+    state.SetIterationTime(result.seconds);
+    state.SetItemsProcessed(static_cast<std::int64_t>(result.requests));
+    state.counters["errors"] = static_cast<double>(result.errors);
+    state.counters["p50_us"] = result.latency.percentile(0.50) / 1e3;
+    state.counters["p90_us"] = result.latency.percentile(0.90) / 1e3;
+    state.counters["p99_us"] = result.latency.percentile(0.99) / 1e3;
+    state.counters["p999_us"] = result.latency.percentile(0.999) / 1e3;
+    state.counters["max_us"] = result.latency.max() / 1e3;
+}
+
+} // namespace
+
+// Requests/s against the number of server threads (arg 0) with a fixed number of
+// keep-alive client connections (arg 1).
+static void BM_ServerThreads(benchmark::State& state) {
+    const auto server_threads = static_cast<std::size_t>(state.range(0));
+    const auto connections = static_cast<int>(state.range(1));
+    constexpr int kRequestsPerConnection = 200;
+
+    HttpServer server(tcp::endpoint{tcp::v4(), 0}, nullptr, server_threads);
+    server.start();
+    const std::string port = std::to_string(server.port());
+
+    for (auto _ : state) {
+        std::vector<std::thread> clients;
+        clients.reserve(connections);
+        for (int c = 0; c < connections; ++c) {
+            clients.emplace_back(run_client, port, kRequestsPerConnection);
+        }
+        for (auto& client : clients) {
+            client.join();
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * connections * kRequestsPerConnection);
+    state.counters["server_threads"] = static_cast<double>(server_threads);
+    server.stop();
+}
+BENCHMARK(BM_ServerThreads)
+    ->ArgsProduct({{1, 2, 4, 8}, {64}})
+    ->ArgNames({"threads", "connections"})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+// Connections/s with `clients` (arg 0) concurrent clients that each open a new
+// connection per request: accept, session setup and teardown on every request.
+static void BM_ConnectionsPerSecond(benchmark::State& state) {
+    const auto clients_count = static_cast<int>(state.range(0));
+    constexpr int kConnectionsPerClient = 100;
+
+    HttpServer server(tcp::endpoint{tcp::v4(), 0}, nullptr, 1);
+    server.start();
+    const tcp::endpoint endpoint(boost::asio::ip::make_address("127.0.0.1"), server.port());
+
+    for (auto _ : state) {
+        std::vector<std::thread> clients;
+        clients.reserve(clients_count);
+        for (int c = 0; c < clients_count; ++c) {
+            clients.emplace_back(run_short_client, endpoint, kConnectionsPerClient);
+        }
+        for (auto& client : clients) {
+            client.join();
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * clients_count * kConnectionsPerClient);
+    server.stop();
+}
+BENCHMARK(BM_ConnectionsPerSecond)
+    ->Arg(1)
+    ->Arg(8)
+    ->ArgName("clients")
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+// Round trip of a control call: HTTP parse, hop onto the GLib main context,
+// g_object_set on a live encoder, hop back and reply.
+static void BM_ControlSetBitrate(benchmark::State& state) {
+    HttpServer server(tcp::endpoint{tcp::v4(), 0},
+        "videotestsrc is-live=true ! video/x-raw,width=320,height=240,framerate=30/1 ! videoconvert "
+        "! x264enc name=encode tune=zerolatency speed-preset=ultrafast ! fakesink sync=false", 1);
+    server.start();
+
+    boost::asio::io_context ioc;
+    tcp::resolver resolver(ioc);
+    beast::tcp_stream stream(ioc);
+    stream.connect(resolver.resolve("127.0.0.1", std::to_string(server.port())));
+
+    http::request<http::string_body> req{http::verb::put, "/elements/encode/properties/bitrate", 11};
+    req.set(http::field::host, "127.0.0.1");
+    beast::flat_buffer buffer;
+    unsigned bitrate = 1000;
+    for (auto _ : state) {
+        req.body() = std::to_string(bitrate);
+        req.prepare_payload();
+        http::write(stream, req);
+        http::response<http::string_body> res;
+        http::read(stream, buffer, res);
+        bitrate = bitrate == 1000 ? 2000 : 1000;
+    }
+
+    beast::error_code ec;
+    stream.socket().shutdown(tcp::socket::shutdown_both, ec);
+    server.stop();
+}
+BENCHMARK(BM_ControlSetBitrate)->UseRealTime()->Unit(benchmark::kMicrosecond);
+
+// Latency seen by 8 keep-alive clients in a closed loop while `flood` (arg 0)
+// other clients open a new connection per request as fast as they can, with
+// the connection cap off or on (arg 1). With the cap on, the flood is answered
+// 503 from the accept loop and the p99 of the served clients should stay close
+// to the run without flood.
+static void BM_OverloadLatency(benchmark::State& state) {
+    const auto flood = static_cast<int>(state.range(0));
+    const bool capped = state.range(1) != 0;
+
+    HttpServer server(tcp::endpoint{tcp::v4(), 0}, nullptr, 1);
+    LoadOptions options;
+    options.endpoint = tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), server.port());
+    options.connections = 8;
+    if (capped) {
+        AdmissionLimits limits;
+        limits.max_connections = options.connections;
+        limits.overload_slots = 256;
+        server.set_admission(limits);
+    }
+    server.start();
+
+    std::atomic<bool> stop{false};
+    std::atomic<int> rejected{0};
+    std::vector<std::thread> flooders;
+    LoadResult result;
+    for (auto _ : state) {
+        // The served clients connect first, so that they hold the capped slots.
+        std::thread served([&] { result = run_load(options); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        for (int f = 0; f < flood; ++f) {
+            flooders.emplace_back(run_flood_client, options.endpoint, std::cref(stop), std::ref(rejected));
+        }
+        served.join();
+        report(state, result);
+    }
+
+    stop = true;
+    for (auto& flooder : flooders) {
+        flooder.join();
+    }
+    state.counters["flood_rejected"] = rejected.load();
+    server.stop();
+}
+BENCHMARK(BM_OverloadLatency)
+    ->Args({0, 0})
+    ->Args({32, 0})
+    ->Args({32, 1})
+    ->ArgNames({"flood", "capped"})
+    ->Iterations(1)
+    ->UseManualTime()
+    ->Unit(benchmark::kMillisecond);
+
+// Closed loop: `connections` (arg 0) keep-alive clients on 2 client threads,
+// each sending its next GET / as soon as the previous reply is in, against
+// `threads` (arg 1) server threads. Measures peak throughput; latency grows
+// with the number of connections queued on the server.
+static void BM_LoadClosedLoop(benchmark::State& state) {
+    HttpServer server(tcp::endpoint{tcp::v4(), 0}, nullptr, static_cast<std::size_t>(state.range(1)));
+    server.start();
+    LoadOptions options;
+    options.endpoint = tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), server.port());
+    options.connections = static_cast<std::size_t>(state.range(0));
+    options.threads = 2;
+    for (auto _ : state) {
+        report(state, run_load(options));
+    }
+    server.stop();
+}
+BENCHMARK(BM_LoadClosedLoop)
+    ->ArgsProduct({{1, 16, 256}, {1, 4}})
+    ->ArgNames({"connections", "threads"})
+    ->Iterations(1)
+    ->UseManualTime()
+    ->Unit(benchmark::kMillisecond);
+
+// Open loop: GET / due at `rate` (arg 0) requests per second over 64 keep-alive
+// connections, whatever the server's pace. Latency counts from when a request
+// was due, so it shows queueing once the rate nears what the server sustains.
+static void BM_LoadOpenLoop(benchmark::State& state) {
+    HttpServer server(tcp::endpoint{tcp::v4(), 0}, nullptr, 1);
+    server.start();
+    LoadOptions options;
+    options.endpoint = tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), server.port());
+    options.connections = 64;
+    options.threads = 2;
+    options.requests_per_second = static_cast<double>(state.range(0));
+    for (auto _ : state) {
+        report(state, run_load(options));
+    }
+    server.stop();
+}
+BENCHMARK(BM_LoadOpenLoop)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->Arg(40000)
+    ->ArgName("rate")
+    ->Iterations(1)
+    ->UseManualTime()
+    ->Unit(benchmark::kMillisecond);
+
+// One token taken from a bucket shared by every thread: the cost added to each
+// accept and each keep-alive request when the rate limit is on.
+static void BM_RateLimiterAcquire(benchmark::State& state) {
+    static RateLimiter limiter(1e9, 1e9);
+    const auto client = RateLimiter::client_key(boost::asio::ip::make_address("192.0.2.1"));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(limiter.try_acquire(client));
+    }
+}
+BENCHMARK(BM_RateLimiterAcquire)->ThreadRange(1, 4)->UseRealTime();
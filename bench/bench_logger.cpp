@@ -0,0 +1,58 @@
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <string>
+#include "logging/logger.h"
+
+namespace {
+
+// Keeps the writer busy without flooding the benchmark output.
+void discard_output() {
+    static const bool installed = [] {
+        Logger::instance().set_sink([](std::string_view lines) { benchmark::DoNotOptimize(lines.size()); });
+        return true;
+    }();
+    benchmark::DoNotOptimize(installed);
+}
+
+} // namespace
+
+// Cost on the calling thread: a slot in its ring and a few stores. Records
+// dropped because the writer fell behind are cheaper still, so the writer is
+// given a chance to catch up between batches.
+static void BM_LogStructured(benchmark::State& state) {
+    discard_output();
+    const std::string path = "/elements/encode";
+    std::size_t n = 0;
+    for (auto _ : state) {
+        Logger::instance().log(LogLevel::Info, "Session", "Request received", "bytes", n, "path", path);
+        if (++n % Logger::kThreadRingSize == 0) {
+            state.PauseTiming();
+            Logger::instance().flush();
+            state.ResumeTiming();
+        }
+    }
+}
+BENCHMARK(BM_LogStructured)->ThreadRange(1, 4)->UseRealTime();
+
+// What the hot path paid before: a synchronous write to a stream shared by all
+// threads (std::cout is synced with stdio, so it serialises on the same lock).
+static void BM_LogSyncStdio(benchmark::State& state) {
+    static std::FILE* null = std::fopen("/dev/null", "w");
+    const std::string path = "/elements/encode";
+    std::size_t n = 0;
+    for (auto _ : state) {
+        std::fprintf(null, "[Session] Request received (%zu bytes) %s\n", n++, path.c_str());
+        std::fflush(null);
+    }
+}
+BENCHMARK(BM_LogSyncStdio)->ThreadRange(1, 4)->UseRealTime();
+
+// A level compiled out below SLOG_ACTIVE_LEVEL: nothing is left to run.
+static void BM_LogCompiledOut(benchmark::State& state) {
+    std::size_t n = 0;
+    for (auto _ : state) {
+        SLOG_TRACE("Session", "Request received", "bytes", ++n);
+        benchmark::DoNotOptimize(n);
+    }
+}
+BENCHMARK(BM_LogCompiledOut);
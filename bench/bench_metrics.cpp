@@ -0,0 +1,39 @@
+#include <benchmark/benchmark.h>
+#include "metrics/metrics.h"
+
+// Hot-path cost of a sharded counter. With several threads each one adds to its
+// own cache line, so the time per increment should stay flat as threads grow.
+static void BM_CounterInc(benchmark::State& state) {
+    static Counter counter;
+    for (auto _ : state) {
+        counter.inc();
+    }
+    if (state.thread_index() == 0) {
+        benchmark::DoNotOptimize(counter.value());
+    }
+}
+BENCHMARK(BM_CounterInc)->ThreadRange(1, 8)->UseRealTime();
+
+static void BM_HistogramObserve(benchmark::State& state) {
+    static Histogram histogram(Histogram::latency_bounds());
+    double value = 0.0001;
+    for (auto _ : state) {
+        histogram.observe(value);
+        value = value < 10 ? value * 1.5 : 0.0001;
+    }
+}
+BENCHMARK(BM_HistogramObserve)->ThreadRange(1, 8)->UseRealTime();
+
+// A scrape of a registry shaped like the server's: a few dozen routes.
+static void BM_RegistryRender(benchmark::State& state) {
+    MetricsRegistry registry;
+    for (int i = 0; i < 32; ++i) {
+        const auto labels = MetricsRegistry::labels({{"route", "/api/v1/resource" + std::to_string(i)}});
+        registry.histogram("http_request_duration_seconds", "Latency.", labels).observe(0.01);
+        registry.counter("http_requests_total", "Requests.", labels).inc();
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(registry.render());
+    }
+}
+BENCHMARK(BM_RegistryRender);
@@ -0,0 +1,52 @@
+#include <benchmark/benchmark.h>
+#include <vector>
+#include "mypassthrough_slices.h"
+
+namespace {
+
+struct Job {
+    MyPassFrame frame;
+    MyPassParams params;
+    const MyPassKernels* kernels;
+};
+
+void run_slice(gpointer data, gint index, gint n_slices) {
+    auto* job = static_cast<Job*>(data);
+    my_pass_process_slice(&job->frame, &job->params, job->kernels, index, n_slices);
+}
+
+} // namespace
+
+// One NV12 frame per iteration through the slice pool, as transform_ip does.
+// Args: height (width is 16:9), thread count.
+static void BM_MypassthroughNV12(benchmark::State& state) {
+    const gint height = static_cast<gint>(state.range(0));
+    const gint width = height * 16 / 9;
+    std::vector<guint8> buffer(static_cast<std::size_t>(width) * height * 3 / 2, 90);
+
+    const gdouble saturate[9] = {1.2, -0.1, -0.1, -0.1, 1.2, -0.1, -0.1, -0.1, 1.2};
+    Job job{};
+    job.frame.layout = MY_PASS_LAYOUT_NV12;
+    job.frame.width = width;
+    job.frame.height = height;
+    job.frame.data[0] = buffer.data();
+    job.frame.data[1] = buffer.data() + width * height;
+    job.frame.stride[0] = job.frame.stride[1] = width;
+    my_pass_params_compute(&job.params, 0.02, 1.1, 1.0, saturate, 0.2126, 0.0722);
+    job.kernels = my_pass_kernels_get(MY_PASS_KERNEL_AUTO);
+
+    MyPassSlicePool* pool = my_pass_slice_pool_new(static_cast<guint>(state.range(1)));
+    for (auto _ : state) {
+        my_pass_slice_pool_run(pool, run_slice, &job);
+        benchmark::ClobberMemory();
+    }
+    my_pass_slice_pool_free(pool);
+
+    state.counters["fps"] = benchmark::Counter(static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(buffer.size()));
+}
+BENCHMARK(BM_MypassthroughNV12)
+    ->ArgNames({"height", "threads"})
+    ->ArgsProduct({{1080, 2160}, {1, 2, 4, 8}})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,67 @@
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "gstreamer/main_loop_thread.hpp"
+#include "gstreamer/pipeline_pool.hpp"
+#include "destroy_on_loop.hpp"
+
+namespace {
+
+// Encode + decode, the expensive case the pool is meant for.
+const char* kTranscodeDesc =
+    "videotestsrc ! video/x-raw,width=1280,height=720,framerate=30/1 "
+    "! x264enc tune=zerolatency speed-preset=ultrafast ! avdec_h264 "
+    "! appsink name=out sync=false";
+
+// Starts `pipeline` and returns the seconds until its first buffer reaches the appsink.
+double time_to_first_buffer(GstPipelineWrapper& pipeline, std::chrono::steady_clock::time_point since) {
+    auto got = std::make_shared<std::promise<std::chrono::steady_clock::time_point>>();
+    auto future = got->get_future();
+    auto once = std::make_shared<std::once_flag>();
+    pipeline.tap_appsink("out", [got, once](GstBuffer*) {
+        std::call_once(*once, [&] { got->set_value(std::chrono::steady_clock::now()); });
+    });
+    pipeline.start_async();
+    return std::chrono::duration<double>(future.get() - since).count();
+}
+
+} // namespace
+
+// Parse, NULL->PLAYING, preroll and first frame, as GstPipelineWrapper did alone.
+static void BM_TimeToFirstBufferCold(benchmark::State& state) {
+    auto loop = std::make_unique<MainLoopThread>();
+    for (auto _ : state) {
+        const auto start = std::chrono::steady_clock::now();
+        auto pipeline = std::make_unique<GstPipelineWrapper>(kTranscodeDesc, loop->context());
+        state.SetIterationTime(time_to_first_buffer(*pipeline, start));
+        pipeline->stop_async().wait();
+        destroy_on_loop(std::move(pipeline));
+    }
+    loop.reset();
+}
+BENCHMARK(BM_TimeToFirstBufferCold)->UseManualTime()->Unit(benchmark::kMillisecond)->Iterations(10);
+
+// Same, from a prerolled pipeline taken from the pool: PAUSED->PLAYING only.
+static void BM_TimeToFirstBufferPooled(benchmark::State& state) {
+    auto loop = std::make_unique<MainLoopThread>();
+    auto pool = std::make_unique<PipelinePool>(loop->context());
+    pool->prewarm(kTranscodeDesc, 1);
+    std::size_t cold = 0;
+    for (auto _ : state) {
+        // Not timed: the pool refills between requests.
+        while (pool->idle(kTranscodeDesc) == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        const auto start = std::chrono::steady_clock::now();
+        PipelineLease lease = pool->acquire(kTranscodeDesc);
+        cold += lease.warm() ? 0 : 1;
+        state.SetIterationTime(time_to_first_buffer(*lease, start));
+    }
+    state.counters["cold_starts"] = static_cast<double>(cold);
+    pool.reset();
+    loop.reset();
+}
+BENCHMARK(BM_TimeToFirstBufferPooled)->UseManualTime()->Unit(benchmark::kMillisecond)->Iterations(10);
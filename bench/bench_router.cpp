@@ -0,0 +1,58 @@
+#include <benchmark/benchmark.h>
+#include <string>
+#include "http/router.h"
+
+namespace http = boost::beast::http;
+
+namespace {
+
+struct NullSink : ResponseSink {
+    void send(Response&& response) override { benchmark::DoNotOptimize(response); }
+};
+
+void noop(const Request&, const PathParams& params, const Reply&) {
+    benchmark::DoNotOptimize(params.size());
+}
+
+// A route table shaped like the server's: a few control endpoints plus filler.
+Router make_router() {
+    Router router;
+    router.add(http::verb::get, "/", noop);
+    router.add(http::verb::get, "/metrics", noop);
+    router.add(http::verb::get, "/elements/{name}", noop);
+    router.add(http::verb::put, "/elements/{name}/properties/{prop}", noop);
+    router.add(http::verb::post, "/elements/{name}/force-key-unit", noop);
+    router.add(http::verb::get, "/static/*", noop);
+    for (int i = 0; i < 32; ++i) {
+        router.add(http::verb::get, "/api/v1/resource" + std::to_string(i) + "/{id}", noop);
+    }
+    return router;
+}
+
+} // namespace
+
+static void BM_RouterMatch(benchmark::State& state, const char* target) {
+    const Router router = make_router();
+    for (auto _ : state) {
+        const Handler* handler = nullptr;
+        PathParams params;
+        benchmark::DoNotOptimize(router.match(http::verb::put, target, handler, params));
+    }
+}
+BENCHMARK_CAPTURE(BM_RouterMatch, root, "/");
+BENCHMARK_CAPTURE(BM_RouterMatch, two_params, "/elements/encode/properties/bitrate");
+BENCHMARK_CAPTURE(BM_RouterMatch, not_found, "/api/v1/unknown/7");
+
+// Full dispatch, including building a small string response.
+static void BM_RouterDispatch(benchmark::State& state) {
+    Router router = make_router();
+    router.add(http::verb::get, "/hello", [](const Request&, const PathParams&, const Reply& reply) {
+        reply(Response::text(http::status::ok, "Hello, World!"));
+    });
+    const Request req{http::verb::get, "/hello", 11};
+    const Reply reply(std::make_shared<NullSink>());
+    for (auto _ : state) {
+        router.dispatch(req, reply);
+    }
+}
+BENCHMARK(BM_RouterDispatch);
@@ -0,0 +1,16 @@
+#pragma once
+#include <future>
+#include <memory>
+#include "gstreamer/gst_pipeline.hpp"
+
+// Destroys `pipeline` on its own main context and waits until it is gone: a
+// wrapper may only be destroyed from its loop while that loop is running.
+inline void destroy_on_loop(std::unique_ptr<GstPipelineWrapper> pipeline) {
+    std::promise<void> destroyed;
+    GstPipelineWrapper* raw = pipeline.release();
+    raw->invoke([raw, &destroyed] {
+        delete raw;
+        destroyed.set_value();
+    });
+    destroyed.get_future().wait();
+}
@@ -0,0 +1,55 @@
+#include "latency_histogram.hpp"
+#include <algorithm>
+#include <cmath>
+
+LatencyHistogram::LatencyHistogram() : counts_(index(~std::uint64_t{0}) + 1) {}
+
+std::size_t LatencyHistogram::index(std::uint64_t ns) {
+    // Below 2 * kSubBuckets every value has its own bucket.
+    if (ns < 2 * kSubBuckets) {
+        return ns;
+    }
+    // Keep the top kSubBucketBits + 1 bits: ns >> shift is in [kSubBuckets, 2 * kSubBuckets).
+    const int shift = 63 - __builtin_clzll(ns) - kSubBucketBits;
+    return shift * kSubBuckets + (ns >> shift);
+}
+
+std::uint64_t LatencyHistogram::highest_in(std::size_t index) {
+    if (index < 2 * kSubBuckets) {
+        return index;
+    }
+    const std::size_t shift = index / kSubBuckets - 1;
+    const std::uint64_t top = index - shift * kSubBuckets;
+    return ((top + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(std::uint64_t ns) {
+    ++counts_[index(ns)];
+    ++count_;
+    sum_ += ns;
+    max_ = std::max(max_, ns);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (std::size_t i = 0; i < counts_.size(); ++i) {
+        counts_[i] += other.counts_[i];
+    }
+    count_ += other.count_;
+    sum_ += other.sum_;
+    max_ = std::max(max_, other.max_);
+}
+
+std::uint64_t LatencyHistogram::percentile(double q) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    const auto rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(q * count_)));
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < counts_.size(); ++i) {
+        seen += counts_[i];
+        if (seen >= rank) {
+            return std::min(highest_in(i), max_);
+        }
+    }
+    return max_;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Log-linear latency histogram in the style of HdrHistogram: every power of two
+// is split into kSubBuckets linear buckets, so any recorded value is known to
+// within 1/kSubBuckets (under 1%) whatever its magnitude. Values are nanoseconds.
+class LatencyHistogram {
+public:
+    static constexpr int kSubBucketBits = 7;
+    static constexpr std::uint64_t kSubBuckets = std::uint64_t{1} << kSubBucketBits;
+
+    LatencyHistogram();
+
+    void record(std::uint64_t ns);
+    void merge(const LatencyHistogram& other);
+
+    std::uint64_t count() const { return count_; }
+    std::uint64_t max() const { return max_; }
+    double mean() const { return count_ ? static_cast<double>(sum_) / count_ : 0; }
+    // Highest value of the bucket holding the `q` quantile (0 < q <= 1).
+    std::uint64_t percentile(double q) const;
+
+private:
+    static std::size_t index(std::uint64_t ns);
+    static std::uint64_t highest_in(std::size_t index);
+
+    std::vector<std::uint64_t> counts_;
+    std::uint64_t count_ = 0;
+    std::uint64_t sum_ = 0;
+    std::uint64_t max_ = 0;
+};
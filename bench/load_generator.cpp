@@ -0,0 +1,148 @@
+#include "load_generator.hpp"
+#include <boost/asio.hpp>
+#include <boost/beast.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <thread>
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+using tcp = boost::asio::ip::tcp;
+using Clock = std::chrono::steady_clock;
+
+std::string LoadResult::json() const {
+    char out[512];
+    std::snprintf(out, sizeof out,
+                  "{\"requests\":%llu,\"errors\":%llu,\"seconds\":%.3f,\"throughput\":%.1f,"
+                  "\"latency_us\":{\"mean\":%.1f,\"p50\":%.1f,\"p90\":%.1f,\"p99\":%.1f,\"p999\":%.1f,\"max\":%.1f}}",
+                  static_cast<unsigned long long>(requests), static_cast<unsigned long long>(errors), seconds,
+                  throughput(), latency.mean() / 1e3, latency.percentile(0.50) / 1e3,
+                  latency.percentile(0.90) / 1e3, latency.percentile(0.99) / 1e3,
+                  latency.percentile(0.999) / 1e3, latency.max() / 1e3);
+    return out;
+}
+
+namespace {
+
+// One keep-alive connection, run by a single client thread. Sends a request,
+// waits for the reply, records its latency and moves on to the next one.
+class Connection {
+public:
+    Connection(boost::asio::io_context& ioc, const LoadOptions& options, LoadResult& result)
+        : socket_(ioc), timer_(ioc), result_(result) {
+        socket_.connect(options.endpoint);
+        socket_.set_option(tcp::no_delay(true));
+        request_ = {http::verb::get, options.target, 11};
+        request_.set(http::field::host, options.endpoint.address().to_string());
+    }
+
+    // `interval` is zero in a closed loop.
+    void start(Clock::time_point first_due, Clock::duration interval, Clock::time_point end) {
+        due_ = first_due;
+        interval_ = interval;
+        end_ = end;
+        wait_until_due();
+    }
+
+private:
+    void wait_until_due() {
+        if (due_ >= end_) {
+            beast::error_code ec;
+            socket_.shutdown(tcp::socket::shutdown_both, ec);
+            return;
+        }
+        if (due_ <= Clock::now()) {
+            send();
+            return;
+        }
+        timer_.expires_at(due_);
+        timer_.async_wait([this](beast::error_code) { send(); });
+    }
+
+    void send() {
+        if (interval_ == Clock::duration::zero()) {
+            due_ = Clock::now();
+        }
+        http::async_write(socket_, request_, [this](beast::error_code ec, std::size_t) {
+            if (ec) {
+                ++result_.errors;
+                return;
+            }
+            response_ = {};
+            http::async_read(socket_, buffer_, response_, [this](beast::error_code ec, std::size_t) {
+                if (ec) {
+                    ++result_.errors;
+                    return;
+                }
+                const auto now = Clock::now();
+                result_.latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(now - due_).count());
+                ++result_.requests;
+                if (response_.result_int() / 100 != 2) {
+                    ++result_.errors;
+                }
+                // Late requests go out right away, but keep their schedule.
+                due_ = interval_ == Clock::duration::zero() ? now : due_ + interval_;
+                wait_until_due();
+            });
+        });
+    }
+
+    tcp::socket socket_;
+    boost::asio::steady_timer timer_;
+    LoadResult& result_;
+    http::request<http::empty_body> request_;
+    http::response<http::string_body> response_;
+    beast::flat_buffer buffer_;
+    Clock::time_point due_;
+    Clock::duration interval_{};
+    Clock::time_point end_;
+};
+
+} // namespace
+
+LoadResult run_load(const LoadOptions& options) {
+    const std::size_t threads = std::max<std::size_t>(1, std::min(options.threads, options.connections));
+    std::vector<std::unique_ptr<boost::asio::io_context>> contexts;
+    std::vector<LoadResult> partial(threads);
+    std::vector<std::vector<std::unique_ptr<Connection>>> connections(threads);
+    for (std::size_t t = 0; t < threads; ++t) {
+        contexts.push_back(std::make_unique<boost::asio::io_context>(1));
+    }
+    // Connect everything up front, so that connection setup is not measured.
+    for (std::size_t c = 0; c < options.connections; ++c) {
+        const auto t = c % threads;
+        connections[t].push_back(std::make_unique<Connection>(*contexts[t], options, partial[t]));
+    }
+
+    // In an open loop each connection carries its share of the rate, offset so
+    // that the requests of all connections are evenly spread.
+    Clock::duration interval{};
+    if (options.requests_per_second > 0) {
+        interval = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(options.connections / options.requests_per_second));
+    }
+    const auto start = Clock::now() + std::chrono::milliseconds(10);
+    const auto end = start + options.duration;
+    for (std::size_t c = 0; c < options.connections; ++c) {
+        const auto offset = interval * c / options.connections;
+        connections[c % threads][c / threads]->start(start + offset, interval, end);
+    }
+
+    std::vector<std::thread> runners;
+    for (auto& ioc : contexts) {
+        runners.emplace_back([&ioc] { ioc->run(); });
+    }
+    for (auto& runner : runners) {
+        runner.join();
+    }
+
+    LoadResult result;
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    for (const auto& part : partial) {
+        result.requests += part.requests;
+        result.errors += part.errors;
+        result.latency.merge(part.latency);
+    }
+    return result;
+}
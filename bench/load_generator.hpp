@@ -0,0 +1,39 @@
+#pragma once
+#include <boost/asio/ip/tcp.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "latency_histogram.hpp"
+
+struct LoadOptions {
+    boost::asio::ip::tcp::endpoint endpoint;
+    std::string target = "/";
+    // Keep-alive connections, opened before the clock starts.
+    std::size_t connections = 64;
+    // Client threads, each running its share of the connections.
+    std::size_t threads = 1;
+    // 0 runs a closed loop: each connection sends its next request as soon as
+    // the previous reply is in. Otherwise an open loop: requests are due at
+    // this total rate, spread evenly over the connections, and latency is
+    // counted from when a request was due rather than from when it could be
+    // sent, so a stalled server is not hidden by the client waiting on it.
+    double requests_per_second = 0;
+    std::chrono::milliseconds duration{1000};
+};
+
+struct LoadResult {
+    std::uint64_t requests = 0;
+    // Replies other than 2xx, and connections that failed.
+    std::uint64_t errors = 0;
+    double seconds = 0;
+    LatencyHistogram latency;
+
+    double throughput() const { return seconds > 0 ? requests / seconds : 0; }
+    // {"requests":..,"errors":..,"seconds":..,"throughput":..,"latency_us":{"p50":..,...}}
+    std::string json() const;
+};
+
+// Drives an HTTP server with keep-alive GETs on `options.target` and records
+// the latency of every reply.
+LoadResult run_load(const LoadOptions& options);
@@ -1,5 +1,10 @@
 #include <gst/gst.h>
 #include <gst/base/gstbasetransform.h>
+#include <gst/video/video.h>
+#include <gst/video/gstvideometa.h>
+#include <gst/video/gstvideopool.h>
+#include "mypassthrough_slices.h"
+#include "mypassthrough_stats.h"
 
 /* =======================
  *  Déclarations “boilerplate”
@@ -12,57 +17,617 @@ G_DECLARE_FINAL_TYPE(GstMyPass, gst_my_pass,
 struct _GstMyPass
 {
   GstBaseTransform parent;
-  /* Pas d’état interne pour un simple pass-through */
+
+  /* Protège les propriétés et les coefficients dérivés */
+  GMutex lock;
+  gdouble brightness;
+  gdouble contrast;
+  gdouble gain;
+  gdouble matrix[9];
+  MyPassKernelKind kernel_kind;
+  guint n_threads;
+
+  /* Dérivés : recalculés à chaque changement de propriété ou de caps */
+  const MyPassKernels *kernels;
+  MyPassParams params;
+  GstVideoInfo info;
+  gboolean have_info;
+
+  /* Workers créés dans start, détruits dans stop ; utilisé seulement
+   * depuis le thread de streaming */
+  MyPassSlicePool *pool;
+
+  /* Frames qu'il a fallu copier pour écrire en place (atomique) */
+  gint copies;
+
+  /* Mode mesure (atomique) et compteurs par thread, lus sans verrou */
+  gint measure;
+  MyPassStats *stats;
+};
+
+/* Catégorie propre à l'élément : GST_DEBUG=mypassthrough:5. Dans
+ * l'application, gst_log_bridge la fait passer par le logger asynchrone,
+ * le thread de streaming ne fait alors qu'enregistrer le message. */
+GST_DEBUG_CATEGORY_STATIC(gst_my_pass_debug);
+#define GST_CAT_DEFAULT gst_my_pass_debug
+
+G_DEFINE_TYPE_WITH_CODE(GstMyPass, gst_my_pass, GST_TYPE_BASE_TRANSFORM,
+                        GST_DEBUG_CATEGORY_INIT(gst_my_pass_debug, "mypassthrough", 0,
+                                                "Filtre vidéo en place"))
+
+enum
+{
+  PROP_0,
+  PROP_BRIGHTNESS,
+  PROP_CONTRAST,
+  PROP_GAIN,
+  PROP_COLOR_MATRIX,
+  PROP_KERNEL,
+  PROP_N_THREADS,
+  PROP_COPIES,
+  PROP_MEASURE,
+  PROP_STATS,
 };
 
-G_DEFINE_TYPE(GstMyPass, gst_my_pass, GST_TYPE_BASE_TRANSFORM)
+#define DEFAULT_BRIGHTNESS 0.0
+#define DEFAULT_CONTRAST 1.0
+#define DEFAULT_GAIN 1.0
+#define DEFAULT_N_THREADS 1
+
+/* Alignement des lignes et de la mémoire proposé en amont (masque, 32 octets) */
+#define MY_PASS_ALIGN 31
+
+#define GST_TYPE_MY_PASS_KERNEL (gst_my_pass_kernel_get_type())
+static GType
+gst_my_pass_kernel_get_type(void)
+{
+  static gsize type = 0;
+  static const GEnumValue values[] = {
+      {MY_PASS_KERNEL_AUTO, "Meilleure variante pour ce CPU", "auto"},
+      {MY_PASS_KERNEL_SCALAR, "Scalaire", "scalar"},
+      {MY_PASS_KERNEL_SSE4, "SSE4.1", "sse4"},
+      {MY_PASS_KERNEL_AVX2, "AVX2", "avx2"},
+      {0, NULL, NULL}};
+  if (g_once_init_enter(&type))
+    g_once_init_leave(&type, g_enum_register_static("GstMyPassKernel", values));
+  return (GType)type;
+}
+
+/* =======================
+ *  Coefficients et passthrough
+ * ======================= */
+
+/* À appeler avec self->lock. Recalcule les coefficients et bascule en
+ * passthrough quand rien ne change pour le format négocié : dans ce cas
+ * transform_ip n'est même pas appelée. */
+static void
+gst_my_pass_update(GstMyPass *self)
+{
+  gdouble kr = 0.299, kb = 0.114; /* BT.601 par défaut */
+  if (self->have_info && GST_VIDEO_INFO_IS_YUV(&self->info))
+    gst_video_color_matrix_get_Kr_Kb(self->info.colorimetry.matrix, &kr, &kb);
+
+  my_pass_params_compute(&self->params, self->brightness, self->contrast,
+                         self->gain, self->matrix, kr, kb);
+  self->kernels = my_pass_kernels_get(self->kernel_kind);
+
+  gboolean identity;
+  if (!self->have_info)
+    identity = self->params.luma_identity && self->params.chroma_identity && self->params.rgb_identity;
+  else if (GST_VIDEO_INFO_IS_RGB(&self->info))
+    identity = self->params.rgb_identity;
+  else
+    identity = self->params.luma_identity && self->params.chroma_identity;
+
+  gst_base_transform_set_passthrough(GST_BASE_TRANSFORM(self), identity);
+}
 
 /* =======================
  *  Fonction de traitement
  * ======================= */
 
-/* Transform in-place : on ne touche pas au buffer */
+static gboolean
+gst_my_pass_set_caps(GstBaseTransform *base, GstCaps *incaps, GstCaps *outcaps)
+{
+  GstMyPass *self = GST_MY_PASS(base);
+  GstVideoInfo info;
+
+  if (!gst_video_info_from_caps(&info, incaps))
+    return FALSE;
+
+  g_mutex_lock(&self->lock);
+  self->info = info;
+  self->have_info = TRUE;
+  gst_my_pass_update(self);
+  g_mutex_unlock(&self->lock);
+
+  GST_DEBUG_OBJECT(self, "format %s, noyaux %s",
+                   GST_VIDEO_INFO_NAME(&info), self->kernels->name);
+  return TRUE;
+}
+
+/* =======================
+ *  Allocation
+ * ======================= */
+
+/* Propose à l'amont de quoi produire des frames écrivables et alignées
+ * pour les noyaux SIMD. `decide_query` est la réponse de l'aval : le
+ * buffer lui est transmis tel quel, on relaie donc ce qu'il accepte. */
+static gboolean
+gst_my_pass_propose_allocation(GstBaseTransform *base, GstQuery *decide_query, GstQuery *query)
+{
+  GstMyPass *self = GST_MY_PASS(base);
+  GstCaps *caps;
+  gboolean need_pool;
+  GstVideoInfo info;
+
+  /* Passthrough : la classe de base relaie la requête vers l'aval ;
+   * sinon elle recopie les métas acceptées par l'aval */
+  if (!GST_BASE_TRANSFORM_CLASS(gst_my_pass_parent_class)->propose_allocation(base, decide_query, query))
+    return FALSE;
+  if (decide_query == NULL)
+    return TRUE;
+
+  const gboolean video_meta =
+      gst_query_find_allocation_meta(decide_query, GST_VIDEO_META_API_TYPE, NULL);
+  GST_DEBUG_OBJECT(self, "GstVideoMeta en aval : %s", video_meta ? "oui" : "non");
+
+  gst_query_parse_allocation(query, &caps, &need_pool);
+  if (caps == NULL || !gst_video_info_from_caps(&info, caps))
+    return TRUE;
+
+  GstAllocationParams params;
+  gst_allocation_params_init(&params);
+  params.align = MY_PASS_ALIGN;
+  gst_query_add_allocation_param(query, NULL, &params);
+
+  if (!need_pool)
+    return TRUE;
+
+  /* Mêmes caps des deux côtés : un pool de l'aval convient tel quel */
+  for (guint i = 0; i < gst_query_get_n_allocation_pools(decide_query); i++) {
+    GstBufferPool *pool;
+    guint size, min, max;
+    gst_query_parse_nth_allocation_pool(decide_query, i, &pool, &size, &min, &max);
+    gst_query_add_allocation_pool(query, pool, size, min, max);
+    if (pool)
+      gst_object_unref(pool);
+  }
+  if (gst_query_get_n_allocation_pools(query) > 0)
+    return TRUE;
+
+  GstBufferPool *pool = gst_video_buffer_pool_new();
+  GstStructure *config = gst_buffer_pool_get_config(pool);
+  gst_buffer_pool_config_set_params(config, caps, info.size, 0, 0);
+  gst_buffer_pool_config_set_allocator(config, NULL, &params);
+  if (video_meta) {
+    /* Lignes alignées : possible seulement si l'aval lit les strides */
+    GstVideoAlignment align;
+    gst_video_alignment_reset(&align);
+    for (guint i = 0; i < GST_VIDEO_MAX_PLANES; i++)
+      align.stride_align[i] = MY_PASS_ALIGN;
+    gst_buffer_pool_config_add_option(config, GST_BUFFER_POOL_OPTION_VIDEO_META);
+    gst_buffer_pool_config_add_option(config, GST_BUFFER_POOL_OPTION_VIDEO_ALIGNMENT);
+    gst_buffer_pool_config_set_video_alignment(config, &align);
+  }
+  if (!gst_buffer_pool_set_config(pool, config)) {
+    GST_WARNING_OBJECT(self, "configuration du pool refusée");
+    gst_object_unref(pool);
+    return TRUE;
+  }
+
+  /* L'alignement a pu agrandir les buffers : on relit la taille retenue */
+  guint size;
+  config = gst_buffer_pool_get_config(pool);
+  gst_buffer_pool_config_get_params(config, NULL, &size, NULL, NULL);
+  gst_structure_free(config);
+
+  gst_query_add_allocation_pool(query, pool, size, 0, 0);
+  gst_object_unref(pool);
+  return TRUE;
+}
+
+/* En mode in-place la classe de base n'interroge jamais l'aval (pas de
+ * decide_allocation) et refuse donc la requête d'allocation hors
+ * passthrough : l'amont retombe sur l'allocation par défaut. On fait
+ * nous-mêmes la requête vers l'aval avant de proposer. */
+static gboolean
+gst_my_pass_query(GstBaseTransform *base, GstPadDirection direction, GstQuery *query)
+{
+  if (direction != GST_PAD_SINK || GST_QUERY_TYPE(query) != GST_QUERY_ALLOCATION
+      || gst_base_transform_is_passthrough(base))
+    return GST_BASE_TRANSFORM_CLASS(gst_my_pass_parent_class)->query(base, direction, query);
+
+  GstCaps *caps;
+  gboolean need_pool;
+  gst_query_parse_allocation(query, &caps, &need_pool);
+
+  GstQuery *decide_query = gst_query_new_allocation(caps, need_pool);
+  if (!gst_pad_peer_query(GST_BASE_TRANSFORM_SRC_PAD(base), decide_query))
+    GST_DEBUG_OBJECT(base, "l'aval ne répond pas à la requête d'allocation");
+
+  gboolean ret = gst_my_pass_propose_allocation(base, decide_query, query);
+  gst_query_unref(decide_query);
+  return ret;
+}
+
+/* Rend le buffer d'entrée écrivable en comptant chaque copie cachée :
+ * un buffer partagé (tee, file d'attente amont...) oblige à copier la frame. */
+static GstFlowReturn
+gst_my_pass_prepare_output_buffer(GstBaseTransform *base, GstBuffer *inbuf, GstBuffer **outbuf)
+{
+  GstMyPass *self = GST_MY_PASS(base);
+
+  if (gst_base_transform_is_passthrough(base)) {
+    *outbuf = inbuf;
+    return GST_FLOW_OK;
+  }
+
+  *outbuf = gst_buffer_make_writable(inbuf);
+  /* Des mémoires encore partagées seront dupliquées au mapping en écriture */
+  if (*outbuf != inbuf || !gst_buffer_is_all_memory_writable(*outbuf)) {
+    g_atomic_int_inc(&self->copies);
+    GST_DEBUG_OBJECT(self, "buffer non écrivable : copie de la frame");
+  }
+  return GST_FLOW_OK;
+}
+
+static gboolean
+gst_my_pass_start(GstBaseTransform *base)
+{
+  GstMyPass *self = GST_MY_PASS(base);
+
+  g_mutex_lock(&self->lock);
+  guint n = self->n_threads ? self->n_threads : g_get_num_processors();
+  g_mutex_unlock(&self->lock);
+
+  self->pool = my_pass_slice_pool_new(n);
+  g_atomic_int_set(&self->copies, 0);
+  my_pass_stats_reset(self->stats);
+  GST_DEBUG_OBJECT(self, "%u thread(s) de traitement", n);
+  return TRUE;
+}
+
+static gboolean
+gst_my_pass_stop(GstBaseTransform *base)
+{
+  GstMyPass *self = GST_MY_PASS(base);
+
+  my_pass_slice_pool_free(self->pool);
+  self->pool = NULL;
+  GST_INFO_OBJECT(self, "arrêt après %u copie(s)", (guint) g_atomic_int_get(&self->copies));
+  return TRUE;
+}
+
+/* =======================
+ *  Mesures
+ * ======================= */
+
+/* Appelée pour chaque buffer, passthrough compris (contrairement à
+ * transform_ip). Sans verrou de l'élément : seules l'horloge et le
+ * base-time prennent brièvement le verrou d'objet. */
+static void
+gst_my_pass_before_transform(GstBaseTransform *base, GstBuffer *buf)
+{
+  GstMyPass *self = GST_MY_PASS(base);
+
+  if (!g_atomic_int_get(&self->measure))
+    return;
+
+  const gint64 arrival = (gint64)gst_util_get_timestamp();
+  gint64 lag = MY_PASS_STATS_NO_LAG;
+
+  const GstClockTime running =
+      gst_segment_to_running_time(&base->segment, GST_FORMAT_TIME, GST_BUFFER_PTS(buf));
+  GstClock *clock = gst_element_get_clock(GST_ELEMENT(base));
+  if (clock != NULL) {
+    const GstClockTime now = gst_clock_get_time(clock);
+    const GstClockTime base_time = gst_element_get_base_time(GST_ELEMENT(base));
+    if (GST_CLOCK_TIME_IS_VALID(running) && now >= base_time)
+      lag = GST_CLOCK_DIFF(running, now - base_time);
+    gst_object_unref(clock);
+  }
+
+  my_pass_stats_record(self->stats, arrival, lag, gst_buffer_get_size(buf));
+}
+
+/* Instantané des mesures sous forme de GstStructure */
+static GstStructure *
+gst_my_pass_build_stats(GstMyPass *self)
+{
+  MyPassStatsSnapshot snap;
+  my_pass_stats_snapshot(self->stats, &snap);
+
+  GstStructure *s = gst_structure_new("mypassthrough-stats",
+      "buffers", G_TYPE_UINT64, snap.buffers,
+      "bytes", G_TYPE_UINT64, snap.bytes,
+      "copies", G_TYPE_UINT, (guint)g_atomic_int_get(&self->copies),
+      "interarrival-mean-us", G_TYPE_DOUBLE, snap.interarrival_mean_us,
+      "interarrival-max-us", G_TYPE_DOUBLE, snap.interarrival_max_us,
+      "jitter-us", G_TYPE_DOUBLE, snap.jitter_us,
+      "lag-samples", G_TYPE_UINT64, snap.lag_samples,
+      "lag-mean-us", G_TYPE_DOUBLE, snap.lag_mean_us,
+      "lag-min-us", G_TYPE_INT64, snap.lag_min_us,
+      "lag-max-us", G_TYPE_INT64, snap.lag_max_us,
+      NULL);
+
+  /* Histogramme des tailles : classe i = [2^(i-1), 2^i) octets */
+  GValue histogram = G_VALUE_INIT;
+  gst_value_array_init(&histogram, MY_PASS_STATS_SIZE_BUCKETS);
+  for (guint i = 0; i < MY_PASS_STATS_SIZE_BUCKETS; i++) {
+    GValue v = G_VALUE_INIT;
+    g_value_init(&v, G_TYPE_UINT64);
+    g_value_set_uint64(&v, snap.size_histogram[i]);
+    gst_value_array_append_and_take_value(&histogram, &v);
+  }
+  gst_structure_take_value(s, "size-histogram", &histogram);
+  return s;
+}
+
+/* Ce que chaque worker lit pour traiter sa tranche */
+typedef struct
+{
+  MyPassFrame frame;
+  MyPassParams params;
+  const MyPassKernels *kernels;
+} MyPassJob;
+
+static void
+gst_my_pass_run_slice(gpointer data, gint index, gint n_slices)
+{
+  const MyPassJob *job = (const MyPassJob *)data;
+  my_pass_process_slice(&job->frame, &job->params, job->kernels, index, n_slices);
+}
+
+/* Transform in-place : découpe la frame en tranches horizontales
+ * réparties sur le pool */
 static GstFlowReturn
 gst_my_pass_transform_ip(GstBaseTransform *base, GstBuffer *buf)
 {
-  GST_LOG_OBJECT(base, "buffer passthrough");
+  GstMyPass *self = GST_MY_PASS(base);
+  GstVideoFrame frame;
+  MyPassJob job;
+
+  g_mutex_lock(&self->lock);
+  job.params = self->params;
+  job.kernels = self->kernels;
+  g_mutex_unlock(&self->lock);
+
+  switch (GST_VIDEO_INFO_FORMAT(&self->info)) {
+    case GST_VIDEO_FORMAT_I420:
+      job.frame.layout = MY_PASS_LAYOUT_I420;
+      break;
+    case GST_VIDEO_FORMAT_NV12:
+      job.frame.layout = MY_PASS_LAYOUT_NV12;
+      break;
+    case GST_VIDEO_FORMAT_RGBA:
+      job.frame.layout = MY_PASS_LAYOUT_RGBA;
+      break;
+    default:
+      return GST_FLOW_OK;
+  }
+
+  if (!gst_video_frame_map(&frame, &self->info, buf, GST_MAP_READWRITE)) {
+    GST_ELEMENT_ERROR(self, STREAM, FAILED, (NULL), ("impossible de mapper la frame"));
+    return GST_FLOW_ERROR;
+  }
+
+  job.frame.width = GST_VIDEO_FRAME_WIDTH(&frame);
+  job.frame.height = GST_VIDEO_FRAME_HEIGHT(&frame);
+  for (guint i = 0; i < 3; i++) {
+    const gboolean has_plane = i < GST_VIDEO_FRAME_N_PLANES(&frame);
+    job.frame.data[i] = has_plane ? (guint8 *)GST_VIDEO_FRAME_PLANE_DATA(&frame, i) : NULL;
+    job.frame.stride[i] = has_plane ? GST_VIDEO_FRAME_PLANE_STRIDE(&frame, i) : 0;
+  }
+
+  GST_LOG_OBJECT(self, "frame %" GST_TIME_FORMAT " en %u tranche(s)",
+                 GST_TIME_ARGS(GST_BUFFER_PTS(buf)), my_pass_slice_pool_size(self->pool));
+  my_pass_slice_pool_run(self->pool, gst_my_pass_run_slice, &job);
+
+  gst_video_frame_unmap(&frame);
   return GST_FLOW_OK;
 }
 
+/* =======================
+ *  Propriétés
+ * ======================= */
+
+static void
+gst_my_pass_set_property(GObject *object, guint prop_id, const GValue *value, GParamSpec *pspec)
+{
+  GstMyPass *self = GST_MY_PASS(object);
+
+  g_mutex_lock(&self->lock);
+  switch (prop_id) {
+    case PROP_BRIGHTNESS:
+      self->brightness = g_value_get_double(value);
+      break;
+    case PROP_CONTRAST:
+      self->contrast = g_value_get_double(value);
+      break;
+    case PROP_GAIN:
+      self->gain = g_value_get_double(value);
+      break;
+    case PROP_COLOR_MATRIX:
+      if (gst_value_array_get_size(value) != 9) {
+        g_warning("color-matrix attend 9 valeurs (3x3, ligne par ligne)");
+        break;
+      }
+      for (guint i = 0; i < 9; i++)
+        self->matrix[i] = CLAMP(g_value_get_double(gst_value_array_get_value(value, i)), -2.0, 2.0);
+      break;
+    case PROP_KERNEL:
+      self->kernel_kind = (MyPassKernelKind)g_value_get_enum(value);
+      break;
+    case PROP_N_THREADS:
+      self->n_threads = g_value_get_uint(value);
+      break;
+    case PROP_MEASURE:
+      g_atomic_int_set(&self->measure, g_value_get_boolean(value));
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+      break;
+  }
+  gst_my_pass_update(self);
+  g_mutex_unlock(&self->lock);
+}
+
+static void
+gst_my_pass_get_property(GObject *object, guint prop_id, GValue *value, GParamSpec *pspec)
+{
+  GstMyPass *self = GST_MY_PASS(object);
+
+  /* Compteurs : lus sans self->lock, que transform_ip prend à chaque buffer */
+  switch (prop_id) {
+    case PROP_COPIES:
+      g_value_set_uint(value, (guint)g_atomic_int_get(&self->copies));
+      return;
+    case PROP_MEASURE:
+      g_value_set_boolean(value, g_atomic_int_get(&self->measure));
+      return;
+    case PROP_STATS:
+      g_value_take_boxed(value, gst_my_pass_build_stats(self));
+      return;
+    default:
+      break;
+  }
+
+  g_mutex_lock(&self->lock);
+  switch (prop_id) {
+    case PROP_BRIGHTNESS:
+      g_value_set_double(value, self->brightness);
+      break;
+    case PROP_CONTRAST:
+      g_value_set_double(value, self->contrast);
+      break;
+    case PROP_GAIN:
+      g_value_set_double(value, self->gain);
+      break;
+    case PROP_COLOR_MATRIX:
+      for (guint i = 0; i < 9; i++) {
+        GValue v = G_VALUE_INIT;
+        g_value_init(&v, G_TYPE_DOUBLE);
+        g_value_set_double(&v, self->matrix[i]);
+        gst_value_array_append_and_take_value(value, &v);
+      }
+      break;
+    case PROP_KERNEL:
+      g_value_set_enum(value, self->kernel_kind);
+      break;
+    case PROP_N_THREADS:
+      g_value_set_uint(value, self->n_threads);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+      break;
+  }
+  g_mutex_unlock(&self->lock);
+}
+
+static void
+gst_my_pass_finalize(GObject *object)
+{
+  GstMyPass *self = GST_MY_PASS(object);
+  my_pass_stats_free(self->stats);
+  g_mutex_clear(&self->lock);
+  G_OBJECT_CLASS(gst_my_pass_parent_class)->finalize(object);
+}
+
 /* =======================
  *  Initialisation de la classe
  * ======================= */
 static void
 gst_my_pass_class_init(GstMyPassClass *klass)
 {
+  GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
 
-  /* -------- PAD TEMPLATES : accept “ANY” caps pour un passe-tout -------- */
+  /* -------- PAD TEMPLATES : formats bruts 8 bits traités en place -------- */
   static GstStaticPadTemplate sink_templ = GST_STATIC_PAD_TEMPLATE(
       "sink",               /* nom du pad             */
       GST_PAD_SINK,         /* direction              */
       GST_PAD_ALWAYS,       /* disponibilité          */
-      GST_STATIC_CAPS_ANY); /* nous acceptons tout    */
+      GST_STATIC_CAPS(GST_VIDEO_CAPS_MAKE("{ I420, NV12, RGBA }")));
 
   static GstStaticPadTemplate src_templ = GST_STATIC_PAD_TEMPLATE(
       "src",
       GST_PAD_SRC,
       GST_PAD_ALWAYS,
-      GST_STATIC_CAPS_ANY);
+      GST_STATIC_CAPS(GST_VIDEO_CAPS_MAKE("{ I420, NV12, RGBA }")));
 
   /* Enregistrement auprès de la classe élément */
   gst_element_class_add_static_pad_template(GST_ELEMENT_CLASS(klass), &sink_templ);
   gst_element_class_add_static_pad_template(GST_ELEMENT_CLASS(klass), &src_templ);
 
-  /* (facultatif mais pratique) : indiquer qu’on est passe-tout */
+  gobject_class->set_property = gst_my_pass_set_property;
+  gobject_class->get_property = gst_my_pass_get_property;
+  gobject_class->finalize = gst_my_pass_finalize;
+
+  g_object_class_install_property(gobject_class, PROP_BRIGHTNESS,
+      g_param_spec_double("brightness", "Luminosité", "Décalage en fraction de la pleine échelle",
+                          -1.0, 1.0, DEFAULT_BRIGHTNESS,
+                          (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_CONTROLLABLE)));
+  g_object_class_install_property(gobject_class, PROP_CONTRAST,
+      g_param_spec_double("contrast", "Contraste", "Facteur autour du milieu de l'échelle",
+                          0.0, 2.0, DEFAULT_CONTRAST,
+                          (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_CONTROLLABLE)));
+  g_object_class_install_property(gobject_class, PROP_GAIN,
+      g_param_spec_double("gain", "Gain", "Facteur multiplicatif du signal",
+                          0.0, 4.0, DEFAULT_GAIN,
+                          (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_CONTROLLABLE)));
+  g_object_class_install_property(gobject_class, PROP_COLOR_MATRIX,
+      gst_param_spec_array("color-matrix", "Matrice couleur",
+                           "Matrice 3x3 en RGB, ligne par ligne, coefficients dans [-2, 2] "
+                           "(en YUV seuls les termes de chroma s'appliquent)",
+                           g_param_spec_double("coefficient", "Coefficient", "Coefficient",
+                                               -2.0, 2.0, 0.0, G_PARAM_STATIC_STRINGS),
+                           (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property(gobject_class, PROP_KERNEL,
+      g_param_spec_enum("kernel", "Noyaux", "Variante SIMD (repli sur la meilleure disponible)",
+                        GST_TYPE_MY_PASS_KERNEL, MY_PASS_KERNEL_AUTO,
+                        (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property(gobject_class, PROP_N_THREADS,
+      g_param_spec_uint("n-threads", "Threads",
+                        "Nombre de tranches traitées en parallèle (0 = un par cœur), "
+                        "pris en compte au démarrage",
+                        0, 64, DEFAULT_N_THREADS,
+                        (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+  g_object_class_install_property(gobject_class, PROP_COPIES,
+      g_param_spec_uint("copies", "Copies",
+                        "Frames copiées depuis le démarrage faute de buffer écrivable",
+                        0, G_MAXUINT, 0,
+                        (GParamFlags)(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property(gobject_class, PROP_MEASURE,
+      g_param_spec_boolean("measure", "Mesure",
+                           "Mesure gigue d'arrivée, retard sur l'horloge et tailles de chaque buffer",
+                           FALSE,
+                           (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property(gobject_class, PROP_STATS,
+      g_param_spec_boxed("stats", "Statistiques",
+                         "Instantané des mesures depuis le démarrage, lisible à tout moment",
+                         GST_TYPE_STRUCTURE,
+                         (GParamFlags)(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
   GstBaseTransformClass *trans_class = GST_BASE_TRANSFORM_CLASS(klass);
-  trans_class->passthrough_on_same_caps = TRUE;
+  /* Les caps sont toujours identiques en entrée et en sortie : c'est
+   * gst_my_pass_update qui décide du passthrough, selon les paramètres. */
+  trans_class->passthrough_on_same_caps = FALSE;
+  /* En passthrough, pas d'appel à transform_ip : coût nul */
+  trans_class->transform_ip_on_passthrough = FALSE;
 
   /* L’élément est en mode in-place, sans changement de taille */
+  trans_class->start = GST_DEBUG_FUNCPTR(gst_my_pass_start);
+  trans_class->stop = GST_DEBUG_FUNCPTR(gst_my_pass_stop);
+  trans_class->set_caps = GST_DEBUG_FUNCPTR(gst_my_pass_set_caps);
+  trans_class->before_transform = GST_DEBUG_FUNCPTR(gst_my_pass_before_transform);
+  trans_class->query = GST_DEBUG_FUNCPTR(gst_my_pass_query);
+  trans_class->propose_allocation = GST_DEBUG_FUNCPTR(gst_my_pass_propose_allocation);
+  trans_class->prepare_output_buffer = GST_DEBUG_FUNCPTR(gst_my_pass_prepare_output_buffer);
   trans_class->transform_ip = GST_DEBUG_FUNCPTR(gst_my_pass_transform_ip);
-  /* Indique qu’on accepte les caps d’entrée en sortie sans modif */
   gst_element_class_set_static_metadata(GST_ELEMENT_CLASS(klass),
-                                        "Passe-tout minimal", "Filter/Effect/Video",
-                                        "Ne fait rien, exemple pédagogique",
+                                        "Filtre vidéo en place", "Filter/Effect/Video",
+                                        "Luminosité, contraste, gain et matrice couleur "
+                                        "(SSE4.1/AVX2), passe-tout à l'identité",
                                         "Votre Nom <vous@exemple.com>");
 }
 
@@ -70,7 +635,23 @@ gst_my_pass_class_init(GstMyPassClass *klass)
  *  Initialisation instance
  * ======================= */
 static void
-gst_my_pass_init(GstMyPass *self) { /* rien à faire */ }
+gst_my_pass_init(GstMyPass *self)
+{
+  g_mutex_init(&self->lock);
+  self->brightness = DEFAULT_BRIGHTNESS;
+  self->contrast = DEFAULT_CONTRAST;
+  self->gain = DEFAULT_GAIN;
+  for (guint i = 0; i < 9; i++)
+    self->matrix[i] = (i % 4 == 0) ? 1.0 : 0.0;
+  self->kernel_kind = MY_PASS_KERNEL_AUTO;
+  self->n_threads = DEFAULT_N_THREADS;
+  self->pool = NULL;
+  self->copies = 0;
+  self->measure = FALSE;
+  self->stats = my_pass_stats_new();
+  self->have_info = FALSE;
+  gst_my_pass_update(self);
+}
 
 /* =======================
  *  Point d’entrée du plugin
@@ -95,7 +676,7 @@ plugin_init(GstPlugin *plugin)
 GST_PLUGIN_DEFINE(GST_VERSION_MAJOR,
                   GST_VERSION_MINOR,
                   mypassthrough,               /* nom interne */
-                  "Plugin passe-tout minimal", /* description */
+                  "Plugin de filtre vidéo en place", /* description */
                   plugin_init,
                   "1.0", /* version */
                   "LGPL",
@@ -0,0 +1,185 @@
+#include "mypassthrough_kernels.h"
+#include <cmath>
+
+/* =======================
+ *  Calcul des coefficients
+ * ======================= */
+
+/* Bornes qui garantissent qu'aucune somme Q16 ne déborde d'un gint32. */
+#define MY_PASS_MAX_COEF 32.0
+#define MY_PASS_MAX_OFFSET 2048.0
+
+static gint32
+to_q16(gdouble v, gdouble bound)
+{
+  v = CLAMP(v, -bound, bound);
+  return (gint32) std::lround(v * 65536.0);
+}
+
+static void
+invert3(const gdouble m[3][3], gdouble out[3][3])
+{
+  gdouble det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+      - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+      + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+  for (int i = 0; i < 3; i++)
+    for (int j = 0; j < 3; j++) {
+      /* cofacteur(j, i) */
+      int r0 = (j + 1) % 3, r1 = (j + 2) % 3, c0 = (i + 1) % 3, c1 = (i + 2) % 3;
+      out[i][j] = (m[r0][c0] * m[r1][c1] - m[r0][c1] * m[r1][c0]) / det;
+    }
+}
+
+void
+my_pass_params_compute(MyPassParams *p, gdouble brightness, gdouble contrast,
+    gdouble gain, const gdouble matrix[9], gdouble kr, gdouble kb)
+{
+  /* Par canal : x' = a * x + b, pivot du contraste au milieu de l'échelle */
+  const gdouble a = gain * contrast;
+  const gdouble b = gain * (128.0 - 128.0 * contrast) + 255.0 * brightness;
+
+  gdouble m[3][3];
+  gboolean matrix_identity = TRUE;
+  for (int i = 0; i < 3; i++)
+    for (int j = 0; j < 3; j++) {
+      m[i][j] = matrix[i * 3 + j];
+      if (m[i][j] != (i == j ? 1.0 : 0.0))
+        matrix_identity = FALSE;
+    }
+  const gboolean affine_identity = a == 1.0 && b == 0.0;
+
+  /* ---- Luma ---- */
+  p->luma_a = to_q16(a, MY_PASS_MAX_COEF);
+  p->luma_b = to_q16(b, MY_PASS_MAX_OFFSET) + 32768;
+  p->luma_identity = affine_identity;
+
+  /* ---- RGBA : M * (a x + b) ---- */
+  for (int i = 0; i < 3; i++) {
+    gdouble row_sum = 0.0;
+    for (int j = 0; j < 3; j++) {
+      p->rgb_m[i][j] = to_q16(m[i][j] * a, MY_PASS_MAX_COEF);
+      row_sum += m[i][j];
+    }
+    p->rgb_off[i] = to_q16(row_sum * b, MY_PASS_MAX_OFFSET) + 32768;
+  }
+  p->rgb_identity = affine_identity && matrix_identity;
+
+  /* ---- Chroma : bloc CbCr de T * M * T^-1, mis à l'échelle par a ---- */
+  const gdouble kg = 1.0 - kr - kb;
+  const gdouble t[3][3] = {
+    {kr, kg, kb},
+    {-kr / (2.0 * (1.0 - kb)), -kg / (2.0 * (1.0 - kb)), 0.5},
+    {0.5, -kg / (2.0 * (1.0 - kr)), -kb / (2.0 * (1.0 - kr))},
+  };
+  gdouble t_inv[3][3], tm[3][3], yuv[3][3];
+  invert3(t, t_inv);
+  for (int i = 0; i < 3; i++)
+    for (int j = 0; j < 3; j++) {
+      tm[i][j] = 0.0;
+      for (int k = 0; k < 3; k++)
+        tm[i][j] += t[i][k] * m[k][j];
+    }
+  for (int i = 0; i < 3; i++)
+    for (int j = 0; j < 3; j++) {
+      yuv[i][j] = 0.0;
+      for (int k = 0; k < 3; k++)
+        yuv[i][j] += tm[i][k] * t_inv[k][j];
+    }
+  for (int i = 0; i < 2; i++) {
+    for (int j = 0; j < 2; j++)
+      p->chroma_m[i][j] = to_q16(yuv[i + 1][j + 1] * a, MY_PASS_MAX_COEF);
+    /* Chroma centrée sur 128 : le décalage est replié dans l'offset */
+    p->chroma_off[i] = (128 << 16) - 128 * (p->chroma_m[i][0] + p->chroma_m[i][1]) + 32768;
+  }
+  p->chroma_identity = a == 1.0 && matrix_identity;
+}
+
+/* =======================
+ *  Variante scalaire(référence)
+ * ======================= */
+
+static void
+luma_scalar(guint8 *row, gint n, const MyPassParams *p)
+{
+  for (gint i = 0; i < n; i++)
+    row[i] = my_pass_clamp_q16(row[i] * p->luma_a + p->luma_b);
+}
+
+static void
+chroma_planar_scalar(guint8 *u, guint8 *v, gint n, const MyPassParams *p)
+{
+  for (gint i = 0; i < n; i++) {
+    const gint32 cu = u[i], cv = v[i];
+    u[i] = my_pass_clamp_q16(p->chroma_m[0][0] * cu + p->chroma_m[0][1] * cv + p->chroma_off[0]);
+    v[i] = my_pass_clamp_q16(p->chroma_m[1][0] * cu + p->chroma_m[1][1] * cv + p->chroma_off[1]);
+  }
+}
+
+static void
+chroma_interleaved_scalar(guint8 *uv, gint n, const MyPassParams *p)
+{
+  for (gint i = 0; i < n; i++) {
+    const gint32 cu = uv[2 * i], cv = uv[2 * i + 1];
+    uv[2 * i] = my_pass_clamp_q16(p->chroma_m[0][0] * cu + p->chroma_m[0][1] * cv + p->chroma_off[0]);
+    uv[2 * i + 1] = my_pass_clamp_q16(p->chroma_m[1][0] * cu + p->chroma_m[1][1] * cv + p->chroma_off[1]);
+  }
+}
+
+static void
+rgba_scalar(guint8 *row, gint n, const MyPassParams *p)
+{
+  for (gint i = 0; i < n; i++) {
+    guint8 *px = row + 4 * i;
+    const gint32 r = px[0], g = px[1], b = px[2];
+    for (int c = 0; c < 3; c++)
+      px[c] = my_pass_clamp_q16(p->rgb_m[c][0] * r + p->rgb_m[c][1] * g
+          + p->rgb_m[c][2] * b + p->rgb_off[c]);
+  }
+}
+
+const MyPassKernels my_pass_kernels_scalar = {
+  "scalar",
+  luma_scalar,
+  chroma_planar_scalar,
+  chroma_interleaved_scalar,
+  rgba_scalar,
+};
+
+/* =======================
+ *  Sélection à l'exécution
+ * ======================= */
+
+gboolean
+my_pass_kernels_supported(MyPassKernelKind kind)
+{
+  switch (kind) {
+    case MY_PASS_KERNEL_AUTO:
+    case MY_PASS_KERNEL_SCALAR:
+      return TRUE;
+#if defined(MY_PASS_HAVE_X86)
+    case MY_PASS_KERNEL_SSE4:
+      return __builtin_cpu_supports("sse4.1");
+    case MY_PASS_KERNEL_AVX2:
+      return __builtin_cpu_supports("avx2");
+#endif
+    default:
+      return FALSE;
+  }
+}
+
+const MyPassKernels *
+my_pass_kernels_get(MyPassKernelKind kind)
+{
+#if defined(MY_PASS_HAVE_X86)
+  if ((kind == MY_PASS_KERNEL_AUTO || kind == MY_PASS_KERNEL_AVX2)
+      && my_pass_kernels_supported(MY_PASS_KERNEL_AVX2))
+    return &my_pass_kernels_avx2;
+  if ((kind == MY_PASS_KERNEL_AUTO || kind == MY_PASS_KERNEL_AVX2
+          || kind == MY_PASS_KERNEL_SSE4)
+      && my_pass_kernels_supported(MY_PASS_KERNEL_SSE4))
+    return &my_pass_kernels_sse4;
+#else
+  (void) kind;
+#endif
+  return &my_pass_kernels_scalar;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <glib.h>
+
+/* =======================
+ *  Noyaux de traitement vidéo en place(8 bits)
+ * =======================
+ *
+ * Tous les calculs sont en virgule fixe Q16 sur des entiers 32 bits, avec
+ * exactement la même formule dans chaque variante : le résultat est
+ * identique au bit près entre scalaire, SSE4.1 et AVX2.
+ */
+
+typedef struct
+{
+  /* Luma (I420, NV12) : y' = (y * luma_a + luma_b) >> 16 */
+  gint32 luma_a, luma_b;
+  /* Chroma centrée : [u' v'] = chroma_m * [u v] + chroma_off, puis >> 16 */
+  gint32 chroma_m[2][2];
+  gint32 chroma_off[2];
+  /* RGBA : [r' g' b'] = rgb_m * [r g b] + rgb_off, puis >> 16 ; alpha intact */
+  gint32 rgb_m[3][3];
+  gint32 rgb_off[3];
+
+  gboolean luma_identity;
+  gboolean chroma_identity;
+  gboolean rgb_identity;
+} MyPassParams;
+
+/* Une variante des noyaux. Chaque fonction traite une ligne de `n` pixels. */
+typedef struct
+{
+  const char *name;
+  void (*luma)(guint8 *row, gint n, const MyPassParams *p);
+  /* I420 : plans U et V séparés */
+  void (*chroma_planar)(guint8 *u, guint8 *v, gint n, const MyPassParams *p);
+  /* NV12 : paires UV entrelacées, `n` paires */
+  void (*chroma_interleaved)(guint8 *uv, gint n, const MyPassParams *p);
+  void (*rgba)(guint8 *row, gint n, const MyPassParams *p);
+} MyPassKernels;
+
+typedef enum
+{
+  MY_PASS_KERNEL_AUTO,
+  MY_PASS_KERNEL_SCALAR,
+  MY_PASS_KERNEL_SSE4,
+  MY_PASS_KERNEL_AVX2,
+} MyPassKernelKind;
+
+/* Calcule les coefficients à partir des propriétés de l'élément.
+ * `matrix` est une matrice 3x3 en RGB(ligne par ligne). Pour les formats YUV
+ * elle est ramenée en Y'CbCr avec `kr`/`kb` ; seuls les termes chroma-chroma
+ * sont gardés, ce qui est exact pour les matrices qui préservent la luma
+ * (saturation, rotation de teinte). */
+void my_pass_params_compute(MyPassParams *p, gdouble brightness, gdouble contrast,
+    gdouble gain, const gdouble matrix[9], gdouble kr, gdouble kb);
+
+/* Variante demandée si le CPU la supporte, sinon la meilleure disponible
+ * (AUTO : détection à l'exécution). Ne retourne jamais NULL. */
+const MyPassKernels *my_pass_kernels_get(MyPassKernelKind kind);
+
+/* Vrai si `kind` peut tourner sur ce CPU. */
+gboolean my_pass_kernels_supported(MyPassKernelKind kind);
+
+extern const MyPassKernels my_pass_kernels_scalar;
+#if defined(MY_PASS_HAVE_X86)
+extern const MyPassKernels my_pass_kernels_sse4;
+extern const MyPassKernels my_pass_kernels_avx2;
+#endif
+
+/* Sature vers [0, 255] le résultat Q16 d'une combinaison linéaire. */
+static inline guint8
+my_pass_clamp_q16(gint32 v)
+{
+  v >>= 16;
+  return (guint8) (v < 0 ? 0 : (v > 255 ? 255 : v));
+}
@@ -0,0 +1,127 @@
+/* Compilé avec -mavx2 ; appelé seulement si le CPU le supporte. */
+#include "mypassthrough_kernels.h"
+#include <immintrin.h>
+
+#define Q16(v) _mm256_srai_epi32((v), 16)
+
+/* Élargit 32 octets en 4 vecteurs de 8 x gint32 */
+static inline void
+widen32(const guint8 *src, __m256i out[4])
+{
+  for (int k = 0; k < 4; k++)
+    out[k] = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(src + 8 * k)));
+}
+
+static inline void
+narrow32(guint8 *dst, const __m256i v[4])
+{
+  /* packs/packus travaillent par moitié de 128 bits : on remet les mots dans l'ordre */
+  const __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(Q16(v[0]), Q16(v[1])),
+      _mm256_packs_epi32(Q16(v[2]), Q16(v[3])));
+  const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+  _mm256_storeu_si256((__m256i *) dst, _mm256_permutevar8x32_epi32(packed, order));
+}
+
+static void
+luma_avx2(guint8 *row, gint n, const MyPassParams *p)
+{
+  const __m256i a = _mm256_set1_epi32(p->luma_a);
+  const __m256i b = _mm256_set1_epi32(p->luma_b);
+  gint i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i v[4];
+    widen32(row + i, v);
+    for (int k = 0; k < 4; k++)
+      v[k] = _mm256_add_epi32(_mm256_mullo_epi32(v[k], a), b);
+    narrow32(row + i, v);
+  }
+  my_pass_kernels_sse4.luma(row + i, n - i, p);
+}
+
+static void
+chroma_planar_avx2(guint8 *u, guint8 *v, gint n, const MyPassParams *p)
+{
+  const __m256i m00 = _mm256_set1_epi32(p->chroma_m[0][0]);
+  const __m256i m01 = _mm256_set1_epi32(p->chroma_m[0][1]);
+  const __m256i m10 = _mm256_set1_epi32(p->chroma_m[1][0]);
+  const __m256i m11 = _mm256_set1_epi32(p->chroma_m[1][1]);
+  const __m256i o0 = _mm256_set1_epi32(p->chroma_off[0]);
+  const __m256i o1 = _mm256_set1_epi32(p->chroma_off[1]);
+  gint i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i cu[4], cv[4], ru[4], rv[4];
+    widen32(u + i, cu);
+    widen32(v + i, cv);
+    for (int k = 0; k < 4; k++) {
+      ru[k] = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(cu[k], m00),
+              _mm256_mullo_epi32(cv[k], m01)), o0);
+      rv[k] = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(cu[k], m10),
+              _mm256_mullo_epi32(cv[k], m11)), o1);
+    }
+    narrow32(u + i, ru);
+    narrow32(v + i, rv);
+  }
+  my_pass_kernels_sse4.chroma_planar(u + i, v + i, n - i, p);
+}
+
+static void
+chroma_interleaved_avx2(guint8 *uv, gint n, const MyPassParams *p)
+{
+  const __m256i d0 = _mm256_setr_epi32(p->chroma_m[0][0], p->chroma_m[1][1],
+      p->chroma_m[0][0], p->chroma_m[1][1], p->chroma_m[0][0], p->chroma_m[1][1],
+      p->chroma_m[0][0], p->chroma_m[1][1]);
+  const __m256i d1 = _mm256_setr_epi32(p->chroma_m[0][1], p->chroma_m[1][0],
+      p->chroma_m[0][1], p->chroma_m[1][0], p->chroma_m[0][1], p->chroma_m[1][0],
+      p->chroma_m[0][1], p->chroma_m[1][0]);
+  const __m256i off = _mm256_setr_epi32(p->chroma_off[0], p->chroma_off[1],
+      p->chroma_off[0], p->chroma_off[1], p->chroma_off[0], p->chroma_off[1],
+      p->chroma_off[0], p->chroma_off[1]);
+  gint i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256i x[4];
+    widen32(uv + 2 * i, x);
+    for (int k = 0; k < 4; k++) {
+      const __m256i swapped = _mm256_shuffle_epi32(x[k], _MM_SHUFFLE(2, 3, 0, 1));
+      x[k] = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(x[k], d0),
+              _mm256_mullo_epi32(swapped, d1)), off);
+    }
+    narrow32(uv + 2 * i, x);
+  }
+  my_pass_kernels_sse4.chroma_interleaved(uv + 2 * i, n - i, p);
+}
+
+static void
+rgba_avx2(guint8 *row, gint n, const MyPassParams *p)
+{
+  /* Deux pixels par vecteur ; les shuffles opèrent par moitié de 128 bits */
+  const __m256i d0 = _mm256_setr_epi32(p->rgb_m[0][0], p->rgb_m[1][1], p->rgb_m[2][2], 65536,
+      p->rgb_m[0][0], p->rgb_m[1][1], p->rgb_m[2][2], 65536);
+  const __m256i d1 = _mm256_setr_epi32(p->rgb_m[0][1], p->rgb_m[1][2], p->rgb_m[2][0], 0,
+      p->rgb_m[0][1], p->rgb_m[1][2], p->rgb_m[2][0], 0);
+  const __m256i d2 = _mm256_setr_epi32(p->rgb_m[0][2], p->rgb_m[1][0], p->rgb_m[2][1], 0,
+      p->rgb_m[0][2], p->rgb_m[1][0], p->rgb_m[2][1], 0);
+  const __m256i off = _mm256_setr_epi32(p->rgb_off[0], p->rgb_off[1], p->rgb_off[2], 32768,
+      p->rgb_off[0], p->rgb_off[1], p->rgb_off[2], 32768);
+  gint i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i x[4];
+    widen32(row + 4 * i, x);
+    for (int k = 0; k < 4; k++) {
+      const __m256i v1 = _mm256_shuffle_epi32(x[k], _MM_SHUFFLE(3, 0, 2, 1));
+      const __m256i v2 = _mm256_shuffle_epi32(x[k], _MM_SHUFFLE(3, 1, 0, 2));
+      x[k] = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(x[k], d0),
+              _mm256_mullo_epi32(v1, d1)),
+          _mm256_add_epi32(_mm256_mullo_epi32(v2, d2), off));
+    }
+    narrow32(row + 4 * i, x);
+  }
+  my_pass_kernels_sse4.rgba(row + 4 * i, n - i, p);
+}
+
+const MyPassKernels my_pass_kernels_avx2 = {
+  "avx2",
+  luma_avx2,
+  chroma_planar_avx2,
+  chroma_interleaved_avx2,
+  rgba_avx2,
+};
@@ -0,0 +1,121 @@
+/* Compilé avec -msse4.1 ; appelé seulement si le CPU le supporte. */
+#include "mypassthrough_kernels.h"
+#include <smmintrin.h>
+
+/* 4 entiers Q16 -> décalage ; le clamp se fait au pack(packs puis packus) */
+#define Q16(v) _mm_srai_epi32((v), 16)
+
+/* Élargit 16 octets en 4 vecteurs de 4 x gint32 */
+static inline void
+widen16(__m128i x, __m128i out[4])
+{
+  out[0] = _mm_cvtepu8_epi32(x);
+  out[1] = _mm_cvtepu8_epi32(_mm_srli_si128(x, 4));
+  out[2] = _mm_cvtepu8_epi32(_mm_srli_si128(x, 8));
+  out[3] = _mm_cvtepu8_epi32(_mm_srli_si128(x, 12));
+}
+
+static inline __m128i
+narrow16(const __m128i v[4])
+{
+  return _mm_packus_epi16(_mm_packs_epi32(Q16(v[0]), Q16(v[1])),
+      _mm_packs_epi32(Q16(v[2]), Q16(v[3])));
+}
+
+static void
+luma_sse4(guint8 *row, gint n, const MyPassParams *p)
+{
+  const __m128i a = _mm_set1_epi32(p->luma_a);
+  const __m128i b = _mm_set1_epi32(p->luma_b);
+  gint i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i v[4];
+    widen16(_mm_loadu_si128((const __m128i *)(row + i)), v);
+    for (int k = 0; k < 4; k++)
+      v[k] = _mm_add_epi32(_mm_mullo_epi32(v[k], a), b);
+    _mm_storeu_si128((__m128i *)(row + i), narrow16(v));
+  }
+  my_pass_kernels_scalar.luma(row + i, n - i, p);
+}
+
+static void
+chroma_planar_sse4(guint8 *u, guint8 *v, gint n, const MyPassParams *p)
+{
+  const __m128i m00 = _mm_set1_epi32(p->chroma_m[0][0]);
+  const __m128i m01 = _mm_set1_epi32(p->chroma_m[0][1]);
+  const __m128i m10 = _mm_set1_epi32(p->chroma_m[1][0]);
+  const __m128i m11 = _mm_set1_epi32(p->chroma_m[1][1]);
+  const __m128i o0 = _mm_set1_epi32(p->chroma_off[0]);
+  const __m128i o1 = _mm_set1_epi32(p->chroma_off[1]);
+  gint i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i cu[4], cv[4], ru[4], rv[4];
+    widen16(_mm_loadu_si128((const __m128i *)(u + i)), cu);
+    widen16(_mm_loadu_si128((const __m128i *)(v + i)), cv);
+    for (int k = 0; k < 4; k++) {
+      ru[k] = _mm_add_epi32(_mm_add_epi32(_mm_mullo_epi32(cu[k], m00),
+              _mm_mullo_epi32(cv[k], m01)), o0);
+      rv[k] = _mm_add_epi32(_mm_add_epi32(_mm_mullo_epi32(cu[k], m10),
+              _mm_mullo_epi32(cv[k], m11)), o1);
+    }
+    _mm_storeu_si128((__m128i *)(u + i), narrow16(ru));
+    _mm_storeu_si128((__m128i *)(v + i), narrow16(rv));
+  }
+  my_pass_kernels_scalar.chroma_planar(u + i, v + i, n - i, p);
+}
+
+static void
+chroma_interleaved_sse4(guint8 *uv, gint n, const MyPassParams *p)
+{
+  /* Voies [u v u v] : u' = m00 u + m01 v, v' = m11 v + m10 u */
+  const __m128i d0 = _mm_setr_epi32(p->chroma_m[0][0], p->chroma_m[1][1],
+      p->chroma_m[0][0], p->chroma_m[1][1]);
+  const __m128i d1 = _mm_setr_epi32(p->chroma_m[0][1], p->chroma_m[1][0],
+      p->chroma_m[0][1], p->chroma_m[1][0]);
+  const __m128i off = _mm_setr_epi32(p->chroma_off[0], p->chroma_off[1],
+      p->chroma_off[0], p->chroma_off[1]);
+  gint i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i x[4];
+    widen16(_mm_loadu_si128((const __m128i *)(uv + 2 * i)), x);
+    for (int k = 0; k < 4; k++) {
+      const __m128i swapped = _mm_shuffle_epi32(x[k], _MM_SHUFFLE(2, 3, 0, 1));
+      x[k] = _mm_add_epi32(_mm_add_epi32(_mm_mullo_epi32(x[k], d0),
+              _mm_mullo_epi32(swapped, d1)), off);
+    }
+    _mm_storeu_si128((__m128i *)(uv + 2 * i), narrow16(x));
+  }
+  my_pass_kernels_scalar.chroma_interleaved(uv + 2 * i, n - i, p);
+}
+
+static void
+rgba_sse4(guint8 *row, gint n, const MyPassParams *p)
+{
+  /* Voies [r g b a] ; rotations [g b r a] et [b r g a] ; alpha recopié (x 1.0) */
+  const __m128i d0 = _mm_setr_epi32(p->rgb_m[0][0], p->rgb_m[1][1], p->rgb_m[2][2], 65536);
+  const __m128i d1 = _mm_setr_epi32(p->rgb_m[0][1], p->rgb_m[1][2], p->rgb_m[2][0], 0);
+  const __m128i d2 = _mm_setr_epi32(p->rgb_m[0][2], p->rgb_m[1][0], p->rgb_m[2][1], 0);
+  const __m128i off = _mm_setr_epi32(p->rgb_off[0], p->rgb_off[1], p->rgb_off[2], 32768);
+  gint i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128i x[4];
+    widen16(_mm_loadu_si128((const __m128i *)(row + 4 * i)), x);
+    for (int k = 0; k < 4; k++) {
+      const __m128i v1 = _mm_shuffle_epi32(x[k], _MM_SHUFFLE(3, 0, 2, 1));
+      const __m128i v2 = _mm_shuffle_epi32(x[k], _MM_SHUFFLE(3, 1, 0, 2));
+      x[k] = _mm_add_epi32(_mm_add_epi32(_mm_mullo_epi32(x[k], d0),
+              _mm_mullo_epi32(v1, d1)),
+          _mm_add_epi32(_mm_mullo_epi32(v2, d2), off));
+    }
+    _mm_storeu_si128((__m128i *)(row + 4 * i), narrow16(x));
+  }
+  my_pass_kernels_scalar.rgba(row + 4 * i, n - i, p);
+}
+
+const MyPassKernels my_pass_kernels_sse4 = {
+  "sse4.1",
+  luma_sse4,
+  chroma_planar_sse4,
+  chroma_interleaved_sse4,
+  rgba_sse4,
+};
@@ -0,0 +1,211 @@
+#include "mypassthrough_slices.h"
+
+/* =======================
+ *  Traitement d'une tranche
+ * ======================= */
+
+/* Lignes [first, last) d'un plan de `rows` lignes pour la tranche `index` */
+static inline void
+slice_rows(gint rows, gint index, gint n_slices, gint *first, gint *last)
+{
+  *first = (gint) ((gint64) rows * index / n_slices);
+  *last = (gint) ((gint64) rows * (index + 1) / n_slices);
+}
+
+void
+my_pass_process_slice(const MyPassFrame *frame, const MyPassParams *p,
+    const MyPassKernels *k, gint index, gint n_slices)
+{
+  gint first, last;
+
+  if (frame->layout == MY_PASS_LAYOUT_RGBA) {
+    slice_rows(frame->height, index, n_slices, &first, &last);
+    for (gint y = first; y < last; y++)
+      k->rgba(frame->data[0] + y * frame->stride[0], frame->width, p);
+    return;
+  }
+
+  if (!p->luma_identity) {
+    slice_rows(frame->height, index, n_slices, &first, &last);
+    for (gint y = first; y < last; y++)
+      k->luma(frame->data[0] + y * frame->stride[0], frame->width, p);
+  }
+  if (p->chroma_identity)
+    return;
+
+  /* Chroma sous-échantillonnée 2x2 */
+  const gint cw = (frame->width + 1) / 2;
+  slice_rows((frame->height + 1) / 2, index, n_slices, &first, &last);
+  for (gint y = first; y < last; y++) {
+    if (frame->layout == MY_PASS_LAYOUT_NV12)
+      k->chroma_interleaved(frame->data[1] + y * frame->stride[1], cw, p);
+    else
+      k->chroma_planar(frame->data[1] + y * frame->stride[1],
+          frame->data[2] + y * frame->stride[2], cw, p);
+  }
+}
+
+/* =======================
+ *  Pool de threads
+ * ======================= */
+
+/* Itérations d'attente active avant de dormir : couvre l'écart entre deux
+ * appels rapprochés sans brûler un cœur entre deux frames. */
+#define MY_PASS_SPIN 4000
+
+static inline void
+cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#endif
+}
+
+struct _MyPassSlicePool
+{
+  guint n_threads;
+  GThread **workers;
+
+  /* Tâche courante, publiée avant l'incrément de `generation` */
+  MyPassSliceFunc func;
+  gpointer data;
+
+  gint generation;  /* atomique */
+  gint pending;     /* atomique : workers pas encore revenus */
+  gint quit;        /* atomique */
+
+  GMutex lock;
+  GCond start_cond;
+  GCond done_cond;
+  guint sleeping;   /* protégé par lock */
+  gboolean waiting; /* protégé par lock */
+};
+
+typedef struct
+{
+  MyPassSlicePool *pool;
+  gint index;
+} WorkerArgs;
+
+static gpointer
+worker_main(gpointer user_data)
+{
+  WorkerArgs *args = (WorkerArgs *) user_data;
+  MyPassSlicePool *pool = args->pool;
+  const gint index = args->index;
+  gint seen = 0;
+  g_free(args);
+
+  for (;;) {
+    gint gen = g_atomic_int_get(&pool->generation);
+    for (guint i = 0; gen == seen && i < MY_PASS_SPIN; i++) {
+      cpu_relax();
+      gen = g_atomic_int_get(&pool->generation);
+    }
+    if (gen == seen) {
+      g_mutex_lock(&pool->lock);
+      pool->sleeping++;
+      while ((gen = g_atomic_int_get(&pool->generation)) == seen)
+        g_cond_wait(&pool->start_cond, &pool->lock);
+      pool->sleeping--;
+      g_mutex_unlock(&pool->lock);
+    }
+    seen = gen;
+
+    if (g_atomic_int_get(&pool->quit))
+      break;
+
+    pool->func(pool->data, index, (gint) pool->n_threads);
+
+    if (g_atomic_int_dec_and_test(&pool->pending)) {
+      g_mutex_lock(&pool->lock);
+      if (pool->waiting)
+        g_cond_signal(&pool->done_cond);
+      g_mutex_unlock(&pool->lock);
+    }
+  }
+  return NULL;
+}
+
+/* Publie une nouvelle génération et réveille les workers endormis */
+static void
+pool_kick(MyPassSlicePool *pool)
+{
+  g_mutex_lock(&pool->lock);
+  g_atomic_int_inc(&pool->generation);
+  if (pool->sleeping > 0)
+    g_cond_broadcast(&pool->start_cond);
+  g_mutex_unlock(&pool->lock);
+}
+
+MyPassSlicePool *
+my_pass_slice_pool_new(guint n_threads)
+{
+  MyPassSlicePool *pool = g_new0(MyPassSlicePool, 1);
+  pool->n_threads = MAX(n_threads, 1u);
+  g_mutex_init(&pool->lock);
+  g_cond_init(&pool->start_cond);
+  g_cond_init(&pool->done_cond);
+
+  pool->workers = g_new0(GThread *, pool->n_threads);
+  for (guint i = 1; i < pool->n_threads; i++) {
+    WorkerArgs *args = g_new(WorkerArgs, 1);
+    args->pool = pool;
+    args->index = (gint) i;
+    pool->workers[i] = g_thread_new("mypass-slice", worker_main, args);
+  }
+  return pool;
+}
+
+void
+my_pass_slice_pool_free(MyPassSlicePool *pool)
+{
+  if (pool == NULL)
+    return;
+
+  g_atomic_int_set(&pool->quit, 1);
+  pool_kick(pool);
+  for (guint i = 1; i < pool->n_threads; i++)
+    g_thread_join(pool->workers[i]);
+
+  g_free(pool->workers);
+  g_cond_clear(&pool->done_cond);
+  g_cond_clear(&pool->start_cond);
+  g_mutex_clear(&pool->lock);
+  g_free(pool);
+}
+
+guint
+my_pass_slice_pool_size(const MyPassSlicePool *pool)
+{
+  return pool->n_threads;
+}
+
+void
+my_pass_slice_pool_run(MyPassSlicePool *pool, MyPassSliceFunc func, gpointer data)
+{
+  const gint n = (gint) pool->n_threads;
+  if (n == 1) {
+    func(data, 0, 1);
+    return;
+  }
+
+  pool->func = func;
+  pool->data = data;
+  g_atomic_int_set(&pool->pending, n - 1);
+  pool_kick(pool);
+
+  func(data, 0, n);
+
+  /* Barrière : attente active courte, puis sommeil */
+  for (guint i = 0; g_atomic_int_get(&pool->pending) > 0 && i < MY_PASS_SPIN; i++)
+    cpu_relax();
+  if (g_atomic_int_get(&pool->pending) > 0) {
+    g_mutex_lock(&pool->lock);
+    pool->waiting = TRUE;
+    while (g_atomic_int_get(&pool->pending) > 0)
+      g_cond_wait(&pool->done_cond, &pool->lock);
+    pool->waiting = FALSE;
+    g_mutex_unlock(&pool->lock);
+  }
+}
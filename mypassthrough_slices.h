@@ -0,0 +1,52 @@
+#pragma once
+#include "mypassthrough_kernels.h"
+
+/* =======================
+ *  Découpage d'une frame en tranches horizontales
+ * ======================= */
+
+typedef enum
+{
+  MY_PASS_LAYOUT_I420,
+  MY_PASS_LAYOUT_NV12,
+  MY_PASS_LAYOUT_RGBA,
+} MyPassLayout;
+
+/* Vue sur une frame déjà mappée : plans et strides, sans dépendance à
+ * gst-video pour que les tests et les benchmarks s'en servent directement. */
+typedef struct
+{
+  MyPassLayout layout;
+  gint width;
+  gint height;
+  guint8 *data[3];
+  gint stride[3];
+} MyPassFrame;
+
+/* Traite la tranche `index` sur `n_slices`. Chaque ligne est traitée
+ * indépendamment : le résultat ne dépend pas du découpage. */
+void my_pass_process_slice(const MyPassFrame *frame, const MyPassParams *p,
+    const MyPassKernels *k, gint index, gint n_slices);
+
+/* =======================
+ *  Pool de threads persistant
+ * =======================
+ *
+ * Créé une fois (dans `start`), puis réutilisé pour chaque buffer. Le
+ * thread appelant prend la tranche 0 ; les workers attendent la génération
+ * suivante en attente active brève, puis sur une GCond. Le réveil et la
+ * barrière de fin n'entrent dans le noyau que si quelqu'un dort vraiment.
+ */
+
+typedef void (*MyPassSliceFunc)(gpointer data, gint index, gint n_slices);
+
+typedef struct _MyPassSlicePool MyPassSlicePool;
+
+/* `n_threads` compte le thread appelant ; 1 ne crée aucun worker. */
+MyPassSlicePool *my_pass_slice_pool_new(guint n_threads);
+void my_pass_slice_pool_free(MyPassSlicePool *pool);
+guint my_pass_slice_pool_size(const MyPassSlicePool *pool);
+
+/* Exécute `func` sur toutes les tranches et ne rend la main qu'une fois
+ * chacune terminée. Un seul appelant à la fois. */
+void my_pass_slice_pool_run(MyPassSlicePool *pool, MyPassSliceFunc func, gpointer data);
@@ -0,0 +1,171 @@
+#include "mypassthrough_stats.h"
+#include <atomic>
+#include <cmath>
+
+/* Plus de threads écrivains que de compteurs : ils se partagent une ligne,
+ * les additions restent exactes, seule la contention augmente. */
+#define MY_PASS_STATS_SHARDS 8
+
+namespace {
+
+struct alignas(64) Shard
+{
+  std::atomic<guint64> buffers{0};
+  std::atomic<guint64> bytes{0};
+  std::atomic<guint64> intervals{0};
+  std::atomic<guint64> interval_sum_us{0};
+  std::atomic<guint64> interval_sq_sum_us{0};
+  std::atomic<guint64> interval_max_us{0};
+  std::atomic<guint64> lag_samples{0};
+  std::atomic<gint64> lag_sum_us{0};
+  std::atomic<gint64> lag_min_us{G_MAXINT64};
+  std::atomic<gint64> lag_max_us{G_MININT64};
+  std::atomic<guint64> sizes[MY_PASS_STATS_SIZE_BUCKETS] = {};
+};
+
+/* Chaque thread reçoit un compteur une fois pour toutes */
+guint
+shard_index(void)
+{
+  static std::atomic<guint> next{0};
+  thread_local const guint index = next.fetch_add(1, std::memory_order_relaxed) % MY_PASS_STATS_SHARDS;
+  return index;
+}
+
+template <typename T>
+void
+store_max(std::atomic<T> &slot, T v)
+{
+  T cur = slot.load(std::memory_order_relaxed);
+  while (v > cur && !slot.compare_exchange_weak(cur, v, std::memory_order_relaxed))
+    ;
+}
+
+template <typename T>
+void
+store_min(std::atomic<T> &slot, T v)
+{
+  T cur = slot.load(std::memory_order_relaxed);
+  while (v < cur && !slot.compare_exchange_weak(cur, v, std::memory_order_relaxed))
+    ;
+}
+
+guint
+size_bucket(gsize size)
+{
+  guint bits = 0;
+  while (size != 0 && bits < MY_PASS_STATS_SIZE_BUCKETS - 1) {
+    size >>= 1;
+    bits++;
+  }
+  return bits;
+}
+
+} // namespace
+
+struct _MyPassStats
+{
+  Shard shards[MY_PASS_STATS_SHARDS];
+  /* Dernière arrivée, partagée : l'intervalle se mesure entre buffers
+   * consécutifs quel que soit le thread qui les pousse */
+  std::atomic<gint64> last_arrival_ns{-1};
+};
+
+MyPassStats *
+my_pass_stats_new(void)
+{
+  return new MyPassStats();
+}
+
+void
+my_pass_stats_free(MyPassStats *stats)
+{
+  delete stats;
+}
+
+void
+my_pass_stats_reset(MyPassStats *stats)
+{
+  for (Shard &s : stats->shards) {
+    s.buffers = 0;
+    s.bytes = 0;
+    s.intervals = 0;
+    s.interval_sum_us = 0;
+    s.interval_sq_sum_us = 0;
+    s.interval_max_us = 0;
+    s.lag_samples = 0;
+    s.lag_sum_us = 0;
+    s.lag_min_us = G_MAXINT64;
+    s.lag_max_us = G_MININT64;
+    for (auto &b : s.sizes)
+      b = 0;
+  }
+  stats->last_arrival_ns = -1;
+}
+
+void
+my_pass_stats_record(MyPassStats *stats, gint64 arrival_ns, gint64 lag_ns, gsize size)
+{
+  Shard &s = stats->shards[shard_index()];
+  const auto relaxed = std::memory_order_relaxed;
+
+  s.buffers.fetch_add(1, relaxed);
+  s.bytes.fetch_add(size, relaxed);
+  s.sizes[size_bucket(size)].fetch_add(1, relaxed);
+
+  const gint64 previous = stats->last_arrival_ns.exchange(arrival_ns, relaxed);
+  if (previous >= 0 && arrival_ns >= previous) {
+    const guint64 us = (guint64) ((arrival_ns - previous) / 1000);
+    s.intervals.fetch_add(1, relaxed);
+    s.interval_sum_us.fetch_add(us, relaxed);
+    s.interval_sq_sum_us.fetch_add(us * us, relaxed);
+    store_max(s.interval_max_us, us);
+  }
+
+  if (lag_ns != MY_PASS_STATS_NO_LAG) {
+    const gint64 us = lag_ns / 1000;
+    s.lag_samples.fetch_add(1, relaxed);
+    s.lag_sum_us.fetch_add(us, relaxed);
+    store_min(s.lag_min_us, us);
+    store_max(s.lag_max_us, us);
+  }
+}
+
+void
+my_pass_stats_snapshot(const MyPassStats *stats, MyPassStatsSnapshot *out)
+{
+  const auto relaxed = std::memory_order_relaxed;
+  guint64 intervals = 0, interval_sum = 0, interval_sq_sum = 0;
+  gint64 lag_sum = 0;
+
+  *out = MyPassStatsSnapshot();
+  out->lag_min_us = G_MAXINT64;
+  out->lag_max_us = G_MININT64;
+  for (const Shard &s : stats->shards) {
+    out->buffers += s.buffers.load(relaxed);
+    out->bytes += s.bytes.load(relaxed);
+    intervals += s.intervals.load(relaxed);
+    interval_sum += s.interval_sum_us.load(relaxed);
+    interval_sq_sum += s.interval_sq_sum_us.load(relaxed);
+    out->interarrival_max_us = MAX(out->interarrival_max_us, (gdouble) s.interval_max_us.load(relaxed));
+    out->lag_samples += s.lag_samples.load(relaxed);
+    lag_sum += s.lag_sum_us.load(relaxed);
+    out->lag_min_us = MIN(out->lag_min_us, s.lag_min_us.load(relaxed));
+    out->lag_max_us = MAX(out->lag_max_us, s.lag_max_us.load(relaxed));
+    for (guint i = 0; i < MY_PASS_STATS_SIZE_BUCKETS; i++)
+      out->size_histogram[i] += s.sizes[i].load(relaxed);
+  }
+
+  if (intervals > 0) {
+    const gdouble mean = (gdouble) interval_sum / intervals;
+    const gdouble var = (gdouble) interval_sq_sum / intervals - mean * mean;
+    out->interarrival_mean_us = mean;
+    out->jitter_us = var > 0.0 ? std::sqrt(var) : 0.0;
+  }
+  if (out->lag_samples > 0) {
+    out->lag_mean_us = (gdouble) lag_sum / out->lag_samples;
+  } else {
+    out->lag_min_us = 0;
+    out->lag_max_us = 0;
+  }
+}
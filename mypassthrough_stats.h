@@ -0,0 +1,52 @@
+#pragma once
+#include <glib.h>
+
+/* =======================
+ *  Mesures par buffer (mode `measure`)
+ * =======================
+ *
+ * Le thread de streaming écrit dans un compteur qui lui est propre (une
+ * ligne de cache par thread, additions atomiques relâchées) ; la lecture
+ * additionne les compteurs sans verrou et ne bloque jamais l'écrivain.
+ * Un instantané peut donc mélanger deux buffers consécutifs, jamais plus.
+ */
+
+/* Classe i : tailles dans [2^(i-1), 2^i) octets ; la dernière prend le reste */
+#define MY_PASS_STATS_SIZE_BUCKETS 32
+
+/* Valeur de `lag_ns` quand le décalage n'est pas mesurable
+ * (pas d'horloge, PTS absent ou hors segment) */
+#define MY_PASS_STATS_NO_LAG G_MININT64
+
+typedef struct
+{
+  guint64 buffers;
+  guint64 bytes;
+
+  /* Intervalle entre deux arrivées ; la gigue est son écart-type */
+  gdouble interarrival_mean_us;
+  gdouble jitter_us;
+  gdouble interarrival_max_us;
+
+  /* Temps courant du pipeline moins running-time du PTS : > 0 en retard */
+  guint64 lag_samples;
+  gdouble lag_mean_us;
+  gint64 lag_min_us;
+  gint64 lag_max_us;
+
+  guint64 size_histogram[MY_PASS_STATS_SIZE_BUCKETS];
+} MyPassStatsSnapshot;
+
+typedef struct _MyPassStats MyPassStats;
+
+MyPassStats *my_pass_stats_new(void);
+void my_pass_stats_free(MyPassStats *stats);
+
+/* À appeler hors streaming (start) : ne remet pas à zéro de façon atomique */
+void my_pass_stats_reset(MyPassStats *stats);
+
+/* Un buffer arrivé à `arrival_ns` (horloge monotone). Sans verrou. */
+void my_pass_stats_record(MyPassStats *stats, gint64 arrival_ns, gint64 lag_ns, gsize size);
+
+/* Lisible à tout moment, depuis n'importe quel thread. */
+void my_pass_stats_snapshot(const MyPassStats *stats, MyPassStatsSnapshot *out);
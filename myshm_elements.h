@@ -0,0 +1,19 @@
+#pragma once
+#include <gst/gst.h>
+#include <gst/base/gstbasesink.h>
+#include <gst/base/gstpushsrc.h>
+
+/* =======================
+ *  Éléments du plugin myshm
+ * =======================
+ *
+ * myshmsink publie les frames dans un anneau en mémoire partagée
+ * (myshm_ring.h) et le donne au processus qui se connecte à sa socket
+ * Unix ; myshmsrc, dans ce processus, pousse les frames sans les copier.
+ */
+
+#define GST_TYPE_MY_SHM_SINK (gst_my_shm_sink_get_type())
+G_DECLARE_FINAL_TYPE(GstMyShmSink, gst_my_shm_sink, GST, MY_SHM_SINK, GstBaseSink)
+
+#define GST_TYPE_MY_SHM_SRC (gst_my_shm_src_get_type())
+G_DECLARE_FINAL_TYPE(GstMyShmSrc, gst_my_shm_src, GST, MY_SHM_SRC, GstPushSrc)
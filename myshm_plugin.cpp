@@ -0,0 +1,29 @@
+#include <gst/gst.h>
+#include "myshm_elements.h"
+
+/* =======================
+ *  Point d’entrée du plugin
+ * ======================= */
+static gboolean
+plugin_init(GstPlugin *plugin)
+{
+  return gst_element_register(plugin, "myshmsink", GST_RANK_NONE, GST_TYPE_MY_SHM_SINK)
+      && gst_element_register(plugin, "myshmsrc", GST_RANK_NONE, GST_TYPE_MY_SHM_SRC);
+}
+
+/* =======================
+ *  Déclaration du plugin
+ * ======================= */
+#ifndef PACKAGE
+#define PACKAGE "myshm"
+#endif
+
+GST_PLUGIN_DEFINE(GST_VERSION_MAJOR,
+                  GST_VERSION_MINOR,
+                  myshm,                                         /* nom interne */
+                  "Frames entre processus en mémoire partagée", /* description */
+                  plugin_init,
+                  "1.0", /* version */
+                  "LGPL",
+                  "myshm",
+                  "https://exemple.com")
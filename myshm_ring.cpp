@@ -0,0 +1,544 @@
+#include "myshm_ring.h"
+#include <atomic>
+#include <new>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#define MY_SHM_RING_MAGIC 0x4d595348u /* "MYSH" */
+#define MY_SHM_RING_VERSION 2u
+#define MY_SHM_PAGE 4096u
+
+namespace {
+
+/* L'état d'un emplacement occupe les deux bits bas du mot d'état, son
+ * époque le reste. reclaim change l'époque de ce qu'il reprend : une
+ * libération tardive, faite avec l'ancienne, ne touche plus à rien. */
+enum : guint32
+{
+  SLOT_FREE,
+  /* Réservé par le producteur, en cours d'écriture */
+  SLOT_WRITING,
+  /* Publié : au consommateur jusqu'à sa libération */
+  SLOT_READY,
+  SLOT_KIND_MASK = 3,
+  SLOT_EPOCH_SHIFT = 2,
+};
+
+static_assert(std::atomic<guint32>::is_always_lock_free, "atomiques partagées entre processus");
+static_assert(std::atomic<guint64>::is_always_lock_free, "atomiques partagées entre processus");
+
+/* Vu des deux processus : uniquement des types de taille fixe */
+struct Header
+{
+  guint32 magic;
+  guint32 version;
+  guint32 n_slots;
+  guint32 reserved;
+  guint64 slot_stride;
+  guint64 slots_offset;
+  guint64 queue_offset;
+  guint64 data_offset;
+  guint64 total_size;
+
+  /* Frames publiées (producteur) et retirées (consommateur) depuis le
+   * début, chacun sur sa ligne de cache */
+  alignas(64) std::atomic<guint64> head;
+  alignas(64) std::atomic<guint64> tail;
+
+  /* Caps sous verrou de séquence : impair pendant l'écriture */
+  alignas(64) std::atomic<guint32> caps_seq;
+  guint32 caps_generation;
+  gchar caps[MY_SHM_RING_MAX_CAPS];
+};
+
+struct alignas(64) Slot
+{
+  std::atomic<guint32> state;
+  MyShmFrameInfo info;
+};
+
+guint32
+with_kind(guint32 state, guint32 kind)
+{
+  return (state & ~(guint32)SLOT_KIND_MASK) | kind;
+}
+
+gsize
+round_up(gsize v, gsize align)
+{
+  return (v + align - 1) / align * align;
+}
+
+void
+set_errno_error(GError **error, const gchar *what)
+{
+  int saved = errno;
+  g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(saved), "%s : %s", what, g_strerror(saved));
+}
+
+void
+ring_doorbell(int fd)
+{
+  guint64 one = 1;
+  /* EAGAIN : compteur saturé, la sonnette a déjà sonné */
+  while (write(fd, &one, sizeof one) < 0 && errno == EINTR)
+    ;
+}
+
+} // namespace
+
+struct _MyShmRing
+{
+  gint ref_count;
+  int fds[MY_SHM_RING_N_FDS];
+  guint8 *base;
+  gsize size;
+  Header *header;
+  Slot *slots;
+  guint32 *queue;
+  guint8 *data;
+  /* Géométrie validée, copiée de l'en-tête : le producteur peut encore
+   * réécrire celui-ci, pas ces copies */
+  guint n_slots;
+  gsize slot_stride;
+  /* Producteur : où reprendre la recherche d'un emplacement libre */
+  std::atomic<guint> next_free;
+};
+
+static MyShmRing *
+my_shm_ring_map(const int fds[MY_SHM_RING_N_FDS], gsize size, GError **error)
+{
+  void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+  if (base == MAP_FAILED) {
+    set_errno_error(error, "mmap");
+    return NULL;
+  }
+  MyShmRing *ring = new MyShmRing();
+  ring->ref_count = 1;
+  for (guint i = 0; i < MY_SHM_RING_N_FDS; i++)
+    ring->fds[i] = fds[i];
+  ring->base = static_cast<guint8 *>(base);
+  ring->size = size;
+  ring->header = reinterpret_cast<Header *>(ring->base);
+  ring->next_free = 0;
+  return ring;
+}
+
+static void
+my_shm_ring_locate(MyShmRing *ring, guint n_slots, gsize slot_stride, gsize slots_offset, gsize queue_offset,
+                   gsize data_offset)
+{
+  ring->n_slots = n_slots;
+  ring->slot_stride = slot_stride;
+  ring->slots = reinterpret_cast<Slot *>(ring->base + slots_offset);
+  ring->queue = reinterpret_cast<guint32 *>(ring->base + queue_offset);
+  ring->data = ring->base + data_offset;
+}
+
+MyShmRing *
+my_shm_ring_new(guint n_slots, gsize slot_size, GError **error)
+{
+  g_return_val_if_fail(n_slots > 0 && slot_size > 0, NULL);
+
+  const gsize stride = round_up(slot_size, MY_SHM_PAGE);
+  const gsize slots_offset = round_up(sizeof(Header), alignof(Slot));
+  const gsize queue_offset = slots_offset + n_slots * sizeof(Slot);
+  const gsize data_offset = round_up(queue_offset + n_slots * sizeof(guint32), MY_SHM_PAGE);
+  const gsize total = data_offset + n_slots * stride;
+
+  int fds[MY_SHM_RING_N_FDS] = {-1, -1, -1};
+  fds[0] = memfd_create("myshm-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (fds[0] < 0) {
+    set_errno_error(error, "memfd_create");
+    return NULL;
+  }
+  /* Taille figée : le consommateur peut faire confiance à son mmap */
+  if (ftruncate(fds[0], (off_t)total) < 0
+      || fcntl(fds[0], F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0) {
+    set_errno_error(error, "memfd");
+    close(fds[0]);
+    return NULL;
+  }
+  for (guint i = 1; i < MY_SHM_RING_N_FDS; i++) {
+    fds[i] = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (fds[i] < 0) {
+      set_errno_error(error, "eventfd");
+      for (guint j = 0; j < i; j++)
+        close(fds[j]);
+      return NULL;
+    }
+  }
+
+  MyShmRing *ring = my_shm_ring_map(fds, total, error);
+  if (!ring) {
+    for (int fd : fds)
+      close(fd);
+    return NULL;
+  }
+
+  /* Le memfd neuf est à zéro : seuls les champs non nuls sont écrits */
+  Header *h = new (ring->base) Header();
+  h->magic = MY_SHM_RING_MAGIC;
+  h->version = MY_SHM_RING_VERSION;
+  h->n_slots = n_slots;
+  h->slot_stride = stride;
+  h->slots_offset = slots_offset;
+  h->queue_offset = queue_offset;
+  h->data_offset = data_offset;
+  h->total_size = total;
+  my_shm_ring_locate(ring, n_slots, stride, slots_offset, queue_offset, data_offset);
+  for (guint i = 0; i < n_slots; i++)
+    new (&ring->slots[i]) Slot();
+  return ring;
+}
+
+MyShmRing *
+my_shm_ring_attach(const int fds[MY_SHM_RING_N_FDS], GError **error)
+{
+  struct stat st;
+  if (fstat(fds[0], &st) < 0) {
+    set_errno_error(error, "fstat");
+    goto fail;
+  }
+  /* Sans les sceaux, le producteur pourrait réduire le fichier sous nos pieds */
+  if ((fcntl(fds[0], F_GET_SEALS) & F_SEAL_SHRINK) == 0 || (gsize)st.st_size < sizeof(Header)) {
+    g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "anneau non scellé ou trop petit");
+    goto fail;
+  }
+  {
+    MyShmRing *ring = my_shm_ring_map(fds, (gsize)st.st_size, error);
+    if (!ring)
+      goto fail;
+    /* Lu une seule fois : ce qui est validé est ce qui sert ensuite */
+    const Header *h = ring->header;
+    const guint32 magic = h->magic, version = h->version, n_slots = h->n_slots;
+    const guint64 slot_stride = h->slot_stride, slots_offset = h->slots_offset, queue_offset = h->queue_offset,
+                  data_offset = h->data_offset, total_size = h->total_size;
+    const gboolean valid =
+        magic == MY_SHM_RING_MAGIC && version == MY_SHM_RING_VERSION && n_slots > 0
+        && total_size == (guint64)st.st_size && slots_offset >= sizeof(Header)
+        && slots_offset % alignof(Slot) == 0 && slots_offset <= total_size && queue_offset <= total_size
+        && queue_offset >= slots_offset + (guint64)n_slots * sizeof(Slot)
+        && data_offset >= queue_offset + (guint64)n_slots * sizeof(guint32)
+        && data_offset <= total_size && slot_stride <= (total_size - data_offset) / n_slots;
+    if (!valid) {
+      g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "en-tête d'anneau invalide");
+      my_shm_ring_unref(ring);
+      return NULL;
+    }
+    my_shm_ring_locate(ring, n_slots, slot_stride, slots_offset, queue_offset, data_offset);
+    return ring;
+  }
+
+fail:
+  for (guint i = 0; i < MY_SHM_RING_N_FDS; i++)
+    close(fds[i]);
+  return NULL;
+}
+
+MyShmRing *
+my_shm_ring_ref(MyShmRing *ring)
+{
+  g_atomic_int_inc(&ring->ref_count);
+  return ring;
+}
+
+void
+my_shm_ring_unref(MyShmRing *ring)
+{
+  if (!g_atomic_int_dec_and_test(&ring->ref_count))
+    return;
+  munmap(ring->base, ring->size);
+  for (int fd : ring->fds)
+    close(fd);
+  delete ring;
+}
+
+void
+my_shm_ring_get_fds(const MyShmRing *ring, int fds[MY_SHM_RING_N_FDS])
+{
+  for (guint i = 0; i < MY_SHM_RING_N_FDS; i++)
+    fds[i] = ring->fds[i];
+}
+
+guint
+my_shm_ring_n_slots(const MyShmRing *ring)
+{
+  return ring->n_slots;
+}
+
+gsize
+my_shm_ring_slot_size(const MyShmRing *ring)
+{
+  return ring->slot_stride;
+}
+
+guint8 *
+my_shm_ring_slot_data(const MyShmRing *ring, guint slot)
+{
+  return ring->data + (gsize)slot * ring->slot_stride;
+}
+
+/* =======================
+ *  Producteur
+ * ======================= */
+
+gint
+my_shm_ring_acquire(MyShmRing *ring)
+{
+  const guint n = ring->n_slots;
+  const guint start = ring->next_free.load(std::memory_order_relaxed);
+  for (guint i = 0; i < n; i++) {
+    const guint slot = (start + i) % n;
+    guint32 expected = ring->slots[slot].state.load(std::memory_order_relaxed);
+    if ((expected & SLOT_KIND_MASK) != SLOT_FREE)
+      continue;
+    /* acquire : ce que le consommateur a lu avant de libérer est terminé */
+    if (ring->slots[slot].state.compare_exchange_strong(expected, with_kind(expected, SLOT_WRITING),
+                                                        std::memory_order_acquire, std::memory_order_relaxed)) {
+      ring->next_free.store((slot + 1) % n, std::memory_order_relaxed);
+      return (gint)slot;
+    }
+  }
+  return -1;
+}
+
+void
+my_shm_ring_abandon(MyShmRing *ring, guint slot)
+{
+  /* Réservé : personne d'autre n'écrit cet état */
+  std::atomic<guint32> &state = ring->slots[slot].state;
+  state.store(with_kind(state.load(std::memory_order_relaxed), SLOT_FREE), std::memory_order_release);
+}
+
+void
+my_shm_ring_publish(MyShmRing *ring, guint slot, const MyShmFrameInfo *info)
+{
+  Header *h = ring->header;
+  std::atomic<guint32> &state = ring->slots[slot].state;
+  ring->slots[slot].info = *info;
+  state.store(with_kind(state.load(std::memory_order_relaxed), SLOT_READY), std::memory_order_relaxed);
+  /* Un emplacement n'est dans la file qu'une fois jusqu'à sa libération :
+   * elle ne déborde jamais. */
+  const guint64 head = h->head.load(std::memory_order_relaxed);
+  ring->queue[head % ring->n_slots] = slot;
+  /* release : données, info et entrée de file visibles avant la tête */
+  h->head.store(head + 1, std::memory_order_release);
+  ring_doorbell(ring->fds[1 + MY_SHM_DOORBELL_READY]);
+}
+
+gboolean
+my_shm_ring_set_caps(MyShmRing *ring, const gchar *caps)
+{
+  const gsize len = strlen(caps);
+  if (len >= MY_SHM_RING_MAX_CAPS)
+    return FALSE;
+  Header *h = ring->header;
+  const guint32 seq = h->caps_seq.load(std::memory_order_relaxed);
+  h->caps_seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(h->caps, caps, len + 1);
+  h->caps_generation++;
+  h->caps_seq.store(seq + 2, std::memory_order_release);
+  return TRUE;
+}
+
+guint32
+my_shm_ring_caps_generation(const MyShmRing *ring)
+{
+  /* Seul le producteur écrit la génération : lecture directe */
+  return ring->header->caps_generation;
+}
+
+void
+my_shm_ring_reclaim(MyShmRing *ring)
+{
+  Header *h = ring->header;
+  h->tail.store(h->head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  for (guint i = 0; i < ring->n_slots; i++) {
+    guint32 expected = ring->slots[i].state.load(std::memory_order_relaxed);
+    if ((expected & SLOT_KIND_MASK) != SLOT_READY)
+      continue;
+    /* Époque suivante : les libérations encore en route sont caduques */
+    const guint32 next = with_kind(expected + (1u << SLOT_EPOCH_SHIFT), SLOT_FREE);
+    ring->slots[i].state.compare_exchange_strong(expected, next, std::memory_order_acq_rel);
+  }
+}
+
+/* =======================
+ *  Consommateur
+ * ======================= */
+
+gint
+my_shm_ring_pop(MyShmRing *ring, MyShmFrameInfo *info, guint32 *epoch)
+{
+  Header *h = ring->header;
+  guint64 tail = h->tail.load(std::memory_order_relaxed);
+  while (tail != h->head.load(std::memory_order_acquire)) {
+    const guint32 slot = ring->queue[tail % ring->n_slots];
+    h->tail.store(++tail, std::memory_order_relaxed);
+    /* Un producteur défaillant ne doit pas nous faire lire hors de
+     * l'anneau, ni nous donner un emplacement qui n'est pas publié */
+    if (slot >= ring->n_slots)
+      continue;
+    const guint32 state = ring->slots[slot].state.load(std::memory_order_acquire);
+    if ((state & SLOT_KIND_MASK) != SLOT_READY)
+      continue;
+    *info = ring->slots[slot].info;
+    if (info->offset > ring->slot_stride || info->size > ring->slot_stride - info->offset)
+      info->size = 0;
+    *epoch = state >> SLOT_EPOCH_SHIFT;
+    return (gint)slot;
+  }
+  return -1;
+}
+
+gchar *
+my_shm_ring_dup_caps(MyShmRing *ring, guint32 *generation)
+{
+  Header *h = ring->header;
+  gchar caps[MY_SHM_RING_MAX_CAPS];
+  guint32 seq;
+  do {
+    seq = h->caps_seq.load(std::memory_order_acquire);
+    if (seq & 1)
+      continue;
+    memcpy(caps, h->caps, sizeof caps);
+    *generation = h->caps_generation;
+    std::atomic_thread_fence(std::memory_order_acquire);
+  } while ((seq & 1) || h->caps_seq.load(std::memory_order_relaxed) != seq);
+  caps[MY_SHM_RING_MAX_CAPS - 1] = '\0';
+  return caps[0] ? g_strdup(caps) : NULL;
+}
+
+void
+my_shm_ring_release(MyShmRing *ring, guint slot, guint32 epoch)
+{
+  /* Depuis reclaim, l'emplacement a pu repartir chez le producteur ou chez
+   * un autre consommateur : seule la frame reçue à cette époque est rendue */
+  guint32 expected = (epoch << SLOT_EPOCH_SHIFT) | SLOT_READY;
+  if (slot < ring->n_slots
+      && ring->slots[slot].state.compare_exchange_strong(expected, with_kind(expected, SLOT_FREE),
+                                                         std::memory_order_release, std::memory_order_relaxed))
+    ring_doorbell(ring->fds[1 + MY_SHM_DOORBELL_FREE]);
+}
+
+/* =======================
+ *  Sonnettes
+ * ======================= */
+
+typedef struct
+{
+  GSource source;
+  gpointer tag;
+  int fd;
+} MyShmDoorbellSource;
+
+static gboolean
+my_shm_doorbell_dispatch(GSource *source, GSourceFunc callback, gpointer data)
+{
+  MyShmDoorbellSource *bell = (MyShmDoorbellSource *)source;
+  guint64 rings;
+  /* Toutes les sonneries depuis la dernière fois en une lecture */
+  while (read(bell->fd, &rings, sizeof rings) < 0 && errno == EINTR)
+    ;
+  return callback ? callback(data) : G_SOURCE_CONTINUE;
+}
+
+static GSourceFuncs my_shm_doorbell_funcs = {
+    NULL, NULL, my_shm_doorbell_dispatch, NULL, NULL, NULL};
+
+GSource *
+my_shm_doorbell_source_new(MyShmRing *ring, MyShmDoorbell doorbell)
+{
+  GSource *source = g_source_new(&my_shm_doorbell_funcs, sizeof(MyShmDoorbellSource));
+  MyShmDoorbellSource *bell = (MyShmDoorbellSource *)source;
+  bell->fd = ring->fds[1 + doorbell];
+  bell->tag = g_source_add_unix_fd(source, bell->fd, G_IO_IN);
+  g_source_set_name(source, doorbell == MY_SHM_DOORBELL_READY ? "myshm frame prête" : "myshm emplacement libre");
+  return source;
+}
+
+/* =======================
+ *  Passage des descripteurs
+ * ======================= */
+
+gboolean
+my_shm_send_fds(int socket, const int *fds, guint n_fds, GError **error)
+{
+  char byte = 0;
+  struct iovec iov = {&byte, 1};
+  union {
+    struct cmsghdr align;
+    char buf[CMSG_SPACE(sizeof(int) * 8)];
+  } control;
+  g_return_val_if_fail(n_fds <= 8, FALSE);
+  memset(&control, 0, sizeof control);
+
+  struct msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = CMSG_SPACE(sizeof(int) * n_fds);
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int) * n_fds);
+  memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * n_fds);
+
+  ssize_t sent;
+  while ((sent = sendmsg(socket, &msg, MSG_NOSIGNAL)) < 0 && errno == EINTR)
+    ;
+  if (sent < 0) {
+    set_errno_error(error, "sendmsg");
+    return FALSE;
+  }
+  return TRUE;
+}
+
+gboolean
+my_shm_recv_fds(int socket, int *fds, guint n_fds, GError **error)
+{
+  char byte;
+  struct iovec iov = {&byte, 1};
+  union {
+    struct cmsghdr align;
+    char buf[CMSG_SPACE(sizeof(int) * 8)];
+  } control;
+  g_return_val_if_fail(n_fds <= 8, FALSE);
+
+  struct msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof control.buf;
+
+  ssize_t got;
+  while ((got = recvmsg(socket, &msg, MSG_CMSG_CLOEXEC)) < 0 && errno == EINTR)
+    ;
+  if (got < 0) {
+    set_errno_error(error, "recvmsg");
+    return FALSE;
+  }
+  struct cmsghdr *cmsg = got > 0 ? CMSG_FIRSTHDR(&msg) : NULL;
+  if (cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+    g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_PIPE, "aucun descripteur reçu");
+    return FALSE;
+  }
+  const guint received = (guint)((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+  int *in = (int *)CMSG_DATA(cmsg);
+  if (received != n_fds) {
+    for (guint i = 0; i < received; i++)
+      close(in[i]);
+    g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "%u descripteur(s) reçu(s), %u attendu(s)", received, n_fds);
+    return FALSE;
+  }
+  memcpy(fds, in, sizeof(int) * n_fds);
+  return TRUE;
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <glib.h>
+
+/* =======================
+ *  Anneau de frames en mémoire partagée
+ * =======================
+ *
+ * Un memfd scellé contient un en-tête, `n_slots` emplacements de taille
+ * fixe et la file des emplacements publiés. Le producteur écrit une frame
+ * directement dans un emplacement, le publie ; le consommateur (un autre
+ * processus, qui a reçu le memfd par une socket Unix) le lit sur place
+ * puis le libère. Aucune copie, aucun verrou : chaque emplacement a un
+ * état atomique, la file est à un seul producteur et un seul consommateur.
+ *
+ * Deux eventfd servent de sonnettes : « frame prête » après chaque
+ * publication, « emplacement libre » après chaque libération. Une source
+ * GLib les surveille pour qui attend dans une boucle.
+ */
+
+/* memfd, sonnette « frame prête », sonnette « emplacement libre » */
+#define MY_SHM_RING_N_FDS 3
+
+/* Caps sérialisées, terminateur compris */
+#define MY_SHM_RING_MAX_CAPS 4096
+
+/* Ce qui accompagne une frame publiée ; les données sont dans
+ * l'emplacement, à partir de `offset`. */
+typedef struct
+{
+  guint64 offset;
+  guint64 size;
+  guint64 pts;
+  guint64 dts;
+  guint64 duration;
+  guint32 flags;
+  /* Génération des caps en vigueur à la publication */
+  guint32 caps_generation;
+} MyShmFrameInfo;
+
+typedef enum
+{
+  MY_SHM_DOORBELL_READY,
+  MY_SHM_DOORBELL_FREE,
+} MyShmDoorbell;
+
+typedef struct _MyShmRing MyShmRing;
+
+/* Crée un anneau neuf, côté producteur. La taille des emplacements est
+ * arrondie à la page. */
+MyShmRing *my_shm_ring_new(guint n_slots, gsize slot_size, GError **error);
+/* Ouvre l'anneau reçu d'un autre processus, côté consommateur. Prend
+ * possession des descripteurs, même en cas d'échec. */
+MyShmRing *my_shm_ring_attach(const int fds[MY_SHM_RING_N_FDS], GError **error);
+
+MyShmRing *my_shm_ring_ref(MyShmRing *ring);
+void my_shm_ring_unref(MyShmRing *ring);
+
+/* Descripteurs à transmettre au consommateur ; restent à l'anneau */
+void my_shm_ring_get_fds(const MyShmRing *ring, int fds[MY_SHM_RING_N_FDS]);
+guint my_shm_ring_n_slots(const MyShmRing *ring);
+gsize my_shm_ring_slot_size(const MyShmRing *ring);
+guint8 *my_shm_ring_slot_data(const MyShmRing *ring, guint slot);
+
+/* ---- Producteur ----
+ * acquire et abandon depuis n'importe quel thread ; publish, set_caps et
+ * reclaim depuis un seul à la fois. */
+
+/* Un emplacement libre, réservé à l'appelant, ou -1 si tous sont pris */
+gint my_shm_ring_acquire(MyShmRing *ring);
+/* Rend un emplacement réservé sans le publier */
+void my_shm_ring_abandon(MyShmRing *ring, guint slot);
+/* Passe l'emplacement au consommateur et sonne « frame prête » */
+void my_shm_ring_publish(MyShmRing *ring, guint slot, const MyShmFrameInfo *info);
+/* Nouvelles caps pour les frames publiées ensuite. FALSE si trop longues. */
+gboolean my_shm_ring_set_caps(MyShmRing *ring, const gchar *caps);
+guint32 my_shm_ring_caps_generation(const MyShmRing *ring);
+/* Le consommateur est parti : ce qu'il n'a pas libéré redevient libre,
+ * la file est vidée. Ses libérations tardives seront ignorées. Ne pas
+ * appeler pendant un publish. */
+void my_shm_ring_reclaim(MyShmRing *ring);
+
+/* ---- Consommateur ----
+ * pop et dup_caps depuis un seul thread ; release depuis n'importe lequel. */
+
+/* Prochaine frame publiée, ou -1 si la file est vide. `epoch` est à
+ * rendre avec l'emplacement. */
+gint my_shm_ring_pop(MyShmRing *ring, MyShmFrameInfo *info, guint32 *epoch);
+/* Copie des caps courantes et de leur génération, NULL si aucune */
+gchar *my_shm_ring_dup_caps(MyShmRing *ring, guint32 *generation);
+/* Rend l'emplacement au producteur et sonne « emplacement libre ». Sans
+ * effet si le producteur l'a repris entre-temps (reclaim). */
+void my_shm_ring_release(MyShmRing *ring, guint slot, guint32 epoch);
+
+/* Source GLib prête dès que la sonnette a sonné ; la sonnette est remise
+ * à zéro avant l'appel du callback (GSourceFunc). */
+GSource *my_shm_doorbell_source_new(MyShmRing *ring, MyShmDoorbell doorbell);
+
+/* ---- Passage des descripteurs (SCM_RIGHTS) ---- */
+
+gboolean my_shm_send_fds(int socket, const int *fds, guint n_fds, GError **error);
+/* Bloquant. FALSE aussi si le pair a fermé avant d'envoyer. */
+gboolean my_shm_recv_fds(int socket, int *fds, guint n_fds, GError **error);
@@ -0,0 +1,803 @@
+#include <gst/gst.h>
+#include <gst/base/gstbasesink.h>
+#include <gst/video/video.h>
+#include <glib-unix.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "myshm_elements.h"
+#include "myshm_ring.h"
+
+/* =======================
+ *  Déclarations “boilerplate”
+ * ======================= */
+
+struct _GstMyShmSink
+{
+  GstBaseSink parent;
+
+  /* Protège les propriétés, l'anneau, le consommateur et la publication */
+  GMutex lock;
+  gchar *socket_path;
+  guint n_slots;
+  guint slot_size;
+
+  MyShmRing *ring;
+
+  /* Socket d'écoute et consommateur, servis par le thread de contrôle.
+   * Un consommateur à la fois ; `connected` une fois l'anneau transmis. */
+  int listen_fd;
+  int client_fd;
+  gboolean connected;
+  GSource *client_source;
+  GMainContext *control_context;
+  GMainLoop *control_loop;
+  GThread *control_thread;
+
+  /* Attente d'un emplacement libre : sonnette « emplacement libre »,
+   * réveillée aussi par unlock, le flush du pool et le départ du
+   * consommateur */
+  GMainContext *wait_context;
+  GSource *free_source;
+  gint unlocked;
+
+  /* Compteurs (atomiques) */
+  gint copies;
+  gint dropped;
+};
+
+GST_DEBUG_CATEGORY_STATIC(gst_my_shm_sink_debug);
+#define GST_CAT_DEFAULT gst_my_shm_sink_debug
+
+G_DEFINE_TYPE_WITH_CODE(GstMyShmSink, gst_my_shm_sink, GST_TYPE_BASE_SINK,
+                        GST_DEBUG_CATEGORY_INIT(gst_my_shm_sink_debug, "myshmsink", 0,
+                                                "Frames vers un autre processus, en mémoire partagée"))
+
+enum
+{
+  PROP_0,
+  PROP_SOCKET_PATH,
+  PROP_N_SLOTS,
+  PROP_SLOT_SIZE,
+  PROP_CONNECTED,
+  PROP_COPIES,
+  PROP_DROPPED,
+};
+
+#define DEFAULT_SOCKET_PATH "/tmp/myshm.sock"
+#define DEFAULT_N_SLOTS 8
+
+/* Emplacement réservé pour un buffer du pool, attaché à sa mémoire */
+typedef struct
+{
+  MyShmRing *ring;
+  guint slot;
+  gint published;
+} GstMyShmSlot;
+
+static GQuark gst_my_shm_slot_quark;
+
+static void
+gst_my_shm_slot_free(gpointer data)
+{
+  GstMyShmSlot *s = (GstMyShmSlot *)data;
+  /* Publié : l'emplacement est au consommateur, qui le libérera */
+  if (!g_atomic_int_get(&s->published))
+    my_shm_ring_abandon(s->ring, s->slot);
+  my_shm_ring_unref(s->ring);
+  g_free(s);
+}
+
+/* Un buffer dont l'unique mémoire est l'emplacement `slot`, pour
+ * `frame_size` octets */
+static GstBuffer *
+gst_my_shm_wrap_slot(MyShmRing *ring, guint slot, gsize frame_size)
+{
+  GstMyShmSlot *s = g_new0(GstMyShmSlot, 1);
+  s->ring = my_shm_ring_ref(ring);
+  s->slot = slot;
+  GstMemory *mem = gst_memory_new_wrapped((GstMemoryFlags)0, my_shm_ring_slot_data(ring, slot),
+                                          my_shm_ring_slot_size(ring), 0, frame_size,
+                                          s, gst_my_shm_slot_free);
+  gst_mini_object_set_qdata(GST_MINI_OBJECT_CAST(mem), gst_my_shm_slot_quark, s, NULL);
+  GstBuffer *buffer = gst_buffer_new();
+  gst_buffer_append_memory(buffer, mem);
+  return buffer;
+}
+
+/* L'emplacement de l'anneau derrière `buf`, s'il tient dans une seule
+ * mémoire venue de notre pool et pas encore publiée */
+static GstMyShmSlot *
+gst_my_shm_slot_of(MyShmRing *ring, GstBuffer *buf)
+{
+  if (gst_buffer_n_memory(buf) != 1)
+    return NULL;
+  GstMemory *mem = gst_buffer_peek_memory(buf, 0);
+  while (mem->parent)
+    mem = mem->parent;
+  GstMyShmSlot *s = (GstMyShmSlot *)gst_mini_object_get_qdata(GST_MINI_OBJECT_CAST(mem), gst_my_shm_slot_quark);
+  if (s == NULL || s->ring != ring || g_atomic_int_get(&s->published))
+    return NULL;
+  return s;
+}
+
+/* Attend un emplacement libre en itérant `context`, où sonne la sonnette
+ * « emplacement libre ». -1 si l'attente est interrompue : unlock de
+ * l'élément, ou flush du pool quand `pool` est donné. */
+static gint
+gst_my_shm_sink_wait_slot(GstMyShmSink *self, MyShmRing *ring, GMainContext *context, GstBufferPool *pool)
+{
+  for (;;) {
+    gint slot = my_shm_ring_acquire(ring);
+    if (slot >= 0)
+      return slot;
+    if (g_atomic_int_get(&self->unlocked) || (pool && GST_BUFFER_POOL_IS_FLUSHING(pool)))
+      return -1;
+    /* Plusieurs threads peuvent attendre : un seul itère, les autres
+     * dorment jusqu'à ce qu'il rende le contexte */
+    g_main_context_iteration(context, TRUE);
+  }
+}
+
+/* =======================
+ *  Pool : les buffers de l'amont sont des emplacements de l'anneau
+ * ======================= */
+
+#define GST_TYPE_MY_SHM_POOL (gst_my_shm_pool_get_type())
+G_DECLARE_FINAL_TYPE(GstMyShmPool, gst_my_shm_pool, GST, MY_SHM_POOL, GstBufferPool)
+
+struct _GstMyShmPool
+{
+  GstBufferPool parent;
+  GstMyShmSink *sink;
+  MyShmRing *ring;
+  /* Celui de l'élément à la création : le pool peut lui survivre */
+  GMainContext *wait_context;
+  gsize frame_size;
+};
+
+G_DEFINE_TYPE(GstMyShmPool, gst_my_shm_pool, GST_TYPE_BUFFER_POOL)
+
+static gboolean
+gst_my_shm_pool_set_config(GstBufferPool *pool, GstStructure *config)
+{
+  GstMyShmPool *self = GST_MY_SHM_POOL(pool);
+  GstCaps *caps;
+  guint size, min, max;
+
+  if (!gst_buffer_pool_config_get_params(config, &caps, &size, &min, &max))
+    return FALSE;
+  if (size == 0 || size > my_shm_ring_slot_size(self->ring)) {
+    GST_WARNING_OBJECT(pool, "buffers de %u octets, emplacements de %" G_GSIZE_FORMAT,
+                       size, my_shm_ring_slot_size(self->ring));
+    return FALSE;
+  }
+  self->frame_size = size;
+  /* Le nombre de buffers est celui des emplacements */
+  gst_buffer_pool_config_set_params(config, caps, size, 0, 0);
+  return GST_BUFFER_POOL_CLASS(gst_my_shm_pool_parent_class)->set_config(pool, config);
+}
+
+static GstFlowReturn
+gst_my_shm_pool_acquire_buffer(GstBufferPool *pool, GstBuffer **buffer, GstBufferPoolAcquireParams *params)
+{
+  GstMyShmPool *self = GST_MY_SHM_POOL(pool);
+  gint slot;
+
+  if (params && (params->flags & GST_BUFFER_POOL_ACQUIRE_FLAG_DONTWAIT))
+    slot = my_shm_ring_acquire(self->ring);
+  else
+    slot = gst_my_shm_sink_wait_slot(self->sink, self->ring, self->wait_context, pool);
+  if (slot < 0)
+    return (params && (params->flags & GST_BUFFER_POOL_ACQUIRE_FLAG_DONTWAIT)) ? GST_FLOW_EOS : GST_FLOW_FLUSHING;
+
+  *buffer = gst_my_shm_wrap_slot(self->ring, (guint)slot, self->frame_size);
+  return GST_FLOW_OK;
+}
+
+/* Un buffer rendu n'est pas recyclé : sa mémoire rend l'emplacement */
+static void
+gst_my_shm_pool_release_buffer(GstBufferPool *pool, GstBuffer *buffer)
+{
+  (void)pool;
+  gst_buffer_unref(buffer);
+}
+
+static void
+gst_my_shm_pool_flush_start(GstBufferPool *pool)
+{
+  g_main_context_wakeup(GST_MY_SHM_POOL(pool)->wait_context);
+}
+
+static void
+gst_my_shm_pool_finalize(GObject *object)
+{
+  GstMyShmPool *self = GST_MY_SHM_POOL(object);
+  my_shm_ring_unref(self->ring);
+  g_main_context_unref(self->wait_context);
+  gst_object_unref(self->sink);
+  G_OBJECT_CLASS(gst_my_shm_pool_parent_class)->finalize(object);
+}
+
+static void
+gst_my_shm_pool_class_init(GstMyShmPoolClass *klass)
+{
+  GstBufferPoolClass *pool_class = GST_BUFFER_POOL_CLASS(klass);
+  G_OBJECT_CLASS(klass)->finalize = gst_my_shm_pool_finalize;
+  pool_class->set_config = gst_my_shm_pool_set_config;
+  pool_class->acquire_buffer = gst_my_shm_pool_acquire_buffer;
+  pool_class->release_buffer = gst_my_shm_pool_release_buffer;
+  pool_class->flush_start = gst_my_shm_pool_flush_start;
+}
+
+static void
+gst_my_shm_pool_init(GstMyShmPool *self)
+{
+  (void)self;
+}
+
+static GstBufferPool *
+gst_my_shm_pool_new(GstMyShmSink *sink, MyShmRing *ring)
+{
+  GstMyShmPool *pool = GST_MY_SHM_POOL(g_object_new(GST_TYPE_MY_SHM_POOL, NULL));
+  gst_object_ref_sink(pool);
+  pool->sink = GST_MY_SHM_SINK(gst_object_ref(sink));
+  pool->ring = my_shm_ring_ref(ring);
+  pool->wait_context = g_main_context_ref(sink->wait_context);
+  return GST_BUFFER_POOL(pool);
+}
+
+/* =======================
+ *  Consommateur (thread de contrôle)
+ * ======================= */
+
+/* À appeler avec self->lock */
+static void
+gst_my_shm_sink_drop_client(GstMyShmSink *self)
+{
+  if (self->client_fd < 0)
+    return;
+  g_source_destroy(self->client_source);
+  g_source_unref(self->client_source);
+  self->client_source = NULL;
+  close(self->client_fd);
+  self->client_fd = -1;
+  /* Ce que le consommateur n'a pas libéré ne le sera jamais : publish
+   * prend le même verrou, rien n'est publié pendant la reprise */
+  if (self->connected && self->ring)
+    my_shm_ring_reclaim(self->ring);
+  self->connected = FALSE;
+  g_main_context_wakeup(self->wait_context);
+}
+
+/* À appeler avec self->lock : donne l'anneau au consommateur en attente */
+static void
+gst_my_shm_sink_offer_ring(GstMyShmSink *self)
+{
+  if (self->client_fd < 0 || self->connected || self->ring == NULL)
+    return;
+  int fds[MY_SHM_RING_N_FDS];
+  GError *error = NULL;
+  my_shm_ring_get_fds(self->ring, fds);
+  if (!my_shm_send_fds(self->client_fd, fds, MY_SHM_RING_N_FDS, &error)) {
+    GST_WARNING_OBJECT(self, "envoi de l'anneau : %s", error->message);
+    g_error_free(error);
+    gst_my_shm_sink_drop_client(self);
+    return;
+  }
+  self->connected = TRUE;
+  GST_INFO_OBJECT(self, "consommateur connecté");
+}
+
+/* Le consommateur n'envoie rien : lisible veut dire parti */
+static gboolean
+gst_my_shm_sink_on_client(gint fd, GIOCondition condition, gpointer data)
+{
+  GstMyShmSink *self = GST_MY_SHM_SINK(data);
+  (void)fd;
+  (void)condition;
+  g_mutex_lock(&self->lock);
+  GST_INFO_OBJECT(self, "consommateur parti");
+  gst_my_shm_sink_drop_client(self);
+  g_mutex_unlock(&self->lock);
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+gst_my_shm_sink_on_accept(gint fd, GIOCondition condition, gpointer data)
+{
+  GstMyShmSink *self = GST_MY_SHM_SINK(data);
+  (void)condition;
+  int client = accept4(fd, NULL, NULL, SOCK_CLOEXEC);
+  if (client < 0)
+    return G_SOURCE_CONTINUE;
+
+  g_mutex_lock(&self->lock);
+  if (self->client_fd >= 0) {
+    g_mutex_unlock(&self->lock);
+    GST_WARNING_OBJECT(self, "un consommateur est déjà connecté, connexion refusée");
+    close(client);
+    return G_SOURCE_CONTINUE;
+  }
+  self->client_fd = client;
+  self->client_source = g_unix_fd_source_new(client, (GIOCondition)(G_IO_IN | G_IO_HUP | G_IO_ERR));
+  g_source_set_callback(self->client_source, G_SOURCE_FUNC(gst_my_shm_sink_on_client), self, NULL);
+  g_source_attach(self->client_source, self->control_context);
+  /* Sans caps, pas encore d'anneau : il partira depuis set_caps */
+  gst_my_shm_sink_offer_ring(self);
+  g_mutex_unlock(&self->lock);
+  return G_SOURCE_CONTINUE;
+}
+
+static gpointer
+gst_my_shm_sink_control_thread(gpointer data)
+{
+  GstMyShmSink *self = GST_MY_SHM_SINK(data);
+  g_main_context_push_thread_default(self->control_context);
+  g_main_loop_run(self->control_loop);
+  g_main_context_pop_thread_default(self->control_context);
+  return NULL;
+}
+
+static gboolean
+gst_my_shm_sink_quit_control(gpointer data)
+{
+  g_main_loop_quit((GMainLoop *)data);
+  return G_SOURCE_REMOVE;
+}
+
+/* =======================
+ *  Démarrage et arrêt
+ * ======================= */
+
+static int
+gst_my_shm_sink_listen(GstMyShmSink *self, const gchar *path)
+{
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof addr);
+  addr.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof addr.sun_path) {
+    GST_ELEMENT_ERROR(self, RESOURCE, SETTINGS, (NULL), ("chemin de socket trop long : %s", path));
+    return -1;
+  }
+  strcpy(addr.sun_path, path);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    GST_ELEMENT_ERROR(self, RESOURCE, OPEN_READ_WRITE, (NULL), ("socket : %s", g_strerror(errno)));
+    return -1;
+  }
+  /* Une socket laissée par une instance précédente empêcherait le bind */
+  unlink(path);
+  if (bind(fd, (struct sockaddr *)&addr, sizeof addr) < 0 || listen(fd, 1) < 0) {
+    GST_ELEMENT_ERROR(self, RESOURCE, OPEN_READ_WRITE, (NULL), ("%s : %s", path, g_strerror(errno)));
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+static gboolean
+gst_my_shm_sink_start(GstBaseSink *base)
+{
+  GstMyShmSink *self = GST_MY_SHM_SINK(base);
+
+  g_mutex_lock(&self->lock);
+  gchar *path = g_strdup(self->socket_path);
+  g_mutex_unlock(&self->lock);
+  self->listen_fd = gst_my_shm_sink_listen(self, path);
+  g_free(path);
+  if (self->listen_fd < 0)
+    return FALSE;
+
+  g_atomic_int_set(&self->copies, 0);
+  g_atomic_int_set(&self->dropped, 0);
+  g_atomic_int_set(&self->unlocked, FALSE);
+  self->wait_context = g_main_context_new();
+  self->control_context = g_main_context_new();
+  self->control_loop = g_main_loop_new(self->control_context, FALSE);
+  GSource *accept_source = g_unix_fd_source_new(self->listen_fd, G_IO_IN);
+  g_source_set_callback(accept_source, G_SOURCE_FUNC(gst_my_shm_sink_on_accept), self, NULL);
+  g_source_attach(accept_source, self->control_context);
+  g_source_unref(accept_source);
+  self->control_thread = g_thread_new("myshmsink-ctl", gst_my_shm_sink_control_thread, self);
+  return TRUE;
+}
+
+static gboolean
+gst_my_shm_sink_stop(GstBaseSink *base)
+{
+  GstMyShmSink *self = GST_MY_SHM_SINK(base);
+
+  /* Une source plutôt que g_main_loop_quit : un quit avant que le
+   * thread n'entre dans sa boucle serait perdu */
+  GSource *quit = g_idle_source_new();
+  g_source_set_callback(quit, gst_my_shm_sink_quit_control, self->control_loop, NULL);
+  g_source_attach(quit, self->control_context);
+  g_source_unref(quit);
+  g_thread_join(self->control_thread);
+  self->control_thread = NULL;
+
+  g_mutex_lock(&self->lock);
+  gst_my_shm_sink_drop_client(self);
+  close(self->listen_fd);
+  self->listen_fd = -1;
+  unlink(self->socket_path);
+  /* Les buffers encore en amont gardent leur référence sur l'anneau */
+  if (self->ring) {
+    my_shm_ring_unref(self->ring);
+    self->ring = NULL;
+  }
+  g_mutex_unlock(&self->lock);
+
+  if (self->free_source) {
+    g_source_destroy(self->free_source);
+    g_source_unref(self->free_source);
+    self->free_source = NULL;
+  }
+  g_main_loop_unref(self->control_loop);
+  g_main_context_unref(self->control_context);
+  g_main_context_unref(self->wait_context);
+  self->control_loop = NULL;
+  self->control_context = NULL;
+  self->wait_context = NULL;
+  return TRUE;
+}
+
+static gboolean
+gst_my_shm_sink_unlock(GstBaseSink *base)
+{
+  GstMyShmSink *self = GST_MY_SHM_SINK(base);
+  g_atomic_int_set(&self->unlocked, TRUE);
+  g_main_context_wakeup(self->wait_context);
+  return TRUE;
+}
+
+static gboolean
+gst_my_shm_sink_unlock_stop(GstBaseSink *base)
+{
+  g_atomic_int_set(&GST_MY_SHM_SINK(base)->unlocked, FALSE);
+  return TRUE;
+}
+
+/* =======================
+ *  Caps et allocation
+ * ======================= */
+
+/* Taille d'une frame pour ces caps : celle de la vidéo brute, sinon la
+ * propriété slot-size */
+static gsize
+gst_my_shm_sink_frame_size(GstMyShmSink *self, GstCaps *caps)
+{
+  GstVideoInfo info;
+  gsize size = self->slot_size;
+  if (gst_video_info_from_caps(&info, caps))
+    size = MAX(size, info.size);
+  return size;
+}
+
+/* Crée l'anneau aux premières caps. Les suivantes ne le recréent pas :
+ * le consommateur le garde, seules les caps publiées changent. */
+static gboolean
+gst_my_shm_sink_set_caps(GstBaseSink *base, GstCaps *caps)
+{
+  GstMyShmSink *self = GST_MY_SHM_SINK(base);
+  GError *error = NULL;
+
+  g_mutex_lock(&self->lock);
+  const gsize size = gst_my_shm_sink_frame_size(self, caps);
+  const guint n_slots = self->n_slots;
+  g_mutex_unlock(&self->lock);
+  if (size == 0) {
+    GST_ELEMENT_ERROR(self, CORE, NEGOTIATION, (NULL),
+                      ("caps non vidéo : slot-size doit donner la taille des frames"));
+    return FALSE;
+  }
+
+  MyShmRing *ring = self->ring;
+  if (ring == NULL) {
+    ring = my_shm_ring_new(n_slots, size, &error);
+    if (ring == NULL) {
+      GST_ELEMENT_ERROR(self, RESOURCE, NO_SPACE_LEFT, (NULL), ("anneau : %s", error->message));
+      g_error_free(error);
+      return FALSE;
+    }
+    self->free_source = my_shm_doorbell_source_new(ring, MY_SHM_DOORBELL_FREE);
+    g_source_attach(self->free_source, self->wait_context);
+    GST_DEBUG_OBJECT(self, "anneau de %u emplacements de %" G_GSIZE_FORMAT " octets",
+                     n_slots, my_shm_ring_slot_size(ring));
+  } else if (size > my_shm_ring_slot_size(ring)) {
+    GST_ELEMENT_ERROR(self, CORE, NEGOTIATION, (NULL),
+                      ("frames de %" G_GSIZE_FORMAT " octets, emplacements de %" G_GSIZE_FORMAT,
+                       size, my_shm_ring_slot_size(ring)));
+    return FALSE;
+  }
+
+  gchar *str = gst_caps_to_string(caps);
+  const gboolean stored = my_shm_ring_set_caps(ring, str);
+  g_free(str);
+  if (!stored) {
+    GST_ELEMENT_ERROR(self, CORE, NEGOTIATION, (NULL), ("caps trop longues pour l'anneau"));
+    if (self->ring == NULL)
+      my_shm_ring_unref(ring);
+    return FALSE;
+  }
+
+  g_mutex_lock(&self->lock);
+  self->ring = ring;
+  gst_my_shm_sink_offer_ring(self);
+  g_mutex_unlock(&self->lock);
+  return TRUE;
+}
+
+/* Propose à l'amont d'écrire directement dans l'anneau */
+static gboolean
+gst_my_shm_sink_propose_allocation(GstBaseSink *base, GstQuery *query)
+{
+  GstMyShmSink *self = GST_MY_SHM_SINK(base);
+  GstCaps *caps;
+  gboolean need_pool;
+
+  gst_query_parse_allocation(query, &caps, &need_pool);
+  if (caps == NULL || self->ring == NULL)
+    return TRUE;
+
+  g_mutex_lock(&self->lock);
+  const gsize size = gst_my_shm_sink_frame_size(self, caps);
+  g_mutex_unlock(&self->lock);
+  if (size == 0 || size > my_shm_ring_slot_size(self->ring))
+    return TRUE;
+
+  GstBufferPool *pool = gst_my_shm_pool_new(self, self->ring);
+  GstStructure *config = gst_buffer_pool_get_config(pool);
+  gst_buffer_pool_config_set_params(config, caps, (guint)size, 0, 0);
+  if (!gst_buffer_pool_set_config(pool, config)) {
+    gst_object_unref(pool);
+    return TRUE;
+  }
+  gst_query_add_allocation_pool(query, pool, (guint)size, 0, 0);
+  gst_object_unref(pool);
+  return TRUE;
+}
+
+/* =======================
+ *  Fonction de traitement
+ * ======================= */
+
+/* Publie l'emplacement si un consommateur l'attend, sinon le rend */
+static void
+gst_my_shm_sink_publish(GstMyShmSink *self, guint slot, const MyShmFrameInfo *info, GstMyShmSlot *held)
+{
+  g_mutex_lock(&self->lock);
+  if (self->connected) {
+    my_shm_ring_publish(self->ring, slot, info);
+    if (held)
+      g_atomic_int_set(&held->published, TRUE);
+  } else {
+    g_atomic_int_inc(&self->dropped);
+    if (!held)
+      my_shm_ring_abandon(self->ring, slot);
+  }
+  g_mutex_unlock(&self->lock);
+}
+
+static GstFlowReturn
+gst_my_shm_sink_render(GstBaseSink *base, GstBuffer *buf)
+{
+  GstMyShmSink *self = GST_MY_SHM_SINK(base);
+  MyShmRing *ring = self->ring;
+  MyShmFrameInfo info;
+
+  if (ring == NULL)
+    return GST_FLOW_NOT_NEGOTIATED;
+
+  memset(&info, 0, sizeof info);
+  info.pts = GST_BUFFER_PTS(buf);
+  info.dts = GST_BUFFER_DTS(buf);
+  info.duration = GST_BUFFER_DURATION(buf);
+  /* Les drapeaux du GstMiniObject n'ont pas de sens de l'autre côté */
+  info.flags = GST_BUFFER_FLAGS(buf) & ~(GST_MINI_OBJECT_FLAG_LAST - 1) & ~GST_BUFFER_FLAG_TAG_MEMORY;
+  info.caps_generation = my_shm_ring_caps_generation(ring);
+
+  /* Chemin normal : l'amont a écrit dans un emplacement de notre pool */
+  GstMyShmSlot *held = gst_my_shm_slot_of(ring, buf);
+  if (held) {
+    GstMemory *mem = gst_buffer_peek_memory(buf, 0);
+    info.offset = mem->offset;
+    info.size = mem->size;
+    gst_my_shm_sink_publish(self, held->slot, &info, held);
+    return GST_FLOW_OK;
+  }
+
+  /* L'amont a ignoré le pool : une copie, comptée */
+  info.size = gst_buffer_get_size(buf);
+  if (info.size > my_shm_ring_slot_size(ring)) {
+    GST_ELEMENT_ERROR(self, STREAM, FAILED, (NULL),
+                      ("buffer de %" G_GUINT64_FORMAT " octets, emplacements de %" G_GSIZE_FORMAT,
+                       info.size, my_shm_ring_slot_size(ring)));
+    return GST_FLOW_ERROR;
+  }
+  g_mutex_lock(&self->lock);
+  const gboolean connected = self->connected;
+  g_mutex_unlock(&self->lock);
+  if (!connected) {
+    g_atomic_int_inc(&self->dropped);
+    return GST_FLOW_OK;
+  }
+
+  gint slot;
+  while ((slot = gst_my_shm_sink_wait_slot(self, ring, self->wait_context, NULL)) < 0) {
+    GstFlowReturn ret = gst_base_sink_wait_preroll(base);
+    if (ret != GST_FLOW_OK)
+      return ret;
+  }
+  gst_buffer_extract(buf, 0, my_shm_ring_slot_data(ring, (guint)slot), info.size);
+  g_atomic_int_inc(&self->copies);
+  gst_my_shm_sink_publish(self, (guint)slot, &info, NULL);
+  return GST_FLOW_OK;
+}
+
+/* =======================
+ *  Propriétés
+ * ======================= */
+
+static void
+gst_my_shm_sink_set_property(GObject *object, guint prop_id, const GValue *value, GParamSpec *pspec)
+{
+  GstMyShmSink *self = GST_MY_SHM_SINK(object);
+
+  g_mutex_lock(&self->lock);
+  switch (prop_id) {
+    case PROP_SOCKET_PATH:
+      g_free(self->socket_path);
+      self->socket_path = g_value_dup_string(value);
+      break;
+    case PROP_N_SLOTS:
+      self->n_slots = g_value_get_uint(value);
+      break;
+    case PROP_SLOT_SIZE:
+      self->slot_size = g_value_get_uint(value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+      break;
+  }
+  g_mutex_unlock(&self->lock);
+}
+
+static void
+gst_my_shm_sink_get_property(GObject *object, guint prop_id, GValue *value, GParamSpec *pspec)
+{
+  GstMyShmSink *self = GST_MY_SHM_SINK(object);
+
+  /* Compteurs : lus sans self->lock, que render prend à chaque buffer */
+  switch (prop_id) {
+    case PROP_COPIES:
+      g_value_set_uint(value, (guint)g_atomic_int_get(&self->copies));
+      return;
+    case PROP_DROPPED:
+      g_value_set_uint(value, (guint)g_atomic_int_get(&self->dropped));
+      return;
+    default:
+      break;
+  }
+
+  g_mutex_lock(&self->lock);
+  switch (prop_id) {
+    case PROP_SOCKET_PATH:
+      g_value_set_string(value, self->socket_path);
+      break;
+    case PROP_N_SLOTS:
+      g_value_set_uint(value, self->n_slots);
+      break;
+    case PROP_SLOT_SIZE:
+      g_value_set_uint(value, self->slot_size);
+      break;
+    case PROP_CONNECTED:
+      g_value_set_boolean(value, self->connected);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+      break;
+  }
+  g_mutex_unlock(&self->lock);
+}
+
+static void
+gst_my_shm_sink_finalize(GObject *object)
+{
+  GstMyShmSink *self = GST_MY_SHM_SINK(object);
+  g_free(self->socket_path);
+  g_mutex_clear(&self->lock);
+  G_OBJECT_CLASS(gst_my_shm_sink_parent_class)->finalize(object);
+}
+
+/* =======================
+ *  Initialisation de la classe
+ * ======================= */
+static void
+gst_my_shm_sink_class_init(GstMyShmSinkClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+  GstBaseSinkClass *sink_class = GST_BASE_SINK_CLASS(klass);
+
+  gst_my_shm_slot_quark = g_quark_from_static_string("myshm-slot");
+
+  /* Tout format : la vidéo brute donne la taille des emplacements,
+   * slot-size sinon */
+  static GstStaticPadTemplate sink_templ = GST_STATIC_PAD_TEMPLATE(
+      "sink", GST_PAD_SINK, GST_PAD_ALWAYS, GST_STATIC_CAPS_ANY);
+  gst_element_class_add_static_pad_template(GST_ELEMENT_CLASS(klass), &sink_templ);
+
+  gobject_class->set_property = gst_my_shm_sink_set_property;
+  gobject_class->get_property = gst_my_shm_sink_get_property;
+  gobject_class->finalize = gst_my_shm_sink_finalize;
+
+  g_object_class_install_property(gobject_class, PROP_SOCKET_PATH,
+      g_param_spec_string("socket-path", "Socket",
+                          "Socket Unix où le consommateur vient chercher l'anneau",
+                          DEFAULT_SOCKET_PATH,
+                          (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+  g_object_class_install_property(gobject_class, PROP_N_SLOTS,
+      g_param_spec_uint("n-slots", "Emplacements",
+                        "Frames en vol entre l'amont et le consommateur",
+                        2, 64, DEFAULT_N_SLOTS,
+                        (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+  g_object_class_install_property(gobject_class, PROP_SLOT_SIZE,
+      g_param_spec_uint("slot-size", "Taille d'emplacement",
+                        "Taille minimale d'un emplacement en octets (0 = taille d'une frame "
+                        "vidéo ; requise pour les autres caps)",
+                        0, G_MAXINT, 0,
+                        (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+  g_object_class_install_property(gobject_class, PROP_CONNECTED,
+      g_param_spec_boolean("connected", "Connecté", "Un consommateur a reçu l'anneau",
+                           FALSE,
+                           (GParamFlags)(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property(gobject_class, PROP_COPIES,
+      g_param_spec_uint("copies", "Copies",
+                        "Frames copiées dans l'anneau faute d'avoir été écrites dans un emplacement",
+                        0, G_MAXUINT, 0,
+                        (GParamFlags)(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property(gobject_class, PROP_DROPPED,
+      g_param_spec_uint("dropped", "Perdues", "Frames jetées faute de consommateur",
+                        0, G_MAXUINT, 0,
+                        (GParamFlags)(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+
+  sink_class->start = GST_DEBUG_FUNCPTR(gst_my_shm_sink_start);
+  sink_class->stop = GST_DEBUG_FUNCPTR(gst_my_shm_sink_stop);
+  sink_class->unlock = GST_DEBUG_FUNCPTR(gst_my_shm_sink_unlock);
+  sink_class->unlock_stop = GST_DEBUG_FUNCPTR(gst_my_shm_sink_unlock_stop);
+  sink_class->set_caps = GST_DEBUG_FUNCPTR(gst_my_shm_sink_set_caps);
+  sink_class->propose_allocation = GST_DEBUG_FUNCPTR(gst_my_shm_sink_propose_allocation);
+  sink_class->render = GST_DEBUG_FUNCPTR(gst_my_shm_sink_render);
+  gst_element_class_set_static_metadata(GST_ELEMENT_CLASS(klass),
+                                        "Sortie en mémoire partagée", "Sink",
+                                        "Publie les frames dans un anneau memfd pour un myshmsrc "
+                                        "d'un autre processus, sans copie",
+                                        "Votre Nom <vous@exemple.com>");
+}
+
+/* =======================
+ *  Initialisation instance
+ * ======================= */
+static void
+gst_my_shm_sink_init(GstMyShmSink *self)
+{
+  g_mutex_init(&self->lock);
+  self->socket_path = g_strdup(DEFAULT_SOCKET_PATH);
+  self->n_slots = DEFAULT_N_SLOTS;
+  self->slot_size = 0;
+  self->ring = NULL;
+  self->listen_fd = -1;
+  self->client_fd = -1;
+  self->connected = FALSE;
+  self->copies = 0;
+  self->dropped = 0;
+  self->unlocked = FALSE;
+  /* Le consommateur impose son rythme via les emplacements libres */
+  gst_base_sink_set_sync(GST_BASE_SINK(self), FALSE);
+  /* Une frame publiée appartient au consommateur : ne pas la garder */
+  gst_base_sink_set_last_sample_enabled(GST_BASE_SINK(self), FALSE);
+}
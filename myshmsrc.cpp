@@ -0,0 +1,377 @@
+#include <gst/gst.h>
+#include <gst/base/gstpushsrc.h>
+#include <glib-unix.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "myshm_elements.h"
+#include "myshm_ring.h"
+
+/* =======================
+ *  Déclarations “boilerplate”
+ * ======================= */
+
+struct _GstMyShmSrc
+{
+  GstPushSrc parent;
+
+  /* Protège les propriétés */
+  GMutex lock;
+  gchar *socket_path;
+
+  /* Le reste n'est touché que depuis le thread de streaming, entre start
+   * et stop : les sources de `context` sont dispatchées dans create */
+  int socket_fd;
+  MyShmRing *ring;
+  GMainContext *context;
+  GSource *socket_source;
+  GSource *ready_source;
+  /* Le producteur a fermé la socket */
+  gboolean peer_gone;
+  gchar *peer_error;
+  gboolean have_caps;
+  guint32 caps_generation;
+
+  /* unlock en cours (atomique) */
+  gint flushing;
+};
+
+GST_DEBUG_CATEGORY_STATIC(gst_my_shm_src_debug);
+#define GST_CAT_DEFAULT gst_my_shm_src_debug
+
+G_DEFINE_TYPE_WITH_CODE(GstMyShmSrc, gst_my_shm_src, GST_TYPE_PUSH_SRC,
+                        GST_DEBUG_CATEGORY_INIT(gst_my_shm_src_debug, "myshmsrc", 0,
+                                                "Frames d'un autre processus, en mémoire partagée"))
+
+enum
+{
+  PROP_0,
+  PROP_SOCKET_PATH,
+};
+
+#define DEFAULT_SOCKET_PATH "/tmp/myshm.sock"
+
+/* =======================
+ *  Producteur
+ * ======================= */
+
+static gboolean
+gst_my_shm_src_on_ready(gpointer data)
+{
+  (void)data;
+  /* Rien à faire : create regarde la file au retour de l'itération */
+  return G_SOURCE_CONTINUE;
+}
+
+/* Avant l'anneau, la socket porte ses descripteurs ; ensuite elle ne
+ * devient lisible qu'à la fermeture par le producteur */
+static gboolean
+gst_my_shm_src_on_socket(gint fd, GIOCondition condition, gpointer data)
+{
+  GstMyShmSrc *self = GST_MY_SHM_SRC(data);
+  (void)condition;
+
+  if (self->ring == NULL) {
+    int fds[MY_SHM_RING_N_FDS];
+    GError *error = NULL;
+    if (my_shm_recv_fds(fd, fds, MY_SHM_RING_N_FDS, &error))
+      self->ring = my_shm_ring_attach(fds, &error);
+    if (self->ring) {
+      GST_INFO_OBJECT(self, "anneau de %u emplacements reçu", my_shm_ring_n_slots(self->ring));
+      self->ready_source = my_shm_doorbell_source_new(self->ring, MY_SHM_DOORBELL_READY);
+      g_source_set_callback(self->ready_source, gst_my_shm_src_on_ready, NULL, NULL);
+      g_source_attach(self->ready_source, self->context);
+      return G_SOURCE_CONTINUE;
+    }
+    /* Fermée sans rien envoyer : un autre consommateur est déjà servi */
+    self->peer_error = g_strdup(error->message);
+    g_error_free(error);
+  }
+  self->peer_gone = TRUE;
+  return G_SOURCE_REMOVE;
+}
+
+/* Caps publiées par le producteur, appliquées avant la première frame
+ * qui les utilise */
+static gboolean
+gst_my_shm_src_negotiate_ring(GstMyShmSrc *self)
+{
+  guint32 generation;
+  gchar *str = my_shm_ring_dup_caps(self->ring, &generation);
+  GstCaps *caps = str ? gst_caps_from_string(str) : NULL;
+  g_free(str);
+  if (caps == NULL) {
+    GST_ELEMENT_ERROR(self, CORE, NEGOTIATION, (NULL), ("caps illisibles dans l'anneau"));
+    return FALSE;
+  }
+  GST_DEBUG_OBJECT(self, "caps %u : %" GST_PTR_FORMAT, generation, caps);
+  const gboolean ok = gst_base_src_set_caps(GST_BASE_SRC(self), caps);
+  gst_caps_unref(caps);
+  if (!ok)
+    return FALSE;
+  self->caps_generation = generation;
+  self->have_caps = TRUE;
+  return TRUE;
+}
+
+/* =======================
+ *  Fonction de traitement
+ * ======================= */
+
+typedef struct
+{
+  MyShmRing *ring;
+  guint slot;
+  guint32 epoch;
+} GstMyShmHeld;
+
+/* Dernière référence au buffer : l'emplacement retourne au producteur,
+ * s'il ne l'a pas déjà repris après notre départ */
+static void
+gst_my_shm_src_release(gpointer data)
+{
+  GstMyShmHeld *held = (GstMyShmHeld *)data;
+  my_shm_ring_release(held->ring, held->slot, held->epoch);
+  my_shm_ring_unref(held->ring);
+  g_free(held);
+}
+
+static GstFlowReturn
+gst_my_shm_src_create(GstPushSrc *base, GstBuffer **buf)
+{
+  GstMyShmSrc *self = GST_MY_SHM_SRC(base);
+  MyShmFrameInfo info;
+  guint32 epoch;
+
+  for (;;) {
+    if (g_atomic_int_get(&self->flushing))
+      return GST_FLOW_FLUSHING;
+
+    gint slot = self->ring ? my_shm_ring_pop(self->ring, &info, &epoch) : -1;
+    if (slot >= 0) {
+      if ((!self->have_caps || info.caps_generation != self->caps_generation)
+          && !gst_my_shm_src_negotiate_ring(self)) {
+        my_shm_ring_release(self->ring, (guint)slot, epoch);
+        return GST_FLOW_NOT_NEGOTIATED;
+      }
+      GstMyShmHeld *held = g_new(GstMyShmHeld, 1);
+      held->ring = my_shm_ring_ref(self->ring);
+      held->slot = (guint)slot;
+      held->epoch = epoch;
+      /* Lecture seule : l'emplacement est la frame du producteur, un
+       * élément qui veut écrire devra la copier */
+      GstBuffer *buffer = gst_buffer_new_wrapped_full(
+          GST_MEMORY_FLAG_READONLY, my_shm_ring_slot_data(self->ring, (guint)slot),
+          my_shm_ring_slot_size(self->ring), (gsize)info.offset, (gsize)info.size,
+          held, gst_my_shm_src_release);
+      /* Les horodatages du producteur sont sur son horloge : do-timestamp
+       * date la frame à son arrivée ici */
+      GST_BUFFER_DURATION(buffer) = info.duration;
+      GST_BUFFER_FLAGS(buffer) = info.flags & ~(GST_MINI_OBJECT_FLAG_LAST - 1) & ~GST_BUFFER_FLAG_TAG_MEMORY;
+      *buf = buffer;
+      return GST_FLOW_OK;
+    }
+
+    if (self->peer_gone) {
+      if (self->ring)
+        return GST_FLOW_EOS;
+      GST_ELEMENT_ERROR(self, RESOURCE, READ, (NULL),
+                        ("le producteur n'a pas donné d'anneau : %s",
+                         self->peer_error ? self->peer_error : "connexion fermée"));
+      return GST_FLOW_ERROR;
+    }
+    g_main_context_iteration(self->context, TRUE);
+  }
+}
+
+/* =======================
+ *  Démarrage et arrêt
+ * ======================= */
+
+static gboolean
+gst_my_shm_src_start(GstBaseSrc *base)
+{
+  GstMyShmSrc *self = GST_MY_SHM_SRC(base);
+  struct sockaddr_un addr;
+
+  memset(&addr, 0, sizeof addr);
+  addr.sun_family = AF_UNIX;
+  g_mutex_lock(&self->lock);
+  const gboolean fits = strlen(self->socket_path) < sizeof addr.sun_path;
+  if (fits)
+    strcpy(addr.sun_path, self->socket_path);
+  g_mutex_unlock(&self->lock);
+  if (!fits) {
+    GST_ELEMENT_ERROR(self, RESOURCE, SETTINGS, (NULL), ("chemin de socket trop long"));
+    return FALSE;
+  }
+
+  self->socket_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (self->socket_fd < 0 || connect(self->socket_fd, (struct sockaddr *)&addr, sizeof addr) < 0) {
+    GST_ELEMENT_ERROR(self, RESOURCE, OPEN_READ, (NULL), ("%s : %s", addr.sun_path, g_strerror(errno)));
+    if (self->socket_fd >= 0)
+      close(self->socket_fd);
+    self->socket_fd = -1;
+    return FALSE;
+  }
+
+  self->peer_gone = FALSE;
+  self->have_caps = FALSE;
+  self->context = g_main_context_new();
+  self->socket_source = g_unix_fd_source_new(self->socket_fd, (GIOCondition)(G_IO_IN | G_IO_HUP | G_IO_ERR));
+  g_source_set_callback(self->socket_source, G_SOURCE_FUNC(gst_my_shm_src_on_socket), self, NULL);
+  g_source_attach(self->socket_source, self->context);
+  return TRUE;
+}
+
+static gboolean
+gst_my_shm_src_stop(GstBaseSrc *base)
+{
+  GstMyShmSrc *self = GST_MY_SHM_SRC(base);
+
+  g_source_destroy(self->socket_source);
+  g_source_unref(self->socket_source);
+  self->socket_source = NULL;
+  if (self->ready_source) {
+    g_source_destroy(self->ready_source);
+    g_source_unref(self->ready_source);
+    self->ready_source = NULL;
+  }
+  /* Fermer la socket dit au producteur de reprendre ses emplacements :
+   * les frames encore tenues en aval peuvent alors être réécrites, et leur
+   * libération ne fera plus rien */
+  close(self->socket_fd);
+  self->socket_fd = -1;
+  if (self->ring) {
+    my_shm_ring_unref(self->ring);
+    self->ring = NULL;
+  }
+  g_clear_pointer(&self->peer_error, g_free);
+  g_main_context_unref(self->context);
+  self->context = NULL;
+  return TRUE;
+}
+
+static gboolean
+gst_my_shm_src_unlock(GstBaseSrc *base)
+{
+  GstMyShmSrc *self = GST_MY_SHM_SRC(base);
+  g_atomic_int_set(&self->flushing, TRUE);
+  g_main_context_wakeup(self->context);
+  return TRUE;
+}
+
+static gboolean
+gst_my_shm_src_unlock_stop(GstBaseSrc *base)
+{
+  g_atomic_int_set(&GST_MY_SHM_SRC(base)->flushing, FALSE);
+  return TRUE;
+}
+
+/* =======================
+ *  Propriétés
+ * ======================= */
+
+static void
+gst_my_shm_src_set_property(GObject *object, guint prop_id, const GValue *value, GParamSpec *pspec)
+{
+  GstMyShmSrc *self = GST_MY_SHM_SRC(object);
+
+  g_mutex_lock(&self->lock);
+  switch (prop_id) {
+    case PROP_SOCKET_PATH:
+      g_free(self->socket_path);
+      self->socket_path = g_value_dup_string(value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+      break;
+  }
+  g_mutex_unlock(&self->lock);
+}
+
+static void
+gst_my_shm_src_get_property(GObject *object, guint prop_id, GValue *value, GParamSpec *pspec)
+{
+  GstMyShmSrc *self = GST_MY_SHM_SRC(object);
+
+  g_mutex_lock(&self->lock);
+  switch (prop_id) {
+    case PROP_SOCKET_PATH:
+      g_value_set_string(value, self->socket_path);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+      break;
+  }
+  g_mutex_unlock(&self->lock);
+}
+
+static void
+gst_my_shm_src_finalize(GObject *object)
+{
+  GstMyShmSrc *self = GST_MY_SHM_SRC(object);
+  g_free(self->socket_path);
+  g_mutex_clear(&self->lock);
+  G_OBJECT_CLASS(gst_my_shm_src_parent_class)->finalize(object);
+}
+
+/* =======================
+ *  Initialisation de la classe
+ * ======================= */
+static void
+gst_my_shm_src_class_init(GstMyShmSrcClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+  GstBaseSrcClass *basesrc_class = GST_BASE_SRC_CLASS(klass);
+  GstPushSrcClass *pushsrc_class = GST_PUSH_SRC_CLASS(klass);
+
+  /* Les caps viennent du producteur, par l'anneau */
+  static GstStaticPadTemplate src_templ = GST_STATIC_PAD_TEMPLATE(
+      "src", GST_PAD_SRC, GST_PAD_ALWAYS, GST_STATIC_CAPS_ANY);
+  gst_element_class_add_static_pad_template(GST_ELEMENT_CLASS(klass), &src_templ);
+
+  gobject_class->set_property = gst_my_shm_src_set_property;
+  gobject_class->get_property = gst_my_shm_src_get_property;
+  gobject_class->finalize = gst_my_shm_src_finalize;
+
+  g_object_class_install_property(gobject_class, PROP_SOCKET_PATH,
+      g_param_spec_string("socket-path", "Socket", "Socket Unix d'un myshmsink",
+                          DEFAULT_SOCKET_PATH,
+                          (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+
+  basesrc_class->start = GST_DEBUG_FUNCPTR(gst_my_shm_src_start);
+  basesrc_class->stop = GST_DEBUG_FUNCPTR(gst_my_shm_src_stop);
+  basesrc_class->unlock = GST_DEBUG_FUNCPTR(gst_my_shm_src_unlock);
+  basesrc_class->unlock_stop = GST_DEBUG_FUNCPTR(gst_my_shm_src_unlock_stop);
+  pushsrc_class->create = GST_DEBUG_FUNCPTR(gst_my_shm_src_create);
+  gst_element_class_set_static_metadata(GST_ELEMENT_CLASS(klass),
+                                        "Entrée en mémoire partagée", "Source",
+                                        "Pousse sans copie les frames d'un myshmsink d'un "
+                                        "autre processus",
+                                        "Votre Nom <vous@exemple.com>");
+}
+
+/* =======================
+ *  Initialisation instance
+ * ======================= */
+static void
+gst_my_shm_src_init(GstMyShmSrc *self)
+{
+  g_mutex_init(&self->lock);
+  self->socket_path = g_strdup(DEFAULT_SOCKET_PATH);
+  self->socket_fd = -1;
+  self->ring = NULL;
+  self->context = NULL;
+  self->socket_source = NULL;
+  self->ready_source = NULL;
+  self->peer_gone = FALSE;
+  self->peer_error = NULL;
+  self->have_caps = FALSE;
+  self->flushing = FALSE;
+  gst_base_src_set_live(GST_BASE_SRC(self), TRUE);
+  gst_base_src_set_format(GST_BASE_SRC(self), GST_FORMAT_TIME);
+  gst_base_src_set_do_timestamp(GST_BASE_SRC(self), TRUE);
+}
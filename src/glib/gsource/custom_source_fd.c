@@ -1,90 +1,222 @@
 #include <glib.h>
+#include <glib-unix.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 #include <signal.h>
 
+// One newline-terminated record, without its newline. Only valid during the
+// callback: it points into the source's buffer.
+typedef struct
+{
+    const char *data;
+    gsize len;
+} PipeRecord;
+
+// Called once per wakeup with every complete record read so far. Return FALSE
+// to remove the source.
+typedef gboolean (*PipeBatchFunc)(const PipeRecord *records, guint n_records, gpointer data);
+
+#define PIPE_INITIAL_CAPACITY 4096
+// A record longer than this is handed over in pieces of this size.
+#define PIPE_MAX_CAPACITY (1 << 20)
+// Bytes read per dispatch before letting other sources run. GLib polls
+// level-triggered, so whatever is left wakes us up again right away.
+#define PIPE_READ_BUDGET (1 << 20)
+
 typedef struct
 {
     GSource source;
-    GPollFD pfd; // fd + events + revents
+    gpointer tag; // from g_source_add_unix_fd
+    int fd;
+
+    // Bytes read but not handed over yet are buf[start, end), and
+    // buf[start, scanned) holds no newline. Records are handed over in place;
+    // only the unfinished one is moved back to the front when room runs out,
+    // so a record never wraps and memchr scans it in one go.
+    char *buf;
+    gsize capacity;
+    gsize start;
+    gsize scanned;
+    gsize end;
+
+    PipeRecord *records;
+    guint records_capacity;
+    gboolean eof;
 } PipeSource;
 
-static gboolean pipe_prepare(GSource *s, int *timeout_ms)
+// Makes room for at least one more byte. FALSE when the buffer is at its
+// largest and holds a single unfinished record.
+static gboolean pipe_reserve(PipeSource *ps)
 {
-    *timeout_ms = -1; // no custom timeout; sleep until fd readies
-    return FALSE;
+    if (ps->end < ps->capacity)
+    {
+        return TRUE;
+    }
+    if (ps->start > 0)
+    {
+        memmove(ps->buf, ps->buf + ps->start, ps->end - ps->start);
+        ps->end -= ps->start;
+        ps->scanned -= ps->start;
+        ps->start = 0;
+        return TRUE;
+    }
+    if (ps->capacity >= PIPE_MAX_CAPACITY)
+    {
+        return FALSE;
+    }
+    ps->capacity *= 2;
+    ps->buf = g_realloc(ps->buf, ps->capacity);
+    return TRUE;
 }
 
-static gboolean pipe_check(GSource *s)
+// Reads until EAGAIN, EOF, a full buffer or the budget. FALSE on a read error.
+static gboolean pipe_drain(PipeSource *ps)
 {
-    PipeSource *ps = (PipeSource *)s;
-    return (ps->pfd.revents & G_IO_IN) != 0;
+    gsize budget = PIPE_READ_BUDGET;
+    while (budget > 0 && pipe_reserve(ps))
+    {
+        ssize_t n = read(ps->fd, ps->buf + ps->end, MIN(ps->capacity - ps->end, budget));
+        if (n > 0)
+        {
+            ps->end += (gsize)n;
+            budget -= (gsize)n;
+        }
+        else if (n == 0)
+        {
+            ps->eof = TRUE;
+            return TRUE;
+        }
+        else if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            return TRUE;
+        }
+        else if (errno != EINTR)
+        {
+            g_print("Read error: %s\n", strerror(errno));
+            return FALSE;
+        }
+    }
+    return TRUE;
 }
 
-static gboolean pipe_dispatch(GSource *s, GSourceFunc cb, gpointer data)
+static void pipe_push_record(PipeSource *ps, guint index, gsize from, gsize to)
 {
-    PipeSource *ps = (PipeSource *)s;
-    char buf[256];
-    ssize_t n = read(ps->pfd.fd, buf, sizeof buf); // drain/read available data
-
-    if (n > 0)
+    if (index == ps->records_capacity)
     {
-        buf[n - 1] = '\0'; // null terminate (remove newline)
-        g_print("Read from pipe: %s\n", buf);
+        ps->records_capacity *= 2;
+        ps->records = g_renew(PipeRecord, ps->records, ps->records_capacity);
+    }
+    ps->records[index].data = ps->buf + from;
+    ps->records[index].len = to - from;
+}
 
-        // Check for quit command
-        if (strcmp(buf, "quit") == 0)
+// Splits what was read into records; returns how many. memchr is vectorised
+// by the C library, so long runs without a newline cost little.
+static guint pipe_split(PipeSource *ps)
+{
+    guint n = 0;
+    while (ps->scanned < ps->end)
+    {
+        const char *newline = memchr(ps->buf + ps->scanned, '\n', ps->end - ps->scanned);
+        if (!newline)
         {
-            g_print("Received quit command, stopping main loop\n");
-            GMainLoop *loop = (GMainLoop *)data;
-            g_main_loop_quit(loop);
-            return FALSE;
+            ps->scanned = ps->end;
+            break;
         }
+        gsize at = (gsize)(newline - ps->buf);
+        pipe_push_record(ps, n++, ps->start, at);
+        ps->start = ps->scanned = at + 1;
     }
-    else if (n == 0)
+    // An unfinished record that cannot grow any more, or that never will.
+    gboolean stuck = ps->start == 0 && ps->end == ps->capacity && ps->capacity >= PIPE_MAX_CAPACITY;
+    if (ps->start < ps->end && (stuck || ps->eof))
     {
-        g_print("Pipe closed\n");
-        return FALSE; // remove source
+        pipe_push_record(ps, n++, ps->start, ps->end);
+        ps->start = ps->scanned = ps->end;
     }
-    else
+    // Everything handed over: the next read starts at the front again. The
+    // bytes stay where they are until then, for the records to point at.
+    if (ps->start == ps->end)
     {
-        g_print("Read error: %s\n", strerror(errno));
-        return FALSE; // remove source
+        ps->start = ps->scanned = ps->end = 0;
     }
+    return n;
+}
+
+static gboolean pipe_dispatch(GSource *s, GSourceFunc cb, gpointer data)
+{
+    PipeSource *ps = (PipeSource *)s;
+    // Read what is left even on a hang-up: it comes before the EOF.
+    gboolean readable = pipe_drain(ps);
+    guint n = pipe_split(ps);
 
-    return cb ? cb(data) : TRUE;
+    gboolean keep = TRUE;
+    if (n > 0 && cb)
+    {
+        keep = ((PipeBatchFunc)(void (*)(void))cb)(ps->records, n, data);
+    }
+    if (!readable || ps->eof)
+    {
+        g_print("Pipe closed\n");
+        return FALSE; // remove source
+    }
+    return keep;
 }
 
 static void pipe_finalize(GSource *s)
 {
     PipeSource *ps = (PipeSource *)s;
     g_print("Finalizing pipe source\n");
+    g_free(ps->buf);
+    g_free(ps->records);
     // If your source owns the fd, close it here; if not, skip.
-    // close(ps->pfd.fd);
+    // close(ps->fd);
 }
 
+// No prepare or check: a source is dispatched as soon as one of its unix fds
+// has events.
 static GSourceFuncs pipe_funcs = {
-    .prepare = pipe_prepare,
-    .check = pipe_check,
     .dispatch = pipe_dispatch,
     .finalize = pipe_finalize};
 
+// Watches `fd`, which is switched to non-blocking mode. Set the callback with
+// g_source_set_callback(source, G_SOURCE_FUNC(batch_func), data, notify).
 static GSource *pipe_source_new(int fd)
 {
     PipeSource *ps = (PipeSource *)g_source_new(&pipe_funcs, sizeof *ps);
-    ps->pfd.fd = fd;
-    ps->pfd.events = G_IO_IN;
-    ps->pfd.revents = 0;
-    g_source_add_poll((GSource *)ps, &ps->pfd); // or g_source_add_unix_fd(..., G_IO_IN)
+    GError *error = NULL;
+    if (!g_unix_set_fd_nonblocking(fd, TRUE, &error))
+    {
+        g_print("Cannot make fd %d non-blocking: %s\n", fd, error->message);
+        g_error_free(error);
+    }
+    ps->fd = fd;
+    ps->capacity = PIPE_INITIAL_CAPACITY;
+    ps->buf = g_malloc(ps->capacity);
+    ps->records_capacity = 64;
+    ps->records = g_new(PipeRecord, ps->records_capacity);
+    ps->tag = g_source_add_unix_fd((GSource *)ps, fd, G_IO_IN | G_IO_HUP | G_IO_ERR);
     return (GSource *)ps;
 }
 
-// Callback function when pipe is ready
-static gboolean on_pipe_ready(gpointer data)
+// Callback with each batch of records from the pipe
+static gboolean on_pipe_records(const PipeRecord *records, guint n_records, gpointer data)
 {
-    g_print("Pipe is ready for reading\n");
+    for (guint i = 0; i < n_records; i++)
+    {
+        g_print("Read from pipe: %.*s\n", (int)records[i].len, records[i].data);
+
+        // Check for quit command
+        if (records[i].len == 4 && memcmp(records[i].data, "quit", 4) == 0)
+        {
+            g_print("Received quit command, stopping main loop\n");
+            g_main_loop_quit((GMainLoop *)data);
+            return FALSE;
+        }
+    }
     return TRUE;
 }
 
@@ -100,12 +232,100 @@ static void signal_handler(int sig)
     }
 }
 
+// --bench: a writer thread pushes messages as fast as the pipe takes them.
+typedef struct
+{
+    int fd;
+    guint64 messages;
+} BenchWriter;
+
+typedef struct
+{
+    guint64 records;
+    guint64 batches;
+} BenchCounts;
+
+static gpointer bench_write(gpointer data)
+{
+    BenchWriter *writer = data;
+    char chunk[64 * 1024];
+    gsize used = 0;
+    for (guint64 i = 0; i < writer->messages; i++)
+    {
+        if (used + 40 > sizeof chunk)
+        {
+            if (write(writer->fd, chunk, used) != (ssize_t)used)
+            {
+                break;
+            }
+            used = 0;
+        }
+        used += (gsize)snprintf(chunk + used, sizeof chunk - used, "set bitrate %" G_GUINT64_FORMAT "\n", i);
+    }
+    if (used > 0 && write(writer->fd, chunk, used) != (ssize_t)used)
+    {
+        g_print("Write error: %s\n", strerror(errno));
+    }
+    close(writer->fd); // EOF removes the source
+    return NULL;
+}
+
+static gboolean on_bench_records(const PipeRecord *records, guint n_records, gpointer data)
+{
+    (void)records;
+    BenchCounts *counts = data;
+    counts->records += n_records;
+    counts->batches++;
+    return TRUE;
+}
+
+static void on_bench_done(gpointer data)
+{
+    (void)data;
+    g_main_loop_quit(main_loop);
+}
+
+static int run_bench(guint64 messages)
+{
+    int pipe_fds[2];
+    if (pipe(pipe_fds) == -1)
+    {
+        g_error("Failed to create pipe: %s", strerror(errno));
+        return 1;
+    }
+    main_loop = g_main_loop_new(NULL, FALSE);
+    BenchCounts counts = {0, 0};
+    GSource *source = pipe_source_new(pipe_fds[0]);
+    g_source_set_callback(source, G_SOURCE_FUNC(on_bench_records), &counts, on_bench_done);
+    g_source_attach(source, NULL);
+
+    BenchWriter writer = {pipe_fds[1], messages};
+    gint64 started = g_get_monotonic_time();
+    GThread *thread = g_thread_new("bench-writer", bench_write, &writer);
+    g_main_loop_run(main_loop);
+    double seconds = (double)(g_get_monotonic_time() - started) / G_USEC_PER_SEC;
+    g_thread_join(thread);
+
+    g_print("%" G_GUINT64_FORMAT " records in %.3f s: %.0f records/s, %.1f records per wakeup\n",
+            counts.records, seconds, (double)counts.records / seconds,
+            counts.batches ? (double)counts.records / (double)counts.batches : 0.0);
+    g_source_unref(source);
+    g_main_loop_unref(main_loop);
+    close(pipe_fds[0]);
+    return counts.records == messages ? 0 : 1;
+}
+
 int main(int argc, char *argv[])
 {
     int pipe_fds[2];
     GSource *pipe_source;
     guint source_id;
 
+    if (argc == 3 && strcmp(argv[1], "--bench") == 0)
+    {
+        return run_bench(g_ascii_strtoull(argv[2], NULL, 10));
+    }
+
     g_print("FD-driven GSource Example\n");
     g_print("========================\n\n");
 
@@ -129,8 +349,8 @@ int main(int argc, char *argv[])
     pipe_source = pipe_source_new(pipe_fds[0]);     // monitor read end
     source_id = g_source_attach(pipe_source, NULL); // attach to default context
 
-    // Set the callback (optional, since dispatch handles the logic)
-    g_source_set_callback(pipe_source, on_pipe_ready, main_loop, NULL);
+    // Records are handed to the callback a batch at a time
+    g_source_set_callback(pipe_source, G_SOURCE_FUNC(on_pipe_records), main_loop, NULL);
 
     g_print("Pipe source created and attached (ID: %u)\n", source_id);
     g_print("\nTo test the pipe, run in another terminal:\n");
@@ -155,4 +375,4 @@ int main(int argc, char *argv[])
 
     g_print("Example completed successfully\n");
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,121 @@
+#include "asio_glib_loop.hpp"
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/post.hpp>
+#include <algorithm>
+#include <chrono>
+#include "../logging/logger.h"
+
+AsioGlibLoop::AsioGlibLoop() : context_(g_main_context_new()), timeout_(io_context_) {
+}
+
+AsioGlibLoop::~AsioGlibLoop() {
+    disarm();
+    g_main_context_unref(context_);
+}
+
+void AsioGlibLoop::run() {
+    if (!g_main_context_acquire(context_)) {
+        SLOG_ERROR("GLib", "Main context is owned by another thread");
+        return;
+    }
+    g_main_context_push_thread_default(context_);
+    SLOG_DEBUG("GLib", "Asio and GLib loop started");
+
+    auto work = boost::asio::make_work_guard(io_context_);
+    boost::asio::post(io_context_, [this] { iterate(); });
+    io_context_.run();
+    disarm();
+
+    g_main_context_pop_thread_default(context_);
+    g_main_context_release(context_);
+    SLOG_DEBUG("GLib", "Asio and GLib loop stopped");
+}
+
+void AsioGlibLoop::stop() {
+    io_context_.stop();
+}
+
+void AsioGlibLoop::iterate() {
+    const auto iteration = ++iteration_;
+    const bool ready = g_main_context_prepare(context_, &max_priority_);
+    gint timeout = -1;
+    while ((nfds_ = g_main_context_query(context_, max_priority_, &timeout, fds_.data(),
+                                         static_cast<gint>(fds_.size()))) > static_cast<gint>(fds_.size())) {
+        fds_.resize(nfds_);
+    }
+
+    // Posted rather than run here, so that Asio handlers get their turn
+    // between two GLib iterations when idle sources keep GLib busy.
+    if (ready || timeout == 0) {
+        boost::asio::post(io_context_, [this, iteration] { wake(iteration); });
+        return;
+    }
+    for (gint i = 0; i < nfds_; ++i) {
+        watch(fds_[i].fd, fds_[i].events, iteration);
+    }
+    if (timeout > 0) {
+        timeout_.expires_after(std::chrono::milliseconds(timeout));
+        timeout_.async_wait([this, iteration](boost::system::error_code ec) {
+            if (!ec) {
+                wake(iteration);
+            }
+        });
+    }
+}
+
+void AsioGlibLoop::watch(int fd, gushort events, std::uint64_t iteration) {
+    // GLib may list a descriptor twice; the reactor only takes it once.
+    auto it = std::find_if(watches_.begin(), watches_.end(),
+                           [fd](auto& watch) { return watch.native_handle() == fd; });
+    if (it == watches_.end()) {
+        boost::system::error_code ec;
+        watches_.emplace_back(io_context_);
+        watches_.back().assign(fd, ec);
+        if (ec) {
+            watches_.pop_back();
+            SLOG_WARN("GLib", "Cannot watch descriptor", "fd", fd, "error", ec.message());
+            return;
+        }
+        it = std::prev(watches_.end());
+    }
+    auto on_ready = [this, iteration](boost::system::error_code ec) {
+        if (!ec) {
+            wake(iteration);
+        }
+    };
+    // Errors and hang-ups complete a read wait as well.
+    if (events & (G_IO_IN | G_IO_PRI)) {
+        it->async_wait(boost::asio::posix::stream_descriptor::wait_read, on_ready);
+    }
+    if (events & G_IO_OUT) {
+        it->async_wait(boost::asio::posix::stream_descriptor::wait_write, on_ready);
+    }
+    if (!(events & (G_IO_IN | G_IO_PRI | G_IO_OUT))) {
+        it->async_wait(boost::asio::posix::stream_descriptor::wait_error, on_ready);
+    }
+}
+
+void AsioGlibLoop::wake(std::uint64_t iteration) {
+    if (iteration != iteration_) {
+        return;
+    }
+    disarm();
+    // The reactor only said that something is ready; GLib wants to know what.
+    g_poll(fds_.data(), static_cast<guint>(nfds_), 0);
+    if (g_main_context_check(context_, max_priority_, fds_.data(), nfds_)) {
+        g_main_context_dispatch(context_);
+    }
+    if (!io_context_.stopped()) {
+        iterate();
+    }
+}
+
+void AsioGlibLoop::disarm() {
+    ++iteration_;
+    timeout_.cancel();
+    for (auto& watch : watches_) {
+        // Cancels the waits and hands the descriptor back to GLib, unclosed.
+        watch.release();
+    }
+    watches_.clear();
+}
@@ -0,0 +1,60 @@
+#ifndef ASIO_GLIB_LOOP_HPP
+#define ASIO_GLIB_LOOP_HPP
+
+#include <glib.h>
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <cstdint>
+#include <vector>
+
+// Runs an Asio io_context and a GMainContext together on one thread, the one
+// that calls run(). HTTP sessions on io_context() and bus watches or calls
+// marshalled onto context() then never cross threads.
+//
+// Asio keeps its reactor to itself, so the io_context is the outer loop: each
+// GLib iteration is split into prepare and query, the file descriptors GLib
+// would poll are waited for by the reactor, and check and dispatch run from
+// the completion. A g_main_context_invoke from another thread wakes GLib's
+// own descriptor and gets through like any other.
+class AsioGlibLoop {
+    public:
+        AsioGlibLoop();
+        ~AsioGlibLoop();
+
+        AsioGlibLoop(const AsioGlibLoop&) = delete;
+        AsioGlibLoop& operator=(const AsioGlibLoop&) = delete;
+
+        boost::asio::io_context& io_context() { return io_context_; }
+        GMainContext* context() const { return context_; }
+
+        // Runs both loops on the calling thread until stop(), even if stop() came
+        // first. context() is acquired meanwhile, so a g_main_context_invoke from
+        // a handler calls straight through.
+        void run();
+        // May be called from any thread.
+        void stop();
+
+    private:
+        // Starts a GLib iteration and waits for whatever ends it.
+        void iterate();
+        // Completes the iteration started as `iteration`.
+        void wake(std::uint64_t iteration);
+        void watch(int fd, gushort events, std::uint64_t iteration);
+        // Drops every wait of the current iteration, leaving the descriptors open.
+        void disarm();
+
+        GMainContext* context_;
+        boost::asio::io_context io_context_{1};
+        boost::asio::steady_timer timeout_;
+        std::vector<GPollFD> fds_;
+        gint nfds_ = 0;
+        gint max_priority_ = 0;
+        // Registered afresh with the reactor each iteration: GLib may have closed
+        // and reused a descriptor number in between.
+        std::vector<boost::asio::posix::stream_descriptor> watches_;
+        // Lets completions of a disarmed iteration be told apart.
+        std::uint64_t iteration_ = 0;
+};
+
+#endif // ASIO_GLIB_LOOP_HPP
@@ -0,0 +1,57 @@
+#include "bitrate_controller.hpp"
+#include <algorithm>
+#include <cmath>
+
+BitrateController::BitrateController(BitrateControllerConfig config, unsigned bitrate_kbps, int speed_preset)
+    : config_(config),
+      bitrate_kbps_(std::clamp(bitrate_kbps, config.min_kbps, config.max_kbps)),
+      speed_preset_(speed_preset),
+      quality_preset_(speed_preset) {}
+
+BitrateDecision BitrateController::update(const CongestionSample& sample) {
+    const double encode_load = sample.frame_interval_us > 0 ? sample.encode_us / sample.frame_interval_us : 0.0;
+    const bool egress_bound = sample.egress_fill > config_.high_fill;
+    // A blocked egress stalls the encoder too and fills its input queues; that
+    // is not a CPU shortage.
+    const bool cpu_bound = encode_load > config_.encode_budget || (sample.input_fill > config_.high_fill && !egress_bound);
+    const bool clear = sample.input_fill < config_.low_fill && sample.egress_fill < config_.low_fill
+                       && encode_load < config_.encode_budget * 0.75;
+
+    const unsigned old_bitrate = bitrate_kbps_;
+    const int old_preset = speed_preset_;
+    BitrateDecision decision;
+    decision.reason = "hold";
+
+    if (cpu_bound || egress_bound) {
+        clear_samples_ = 0;
+        decision.reason = cpu_bound ? "cpu" : "egress";
+        bitrate_kbps_ = std::max(config_.min_kbps, static_cast<unsigned>(bitrate_kbps_ * config_.decrease_factor));
+        // Fewer bits barely help an encoder that is out of CPU: search less.
+        if (cpu_bound && speed_preset_ > config_.fastest_preset) {
+            --speed_preset_;
+        }
+    } else if (clear) {
+        if (++clear_samples_ >= config_.stable_samples) {
+            clear_samples_ = 0;
+            decision.reason = "probe";
+            // Quality back first, with enough headroom that it does not tip the
+            // encoder straight back over its budget.
+            if (speed_preset_ >= 0 && speed_preset_ < quality_preset_ && encode_load < config_.encode_budget * 0.5) {
+                ++speed_preset_;
+            } else {
+                bitrate_kbps_ = std::min(config_.max_kbps, bitrate_kbps_ + config_.increase_kbps);
+            }
+        }
+    } else {
+        clear_samples_ = 0;
+    }
+
+    decision.bitrate_kbps = bitrate_kbps_;
+    decision.speed_preset = speed_preset_;
+    decision.bitrate_changed = bitrate_kbps_ != old_bitrate;
+    decision.preset_changed = speed_preset_ != old_preset;
+    decision.force_key_unit =
+        decision.bitrate_changed
+        && std::abs(static_cast<double>(bitrate_kbps_) - old_bitrate) >= config_.key_unit_step * old_bitrate;
+    return decision;
+}
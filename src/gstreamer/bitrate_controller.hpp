@@ -0,0 +1,80 @@
+#ifndef BITRATE_CONTROLLER_HPP
+#define BITRATE_CONTROLLER_HPP
+
+#include <string>
+
+// What the pipeline looked like over the last control period.
+struct CongestionSample {
+    // Fill (0..1) of the fullest queue in front of the encoder: frames waiting
+    // for CPU.
+    double input_fill = 0.0;
+    // Fill (0..1) of the queue between the encoder and the sink: encoded data
+    // the egress cannot take.
+    double egress_fill = 0.0;
+    // Mean time a frame spent inside the encoder, in microseconds.
+    double encode_us = 0.0;
+    // Time between frames at the negotiated framerate; 0 when unknown.
+    double frame_interval_us = 0.0;
+};
+
+struct BitrateControllerConfig {
+    unsigned min_kbps = 200;
+    unsigned max_kbps = 8000;
+    // x264enc speed-preset values: 1 is ultrafast, larger is slower. The
+    // controller never goes slower than the preset the encoder started with.
+    int fastest_preset = 1;
+
+    // A queue fuller than this is congested; emptier than `low_fill` is clear.
+    double high_fill = 0.5;
+    double low_fill = 0.1;
+    // Share of the frame interval the encoder may spend on one frame.
+    double encode_budget = 0.8;
+
+    // Multiplicative decrease on congestion, additive increase once clear for
+    // `stable_samples` periods in a row.
+    double decrease_factor = 0.7;
+    unsigned increase_kbps = 250;
+    int stable_samples = 3;
+
+    // A relative bitrate change at least this large is followed by a keyframe,
+    // so that the stream settles at the new rate at once rather than at the
+    // next natural IDR.
+    double key_unit_step = 0.25;
+};
+
+struct BitrateDecision {
+    unsigned bitrate_kbps = 0;
+    // -1 when the encoder has no speed-preset.
+    int speed_preset = -1;
+    bool bitrate_changed = false;
+    bool preset_changed = false;
+    bool force_key_unit = false;
+    // "cpu", "egress", "probe" or "hold".
+    std::string reason;
+};
+
+// Closed-loop bitrate and speed-preset control (AIMD). Backs off as soon as
+// frames pile up in front of the encoder, the encoder overruns its budget or
+// the egress pushes back; CPU-bound congestion also moves to a faster preset.
+// Probes back up slowly once everything is clear, restoring the preset first.
+// Pure logic: GstPipelineWrapper feeds it samples and applies its decisions.
+class BitrateController {
+    public:
+        // `speed_preset` is the encoder's current preset, -1 if it has none.
+        BitrateController(BitrateControllerConfig config, unsigned bitrate_kbps, int speed_preset);
+
+        BitrateDecision update(const CongestionSample& sample);
+
+        unsigned bitrate_kbps() const { return bitrate_kbps_; }
+        int speed_preset() const { return speed_preset_; }
+
+    private:
+        const BitrateControllerConfig config_;
+        unsigned bitrate_kbps_;
+        int speed_preset_;
+        // Slowest preset allowed: the one configured on the encoder.
+        const int quality_preset_;
+        int clear_samples_ = 0;
+};
+
+#endif // BITRATE_CONTROLLER_HPP
@@ -0,0 +1,139 @@
+#include "fanout_ring.hpp"
+#include <algorithm>
+
+namespace {
+
+std::size_t round_up_pow2(std::size_t n) {
+    std::size_t p = 1;
+    while (p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+
+} // namespace
+
+FanoutRing::FanoutRing(std::size_t capacity)
+    : slots_(new Slot[round_up_pow2(std::max<std::size_t>(capacity, 2))]),
+      mask_(round_up_pow2(std::max<std::size_t>(capacity, 2)) - 1) {}
+
+FanoutRing::~FanoutRing() {
+    for (std::size_t i = 0; i <= mask_; ++i) {
+        if (GstBuffer* buffer = slots_[i].buffer.load()) {
+            gst_buffer_unref(buffer);
+        }
+    }
+    for (auto& entry : retired_) {
+        gst_buffer_unref(entry.first);
+    }
+}
+
+void FanoutRing::publish(GstBuffer* buffer) {
+    const std::uint64_t seq = head_.load(std::memory_order_relaxed);
+    Slot& slot = slots_[seq & mask_];
+
+    // Readers validate `seq` before and after reading `buffer`, so marking the
+    // slot as being written makes any read that overlaps the swap fail.
+    slot.seq.store(kWriting);
+    GstBuffer* old = slot.buffer.exchange(gst_buffer_ref(buffer));
+    slot.seq.store(seq);
+
+    if (old) {
+        // A pinned reader may have read `old` but not yet taken its reference:
+        // keep it alive until the pin is gone. Pins last a few instructions, so
+        // this list stays tiny and is drained on the next publishes.
+        if (slot.pins.load() == 0) {
+            gst_buffer_unref(old);
+        } else {
+            retired_.emplace_back(old, &slot);
+        }
+    }
+    if (!retired_.empty()) {
+        reclaim();
+    }
+
+    if (!GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT)) {
+        last_keyframe_.store(seq, std::memory_order_release);
+    }
+    head_.store(seq + 1, std::memory_order_release);
+}
+
+void FanoutRing::reclaim() {
+    retired_.erase(
+        std::remove_if(retired_.begin(), retired_.end(), [](const auto& entry) {
+            if (entry.second->pins.load() != 0) {
+                return false;
+            }
+            gst_buffer_unref(entry.first);
+            return true;
+        }),
+        retired_.end());
+}
+
+GstBuffer* FanoutRing::acquire(std::uint64_t seq) const {
+    const Slot& slot = slots_[seq & mask_];
+    GstBuffer* result = nullptr;
+
+    // Sequentially consistent pin/unpin pairs with the producer's exchange and
+    // pin check: either the producer sees the pin, or this read sees the new pointer.
+    slot.pins.fetch_add(1);
+    if (slot.seq.load() == seq) {
+        GstBuffer* candidate = slot.buffer.load();
+        if (slot.seq.load() == seq) {
+            result = gst_buffer_ref(candidate);
+        }
+    }
+    slot.pins.fetch_sub(1, std::memory_order_release);
+    return result;
+}
+
+FanoutReader::FanoutReader(const FanoutRing& ring, std::size_t max_lag)
+    : ring_(ring),
+      max_lag_(std::min<std::uint64_t>(std::max<std::size_t>(max_lag, 1), ring.capacity() - 1)),
+      cursor_(ring.head()) {}
+
+GstBuffer* FanoutReader::next() {
+    while (true) {
+        const std::uint64_t head = ring_.head();
+        const std::uint64_t keyframe = ring_.last_keyframe();
+        const bool keyframe_in_window = keyframe != FanoutRing::kNone && head - keyframe <= max_lag_;
+
+        if (head - cursor_ > max_lag_) {
+            // Too far behind: resume at the latest keyframe if it is still in
+            // the window, otherwise give up on everything published so far.
+            resync_ = true;
+            if (keyframe_in_window && keyframe > cursor_) {
+                skipped_ += keyframe - cursor_;
+                cursor_ = keyframe;
+            } else {
+                skipped_ += head - cursor_;
+                cursor_ = head;
+                return nullptr;
+            }
+        } else if (resync_ && keyframe_in_window && keyframe < cursor_) {
+            // Joining mid-GOP: replay the current GOP rather than wait for the next.
+            cursor_ = keyframe;
+        }
+
+        if (cursor_ == head) {
+            return nullptr;
+        }
+        GstBuffer* buffer = ring_.acquire(cursor_);
+        if (!buffer) {
+            // Overwritten while we were looking at it: we are too far behind.
+            resync_ = true;
+            continue;
+        }
+        ++cursor_;
+        if (resync_) {
+            if (GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT)) {
+                // Undecodable without the keyframe we missed.
+                ++skipped_;
+                gst_buffer_unref(buffer);
+                continue;
+            }
+            resync_ = false;
+        }
+        return buffer;
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef FANOUT_RING_HPP
+#define FANOUT_RING_HPP
+
+#include <gst/gst.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Single-producer / multi-consumer ring of GstBuffer references. The producer
+// never waits for, nor even looks at, its readers: publishing costs the same
+// with one reader or ten thousand. Each reader keeps its own cursor, and one
+// that falls too far behind jumps forward to the most recent keyframe (the
+// last buffer without GST_BUFFER_FLAG_DELTA_UNIT).
+class FanoutRing {
+    public:
+        static constexpr std::uint64_t kNone = ~std::uint64_t{0};
+
+        // `capacity` is rounded up to a power of two.
+        explicit FanoutRing(std::size_t capacity);
+        ~FanoutRing();
+
+        FanoutRing(const FanoutRing&) = delete;
+        FanoutRing& operator=(const FanoutRing&) = delete;
+
+        // Producer thread only. Takes its own reference to `buffer`.
+        void publish(GstBuffer* buffer);
+
+        std::size_t capacity() const { return mask_ + 1; }
+        // Sequence number the next published buffer will get.
+        std::uint64_t head() const { return head_.load(std::memory_order_acquire); }
+        // Sequence number of the most recent keyframe, or kNone.
+        std::uint64_t last_keyframe() const { return last_keyframe_.load(std::memory_order_acquire); }
+
+        // New reference to buffer `seq`, or nullptr if it has been overwritten.
+        GstBuffer* acquire(std::uint64_t seq) const;
+
+    private:
+        static constexpr std::uint64_t kWriting = ~std::uint64_t{0};
+
+        struct alignas(64) Slot {
+            std::atomic<std::uint64_t> seq{kWriting};
+            std::atomic<GstBuffer*> buffer{nullptr};
+            // Readers between reading `buffer` and taking their reference.
+            mutable std::atomic<std::uint32_t> pins{0};
+        };
+
+        void reclaim();
+
+        std::unique_ptr<Slot[]> slots_;
+        const std::size_t mask_;
+        alignas(64) std::atomic<std::uint64_t> head_{0};
+        std::atomic<std::uint64_t> last_keyframe_{kNone};
+        // Producer-private: overwritten buffers a reader may still be about to ref.
+        std::vector<std::pair<GstBuffer*, const Slot*>> retired_;
+};
+
+// One consumer's position in a FanoutRing. Not thread-safe: each reader belongs
+// to a single consumer. Readers are cache-line aligned so that neighbouring
+// cursors advanced by different threads never share a line.
+class alignas(64) FanoutReader {
+    public:
+        // A reader more than `max_lag` buffers behind the producer resynchronises
+        // on the latest keyframe. Clamped below the ring capacity.
+        FanoutReader(const FanoutRing& ring, std::size_t max_lag);
+
+        // New reference to the next buffer, or nullptr when caught up.
+        GstBuffer* next();
+
+        // Buffers jumped over to catch up.
+        std::uint64_t skipped() const { return skipped_; }
+
+    private:
+        const FanoutRing& ring_;
+        const std::uint64_t max_lag_;
+        std::uint64_t cursor_;
+        std::uint64_t skipped_ = 0;
+        // Set until the reader sits on a keyframe: at start and after falling behind.
+        bool resync_ = true;
+};
+
+#endif // FANOUT_RING_HPP
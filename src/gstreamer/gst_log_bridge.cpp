@@ -0,0 +1,46 @@
+#include "gst_log_bridge.hpp"
+#include <gst/gst.h>
+#include <mutex>
+#include "../logging/logger.h"
+
+namespace {
+
+LogLevel to_log_level(GstDebugLevel level) {
+    switch (level) {
+    case GST_LEVEL_ERROR:
+        return LogLevel::Error;
+    case GST_LEVEL_WARNING:
+    case GST_LEVEL_FIXME:
+        return LogLevel::Warn;
+    case GST_LEVEL_INFO:
+        return LogLevel::Info;
+    case GST_LEVEL_DEBUG:
+        return LogLevel::Debug;
+    default:
+        return LogLevel::Trace;
+    }
+}
+
+void forward(GstDebugCategory* category, GstDebugLevel gst_level, const gchar*, const gchar* function, gint,
+             GObject* object, GstDebugMessage* message, gpointer) {
+    const LogLevel level = to_log_level(gst_level);
+    if (static_cast<int>(level) < SLOG_ACTIVE_LEVEL || !Logger::enabled(level)) {
+        return;
+    }
+    const gchar* object_name = object && GST_IS_OBJECT(object) ? GST_OBJECT_NAME(object) : nullptr;
+    Logger::instance().log(level, "gst", "",
+                           "category", gst_debug_category_get_name(category),
+                           "object", object_name,
+                           "function", function,
+                           "text", gst_debug_message_get(message));
+}
+
+} // namespace
+
+void install_gst_log_bridge() {
+    static std::once_flag installed;
+    std::call_once(installed, [] {
+        gst_debug_add_log_function(&forward, nullptr, nullptr);
+        gst_debug_remove_log_function(gst_debug_log_default);
+    });
+}
@@ -0,0 +1,11 @@
+#ifndef GST_LOG_BRIDGE_HPP
+#define GST_LOG_BRIDGE_HPP
+
+// Routes GStreamer's debug log (what GST_DEBUG enables, including plugins such
+// as mypassthrough) through Logger instead of GStreamer's default stderr
+// handler. GStreamer still formats and filters messages by category threshold;
+// records below SLOG_ACTIVE_LEVEL or the runtime level are dropped on arrival.
+// Safe to call more than once; requires gst_init().
+void install_gst_log_bridge();
+
+#endif // GST_LOG_BRIDGE_HPP
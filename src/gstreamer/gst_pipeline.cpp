@@ -1,44 +1,852 @@
 #include "gst_pipeline.hpp"
-#include <iostream>
+#include <gst/app/gstappsink.h>
+#include <algorithm>
+#include <memory>
+#include "gst_log_bridge.hpp"
+#include "../logging/logger.h"
 
-GstPipelineWrapper::GstPipelineWrapper(const char* pipeline_str) {
-    std::cout << "[GStreamer] Initializing GStreamer..." << std::endl;
+namespace {
+
+// Reads `pspec` back from `object` in its serialized form.
+std::string read_property(GObject* object, GParamSpec* pspec) {
+    GValue value = G_VALUE_INIT;
+    g_value_init(&value, pspec->value_type);
+    g_object_get_property(object, pspec->name, &value);
+    gchar* serialized = gst_value_serialize(&value);
+    std::string result = serialized ? serialized : "";
+    g_free(serialized);
+    g_value_unset(&value);
+    return result;
+}
+
+// True unless `element` carries the name gst_parse_launch made up for it
+// (factory name followed by a number).
+bool named_explicitly(GstElement* element) {
+    GstElementFactory* factory = gst_element_get_factory(element);
+    if (!factory) {
+        return true;
+    }
+    const std::string name = GST_OBJECT_NAME(element);
+    const std::string factory_name = GST_OBJECT_NAME(factory);
+    if (name.size() <= factory_name.size() || name.compare(0, factory_name.size(), factory_name) != 0) {
+        return true;
+    }
+    return name.find_first_not_of("0123456789", factory_name.size()) != std::string::npos;
+}
+
+// Asks `element` for an IDR frame with all headers, upstream from its src pad.
+// False when it has no src pad or nobody handled the event.
+bool send_force_key_unit(GstElement* element) {
+    GstPad* pad = gst_element_get_static_pad(element, "src");
+    if (!pad) {
+        return false;
+    }
+    GstEvent* event = gst_event_new_custom(
+        GST_EVENT_CUSTOM_UPSTREAM,
+        gst_structure_new("GstForceKeyUnit",
+            "timestamp", G_TYPE_UINT64, GST_CLOCK_TIME_NONE,
+            "all-headers", G_TYPE_BOOLEAN, TRUE,
+            "count", G_TYPE_UINT, 0,
+            NULL));
+    const bool handled = gst_pad_send_event(pad, event);
+    gst_object_unref(pad);
+    return handled;
+}
+
+// Fill (0..1) of a queue element against whichever of its limits is closest.
+double queue_fill(GstElement* queue) {
+    guint level_buffers = 0, max_buffers = 0, level_bytes = 0, max_bytes = 0;
+    guint64 level_time = 0, max_time = 0;
+    g_object_get(queue,
+                 "current-level-buffers", &level_buffers, "max-size-buffers", &max_buffers,
+                 "current-level-bytes", &level_bytes, "max-size-bytes", &max_bytes,
+                 "current-level-time", &level_time, "max-size-time", &max_time,
+                 NULL);
+    double fill = 0.0;
+    if (max_buffers > 0) {
+        fill = std::max(fill, static_cast<double>(level_buffers) / max_buffers);
+    }
+    if (max_bytes > 0) {
+        fill = std::max(fill, static_cast<double>(level_bytes) / max_bytes);
+    }
+    if (max_time > 0) {
+        fill = std::max(fill, static_cast<double>(level_time) / max_time);
+    }
+    return std::min(fill, 1.0);
+}
+
+// Time between frames at the framerate negotiated on `pad`; 0 when unknown.
+double frame_interval_us(GstPad* pad) {
+    GstCaps* caps = gst_pad_get_current_caps(pad);
+    if (!caps) {
+        return 0.0;
+    }
+    gint num = 0, den = 1;
+    const bool known = gst_structure_get_fraction(gst_caps_get_structure(caps, 0), "framerate", &num, &den) && num > 0;
+    gst_caps_unref(caps);
+    return known ? 1e6 * den / num : 0.0;
+}
+
+bool is_queue(GstElement* element) {
+    GstElementFactory* factory = gst_element_get_factory(element);
+    return factory && std::string(GST_OBJECT_NAME(factory)) == "queue";
+}
+
+} // namespace
+
+GstPipelineWrapper::GstPipelineWrapper(const char* pipeline_str, GMainContext* context)
+    : pipeline_(nullptr), context_(context ? g_main_context_ref(context) : g_main_context_ref(g_main_context_default())) {
+    SLOG_INFO("GStreamer", "Initializing GStreamer");
     gst_init(nullptr, nullptr);
+    install_gst_log_bridge();
     GError *error = nullptr;
-    std::cout << "[GStreamer] Creating pipeline: " << pipeline_str << std::endl;
+    SLOG_INFO("GStreamer", "Creating pipeline", "description", pipeline_str);
     pipeline_ = gst_parse_launch(pipeline_str, &error);
     if (!pipeline_ || error) {
-        std::cerr << "[GStreamer] Pipeline creation failed: " << (error ? error->message : "unknown error") << std::endl;
+        SLOG_ERROR("GStreamer", "Pipeline creation failed", "error", error ? error->message : "unknown error");
         if (error) g_error_free(error);
     } else {
-        std::cout << "[GStreamer] Pipeline created successfully." << std::endl;
+        SLOG_INFO("GStreamer", "Pipeline created");
+        GstBus* bus = gst_element_get_bus(pipeline_);
+        bus_watch_ = gst_bus_create_watch(bus);
+        g_source_set_callback(bus_watch_, reinterpret_cast<GSourceFunc>(&GstPipelineWrapper::bus_call), this, nullptr);
+        g_source_attach(bus_watch_, context_);
+        gst_object_unref(bus);
     }
 }
 
 GstPipelineWrapper::~GstPipelineWrapper() {
-    std::cout << "[GStreamer] Destroying pipeline..." << std::endl;
+    SLOG_INFO("GStreamer", "Destroying pipeline");
+    if (bus_watch_) {
+        g_source_destroy(bus_watch_);
+        g_source_unref(bus_watch_);
+        bus_watch_ = nullptr;
+    }
     stop();
+    disable_adaptive_bitrate();
+    disable_key_unit_requests();
+    end_waiters({LifecycleEvent::Status::Error, GST_STATE_NULL, "pipeline destroyed"});
+    if (metrics_) {
+        for (auto id : metric_collectors_) {
+            metrics_->remove(id);
+        }
+    }
+    for (auto& counters : element_counters_) {
+        gst_pad_remove_probe(counters->pad, counters->probe);
+        gst_object_unref(counters->pad);
+    }
     if (pipeline_) {
         gst_object_unref(pipeline_);
         pipeline_ = nullptr;
-        std::cout << "[GStreamer] Pipeline destroyed." << std::endl;
+        SLOG_INFO("GStreamer", "Pipeline destroyed");
     }
+    g_main_context_unref(context_);
 }
 
 void GstPipelineWrapper::start() {
     if (pipeline_) {
-        std::cout << "[GStreamer] Starting pipeline..." << std::endl;
-        gst_element_set_state(pipeline_, GST_STATE_PLAYING);
+        SLOG_INFO("GStreamer", "Starting pipeline");
+        if (gst_element_set_state(pipeline_, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+            SLOG_ERROR("GStreamer", "Pipeline refused to start");
+        }
     } else {
-        std::cerr << "[GStreamer] Cannot start: pipeline is null." << std::endl;
+        SLOG_ERROR("GStreamer", "Cannot start: pipeline is null");
     }
 }
 
 void GstPipelineWrapper::stop() {
     if (pipeline_) {
-        std::cout << "[GStreamer] Stopping pipeline..." << std::endl;
+        SLOG_INFO("GStreamer", "Stopping pipeline");
         gst_element_set_state(pipeline_, GST_STATE_NULL);
     } else {
-        std::cerr << "[GStreamer] Cannot stop: pipeline is null." << std::endl;
+        SLOG_ERROR("GStreamer", "Cannot stop: pipeline is null");
+    }
+}
+
+GstState GstPipelineWrapper::current_state() const {
+    GstState state = GST_STATE_VOID_PENDING;
+    if (pipeline_) {
+        gst_element_get_state(pipeline_, &state, nullptr, 0);
+    }
+    return state;
+}
+
+void GstPipelineWrapper::set_state_async(GstState target, LifecycleCallback done) {
+    invoke([this, target, done = std::move(done)]() mutable {
+        if (!pipeline_) {
+            done({LifecycleEvent::Status::Error, GST_STATE_VOID_PENDING, "pipeline is null"});
+            return;
+        }
+        if (target <= GST_STATE_READY) {
+            ended_.reset();
+        }
+        SLOG_INFO("GStreamer", "Setting pipeline state", "target", gst_element_state_get_name(target));
+        switch (gst_element_set_state(pipeline_, target)) {
+        case GST_STATE_CHANGE_FAILURE: {
+            // The reason was posted as an ERROR message; take it now rather than
+            // let the bus watch find it after we have already answered.
+            std::string message = "state change to " + std::string(gst_element_state_get_name(target)) + " failed";
+            GstBus* bus = gst_element_get_bus(pipeline_);
+            if (GstMessage* msg = gst_bus_pop_filtered(bus, GST_MESSAGE_ERROR)) {
+                GError* error = nullptr;
+                gst_message_parse_error(msg, &error, nullptr);
+                message = error->message;
+                g_error_free(error);
+                gst_message_unref(msg);
+            }
+            gst_object_unref(bus);
+            SLOG_ERROR("GStreamer", "State change failed", "error", message);
+            LifecycleEvent event{LifecycleEvent::Status::Error, current_state(), message};
+            ended_ = event;
+            end_waiters(event);
+            done(std::move(event));
+            break;
+        }
+        case GST_STATE_CHANGE_ASYNC:
+            // Prerolling: the pipeline posts STATE_CHANGED once it gets there.
+            state_waiters_.push_back({target, std::move(done)});
+            break;
+        default: {
+            // Already there. Waiters for another target will never see it now.
+            auto waiters = std::move(state_waiters_);
+            state_waiters_.clear();
+            for (auto& waiter : waiters) {
+                waiter.done({waiter.target == target ? LifecycleEvent::Status::Reached : LifecycleEvent::Status::Error,
+                             target, waiter.target == target ? "" : "superseded"});
+            }
+            done({LifecycleEvent::Status::Reached, target, {}});
+            break;
+        }
+        }
+    });
+}
+
+std::future<LifecycleEvent> GstPipelineWrapper::set_state_async(GstState target) {
+    auto promise = std::make_shared<std::promise<LifecycleEvent>>();
+    auto future = promise->get_future();
+    set_state_async(target, [promise](LifecycleEvent event) { promise->set_value(std::move(event)); });
+    return future;
+}
+
+void GstPipelineWrapper::end_of_stream_async(LifecycleCallback done) {
+    invoke([this, done = std::move(done)]() mutable {
+        if (ended_) {
+            done(*ended_);
+        } else if (!pipeline_) {
+            done({LifecycleEvent::Status::Error, GST_STATE_VOID_PENDING, "pipeline is null"});
+        } else {
+            eos_waiters_.push_back(std::move(done));
+        }
+    });
+}
+
+std::future<LifecycleEvent> GstPipelineWrapper::end_of_stream_async() {
+    auto promise = std::make_shared<std::promise<LifecycleEvent>>();
+    auto future = promise->get_future();
+    end_of_stream_async([promise](LifecycleEvent event) { promise->set_value(std::move(event)); });
+    return future;
+}
+
+void GstPipelineWrapper::send_eos_async(LifecycleCallback done) {
+    invoke([this, done = std::move(done)]() mutable {
+        if (ended_) {
+            done(*ended_);
+            return;
+        }
+        if (!pipeline_) {
+            done({LifecycleEvent::Status::Error, GST_STATE_VOID_PENDING, "pipeline is null"});
+            return;
+        }
+        SLOG_INFO("GStreamer", "Sending end of stream");
+        eos_waiters_.push_back(std::move(done));
+        gst_element_send_event(pipeline_, gst_event_new_eos());
+    });
+}
+
+std::future<LifecycleEvent> GstPipelineWrapper::send_eos_async() {
+    auto promise = std::make_shared<std::promise<LifecycleEvent>>();
+    auto future = promise->get_future();
+    send_eos_async([promise](LifecycleEvent event) { promise->set_value(std::move(event)); });
+    return future;
+}
+
+void GstPipelineWrapper::reset_async(LifecycleCallback done) {
+    invoke([this, done = std::move(done)] {
+        if (!pipeline_) {
+            done({LifecycleEvent::Status::Error, GST_STATE_VOID_PENDING, "pipeline is null"});
+            return;
+        }
+        // Unblock streaming threads parked in a sink so that the downward state
+        // change does not wait on them.
+        gst_element_send_event(pipeline_, gst_event_new_flush_start());
+        gst_element_send_event(pipeline_, gst_event_new_flush_stop(TRUE));
+        if (gst_element_set_state(pipeline_, GST_STATE_READY) == GST_STATE_CHANGE_FAILURE) {
+            done({LifecycleEvent::Status::Error, current_state(), "reset to READY failed"});
+            return;
+        }
+        // Streaming threads are stopped in READY: the tap can go without a race.
+        buffer_tap_ = nullptr;
+        ended_.reset();
+        end_waiters({LifecycleEvent::Status::Error, GST_STATE_READY, "pipeline reset"});
+        done({LifecycleEvent::Status::Reached, GST_STATE_READY, {}});
+    });
+}
+
+void GstPipelineWrapper::end_waiters(const LifecycleEvent& event) {
+    auto state_waiters = std::move(state_waiters_);
+    auto eos_waiters = std::move(eos_waiters_);
+    state_waiters_.clear();
+    eos_waiters_.clear();
+    for (auto& waiter : state_waiters) {
+        waiter.done(event);
+    }
+    for (auto& done : eos_waiters) {
+        done(event);
+    }
+}
+
+gboolean GstPipelineWrapper::bus_call(GstBus*, GstMessage* msg, gpointer data) {
+    auto* self = static_cast<GstPipelineWrapper*>(data);
+
+    switch (GST_MESSAGE_TYPE(msg)) {
+    case GST_MESSAGE_EOS: {
+        SLOG_INFO("GStreamer", "End of stream reached");
+        LifecycleEvent event{LifecycleEvent::Status::Eos, self->current_state(), {}};
+        self->ended_ = event;
+        auto waiters = std::move(self->eos_waiters_);
+        self->eos_waiters_.clear();
+        for (auto& done : waiters) {
+            done(event);
+        }
+        break;
+    }
+
+    case GST_MESSAGE_ERROR: {
+        GError* error = nullptr;
+        gchar* debug = nullptr;
+        gst_message_parse_error(msg, &error, &debug);
+        SLOG_ERROR("GStreamer", "Pipeline error", "element", GST_OBJECT_NAME(GST_MESSAGE_SRC(msg)),
+                   "error", error->message);
+        LifecycleEvent event{LifecycleEvent::Status::Error, self->current_state(), error->message};
+        g_free(debug);
+        g_error_free(error);
+        self->ended_ = event;
+        self->end_waiters(event);
+        break;
+    }
+
+    case GST_MESSAGE_STATE_CHANGED: {
+        if (GST_MESSAGE_SRC(msg) != GST_OBJECT(self->pipeline_)) {
+            break;
+        }
+        GstState old_state, new_state, pending_state;
+        gst_message_parse_state_changed(msg, &old_state, &new_state, &pending_state);
+        SLOG_INFO("GStreamer", "Pipeline state changed", "from", gst_element_state_get_name(old_state),
+                  "to", gst_element_state_get_name(new_state));
+
+        // Intermediate states resolve the waiters that asked for them; once the
+        // pipeline settles, nobody else is going to get their state.
+        const bool settled = pending_state == GST_STATE_VOID_PENDING;
+        std::vector<StateWaiter> resolved;
+        auto& waiters = self->state_waiters_;
+        for (auto it = waiters.begin(); it != waiters.end();) {
+            if (it->target == new_state || settled) {
+                resolved.push_back(std::move(*it));
+                it = waiters.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        for (auto& waiter : resolved) {
+            if (waiter.target == new_state) {
+                waiter.done({LifecycleEvent::Status::Reached, new_state, {}});
+            } else {
+                waiter.done({LifecycleEvent::Status::Error, new_state,
+                             std::string("pipeline settled in ") + gst_element_state_get_name(new_state)});
+            }
+        }
+        break;
+    }
+
+    default:
+        break;
+    }
+
+    return TRUE; /* Keep the source */
+}
+
+void GstPipelineWrapper::invoke(std::function<void()> fn) {
+    auto* call = new std::function<void()>(std::move(fn));
+    g_main_context_invoke_full(context_, G_PRIORITY_HIGH,
+        [](gpointer data) -> gboolean {
+            (*static_cast<std::function<void()>*>(data))();
+            return G_SOURCE_REMOVE;
+        },
+        call,
+        [](gpointer data) { delete static_cast<std::function<void()>*>(data); });
+}
+
+void GstPipelineWrapper::set_property_async(std::string element, std::string property, std::string value, ControlCallback done) {
+    invoke([this, element = std::move(element), property = std::move(property),
+            value = std::move(value), done = std::move(done)] {
+        GstElement* target = pipeline_ ? gst_bin_get_by_name(GST_BIN(pipeline_), element.c_str()) : nullptr;
+        if (!target) {
+            done({ControlResult::Status::NoSuchElement, "no element named " + element});
+            return;
+        }
+        GParamSpec* pspec = g_object_class_find_property(G_OBJECT_GET_CLASS(target), property.c_str());
+        if (!pspec) {
+            done({ControlResult::Status::NoSuchProperty, element + " has no property " + property});
+        } else if (!(pspec->flags & G_PARAM_WRITABLE) || (pspec->flags & G_PARAM_CONSTRUCT_ONLY)) {
+            done({ControlResult::Status::Rejected, property + " cannot be changed at runtime"});
+        } else {
+            GValue parsed = G_VALUE_INIT;
+            g_value_init(&parsed, pspec->value_type);
+            // g_param_value_validate() returns TRUE when it had to clamp the value.
+            if (!gst_value_deserialize(&parsed, value.c_str()) || g_param_value_validate(pspec, &parsed)) {
+                done({ControlResult::Status::Rejected, "invalid value for " + property + ": " + value});
+            } else {
+                g_object_set_property(G_OBJECT(target), pspec->name, &parsed);
+                SLOG_INFO("GStreamer", "Property set", "element", element, "property", property, "value", value);
+                done({ControlResult::Status::Ok, read_property(G_OBJECT(target), pspec)});
+            }
+            g_value_unset(&parsed);
+        }
+        gst_object_unref(target);
+    });
+}
+
+void GstPipelineWrapper::get_property_async(std::string element, std::string property, ControlCallback done) {
+    invoke([this, element = std::move(element), property = std::move(property), done = std::move(done)] {
+        GstElement* target = pipeline_ ? gst_bin_get_by_name(GST_BIN(pipeline_), element.c_str()) : nullptr;
+        if (!target) {
+            done({ControlResult::Status::NoSuchElement, "no element named " + element});
+            return;
+        }
+        GParamSpec* pspec = g_object_class_find_property(G_OBJECT_GET_CLASS(target), property.c_str());
+        if (!pspec || !(pspec->flags & G_PARAM_READABLE)) {
+            done({ControlResult::Status::NoSuchProperty, element + " has no readable property " + property});
+        } else {
+            done({ControlResult::Status::Ok, read_property(G_OBJECT(target), pspec)});
+        }
+        gst_object_unref(target);
+    });
+}
+
+void GstPipelineWrapper::force_key_unit_async(std::string element, ControlCallback done) {
+    invoke([this, element = std::move(element), done = std::move(done)] {
+        GstElement* target = pipeline_ ? gst_bin_get_by_name(GST_BIN(pipeline_), element.c_str()) : nullptr;
+        if (!target) {
+            done({ControlResult::Status::NoSuchElement, "no element named " + element});
+            return;
+        }
+        if (send_force_key_unit(target)) {
+            SLOG_INFO("GStreamer", "Forced key unit", "element", element);
+            done({ControlResult::Status::Ok, "key unit requested"});
+        } else {
+            done({ControlResult::Status::Rejected, element + " did not handle GstForceKeyUnit"});
+        }
+        gst_object_unref(target);
+    });
+}
+
+GstElement* GstPipelineWrapper::element(const char* name) const {
+    return pipeline_ ? gst_bin_get_by_name(GST_BIN(pipeline_), name) : nullptr;
+}
+
+bool GstPipelineWrapper::tap_appsink(const char* appsink_name, BufferTap tap) {
+    GstElement* sink = pipeline_ ? gst_bin_get_by_name(GST_BIN(pipeline_), appsink_name) : nullptr;
+    if (!sink) {
+        return false;
+    }
+    if (!GST_IS_APP_SINK(sink)) {
+        gst_object_unref(sink);
+        return false;
+    }
+
+    buffer_tap_ = std::move(tap);
+    GstAppSinkCallbacks callbacks = {};
+    callbacks.new_sample = [](GstAppSink* appsink, gpointer data) -> GstFlowReturn {
+        GstSample* sample = gst_app_sink_pull_sample(appsink);
+        if (!sample) {
+            return GST_FLOW_EOS;
+        }
+        if (GstBuffer* buffer = gst_sample_get_buffer(sample)) {
+            auto* self = static_cast<GstPipelineWrapper*>(data);
+            if (self->buffer_tap_) {
+                self->buffer_tap_(buffer);
+            }
+        }
+        gst_sample_unref(sample);
+        return GST_FLOW_OK;
+    };
+    gst_app_sink_set_callbacks(GST_APP_SINK(sink), &callbacks, this, nullptr);
+    gst_object_unref(sink);
+    SLOG_INFO("GStreamer", "Tapping appsink", "name", appsink_name);
+    return true;
+}
+
+GstPadProbeReturn GstPipelineWrapper::count_buffers(GstPad*, GstPadProbeInfo* info, gpointer data) {
+    auto* counters = static_cast<ElementCounters*>(data);
+    if (GST_PAD_PROBE_INFO_TYPE(info) & GST_PAD_PROBE_TYPE_BUFFER) {
+        counters->buffers.inc();
+        counters->bytes.inc(gst_buffer_get_size(GST_PAD_PROBE_INFO_BUFFER(info)));
+    } else if (GstBufferList* list = GST_PAD_PROBE_INFO_BUFFER_LIST(info)) {
+        counters->buffers.inc(gst_buffer_list_length(list));
+        counters->bytes.inc(gst_buffer_list_calculate_size(list));
     }
-}
\ No newline at end of file
+    return GST_PAD_PROBE_OK;
+}
+
+void GstPipelineWrapper::register_metrics(MetricsRegistry& registry) {
+    if (!pipeline_ || metrics_) {
+        return;
+    }
+    metrics_ = &registry;
+
+    // Source elements have no sink pad and sinks no src pad: count whichever exists.
+    GstIterator* it = gst_bin_iterate_recurse(GST_BIN(pipeline_));
+    GValue item = G_VALUE_INIT;
+    while (gst_iterator_next(it, &item) == GST_ITERATOR_OK) {
+        GstElement* element = GST_ELEMENT(g_value_get_object(&item));
+        GstPad* pad = nullptr;
+        if (!GST_IS_BIN(element) && named_explicitly(element)) {
+            pad = gst_element_get_static_pad(element, "src");
+            if (!pad) {
+                pad = gst_element_get_static_pad(element, "sink");
+            }
+        }
+        if (pad) {
+            auto counters = std::make_unique<ElementCounters>();
+            counters->name = GST_OBJECT_NAME(element);
+            counters->pad = pad;
+            counters->probe = gst_pad_add_probe(pad,
+                static_cast<GstPadProbeType>(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST),
+                &GstPipelineWrapper::count_buffers, counters.get(), nullptr);
+            element_counters_.push_back(std::move(counters));
+        }
+        g_value_reset(&item);
+    }
+    g_value_unset(&item);
+    gst_iterator_free(it);
+
+    metric_collectors_.push_back(registry.collect("gst_pipeline_state", "1 for the state the pipeline is in.", "gauge",
+        [this](MetricsRegistry::Samples& samples) {
+            const GstState state = current_state();
+            for (GstState s : {GST_STATE_NULL, GST_STATE_READY, GST_STATE_PAUSED, GST_STATE_PLAYING}) {
+                samples.emplace_back(MetricsRegistry::labels({{"state", gst_element_state_get_name(s)}}), s == state ? 1 : 0);
+            }
+        }));
+    metric_collectors_.push_back(registry.collect("gst_element_buffers_total", "Buffers through named elements.", "counter",
+        [this](MetricsRegistry::Samples& samples) {
+            for (const auto& counters : element_counters_) {
+                samples.emplace_back(MetricsRegistry::labels({{"element", counters->name}}), counters->buffers.value());
+            }
+        }));
+    metric_collectors_.push_back(registry.collect("gst_element_bytes_total", "Bytes through named elements.", "counter",
+        [this](MetricsRegistry::Samples& samples) {
+            for (const auto& counters : element_counters_) {
+                samples.emplace_back(MetricsRegistry::labels({{"element", counters->name}}), counters->bytes.value());
+            }
+        }));
+}
+
+bool GstPipelineWrapper::enable_adaptive_bitrate(AdaptiveBitrateConfig config) {
+    disable_adaptive_bitrate();
+    GstElement* encoder = element(config.encoder.c_str());
+    if (!encoder) {
+        SLOG_ERROR("GStreamer", "Adaptive bitrate: no such encoder", "name", config.encoder);
+        return false;
+    }
+    GObjectClass* klass = G_OBJECT_GET_CLASS(encoder);
+    if (!g_object_class_find_property(klass, "bitrate")) {
+        SLOG_ERROR("GStreamer", "Adaptive bitrate: encoder has no bitrate", "name", config.encoder);
+        gst_object_unref(encoder);
+        return false;
+    }
+    guint bitrate = 0;
+    gint speed_preset = -1;
+    g_object_get(encoder, "bitrate", &bitrate, NULL);
+    // x264enc only takes a new preset in READY: leave it alone there.
+    GParamSpec* preset = g_object_class_find_property(klass, "speed-preset");
+    if (preset && (preset->flags & GST_PARAM_MUTABLE_PLAYING)) {
+        g_object_get(encoder, "speed-preset", &speed_preset, NULL);
+    }
+
+    auto abr = std::make_unique<AdaptiveBitrate>(std::move(config), bitrate, speed_preset);
+    abr->encoder = encoder;
+    // From here on a failure goes through disable, which releases what was taken.
+    adaptive_bitrate_ = std::move(abr);
+    AdaptiveBitrate& state = *adaptive_bitrate_;
+    for (const auto& name : state.config.input_queues) {
+        GstElement* queue = element(name.c_str());
+        if (!queue || !is_queue(queue)) {
+            SLOG_ERROR("GStreamer", "Adaptive bitrate: not a queue", "name", name);
+            if (queue) gst_object_unref(queue);
+            disable_adaptive_bitrate();
+            return false;
+        }
+        state.input_queues.push_back(queue);
+    }
+    if (!state.config.egress_queue.empty()) {
+        state.egress_queue = element(state.config.egress_queue.c_str());
+        if (!state.egress_queue || !is_queue(state.egress_queue)) {
+            SLOG_ERROR("GStreamer", "Adaptive bitrate: not a queue", "name", state.config.egress_queue);
+            disable_adaptive_bitrate();
+            return false;
+        }
+    }
+
+    state.sink_pad = gst_element_get_static_pad(encoder, "sink");
+    state.src_pad = gst_element_get_static_pad(encoder, "src");
+    if (!state.sink_pad || !state.src_pad) {
+        SLOG_ERROR("GStreamer", "Adaptive bitrate: encoder needs static sink and src pads", "name", state.config.encoder);
+        disable_adaptive_bitrate();
+        return false;
+    }
+    state.entry_probe = gst_pad_add_probe(state.sink_pad, GST_PAD_PROBE_TYPE_BUFFER,
+                                          &GstPipelineWrapper::encoder_entry, &state, nullptr);
+    state.exit_probe = gst_pad_add_probe(state.src_pad, GST_PAD_PROBE_TYPE_BUFFER,
+                                         &GstPipelineWrapper::encoder_exit, &state, nullptr);
+
+    state.timer = g_timeout_source_new(state.config.interval_ms);
+    g_source_set_callback(state.timer, &GstPipelineWrapper::adaptive_bitrate_tick, this, nullptr);
+    g_source_attach(state.timer, context_);
+    SLOG_INFO("GStreamer", "Adaptive bitrate enabled", "encoder", state.config.encoder,
+              "bitrate", bitrate, "speed_preset", speed_preset);
+    return true;
+}
+
+void GstPipelineWrapper::disable_adaptive_bitrate() {
+    if (!adaptive_bitrate_) {
+        return;
+    }
+    AdaptiveBitrate& state = *adaptive_bitrate_;
+    if (state.timer) {
+        g_source_destroy(state.timer);
+        g_source_unref(state.timer);
+    }
+    // gst_pad_remove_probe() waits for a probe running on a streaming thread.
+    if (state.sink_pad) {
+        if (state.entry_probe) gst_pad_remove_probe(state.sink_pad, state.entry_probe);
+        gst_object_unref(state.sink_pad);
+    }
+    if (state.src_pad) {
+        if (state.exit_probe) gst_pad_remove_probe(state.src_pad, state.exit_probe);
+        gst_object_unref(state.src_pad);
+    }
+    for (GstElement* queue : state.input_queues) {
+        gst_object_unref(queue);
+    }
+    if (state.egress_queue) {
+        gst_object_unref(state.egress_queue);
+    }
+    gst_object_unref(state.encoder);
+    adaptive_bitrate_.reset();
+}
+
+GstPadProbeReturn GstPipelineWrapper::encoder_entry(GstPad*, GstPadProbeInfo* info, gpointer data) {
+    auto* state = static_cast<AdaptiveBitrate*>(data);
+    const GstClockTime pts = GST_BUFFER_PTS(GST_PAD_PROBE_INFO_BUFFER(info));
+    if (!GST_CLOCK_TIME_IS_VALID(pts)) {
+        return GST_PAD_PROBE_OK;
+    }
+    std::lock_guard<std::mutex> lock(state->lock);
+    state->in_flight.emplace_back(pts, g_get_monotonic_time());
+    // Frames the encoder dropped never come out: do not let them pile up.
+    if (state->in_flight.size() > 256) {
+        state->in_flight.pop_front();
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+GstPadProbeReturn GstPipelineWrapper::encoder_exit(GstPad*, GstPadProbeInfo* info, gpointer data) {
+    auto* state = static_cast<AdaptiveBitrate*>(data);
+    const GstClockTime pts = GST_BUFFER_PTS(GST_PAD_PROBE_INFO_BUFFER(info));
+    const gint64 now = g_get_monotonic_time();
+    std::lock_guard<std::mutex> lock(state->lock);
+    auto& in_flight = state->in_flight;
+    auto it = std::find_if(in_flight.begin(), in_flight.end(), [pts](const auto& entry) { return entry.first == pts; });
+    if (it != in_flight.end()) {
+        state->encode_us_total += now - it->second;
+        ++state->encoded;
+        // Anything older went in before this frame and was dropped.
+        in_flight.erase(in_flight.begin(), it + 1);
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+gboolean GstPipelineWrapper::adaptive_bitrate_tick(gpointer data) {
+    auto* self = static_cast<GstPipelineWrapper*>(data);
+    AdaptiveBitrate& state = *self->adaptive_bitrate_;
+    // Stopped or prerolling: empty queues would read as room to grow.
+    if (self->current_state() != GST_STATE_PLAYING) {
+        return G_SOURCE_CONTINUE;
+    }
+
+    CongestionSample sample;
+    for (GstElement* queue : state.input_queues) {
+        sample.input_fill = std::max(sample.input_fill, queue_fill(queue));
+    }
+    if (state.egress_queue) {
+        sample.egress_fill = queue_fill(state.egress_queue);
+    }
+    {
+        std::lock_guard<std::mutex> lock(state.lock);
+        if (state.encoded > 0) {
+            sample.encode_us = static_cast<double>(state.encode_us_total) / state.encoded;
+        }
+        state.encode_us_total = 0;
+        state.encoded = 0;
+    }
+    sample.frame_interval_us = frame_interval_us(state.sink_pad);
+
+    const BitrateDecision decision = state.controller.update(sample);
+    if (decision.bitrate_changed) {
+        g_object_set(state.encoder, "bitrate", decision.bitrate_kbps, NULL);
+    }
+    if (decision.preset_changed) {
+        g_object_set(state.encoder, "speed-preset", decision.speed_preset, NULL);
+    }
+    if (decision.force_key_unit) {
+        if (self->key_unit_requests_) {
+            self->request_key_unit(false, [](ControlResult result) {
+                if (result.status != ControlResult::Status::Ok) {
+                    SLOG_WARN("GStreamer", "Adaptive bitrate: key unit request not handled", "reason", result.message);
+                }
+            });
+        } else if (!send_force_key_unit(state.encoder)) {
+            SLOG_WARN("GStreamer", "Adaptive bitrate: key unit request not handled", "encoder", state.config.encoder);
+        }
+    }
+    if (decision.bitrate_changed || decision.preset_changed) {
+        SLOG_INFO("GStreamer", "Adaptive bitrate", "reason", decision.reason, "bitrate", decision.bitrate_kbps,
+                  "speed_preset", decision.speed_preset, "input_fill", sample.input_fill,
+                  "egress_fill", sample.egress_fill, "encode_us", sample.encode_us);
+    }
+    // A copy: the callback may well disable the controller, and `state` with it.
+    if (auto on_decision = state.config.on_decision) {
+        on_decision(sample, decision);
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+bool GstPipelineWrapper::enable_key_unit_requests(KeyUnitRequestConfig config) {
+    disable_key_unit_requests();
+    GstElement* encoder = element(config.encoder.c_str());
+    if (!encoder) {
+        SLOG_ERROR("GStreamer", "Key unit requests: no such encoder", "name", config.encoder);
+        return false;
+    }
+    GstPad* pad = gst_element_get_static_pad(encoder, "src");
+    if (!pad) {
+        SLOG_ERROR("GStreamer", "Key unit requests: encoder has no src pad", "name", config.encoder);
+        gst_object_unref(encoder);
+        return false;
+    }
+
+    key_unit_requests_ = std::make_unique<KeyUnitRequests>(std::move(config));
+    KeyUnitRequests& state = *key_unit_requests_;
+    state.encoder = encoder;
+    state.src_pad = pad;
+    state.probe = gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, &GstPipelineWrapper::track_keyframes, &state, nullptr);
+    SLOG_INFO("GStreamer", "Key unit requests enabled", "encoder", state.config.encoder,
+              "coalesce_us", state.config.policy.coalesce_us, "min_interval_us", state.config.policy.min_interval_us);
+    return true;
+}
+
+void GstPipelineWrapper::disable_key_unit_requests() {
+    if (!key_unit_requests_) {
+        return;
+    }
+    // Detached first: a callback may call back in.
+    std::unique_ptr<KeyUnitRequests> state = std::move(key_unit_requests_);
+    if (state->timer) {
+        g_source_destroy(state->timer);
+        g_source_unref(state->timer);
+    }
+    gst_pad_remove_probe(state->src_pad, state->probe);
+    gst_object_unref(state->src_pad);
+    gst_object_unref(state->encoder);
+    for (auto& done : state->waiting) {
+        done({ControlResult::Status::Rejected, "key unit requests disabled"});
+    }
+}
+
+void GstPipelineWrapper::request_key_unit_async(bool cached_gop, ControlCallback done) {
+    invoke([this, cached_gop, done = std::move(done)]() mutable {
+        request_key_unit(cached_gop, std::move(done));
+    });
+}
+
+void GstPipelineWrapper::request_key_unit(bool cached_gop, ControlCallback done) {
+    if (!key_unit_requests_) {
+        done({ControlResult::Status::Rejected, "key unit requests are not enabled"});
+        return;
+    }
+    KeyUnitRequests& state = *key_unit_requests_;
+    state.scheduler.on_keyframe(state.last_keyframe_us.load(std::memory_order_relaxed));
+
+    switch (state.scheduler.request(g_get_monotonic_time(), cached_gop)) {
+    case KeyUnitAnswer::Cached:
+        done({ControlResult::Status::Ok, "cached"});
+        return;
+    case KeyUnitAnswer::Scheduled:
+        state.waiting.push_back(std::move(done));
+        arm_key_unit_timer();
+        return;
+    case KeyUnitAnswer::Coalesced:
+        state.waiting.push_back(std::move(done));
+        return;
+    }
+}
+
+void GstPipelineWrapper::arm_key_unit_timer() {
+    KeyUnitRequests& state = *key_unit_requests_;
+    if (state.timer) {
+        g_source_destroy(state.timer);
+        g_source_unref(state.timer);
+    }
+    const gint64 wait_us = std::max<gint64>(0, state.scheduler.deadline_us() - g_get_monotonic_time());
+    // Rounded up: firing early would only re-arm.
+    state.timer = g_timeout_source_new(static_cast<guint>((wait_us + 999) / 1000));
+    g_source_set_callback(state.timer, &GstPipelineWrapper::key_unit_due, this, nullptr);
+    g_source_attach(state.timer, context_);
+}
+
+GstPadProbeReturn GstPipelineWrapper::track_keyframes(GstPad*, GstPadProbeInfo* info, gpointer data) {
+    auto* state = static_cast<KeyUnitRequests*>(data);
+    if (!GST_BUFFER_FLAG_IS_SET(GST_PAD_PROBE_INFO_BUFFER(info), GST_BUFFER_FLAG_DELTA_UNIT)) {
+        state->last_keyframe_us.store(g_get_monotonic_time(), std::memory_order_relaxed);
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+gboolean GstPipelineWrapper::key_unit_due(gpointer data) {
+    auto* self = static_cast<GstPipelineWrapper*>(data);
+    KeyUnitRequests& state = *self->key_unit_requests_;
+    state.scheduler.on_keyframe(state.last_keyframe_us.load(std::memory_order_relaxed));
+    const KeyUnitDue due = state.scheduler.take_due(g_get_monotonic_time());
+    g_source_unref(state.timer);
+    state.timer = nullptr;
+    if (due.requests == 0) {
+        if (state.scheduler.deadline_us() >= 0) {
+            self->arm_key_unit_timer();
+        }
+        return G_SOURCE_REMOVE;
+    }
+
+    ControlResult result{ControlResult::Status::Ok, "key unit requested"};
+    if (due.send && !send_force_key_unit(state.encoder)) {
+        result = {ControlResult::Status::Rejected, state.config.encoder + " did not handle GstForceKeyUnit"};
+    }
+    SLOG_INFO("GStreamer", "Key unit requests answered", "encoder", state.config.encoder,
+              "requests", due.requests, "forced", due.send);
+    // Callbacks may request again (and arm a new timer) or disable the service.
+    std::vector<ControlCallback> waiting = std::move(state.waiting);
+    state.waiting.clear();
+    for (auto& done : waiting) {
+        done(result);
+    }
+    return G_SOURCE_REMOVE;
+}
@@ -2,18 +2,246 @@
 #define GST_PIPELINE_HPP
 
 #include <gst/gst.h>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <vector>
+#include "../metrics/metrics.h"
+#include "bitrate_controller.hpp"
+#include "key_unit_scheduler.hpp"
+
+// Outcome of a control call made on a running pipeline.
+struct ControlResult {
+    enum class Status { Ok, NoSuchElement, NoSuchProperty, Rejected };
+
+    Status status;
+    // New property value on success, reason otherwise.
+    std::string message;
+};
+
+// Outcome of a lifecycle request, as reported by the pipeline's bus.
+struct LifecycleEvent {
+    enum class Status { Reached, Error, Eos };
+
+    Status status;
+    // State the pipeline was in when the event was reported.
+    GstState state;
+    // Error text (from the ERROR message when there was one), empty otherwise.
+    std::string message;
+};
+
+// Where the adaptive bitrate controller looks and how often it acts. Element
+// names refer to the pipeline description.
+struct AdaptiveBitrateConfig {
+    std::string encoder = "encode";
+    // Queues in front of the encoder: frames waiting for CPU.
+    std::vector<std::string> input_queues;
+    // Queue between the encoder and the sink, empty for none: encoded data
+    // waiting for the egress.
+    std::string egress_queue;
+    guint interval_ms = 500;
+    BitrateControllerConfig controller;
+    // Runs on the main context after every period, changed or not.
+    std::function<void(const CongestionSample&, const BitrateDecision&)> on_decision;
+};
+
+// Keyframe request handling for one encoder.
+struct KeyUnitRequestConfig {
+    std::string encoder = "encode";
+    KeyUnitPolicy policy;
+};
 
 class GstPipelineWrapper {
     public:
-        GstPipelineWrapper(const char* pipeline_str);
+        // Control calls and the bus watch are attached to `context`, which must be
+        // iterated by a GMainLoop (nullptr selects the global default context).
+        // Destroy the wrapper once that loop has stopped, or from the loop itself.
+        GstPipelineWrapper(const char* pipeline_str, GMainContext* context = nullptr);
         ~GstPipelineWrapper();
 
+        // False when the description could not be parsed.
+        bool valid() const { return pipeline_ != nullptr; }
+
+        // The element named `name` in the description, with a new reference
+        // (release with gst_object_unref), or nullptr.
+        GstElement* element(const char* name) const;
+
+        // Fire-and-forget state changes; see start_async()/stop_async() to wait.
         void start();
         void stop();
-        //void set_bitrate(const std::string& encoder_name, guint bitrate);
+
+        using LifecycleCallback = std::function<void(LifecycleEvent)>;
+
+        // Requests `target` and reports once the pipeline itself has posted the
+        // matching STATE_CHANGED message (immediately when the change completes
+        // synchronously), or the first ERROR. `done` runs on the main context.
+        void set_state_async(GstState target, LifecycleCallback done);
+        std::future<LifecycleEvent> set_state_async(GstState target);
+        std::future<LifecycleEvent> start_async() { return set_state_async(GST_STATE_PLAYING); }
+        std::future<LifecycleEvent> stop_async() { return set_state_async(GST_STATE_NULL); }
+
+        // Reports EOS or ERROR, whichever comes first; immediately if the pipeline
+        // already ended since it was last brought down to READY.
+        void end_of_stream_async(LifecycleCallback done);
+        std::future<LifecycleEvent> end_of_stream_async();
+
+        // Sends EOS into the pipeline and reports once it has reached the sinks,
+        // or the first ERROR; immediately if the pipeline has already ended.
+        void send_eos_async(LifecycleCallback done);
+        std::future<LifecycleEvent> send_eos_async();
+
+        // Makes a used pipeline reusable: flushes whatever is in flight, drops to
+        // READY and forgets the appsink tap and any past EOS or ERROR.
+        void reset_async(LifecycleCallback done);
+
+        using ControlCallback = std::function<void(ControlResult)>;
+
+        // Runs `fn` on the pipeline's main context; immediately if the caller owns it.
+        void invoke(std::function<void()> fn);
+
+        // Sets `property` of the element named `element` from its string form
+        // (parsed according to the property type), then reports the value read back.
+        // `done` runs on the main context.
+        void set_property_async(std::string element, std::string property, std::string value, ControlCallback done);
+        void get_property_async(std::string element, std::string property, ControlCallback done);
+
+        // Receives the buffers of an appsink tap, see tap_appsink().
+        using BufferTap = std::function<void(GstBuffer*)>;
+
+        // Delivers every buffer reaching the appsink named `appsink_name` to `tap`,
+        // on the streaming thread; the buffer is only borrowed for the call.
+        // Returns false when the pipeline has no such appsink.
+        bool tap_appsink(const char* appsink_name, BufferTap tap);
+
+        // Sends a GstForceKeyUnit upstream event on the element's src pad, asking
+        // the encoder for an IDR frame with all headers, right away: see
+        // request_key_unit_async() for the coalesced, rate-limited path.
+        void force_key_unit_async(std::string element, ControlCallback done);
+
+        // Routes keyframe requests through a KeyUnitScheduler: concurrent requests
+        // share one GstForceKeyUnit and none is sent within the policy's minimum
+        // interval of the previous keyframe leaving the encoder (pad probe).
+        // False when the encoder is missing or has no static src pad. Call
+        // before start() or from the main context; replaces any previous
+        // configuration.
+        bool enable_key_unit_requests(KeyUnitRequestConfig config);
+        void disable_key_unit_requests();
+
+        // Asks for a keyframe. `cached_gop` tells that the caller already holds
+        // the GOP since the last keyframe (a StreamHub viewer replays it from the
+        // ring). `done` runs on the main context with Ok and "cached" when that
+        // GOP is recent enough to start from, with Ok and "key unit requested"
+        // once the shared key unit went out (or a natural keyframe made it
+        // unnecessary), and with Rejected when the encoder refused it or
+        // requests are not enabled.
+        void request_key_unit_async(bool cached_gop, ControlCallback done);
+
+        // Drives the encoder's bitrate and speed-preset from queue fill levels and
+        // the time frames spend in the encoder (pad probes), every
+        // `interval_ms` while PLAYING, and forces a key unit after large steps
+        // (through enable_key_unit_requests() when enabled).
+        // False when one of the named elements is missing or is not a queue, or
+        // when the encoder has no bitrate. Call before start() or from the main
+        // context; replaces any previous configuration.
+        bool enable_adaptive_bitrate(AdaptiveBitrateConfig config);
+        void disable_adaptive_bitrate();
+
+        // Counts buffers and bytes leaving every element given an explicit name in
+        // the description (pad probes), and reports them with the pipeline state
+        // in `registry` when it is scraped. `registry` must outlive the wrapper.
+        void register_metrics(MetricsRegistry& registry);
     private:
+        struct StateWaiter {
+            GstState target;
+            LifecycleCallback done;
+        };
+
+        struct ElementCounters {
+            std::string name;
+            GstPad* pad = nullptr;
+            gulong probe = 0;
+            Counter buffers;
+            Counter bytes;
+        };
+
+        static gboolean bus_call(GstBus* bus, GstMessage* msg, gpointer data);
+        // Measurements and state of the adaptive bitrate loop. The probes run on
+        // streaming threads and only touch `lock`ed fields.
+        struct AdaptiveBitrate {
+            AdaptiveBitrate(AdaptiveBitrateConfig config, unsigned bitrate_kbps, int speed_preset)
+                : config(std::move(config)), controller(this->config.controller, bitrate_kbps, speed_preset) {}
+
+            AdaptiveBitrateConfig config;
+            BitrateController controller;
+            GstElement* encoder = nullptr;
+            std::vector<GstElement*> input_queues;
+            GstElement* egress_queue = nullptr;
+            GstPad* sink_pad = nullptr;
+            GstPad* src_pad = nullptr;
+            gulong entry_probe = 0;
+            gulong exit_probe = 0;
+            GSource* timer = nullptr;
+
+            std::mutex lock;
+            // PTS and arrival time of frames inside the encoder, oldest first.
+            std::deque<std::pair<GstClockTime, gint64>> in_flight;
+            gint64 encode_us_total = 0;
+            guint64 encoded = 0;
+        };
+
+        // Pending keyframe requests. The probe runs on the encoder's streaming
+        // thread and only touches `last_keyframe_us`.
+        struct KeyUnitRequests {
+            explicit KeyUnitRequests(KeyUnitRequestConfig config)
+                : config(std::move(config)), scheduler(this->config.policy) {}
+
+            KeyUnitRequestConfig config;
+            KeyUnitScheduler scheduler;
+            GstElement* encoder = nullptr;
+            GstPad* src_pad = nullptr;
+            gulong probe = 0;
+            // Armed for the pending request's deadline.
+            GSource* timer = nullptr;
+            std::vector<ControlCallback> waiting;
+
+            // Monotonic time the last keyframe left the encoder, -1 before the first.
+            std::atomic<gint64> last_keyframe_us{-1};
+        };
+
+        static GstPadProbeReturn count_buffers(GstPad* pad, GstPadProbeInfo* info, gpointer data);
+        static GstPadProbeReturn encoder_entry(GstPad* pad, GstPadProbeInfo* info, gpointer data);
+        static GstPadProbeReturn encoder_exit(GstPad* pad, GstPadProbeInfo* info, gpointer data);
+        static gboolean adaptive_bitrate_tick(gpointer data);
+        static GstPadProbeReturn track_keyframes(GstPad* pad, GstPadProbeInfo* info, gpointer data);
+        static gboolean key_unit_due(gpointer data);
+        // Main context only.
+        void request_key_unit(bool cached_gop, ControlCallback done);
+        void arm_key_unit_timer();
+        GstState current_state() const;
+        // Resolves every pending waiter with `event`.
+        void end_waiters(const LifecycleEvent& event);
+
         GstElement* pipeline_;
+        GMainContext* context_;
+        GSource* bus_watch_ = nullptr;
+        BufferTap buffer_tap_;
+
+        // Only touched on the main context.
+        std::vector<StateWaiter> state_waiters_;
+        std::vector<LifecycleCallback> eos_waiters_;
+        std::optional<LifecycleEvent> ended_;
+
+        std::vector<std::unique_ptr<ElementCounters>> element_counters_;
+        MetricsRegistry* metrics_ = nullptr;
+        std::vector<std::size_t> metric_collectors_;
+
+        std::unique_ptr<AdaptiveBitrate> adaptive_bitrate_;
+        std::unique_ptr<KeyUnitRequests> key_unit_requests_;
 };
 
-#endif // GST_PIPELINE_HPP
\ No newline at end of file
+#endif // GST_PIPELINE_HPP
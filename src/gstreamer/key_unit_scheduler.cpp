@@ -0,0 +1,42 @@
+#include "key_unit_scheduler.hpp"
+#include <algorithm>
+
+KeyUnitAnswer KeyUnitScheduler::request(std::int64_t now_us, bool cached_gop) {
+    if (cached_gop && last_keyframe_us_ >= 0 && now_us - last_keyframe_us_ <= policy_.max_cached_age_us) {
+        return KeyUnitAnswer::Cached;
+    }
+    if (pending_ > 0) {
+        ++pending_;
+        return KeyUnitAnswer::Coalesced;
+    }
+
+    pending_ = 1;
+    first_request_us_ = now_us;
+    deadline_us_ = now_us + policy_.coalesce_us;
+    // A key unit sent but not out of the encoder yet counts as the last one.
+    const std::int64_t last_idr = std::max(last_keyframe_us_, last_sent_us_);
+    if (last_idr >= 0) {
+        deadline_us_ = std::max(deadline_us_, last_idr + policy_.min_interval_us);
+    }
+    return KeyUnitAnswer::Scheduled;
+}
+
+KeyUnitDue KeyUnitScheduler::take_due(std::int64_t now_us) {
+    if (pending_ == 0 || now_us < deadline_us_) {
+        return {};
+    }
+    KeyUnitDue due;
+    due.requests = pending_;
+    due.send = last_keyframe_us_ < first_request_us_;
+    if (due.send) {
+        last_sent_us_ = now_us;
+    }
+    pending_ = 0;
+    first_request_us_ = -1;
+    deadline_us_ = -1;
+    return due;
+}
+
+void KeyUnitScheduler::on_keyframe(std::int64_t time_us) {
+    last_keyframe_us_ = std::max(last_keyframe_us_, time_us);
+}
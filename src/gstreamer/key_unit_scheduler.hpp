@@ -0,0 +1,67 @@
+#ifndef KEY_UNIT_SCHEDULER_HPP
+#define KEY_UNIT_SCHEDULER_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+struct KeyUnitPolicy {
+    // Requests arriving while one is pending, up to this long after it, share
+    // its key unit.
+    std::int64_t coalesce_us = 100000;
+    // No key unit is forced sooner than this after the previous keyframe,
+    // forced or natural.
+    std::int64_t min_interval_us = 1000000;
+    // A caller that can start from the cached GOP is answered from it as long
+    // as its keyframe is no older than this.
+    std::int64_t max_cached_age_us = 2000000;
+};
+
+enum class KeyUnitAnswer {
+    // Start from the cached GOP: no new keyframe.
+    Cached,
+    // First pending request: a key unit is due at deadline_us().
+    Scheduled,
+    // Joined the pending request.
+    Coalesced,
+};
+
+// What to do once the pending request falls due.
+struct KeyUnitDue {
+    // Requests answered, 0 when nothing was due.
+    std::size_t requests = 0;
+    // False when a keyframe went out since the first of them: it answers all.
+    bool send = false;
+};
+
+// Rate limiting for keyframe requests. Bursts of requests (viewers joining
+// together, decoders reporting loss) collapse into one key unit, never sooner
+// than `min_interval_us` after the last one, and callers that can start from
+// the most recent GOP are sent there instead. Times are in microseconds on any
+// monotonic clock. Pure logic: GstPipelineWrapper feeds it and sends the event.
+class KeyUnitScheduler {
+    public:
+        explicit KeyUnitScheduler(KeyUnitPolicy policy) : policy_(policy) {}
+
+        // `cached_gop` tells whether the caller may start from the cached GOP
+        // (there is one and the caller can use it).
+        KeyUnitAnswer request(std::int64_t now_us, bool cached_gop);
+
+        // When the pending request falls due, -1 when none is pending.
+        std::int64_t deadline_us() const { return deadline_us_; }
+
+        // Answers the pending request once its deadline has passed.
+        KeyUnitDue take_due(std::int64_t now_us);
+
+        // A keyframe left the encoder at `time_us`, forced or not.
+        void on_keyframe(std::int64_t time_us);
+
+    private:
+        const KeyUnitPolicy policy_;
+        std::size_t pending_ = 0;
+        std::int64_t first_request_us_ = -1;
+        std::int64_t deadline_us_ = -1;
+        std::int64_t last_keyframe_us_ = -1;
+        std::int64_t last_sent_us_ = -1;
+};
+
+#endif // KEY_UNIT_SCHEDULER_HPP
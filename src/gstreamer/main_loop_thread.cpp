@@ -0,0 +1,31 @@
+#include "main_loop_thread.hpp"
+#include "../logging/logger.h"
+
+MainLoopThread::MainLoopThread()
+    : context_(g_main_context_new()), loop_(g_main_loop_new(context_, FALSE)) {
+    thread_ = std::thread([this] {
+        g_main_context_push_thread_default(context_);
+        g_main_loop_run(loop_);
+        g_main_context_pop_thread_default(context_);
+    });
+    SLOG_DEBUG("GLib", "Main loop thread started");
+}
+
+MainLoopThread::~MainLoopThread() {
+    // Quit from inside the loop: a g_main_loop_quit() issued before
+    // g_main_loop_run() has started would be lost. The low priority lets work
+    // already queued on the context (deferred teardown, pending calls) run first.
+    GSource* quit = g_idle_source_new();
+    g_source_set_priority(quit, G_PRIORITY_LOW);
+    g_source_set_callback(quit, [](gpointer loop) -> gboolean {
+        g_main_loop_quit(static_cast<GMainLoop*>(loop));
+        return G_SOURCE_REMOVE;
+    }, loop_, nullptr);
+    g_source_attach(quit, context_);
+    g_source_unref(quit);
+
+    thread_.join();
+    g_main_loop_unref(loop_);
+    g_main_context_unref(context_);
+    SLOG_DEBUG("GLib", "Main loop thread stopped");
+}
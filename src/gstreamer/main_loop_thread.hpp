@@ -0,0 +1,24 @@
+#ifndef MAIN_LOOP_THREAD_HPP
+#define MAIN_LOOP_THREAD_HPP
+
+#include <glib.h>
+#include <thread>
+
+// Owns a GMainContext and a thread that runs a GMainLoop on it. Bus watches and
+// calls marshalled with g_main_context_invoke on context() run on that thread.
+class MainLoopThread {
+    public:
+        MainLoopThread();
+        ~MainLoopThread();
+
+        MainLoopThread(const MainLoopThread&) = delete;
+        MainLoopThread& operator=(const MainLoopThread&) = delete;
+
+        GMainContext* context() const { return context_; }
+    private:
+        GMainContext* context_;
+        GMainLoop* loop_;
+        std::thread thread_;
+};
+
+#endif // MAIN_LOOP_THREAD_HPP
@@ -0,0 +1,337 @@
+#include "pipeline_manager.hpp"
+#include <algorithm>
+#include "../logging/logger.h"
+
+struct PipelineManager::Entry {
+    std::string description;
+    std::unique_ptr<GstPipelineWrapper> pipeline;
+    PipelineStatus::State state = PipelineStatus::State::Stopped;
+    // The pipeline has reported EOS or ERROR and must be rebuilt to run again.
+    bool ended = false;
+    // Set by start(), cleared by stop(): only then is an ERROR worth a restart.
+    bool wanted = false;
+    unsigned restarts = 0;
+    std::string last_error;
+    std::chrono::milliseconds backoff{0};
+    std::chrono::steady_clock::time_point started;
+    GSource* restart_timer = nullptr;
+    // Taken from the manager's counter whenever the pipeline is replaced, so
+    // that callbacks of the old one (even from a removed entry of the same
+    // name) are recognised and ignored.
+    std::uint64_t generation = 0;
+};
+
+const char* to_string(PipelineStatus::State state) {
+    switch (state) {
+    case PipelineStatus::State::Stopped: return "stopped";
+    case PipelineStatus::State::Starting: return "starting";
+    case PipelineStatus::State::Playing: return "playing";
+    case PipelineStatus::State::Restarting: return "restarting";
+    case PipelineStatus::State::Ended: return "ended";
+    case PipelineStatus::State::Failed: return "failed";
+    }
+    return "unknown";
+}
+
+namespace {
+
+LifecycleEvent no_such_pipeline(const std::string& name) {
+    return {LifecycleEvent::Status::Error, GST_STATE_VOID_PENDING, "no pipeline named " + name};
+}
+
+// Destroys `pipeline` from an idle source: never from inside one of its own
+// callbacks, which may be what got us here.
+void destroy_later(GMainContext* context, std::unique_ptr<GstPipelineWrapper> pipeline) {
+    if (!pipeline) {
+        return;
+    }
+    GSource* source = g_idle_source_new();
+    g_source_set_callback(source,
+        [](gpointer) -> gboolean { return G_SOURCE_REMOVE; },
+        pipeline.release(),
+        [](gpointer data) { delete static_cast<GstPipelineWrapper*>(data); });
+    g_source_attach(source, context);
+    g_source_unref(source);
+}
+
+template <typename T>
+std::shared_ptr<std::promise<T>> make_promise(std::future<T>& future) {
+    auto promise = std::make_shared<std::promise<T>>();
+    future = promise->get_future();
+    return promise;
+}
+
+} // namespace
+
+PipelineManager::PipelineManager(RestartPolicy policy) : policy_(policy) {
+    SLOG_INFO("PipelineManager", "Pipeline manager started", "initial_backoff_ms", policy_.initial_backoff.count(),
+              "max_backoff_ms", policy_.max_backoff.count());
+}
+
+PipelineManager::~PipelineManager() {
+    std::promise<void> cleared;
+    invoke([this, &cleared] {
+        // Out of the map first: a wrapper being destroyed reports "pipeline
+        // destroyed" to on_ended(), which must then find nothing to act on.
+        std::map<std::string, std::unique_ptr<Entry>> entries;
+        entries.swap(entries_);
+        for (auto& [name, entry] : entries) {
+            cancel_restart(*entry);
+        }
+        // Not called from a pipeline callback: the wrappers can go right away.
+        entries.clear();
+        // Likewise for wrappers still waiting in destroy_later().
+        while (g_main_context_iteration(loop_.context(), FALSE)) {
+        }
+        cleared.set_value();
+    });
+    cleared.get_future().wait();
+    SLOG_INFO("PipelineManager", "Pipeline manager stopped");
+}
+
+void PipelineManager::invoke(std::function<void()> fn) {
+    auto* call = new std::function<void()>(std::move(fn));
+    g_main_context_invoke_full(loop_.context(), G_PRIORITY_HIGH,
+        [](gpointer data) -> gboolean {
+            (*static_cast<std::function<void()>*>(data))();
+            return G_SOURCE_REMOVE;
+        },
+        call,
+        [](gpointer data) { delete static_cast<std::function<void()>*>(data); });
+}
+
+PipelineManager::Entry* PipelineManager::find(const std::string& name) {
+    const auto it = entries_.find(name);
+    return it == entries_.end() ? nullptr : it->second.get();
+}
+
+std::future<bool> PipelineManager::create(std::string name, std::string description) {
+    std::future<bool> future;
+    invoke([this, promise = make_promise(future), name = std::move(name), description = std::move(description)] {
+        if (find(name)) {
+            SLOG_WARN("PipelineManager", "Pipeline name already taken", "name", name);
+            promise->set_value(false);
+            return;
+        }
+        auto entry = std::make_unique<Entry>();
+        entry->description = description;
+        entry->backoff = policy_.initial_backoff;
+        if (!rebuild(name, *entry)) {
+            promise->set_value(false);
+            return;
+        }
+        SLOG_INFO("PipelineManager", "Pipeline created", "name", name);
+        entries_.emplace(name, std::move(entry));
+        promise->set_value(true);
+    });
+    return future;
+}
+
+bool PipelineManager::rebuild(const std::string& name, Entry& entry) {
+    entry.generation = ++generation_;
+    destroy_later(loop_.context(), std::move(entry.pipeline));
+    auto pipeline = std::make_unique<GstPipelineWrapper>(entry.description.c_str(), loop_.context());
+    if (!pipeline->valid()) {
+        entry.state = PipelineStatus::State::Failed;
+        entry.last_error = "description does not parse";
+        return false;
+    }
+    entry.pipeline = std::move(pipeline);
+    entry.ended = false;
+    entry.pipeline->end_of_stream_async([this, name, generation = entry.generation](LifecycleEvent event) {
+        on_ended(name, generation, event);
+    });
+    return true;
+}
+
+std::future<LifecycleEvent> PipelineManager::start(std::string name) {
+    std::future<LifecycleEvent> future;
+    invoke([this, promise = make_promise(future), name = std::move(name)] {
+        Entry* entry = find(name);
+        if (!entry) {
+            promise->set_value(no_such_pipeline(name));
+            return;
+        }
+        entry->wanted = true;
+        cancel_restart(*entry);
+        if ((entry->ended || !entry->pipeline) && !rebuild(name, *entry)) {
+            promise->set_value({LifecycleEvent::Status::Error, GST_STATE_VOID_PENDING, entry->last_error});
+            return;
+        }
+        run(name, *entry, [promise](LifecycleEvent event) { promise->set_value(std::move(event)); });
+    });
+    return future;
+}
+
+void PipelineManager::run(const std::string& name, Entry& entry, std::function<void(LifecycleEvent)> done) {
+    entry.state = PipelineStatus::State::Starting;
+    entry.started = std::chrono::steady_clock::now();
+    entry.pipeline->set_state_async(GST_STATE_PLAYING,
+        [this, name, generation = entry.generation, done = std::move(done)](LifecycleEvent event) {
+            Entry* entry = find(name);
+            if (entry && entry->generation == generation && entry->state == PipelineStatus::State::Starting &&
+                event.status == LifecycleEvent::Status::Reached) {
+                entry->state = PipelineStatus::State::Playing;
+                SLOG_INFO("PipelineManager", "Pipeline playing", "name", name, "restarts", entry->restarts);
+            }
+            // A failure is taken care of by on_ended(), which sees the same ERROR.
+            if (done) {
+                done(std::move(event));
+            }
+        });
+}
+
+void PipelineManager::on_ended(const std::string& name, std::uint64_t generation, const LifecycleEvent& event) {
+    Entry* entry = find(name);
+    if (!entry || entry->generation != generation) {
+        return;
+    }
+    entry->ended = true;
+    if (event.status == LifecycleEvent::Status::Eos) {
+        SLOG_INFO("PipelineManager", "Pipeline ended", "name", name);
+        entry->state = PipelineStatus::State::Ended;
+        entry->wanted = false;
+        return;
+    }
+    entry->last_error = event.message;
+    if (!entry->wanted) {
+        entry->state = PipelineStatus::State::Failed;
+        return;
+    }
+    if (policy_.max_restarts != 0 && entry->restarts >= policy_.max_restarts) {
+        SLOG_ERROR("PipelineManager", "Pipeline failed, giving up", "name", name, "restarts", entry->restarts,
+                   "error", event.message);
+        entry->state = PipelineStatus::State::Failed;
+        entry->wanted = false;
+        return;
+    }
+    schedule_restart(name, *entry);
+}
+
+void PipelineManager::schedule_restart(const std::string& name, Entry& entry) {
+    if (std::chrono::steady_clock::now() - entry.started >= policy_.stable_after) {
+        entry.backoff = policy_.initial_backoff;
+    }
+    const auto delay = entry.backoff;
+    entry.backoff = std::min(entry.backoff * 2, policy_.max_backoff);
+    entry.state = PipelineStatus::State::Restarting;
+    SLOG_WARN("PipelineManager", "Pipeline failed, restarting", "name", name, "delay_ms", delay.count(),
+              "error", entry.last_error);
+
+    struct Call {
+        PipelineManager* self;
+        std::string name;
+    };
+    entry.restart_timer = g_timeout_source_new(static_cast<guint>(delay.count()));
+    g_source_set_callback(entry.restart_timer,
+        [](gpointer data) -> gboolean {
+            auto* call = static_cast<Call*>(data);
+            call->self->restart(call->name);
+            return G_SOURCE_REMOVE;
+        },
+        new Call{this, name},
+        [](gpointer data) { delete static_cast<Call*>(data); });
+    g_source_attach(entry.restart_timer, loop_.context());
+}
+
+void PipelineManager::restart(const std::string& name) {
+    Entry* entry = find(name);
+    if (!entry) {
+        return;
+    }
+    g_source_unref(entry->restart_timer);
+    entry->restart_timer = nullptr;
+    ++entry->restarts;
+    if (!rebuild(name, *entry)) {
+        SLOG_ERROR("PipelineManager", "Pipeline could not be rebuilt", "name", name);
+        entry->wanted = false;
+        return;
+    }
+    run(name, *entry, nullptr);
+}
+
+void PipelineManager::cancel_restart(Entry& entry) {
+    if (entry.restart_timer) {
+        g_source_destroy(entry.restart_timer);
+        g_source_unref(entry.restart_timer);
+        entry.restart_timer = nullptr;
+    }
+}
+
+std::future<LifecycleEvent> PipelineManager::stop(std::string name) {
+    std::future<LifecycleEvent> future;
+    invoke([this, promise = make_promise(future), name = std::move(name)] {
+        Entry* entry = find(name);
+        if (!entry) {
+            promise->set_value(no_such_pipeline(name));
+            return;
+        }
+        entry->wanted = false;
+        cancel_restart(*entry);
+        if (!entry->pipeline) {
+            entry->state = PipelineStatus::State::Stopped;
+            promise->set_value({LifecycleEvent::Status::Reached, GST_STATE_NULL, {}});
+            return;
+        }
+        entry->pipeline->set_state_async(GST_STATE_NULL,
+            [this, promise, name, generation = entry->generation](LifecycleEvent event) {
+                Entry* entry = find(name);
+                if (entry && entry->generation == generation && event.status == LifecycleEvent::Status::Reached) {
+                    entry->state = PipelineStatus::State::Stopped;
+                    SLOG_INFO("PipelineManager", "Pipeline stopped", "name", name);
+                }
+                promise->set_value(std::move(event));
+            });
+    });
+    return future;
+}
+
+std::future<bool> PipelineManager::remove(std::string name) {
+    std::future<bool> future;
+    invoke([this, promise = make_promise(future), name = std::move(name)] {
+        const auto it = entries_.find(name);
+        if (it == entries_.end()) {
+            promise->set_value(false);
+            return;
+        }
+        cancel_restart(*it->second);
+        destroy_later(loop_.context(), std::move(it->second->pipeline));
+        entries_.erase(it);
+        SLOG_INFO("PipelineManager", "Pipeline removed", "name", name);
+        promise->set_value(true);
+    });
+    return future;
+}
+
+PipelineStatus PipelineManager::status_of(const std::string& name, const Entry& entry) const {
+    return {name, entry.description, entry.state, entry.restarts, entry.last_error};
+}
+
+std::future<std::optional<PipelineStatus>> PipelineManager::query(std::string name) {
+    std::future<std::optional<PipelineStatus>> future;
+    invoke([this, promise = make_promise(future), name = std::move(name)] {
+        Entry* entry = find(name);
+        promise->set_value(entry ? std::optional<PipelineStatus>(status_of(name, *entry)) : std::nullopt);
+    });
+    return future;
+}
+
+std::future<std::vector<PipelineStatus>> PipelineManager::list() {
+    std::future<std::vector<PipelineStatus>> future;
+    invoke([this, promise = make_promise(future)] {
+        std::vector<PipelineStatus> statuses;
+        statuses.reserve(entries_.size());
+        for (const auto& [name, entry] : entries_) {
+            statuses.push_back(status_of(name, *entry));
+        }
+        promise->set_value(std::move(statuses));
+    });
+    return future;
+}
+
+void PipelineManager::with_pipeline(std::string name, std::function<void(GstPipelineWrapper*)> fn) {
+    invoke([this, name = std::move(name), fn = std::move(fn)] {
+        Entry* entry = find(name);
+        fn(entry ? entry->pipeline.get() : nullptr);
+    });
+}
@@ -0,0 +1,100 @@
+#ifndef PIPELINE_MANAGER_HPP
+#define PIPELINE_MANAGER_HPP
+
+#include <gst/gst.h>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include "gst_pipeline.hpp"
+#include "main_loop_thread.hpp"
+
+// What to do when a running pipeline posts an ERROR: rebuild it from its
+// description and start it again, waiting longer after each failure in a row.
+struct RestartPolicy {
+    std::chrono::milliseconds initial_backoff{250};
+    std::chrono::milliseconds max_backoff{30000};
+    // A pipeline that ran this long before failing starts over from initial_backoff.
+    std::chrono::milliseconds stable_after{10000};
+    // Restarts before giving up for good; 0 never gives up.
+    unsigned max_restarts = 0;
+};
+
+struct PipelineStatus {
+    enum class State { Stopped, Starting, Playing, Restarting, Ended, Failed };
+
+    std::string name;
+    std::string description;
+    State state;
+    // Restarts after an ERROR since the pipeline was created.
+    unsigned restarts;
+    // Text of the last ERROR, empty if there never was one.
+    std::string last_error;
+};
+
+const char* to_string(PipelineStatus::State state);
+
+// Owns named pipelines and the one GLib main-context thread that runs all of
+// their bus watches, control calls and restarts. Every call may be made from
+// any thread: it is carried out on that thread and answered through a future.
+// Waiting on such a future from a pipeline callback would block that thread.
+class PipelineManager {
+    public:
+        explicit PipelineManager(RestartPolicy policy = {});
+        // Brings every pipeline down to NULL, then stops the thread.
+        ~PipelineManager();
+
+        PipelineManager(const PipelineManager&) = delete;
+        PipelineManager& operator=(const PipelineManager&) = delete;
+
+        // Parses `description` and keeps it under `name`, stopped. False if the
+        // name is taken or the description does not parse.
+        std::future<bool> create(std::string name, std::string description);
+        // Brings the pipeline to PLAYING and keeps it there: an ERROR from now on
+        // restarts it. A pipeline that ended or failed is rebuilt first.
+        std::future<LifecycleEvent> start(std::string name);
+        // Brings the pipeline to NULL and cancels any pending restart.
+        std::future<LifecycleEvent> stop(std::string name);
+        // Stops and destroys the pipeline. False if there is no such pipeline.
+        std::future<bool> remove(std::string name);
+
+        std::future<std::optional<PipelineStatus>> query(std::string name);
+        std::future<std::vector<PipelineStatus>> list();
+
+        // Runs `fn` with the pipeline on the manager's thread, or with nullptr if
+        // there is none. The pointer is only valid during the call: a restart
+        // replaces the pipeline.
+        void with_pipeline(std::string name, std::function<void(GstPipelineWrapper*)> fn);
+
+        GMainContext* context() const { return loop_.context(); }
+
+    private:
+        struct Entry;
+
+        // Runs `fn` on the manager's thread; immediately if the caller is on it.
+        void invoke(std::function<void()> fn);
+        Entry* find(const std::string& name);
+        // Replaces the entry's pipeline with a freshly parsed one. False if the
+        // description no longer parses.
+        bool rebuild(const std::string& name, Entry& entry);
+        void run(const std::string& name, Entry& entry, std::function<void(LifecycleEvent)> done);
+        void on_ended(const std::string& name, std::uint64_t generation, const LifecycleEvent& event);
+        void schedule_restart(const std::string& name, Entry& entry);
+        void restart(const std::string& name);
+        void cancel_restart(Entry& entry);
+        PipelineStatus status_of(const std::string& name, const Entry& entry) const;
+
+        const RestartPolicy policy_;
+        MainLoopThread loop_;
+        // Only touched on the manager's thread.
+        std::map<std::string, std::unique_ptr<Entry>> entries_;
+        // Last generation handed out, across all entries.
+        std::uint64_t generation_ = 0;
+};
+
+#endif // PIPELINE_MANAGER_HPP
@@ -0,0 +1,203 @@
+#include "pipeline_pool.hpp"
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <vector>
+#include "../logging/logger.h"
+
+struct PipelinePoolState {
+    struct Entry {
+        // How many prerolled pipelines prewarm() asked for.
+        std::size_t target = 0;
+        // Pipelines being parsed, prerolled or recycled on the main context.
+        std::size_t warming = 0;
+        std::vector<std::unique_ptr<GstPipelineWrapper>> idle;
+    };
+
+    GMainContext* context;
+    mutable std::mutex mutex;
+    // Signalled whenever a pipeline stops warming, for the pool's destructor.
+    std::condition_variable settled;
+    std::map<std::string, Entry, std::less<>> entries;
+    bool closed = false;
+};
+
+namespace {
+
+using Pipeline = std::shared_ptr<std::unique_ptr<GstPipelineWrapper>>;
+
+// Runs `fn` from an idle source on `context`: after pending control calls, and
+// never from inside a callback of the pipeline that `fn` may destroy.
+void defer(GMainContext* context, std::function<void()> fn) {
+    GSource* source = g_idle_source_new();
+    g_source_set_callback(source,
+        [](gpointer data) -> gboolean {
+            (*static_cast<std::function<void()>*>(data))();
+            return G_SOURCE_REMOVE;
+        },
+        new std::function<void()>(std::move(fn)),
+        [](gpointer data) { delete static_cast<std::function<void()>*>(data); });
+    g_source_attach(source, context);
+    g_source_unref(source);
+}
+
+void discard(const std::shared_ptr<PipelinePoolState>& state, Pipeline pipeline) {
+    defer(state->context, [pipeline] { pipeline->reset(); });
+}
+
+// Called with the mutex held.
+void done_warming(PipelinePoolState& state, const std::string& description) {
+    --state.entries[description].warming;
+    state.settled.notify_all();
+}
+
+// Last step of warming up and of recycling: preroll, then make it available.
+void preroll(std::shared_ptr<PipelinePoolState> state, std::string description, Pipeline pipeline) {
+    (*pipeline)->set_state_async(GST_STATE_PAUSED,
+        [state, description = std::move(description), pipeline](LifecycleEvent event) {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            done_warming(*state, description);
+            if (event.status != LifecycleEvent::Status::Reached || state->closed) {
+                if (event.status != LifecycleEvent::Status::Reached) {
+                    SLOG_WARN("PipelinePool", "Preroll failed", "error", event.message);
+                }
+                discard(state, pipeline);
+                return;
+            }
+            state->entries[description].idle.push_back(std::move(*pipeline));
+        });
+}
+
+// Parses a new pipeline on the main context; `warming` was already counted.
+void warm_up(std::shared_ptr<PipelinePoolState> state, std::string description) {
+    defer(state->context, [state, description = std::move(description)] {
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (state->closed) {
+                done_warming(*state, description);
+                return;
+            }
+        }
+        auto pipeline = std::make_shared<std::unique_ptr<GstPipelineWrapper>>(
+            std::make_unique<GstPipelineWrapper>(description.c_str(), state->context));
+        if (!(*pipeline)->valid()) {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            done_warming(*state, description);
+            discard(state, pipeline);
+            return;
+        }
+        preroll(state, description, pipeline);
+    });
+}
+
+// Tops `entry` up to its target. Called with the mutex held.
+void refill(const std::shared_ptr<PipelinePoolState>& state, const std::string& description,
+            PipelinePoolState::Entry& entry) {
+    while (!state->closed && entry.idle.size() + entry.warming < entry.target) {
+        ++entry.warming;
+        warm_up(state, description);
+    }
+}
+
+} // namespace
+
+PipelineLease::PipelineLease(std::shared_ptr<PipelinePoolState> pool, std::string description,
+                             std::unique_ptr<GstPipelineWrapper> pipeline, bool warm)
+    : pool_(std::move(pool)), description_(std::move(description)), pipeline_(std::move(pipeline)), warm_(warm) {}
+
+PipelineLease& PipelineLease::operator=(PipelineLease&& other) noexcept {
+    if (this != &other) {
+        release();
+        pool_ = std::move(other.pool_);
+        description_ = std::move(other.description_);
+        pipeline_ = std::move(other.pipeline_);
+        warm_ = other.warm_;
+    }
+    return *this;
+}
+
+PipelineLease::~PipelineLease() {
+    release();
+}
+
+void PipelineLease::release() {
+    if (!pipeline_) {
+        return;
+    }
+    auto pipeline = std::make_shared<std::unique_ptr<GstPipelineWrapper>>(std::move(pipeline_));
+    auto state = std::move(pool_);
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        auto& entry = state->entries[description_];
+        if (state->closed || entry.idle.size() + entry.warming >= entry.target) {
+            discard(state, pipeline);
+            return;
+        }
+        ++entry.warming;
+    }
+    (*pipeline)->reset_async([state, description = std::move(description_), pipeline](LifecycleEvent event) {
+        if (event.status != LifecycleEvent::Status::Reached) {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            done_warming(*state, description);
+            discard(state, pipeline);
+            return;
+        }
+        preroll(state, description, pipeline);
+    });
+}
+
+PipelinePool::PipelinePool(GMainContext* context) : state_(std::make_shared<PipelinePoolState>()) {
+    state_->context = context ? context : g_main_context_default();
+}
+
+PipelinePool::~PipelinePool() {
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    state_->closed = true;
+    // Pipelines still warming up are discarded as they finish; they only finish
+    // if the main loop keeps running, hence the rule on where to destroy the pool.
+    state_->settled.wait(lock, [this] {
+        for (const auto& entry : state_->entries) {
+            if (entry.second.warming > 0) {
+                return false;
+            }
+        }
+        return true;
+    });
+    for (auto& entry : state_->entries) {
+        for (auto& pipeline : entry.second.idle) {
+            discard(state_, std::make_shared<std::unique_ptr<GstPipelineWrapper>>(std::move(pipeline)));
+        }
+        entry.second.idle.clear();
+    }
+}
+
+void PipelinePool::prewarm(const std::string& description, std::size_t count) {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    auto& entry = state_->entries[description];
+    entry.target = count;
+    refill(state_, description, entry);
+}
+
+PipelineLease PipelinePool::acquire(const std::string& description) {
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        auto& entry = state_->entries[description];
+        if (!entry.idle.empty()) {
+            auto pipeline = std::move(entry.idle.back());
+            entry.idle.pop_back();
+            refill(state_, description, entry);
+            return PipelineLease(state_, description, std::move(pipeline), true);
+        }
+        refill(state_, description, entry);
+    }
+    SLOG_INFO("PipelinePool", "No prerolled pipeline ready, parsing one");
+    return PipelineLease(state_, description,
+                         std::make_unique<GstPipelineWrapper>(description.c_str(), state_->context), false);
+}
+
+std::size_t PipelinePool::idle(const std::string& description) const {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    auto it = state_->entries.find(description);
+    return it == state_->entries.end() ? 0 : it->second.idle.size();
+}
@@ -0,0 +1,72 @@
+#ifndef PIPELINE_POOL_HPP
+#define PIPELINE_POOL_HPP
+
+#include <gst/gst.h>
+#include <memory>
+#include <string>
+#include "gst_pipeline.hpp"
+
+struct PipelinePoolState;
+
+// A pipeline handed out by a PipelinePool. It goes back to the pool when the
+// lease is destroyed, so the lease must not outlive the pool's main loop.
+class PipelineLease {
+    public:
+        PipelineLease() = default;
+        PipelineLease(PipelineLease&&) noexcept = default;
+        PipelineLease& operator=(PipelineLease&& other) noexcept;
+        ~PipelineLease();
+
+        GstPipelineWrapper* get() const { return pipeline_.get(); }
+        GstPipelineWrapper* operator->() const { return pipeline_.get(); }
+        GstPipelineWrapper& operator*() const { return *pipeline_; }
+        explicit operator bool() const { return pipeline_ != nullptr; }
+
+        // True when the pipeline came prerolled from the pool, false when it had
+        // to be parsed on the spot.
+        bool warm() const { return warm_; }
+
+    private:
+        friend class PipelinePool;
+
+        PipelineLease(std::shared_ptr<PipelinePoolState> pool, std::string description,
+                      std::unique_ptr<GstPipelineWrapper> pipeline, bool warm);
+        void release();
+
+        std::shared_ptr<PipelinePoolState> pool_;
+        std::string description_;
+        std::unique_ptr<GstPipelineWrapper> pipeline_;
+        bool warm_ = false;
+};
+
+// Keeps pipelines parsed and prerolled in PAUSED, keyed by their description, so
+// that starting one costs a PAUSED->PLAYING transition instead of a parse, a
+// NULL->READY element setup and a preroll. Pipelines handed back are flushed,
+// reset to READY and prerolled again rather than destroyed.
+//
+// Parsing, state changes and destruction of pooled pipelines run on `context`,
+// which must be iterated by a GMainLoop. Destroy the pool from another thread
+// while that loop still runs: it waits for pipelines being recycled to settle.
+class PipelinePool {
+    public:
+        explicit PipelinePool(GMainContext* context);
+        ~PipelinePool();
+
+        PipelinePool(const PipelinePool&) = delete;
+        PipelinePool& operator=(const PipelinePool&) = delete;
+
+        // Keeps up to `count` prerolled pipelines of `description` ready, starting now.
+        void prewarm(const std::string& description, std::size_t count);
+
+        // A prerolled pipeline when one is ready, otherwise a freshly parsed one
+        // in NULL. Either way, start_async() brings it to PLAYING.
+        PipelineLease acquire(const std::string& description);
+
+        // Prerolled pipelines of `description` waiting to be handed out.
+        std::size_t idle(const std::string& description) const;
+
+    private:
+        std::shared_ptr<PipelinePoolState> state_;
+};
+
+#endif // PIPELINE_POOL_HPP
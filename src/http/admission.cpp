@@ -0,0 +1,95 @@
+#include "admission.h"
+#include <algorithm>
+
+namespace {
+
+// Finalizer of splitmix64: a bijection, so distinct addresses keep distinct keys,
+// with the high bits (the shard) and the low bits (the slot) both well mixed.
+std::uint64_t mix(std::uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+constexpr int kShardBits = 4;
+static_assert(RateLimiter::kShards == 1u << kShardBits, "shards are picked by the top bits of the key");
+
+} // namespace
+
+RateLimiter::RateLimiter(double requests_per_second, double burst)
+    : interval_ns_(static_cast<std::int64_t>(1e9 / requests_per_second)),
+      tolerance_ns_(static_cast<std::int64_t>(std::max(burst, 1.0) * 1e9 / requests_per_second)),
+      shards_(new Shard[kShards]) {}
+
+std::uint64_t RateLimiter::client_key(const boost::asio::ip::address& address) {
+    std::uint64_t raw = 0;
+    if (address.is_v4()) {
+        raw = address.to_v4().to_uint();
+    } else if (address.to_v6().is_v4_mapped()) {
+        raw = boost::asio::ip::make_address_v4(boost::asio::ip::v4_mapped, address.to_v6()).to_uint();
+    } else {
+        const auto bytes = address.to_v6().to_bytes();
+        for (std::size_t i = 0; i < 8; ++i) {
+            raw = raw << 8 | bytes[i];
+        }
+    }
+    // 0 marks an empty slot.
+    const auto key = mix(raw);
+    return key ? key : 1;
+}
+
+RateLimiter::Slot* RateLimiter::find(std::uint64_t key, std::int64_t now) {
+    Shard& shard = shards_[key >> (64 - kShardBits)];
+    const std::size_t start = key % kSlotsPerShard;
+    Slot* free_slot = nullptr;
+    std::uint64_t free_key = 0;
+    for (std::size_t i = 0; i < kProbes; ++i) {
+        Slot& slot = shard.slots[(start + i) % kSlotsPerShard];
+        const auto current = slot.key.load(std::memory_order_acquire);
+        if (current == key) {
+            return &slot;
+        }
+        // Keys are replaced but never removed: past an empty slot there is
+        // nothing left to find.
+        const bool empty = current == 0;
+        if (!free_slot && (empty || slot.full_at.load(std::memory_order_relaxed) <= now)) {
+            free_slot = &slot;
+            free_key = current;
+        }
+        if (empty) {
+            break;
+        }
+    }
+    if (!free_slot) {
+        return nullptr;
+    }
+    // A full bucket is what a new client starts with: taking over the slot of
+    // one that has been quiet long enough leaves its time as it is. Losing the
+    // race is fine if the winner is the same client.
+    if (free_slot->key.compare_exchange_strong(free_key, key, std::memory_order_acq_rel) || free_key == key) {
+        return free_slot;
+    }
+    return nullptr;
+}
+
+bool RateLimiter::try_acquire(std::uint64_t client, Clock::time_point now) {
+    const std::int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+    Slot* slot = find(client, now_ns);
+    if (!slot) {
+        untracked_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    auto full_at = slot->full_at.load(std::memory_order_relaxed);
+    for (;;) {
+        const auto next = std::max(full_at, now_ns) + interval_ns_;
+        if (next - now_ns > tolerance_ns_) {
+            return false;
+        }
+        if (slot->full_at.compare_exchange_weak(full_at, next, std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <boost/asio/ip/address.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Limits applied to incoming connections. Must be set before the server starts
+// serving.
+struct AdmissionLimits {
+    // Connections served at once. Past this, new connections are answered 503
+    // straight from the accept loop and closed.
+    std::size_t max_connections = 1024;
+    // Connections that may be held open only to be answered 503. Once they are
+    // taken too, the server stops accepting and new clients wait in the listen
+    // backlog until a connection closes.
+    std::size_t overload_slots = 64;
+    // Requests per second allowed to one client address, 0 for no limit. A new
+    // connection costs a request; clients over the limit are answered 429.
+    double requests_per_second = 0;
+    // Requests a client may make at once after staying quiet.
+    double burst = 20;
+};
+
+// Per-client token buckets, shared by every server thread without locks.
+//
+// Each bucket is a single atomic: the time at which it will be full again
+// (the "theoretical arrival time" of GCRA, equivalent to a token bucket). A
+// request moves that time forward by one token's worth, unless that would put
+// it more than `burst` tokens ahead of now. A bucket whose time has passed is
+// full, which is also what a client never seen before gets, so its slot can be
+// handed to another client without losing anything.
+//
+// Clients live in fixed-size open-addressing tables, one per shard, and are
+// placed by a hash of their address. A client that finds every slot of its
+// probe window taken by busier clients is let through and counted in
+// untracked().
+class RateLimiter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr std::size_t kShards = 16;
+    static constexpr std::size_t kSlotsPerShard = 1024;
+    // Slots looked at for one client, starting at its hashed position.
+    static constexpr std::size_t kProbes = 8;
+
+    RateLimiter(double requests_per_second, double burst);
+
+    // Takes a token from `client`'s bucket; false if the bucket is empty.
+    bool try_acquire(std::uint64_t client, Clock::time_point now = Clock::now());
+
+    // IPv4 addresses are limited one by one, IPv6 ones by /64 prefix, the
+    // smallest block a single host is usually given.
+    static std::uint64_t client_key(const boost::asio::ip::address& address);
+
+    std::uint64_t untracked() const { return untracked_.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot {
+        std::atomic<std::uint64_t> key{0};
+        std::atomic<std::int64_t> full_at{0};
+    };
+    struct alignas(64) Shard {
+        std::array<Slot, kSlotsPerShard> slots;
+    };
+
+    Slot* find(std::uint64_t key, std::int64_t now);
+
+    const std::int64_t interval_ns_;
+    const std::int64_t tolerance_ns_;
+    std::unique_ptr<Shard[]> shards_;
+    std::atomic<std::uint64_t> untracked_{0};
+};
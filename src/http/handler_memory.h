@@ -0,0 +1,112 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Storage for the completion handlers of one session's asynchronous operations.
+// Asio and Beast allocate an operation's state through the handler's associated
+// allocator; binding handlers to this memory lets a session reuse the same few
+// blocks for every read and write instead of going to the heap each time.
+//
+// Not thread-safe: only handlers that run on the owning session's io_context
+// may be bound to it. Requests larger than a slot, or made while every slot is
+// taken, fall back to operator new and are counted.
+class HandlerMemory {
+public:
+    // A streaming response is the busiest case: the client watch, a chunk write
+    // and the socket write under it, the current deadline wait and a cancelled
+    // one not yet completed.
+    static constexpr std::size_t kSlots = 6;
+    static constexpr std::size_t kSlotSize = 512;
+
+    HandlerMemory() = default;
+    HandlerMemory(const HandlerMemory&) = delete;
+    HandlerMemory& operator=(const HandlerMemory&) = delete;
+
+    void* allocate(std::size_t size) {
+        if (size <= kSlotSize) {
+            for (std::size_t i = 0; i < kSlots; ++i) {
+                if (!used_[i]) {
+                    used_[i] = true;
+                    return &slots_[i];
+                }
+            }
+        }
+        ++fallbacks_;
+        return ::operator new(size);
+    }
+
+    void deallocate(void* pointer) {
+        for (std::size_t i = 0; i < kSlots; ++i) {
+            if (pointer == &slots_[i]) {
+                used_[i] = false;
+                return;
+            }
+        }
+        ::operator delete(pointer);
+    }
+
+    // Allocations that did not fit in a slot since construction.
+    std::size_t fallbacks() const { return fallbacks_; }
+
+private:
+    struct alignas(std::max_align_t) Slot {
+        unsigned char bytes[kSlotSize];
+    };
+    std::array<Slot, kSlots> slots_;
+    std::array<bool, kSlots> used_{};
+    std::size_t fallbacks_ = 0;
+};
+
+template <typename T>
+class HandlerAllocator {
+public:
+    using value_type = T;
+
+    explicit HandlerAllocator(HandlerMemory& memory) : memory_(&memory) {}
+    template <typename U>
+    HandlerAllocator(const HandlerAllocator<U>& other) noexcept : memory_(other.memory_) {}
+
+    T* allocate(std::size_t n) const { return static_cast<T*>(memory_->allocate(sizeof(T) * n)); }
+    void deallocate(T* pointer, std::size_t) const { memory_->deallocate(pointer); }
+
+    template <typename U>
+    bool operator==(const HandlerAllocator<U>& other) const noexcept { return memory_ == other.memory_; }
+    template <typename U>
+    bool operator!=(const HandlerAllocator<U>& other) const noexcept { return memory_ != other.memory_; }
+
+private:
+    template <typename>
+    friend class HandlerAllocator;
+
+    HandlerMemory* memory_;
+};
+
+// A completion handler whose associated allocator draws from a HandlerMemory.
+template <typename Handler>
+class MemoryBoundHandler {
+public:
+    using allocator_type = HandlerAllocator<Handler>;
+
+    MemoryBoundHandler(HandlerMemory& memory, Handler handler)
+        : memory_(memory), handler_(std::move(handler)) {}
+
+    allocator_type get_allocator() const noexcept { return allocator_type(memory_); }
+
+    template <typename... Args>
+    void operator()(Args&&... args) {
+        handler_(std::forward<Args>(args)...);
+    }
+
+private:
+    HandlerMemory& memory_;
+    Handler handler_;
+};
+
+template <typename Handler>
+MemoryBoundHandler<std::decay_t<Handler>> bind_memory(HandlerMemory& memory, Handler&& handler) {
+    return MemoryBoundHandler<std::decay_t<Handler>>(memory, std::forward<Handler>(handler));
+}
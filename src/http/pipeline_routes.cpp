@@ -0,0 +1,73 @@
+#include "pipeline_routes.h"
+#include <string>
+
+namespace http = boost::beast::http;
+
+namespace {
+
+Response to_response(const ControlResult& result) {
+    http::status status = http::status::ok;
+    switch (result.status) {
+    case ControlResult::Status::Ok:
+        status = http::status::ok;
+        break;
+    case ControlResult::Status::NoSuchElement:
+    case ControlResult::Status::NoSuchProperty:
+        status = http::status::not_found;
+        break;
+    case ControlResult::Status::Rejected:
+        status = http::status::bad_request;
+        break;
+    }
+    return Response::text(status, result.message + "\n");
+}
+
+std::string trimmed(const std::string& s) {
+    const auto first = s.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos) {
+        return {};
+    }
+    const auto last = s.find_last_not_of(" \t\r\n");
+    return s.substr(first, last - first + 1);
+}
+
+} // namespace
+
+void register_pipeline_routes(Router& router, GstPipelineWrapper& pipeline) {
+    router.add(http::verb::get, "/elements/{name}/properties/{prop}",
+        [&pipeline](const Request&, const PathParams& params, const Reply& reply) {
+            pipeline.get_property_async(std::string(params.get("name")), std::string(params.get("prop")),
+                [reply](ControlResult result) { reply(to_response(result)); });
+        });
+
+    router.add(http::verb::put, "/elements/{name}/properties/{prop}",
+        [&pipeline](const Request& req, const PathParams& params, const Reply& reply) {
+            pipeline.set_property_async(std::string(params.get("name")), std::string(params.get("prop")),
+                trimmed(req.body()),
+                [reply](ControlResult result) { reply(to_response(result)); });
+        });
+
+    router.add(http::verb::post, "/elements/{name}/force-key-unit",
+        [&pipeline](const Request&, const PathParams& params, const Reply& reply) {
+            pipeline.force_key_unit_async(std::string(params.get("name")),
+                [reply](ControlResult result) { reply(to_response(result)); });
+        });
+
+    router.add(http::verb::post, "/key-unit",
+        [&pipeline](const Request&, const PathParams&, const Reply& reply) {
+            pipeline.request_key_unit_async(false, [reply](ControlResult result) { reply(to_response(result)); });
+        });
+}
+
+void register_stream_routes(Router& router, std::shared_ptr<StreamHub> hub, GstPipelineWrapper* pipeline) {
+    router.add(http::verb::get, "/stream",
+        [hub, pipeline](const Request&, const PathParams&, const Reply& reply) {
+            // The viewer replays the ring's current GOP when its keyframe is in
+            // reach: a new keyframe is only needed when there is none, or when it
+            // is too old to start from.
+            if (pipeline) {
+                pipeline->request_key_unit_async(hub->keyframe_within(StreamHub::kDefaultMaxLag), [](ControlResult) {});
+            }
+            reply(Response::chunked(http::status::ok, hub->subscribe(StreamHub::kDefaultMaxLag), "video/mp2t"));
+        });
+}
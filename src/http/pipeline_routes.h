@@ -0,0 +1,21 @@
+#pragma once
+#include <memory>
+#include "router.h"
+#include "stream_hub.h"
+#include "../gstreamer/gst_pipeline.hpp"
+
+// REST control plane for a running pipeline:
+//   GET  /elements/{name}/properties/{prop}   current value
+//   PUT  /elements/{name}/properties/{prop}   body holds the new value, e.g. "1000"
+//   POST /elements/{name}/force-key-unit      request an IDR frame right away
+//   POST /key-unit                            request an IDR frame, coalesced and
+//                                             rate-limited (see request_key_unit_async)
+// Calls are marshalled onto the pipeline's GLib main context; the Asio thread
+// never blocks and replies once the main loop has applied the change.
+void register_pipeline_routes(Router& router, GstPipelineWrapper& pipeline);
+
+// GET /stream: the encoded stream published into `hub`, as chunked MPEG-TS.
+// With `pipeline`, each new viewer also asks it for a keyframe, unless the GOP
+// it replays from the hub's ring is recent enough, so that a crowd joining
+// together costs at most one IDR.
+void register_stream_routes(Router& router, std::shared_ptr<StreamHub> hub, GstPipelineWrapper* pipeline = nullptr);
@@ -0,0 +1,83 @@
+#include "recycling_allocator.h"
+#include <new>
+
+namespace {
+
+// Size classes of 16, 32, ... 512 bytes.
+constexpr std::size_t kMinSize = 16;
+constexpr std::size_t kClasses = 6;
+constexpr std::size_t kMaxCachedPerClass = 256;
+
+static_assert(kMinSize << (kClasses - 1) == kRecycledMaxSize, "size classes must end at kRecycledMaxSize");
+
+struct FreeBlock {
+    FreeBlock* next;
+};
+
+// Trivially destructible so that it stays usable while other thread_local
+// destructors still free blocks; the Drain below empties it once.
+struct FreeLists {
+    FreeBlock* head[kClasses];
+    std::size_t count[kClasses];
+    bool drained;
+};
+
+thread_local FreeLists free_lists{};
+
+struct Drain {
+    ~Drain() {
+        for (std::size_t c = 0; c < kClasses; ++c) {
+            while (FreeBlock* block = free_lists.head[c]) {
+                free_lists.head[c] = block->next;
+                ::operator delete(block);
+            }
+            free_lists.count[c] = 0;
+        }
+        free_lists.drained = true;
+    }
+};
+
+std::size_t size_class(std::size_t size) {
+    std::size_t c = 0;
+    while ((kMinSize << c) < size) {
+        ++c;
+    }
+    return c;
+}
+
+} // namespace
+
+void* recycled_allocate(std::size_t size) {
+    if (size > kRecycledMaxSize) {
+        return ::operator new(size);
+    }
+    const std::size_t c = size_class(size);
+    if (FreeBlock* block = free_lists.head[c]) {
+        free_lists.head[c] = block->next;
+        --free_lists.count[c];
+        return block;
+    }
+    return ::operator new(kMinSize << c);
+}
+
+void recycled_deallocate(void* pointer, std::size_t size) {
+    if (!pointer) {
+        return;
+    }
+    if (size > kRecycledMaxSize) {
+        ::operator delete(pointer);
+        return;
+    }
+    const std::size_t c = size_class(size);
+    if (free_lists.drained || free_lists.count[c] == kMaxCachedPerClass) {
+        ::operator delete(pointer);
+        return;
+    }
+    // Blocks only enter a list here: make sure this thread frees its list on exit.
+    thread_local Drain drain;
+    (void)drain;
+    auto* block = static_cast<FreeBlock*>(pointer);
+    block->next = free_lists.head[c];
+    free_lists.head[c] = block;
+    ++free_lists.count[c];
+}
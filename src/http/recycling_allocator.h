@@ -0,0 +1,122 @@
+#pragma once
+#include <cstddef>
+#include <new>
+
+// Small blocks recycled through per-thread free lists, for the short-lived
+// allocations every request makes (header fields of the parsed request and of
+// the response). A block freed on another thread than the one that allocated
+// it simply joins that thread's list. Sizes above kRecycledMaxSize, and blocks
+// beyond what a thread caches, go straight to operator new/delete.
+constexpr std::size_t kRecycledMaxSize = 512;
+
+void* recycled_allocate(std::size_t size);
+void recycled_deallocate(void* pointer, std::size_t size);
+
+template <typename T>
+class RecyclingAllocator {
+public:
+    using value_type = T;
+
+    RecyclingAllocator() noexcept = default;
+    template <typename U>
+    RecyclingAllocator(const RecyclingAllocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n) { return static_cast<T*>(recycled_allocate(n * sizeof(T))); }
+    void deallocate(T* pointer, std::size_t n) noexcept { recycled_deallocate(pointer, n * sizeof(T)); }
+
+    template <typename U>
+    bool operator==(const RecyclingAllocator<U>&) const noexcept { return true; }
+    template <typename U>
+    bool operator!=(const RecyclingAllocator<U>&) const noexcept { return false; }
+};
+
+// Per-thread free list of blocks of one size, for objects too large for the
+// size classes above that are created and destroyed at a steady rate (one
+// session per connection). Keeps at most kMaxCached blocks per thread and frees
+// them when the thread exits.
+template <std::size_t Size, std::size_t Align>
+class BlockPool {
+public:
+    static constexpr std::size_t kMaxCached = 64;
+
+    static void* allocate() {
+        if (Block* block = list_.head) {
+            list_.head = block->next;
+            --list_.count;
+            return block;
+        }
+        return ::operator new(Size, std::align_val_t(Align));
+    }
+
+    static void deallocate(void* pointer) {
+        if (list_.drained || list_.count == kMaxCached) {
+            ::operator delete(pointer, std::align_val_t(Align));
+            return;
+        }
+        thread_local Drain drain;
+        (void)drain;
+        auto* block = static_cast<Block*>(pointer);
+        block->next = list_.head;
+        list_.head = block;
+        ++list_.count;
+    }
+
+private:
+    static_assert(Size >= sizeof(void*), "blocks must hold a free list link");
+
+    struct Block {
+        Block* next;
+    };
+    // Trivially destructible, like the size-class lists.
+    struct List {
+        Block* head;
+        std::size_t count;
+        bool drained;
+    };
+    struct Drain {
+        ~Drain() {
+            while (Block* block = list_.head) {
+                list_.head = block->next;
+                ::operator delete(block, std::align_val_t(Align));
+            }
+            list_.count = 0;
+            list_.drained = true;
+        }
+    };
+
+    static inline thread_local List list_{};
+};
+
+// Allocator for std::allocate_shared: the object and its control block come
+// from a BlockPool sized for them. Only single-object allocations are pooled.
+template <typename T>
+class PoolAllocator {
+public:
+    using value_type = T;
+
+    PoolAllocator() noexcept = default;
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        if (n != 1) {
+            return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(alignof(T))));
+        }
+        return static_cast<T*>(Pool::allocate());
+    }
+    void deallocate(T* pointer, std::size_t n) noexcept {
+        if (n != 1) {
+            ::operator delete(pointer, std::align_val_t(alignof(T)));
+            return;
+        }
+        Pool::deallocate(pointer);
+    }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U>&) const noexcept { return true; }
+    template <typename U>
+    bool operator!=(const PoolAllocator<U>&) const noexcept { return false; }
+
+private:
+    using Pool = BlockPool<sizeof(T), alignof(T)>;
+};
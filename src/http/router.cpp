@@ -0,0 +1,305 @@
+#include "router.h"
+#include <stdexcept>
+#include <type_traits>
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+
+namespace {
+
+beast::string_view to_beast(std::string_view s) {
+    return beast::string_view(s.data(), s.size());
+}
+
+} // namespace
+
+Response Response::text(http::status status, std::string body, std::string_view content_type) {
+    StringMessage m{status, 11};
+    m.set(http::field::content_type, to_beast(content_type));
+    m.body() = std::move(body);
+    return Response{std::move(m), nullptr, nullptr};
+}
+
+Response Response::span(http::status status, std::string_view data,
+                        std::shared_ptr<const void> owner, std::string_view content_type) {
+    SpanMessage m{status, 11};
+    m.set(http::field::content_type, to_beast(content_type));
+    m.body() = http::span_body<const char>::value_type(data.data(), data.size());
+    return Response{std::move(m), std::move(owner), nullptr};
+}
+
+Response Response::buffer(http::status status, const void* data, std::size_t size,
+                          std::shared_ptr<const void> owner, std::string_view content_type) {
+    BufferMessage m{status, 11};
+    m.set(http::field::content_type, to_beast(content_type));
+    m.body().data = const_cast<void*>(data);
+    m.body().size = size;
+    m.body().more = false;
+    m.content_length(size);
+    return Response{std::move(m), std::move(owner), nullptr};
+}
+
+Response Response::chunked(http::status status, std::shared_ptr<ChunkStream> stream,
+                           std::string_view content_type) {
+    StringMessage m{status, 11};
+    m.set(http::field::content_type, to_beast(content_type));
+    m.set(http::field::cache_control, "no-cache");
+    return Response{std::move(m), nullptr, std::move(stream)};
+}
+
+Response Response::file(http::status status, const char* path,
+                        std::string_view content_type, beast::error_code& ec) {
+    http::file_body::value_type body;
+    body.open(path, beast::file_mode::scan, ec);
+    if (ec) {
+        return text(http::status::not_found, "Not Found\n");
+    }
+    FileMessage m{status, 11};
+    m.set(http::field::content_type, to_beast(content_type));
+    m.body() = std::move(body);
+    return Response{std::move(m), nullptr, nullptr};
+}
+
+http::status Response::result() const {
+    return std::visit([](const auto& m) { return m.result(); }, message);
+}
+
+void Response::finalize(unsigned version, bool keep_alive) {
+    std::visit([&](auto& m) {
+        m.version(version);
+        m.set(http::field::server, "Beast");
+        if (stream) {
+            // HTTP/1.0 has no chunked encoding: the end of the body is the end of
+            // the connection.
+            m.keep_alive(keep_alive && version >= 11);
+            m.chunked(version >= 11);
+            return;
+        }
+        m.keep_alive(keep_alive);
+        // A buffer body has no size of its own: its Content-Length was set by buffer().
+        if constexpr (!std::is_same_v<std::decay_t<decltype(m)>, BufferMessage>) {
+            m.prepare_payload();
+        }
+    }, message);
+}
+
+std::string_view PathParams::get(std::string_view name) const {
+    for (std::size_t i = 0; i < size_; ++i) {
+        if (items_[i].first == name) {
+            return items_[i].second;
+        }
+    }
+    return {};
+}
+
+bool PathParams::push(std::string_view name, std::string_view value) {
+    if (size_ == kMaxParams) {
+        return false;
+    }
+    items_[size_++] = {name, value};
+    return true;
+}
+
+void RouteMetrics::record(http::status status, double seconds) const {
+    if (!latency) {
+        return;
+    }
+    latency->observe(seconds);
+    const auto klass = static_cast<unsigned>(status) / 100;
+    if (klass >= 1 && klass <= responses.size()) {
+        responses[klass - 1]->inc();
+    }
+}
+
+struct Router::Route {
+    http::verb method;
+    Handler handler;
+    RouteMetrics metrics;
+};
+
+struct Router::Node {
+    std::string segment;
+    std::vector<std::unique_ptr<Node>> literals;
+    std::string param_name;
+    std::unique_ptr<Node> param;
+    std::unique_ptr<Node> wildcard;
+    std::vector<Route> handlers;
+};
+
+Router::Router() : root_(std::make_unique<Node>()) {}
+
+Router::Router(Router&&) noexcept = default;
+
+Router& Router::operator=(Router&&) noexcept = default;
+
+Router::~Router() = default;
+
+RouteMetrics Router::make_metrics(std::string_view method, std::string_view route) const {
+    RouteMetrics metrics;
+    if (!metrics_) {
+        return metrics;
+    }
+    // No method label at all rather than an empty one.
+    const auto labels = method.empty() ? MetricsRegistry::labels({{"route", route}})
+                                       : MetricsRegistry::labels({{"method", method}, {"route", route}});
+    metrics.latency = &metrics_->histogram("http_request_duration_seconds",
+                                           "Time from a request being read to its reply.", labels);
+    static constexpr const char* kClasses[] = {"1xx", "2xx", "3xx", "4xx", "5xx"};
+    for (std::size_t i = 0; i < metrics.responses.size(); ++i) {
+        metrics.responses[i] = &metrics_->counter("http_requests_total", "Requests answered, by route and status class.",
+            method.empty() ? MetricsRegistry::labels({{"route", route}, {"code", kClasses[i]}})
+                           : MetricsRegistry::labels({{"method", method}, {"route", route}, {"code", kClasses[i]}}));
+    }
+    return metrics;
+}
+
+void Router::set_metrics(MetricsRegistry& registry) {
+    metrics_ = &registry;
+    unmatched_ = make_metrics("", "unmatched");
+}
+
+void Router::add(http::verb method, std::string_view pattern, Handler handler) {
+    if (pattern.empty() || pattern.front() != '/') {
+        throw std::invalid_argument("route pattern must start with '/': " + std::string(pattern));
+    }
+    const std::string_view full_pattern = pattern;
+    pattern.remove_prefix(1);
+
+    Node* node = root_.get();
+    while (!pattern.empty()) {
+        const auto slash = pattern.find('/');
+        const auto segment = pattern.substr(0, slash);
+        pattern = slash == std::string_view::npos ? std::string_view{} : pattern.substr(slash + 1);
+
+        if (segment == "*") {
+            if (slash != std::string_view::npos) {
+                throw std::invalid_argument("'*' must be the last segment of a route");
+            }
+            if (!node->wildcard) {
+                node->wildcard = std::make_unique<Node>();
+            }
+            node = node->wildcard.get();
+        } else if (segment.size() > 2 && segment.front() == '{' && segment.back() == '}') {
+            const auto name = segment.substr(1, segment.size() - 2);
+            if (!node->param) {
+                node->param = std::make_unique<Node>();
+                node->param_name = std::string(name);
+            } else if (node->param_name != name) {
+                throw std::invalid_argument("conflicting parameter names at {" + std::string(name) + "}");
+            }
+            node = node->param.get();
+        } else {
+            Node* next = nullptr;
+            for (auto& child : node->literals) {
+                if (child->segment == segment) {
+                    next = child.get();
+                    break;
+                }
+            }
+            if (!next) {
+                node->literals.push_back(std::make_unique<Node>());
+                next = node->literals.back().get();
+                next->segment = std::string(segment);
+            }
+            node = next;
+        }
+    }
+
+    for (auto& entry : node->handlers) {
+        if (entry.method == method) {
+            entry.handler = std::move(handler);
+            return;
+        }
+    }
+    const auto verb = http::to_string(method);
+    node->handlers.push_back({method, std::move(handler), make_metrics({verb.data(), verb.size()}, full_pattern)});
+}
+
+const Router::Node* Router::find(const Node& node, std::string_view path, PathParams& params) const {
+    // `path` holds what is left after the slash that led to `node`; a null data()
+    // pointer means the whole target has been consumed.
+    if (path.data() == nullptr) {
+        return node.handlers.empty() ? nullptr : &node;
+    }
+
+    const auto slash = path.find('/');
+    const auto segment = path.substr(0, slash);
+    const auto rest = slash == std::string_view::npos ? std::string_view{} : path.substr(slash + 1);
+
+    for (const auto& child : node.literals) {
+        if (child->segment == segment) {
+            if (const Node* found = find(*child, rest, params)) {
+                return found;
+            }
+            break;
+        }
+    }
+
+    if (node.param && !segment.empty()) {
+        const auto mark = params.size_;
+        if (params.push(node.param_name, segment)) {
+            if (const Node* found = find(*node.param, rest, params)) {
+                return found;
+            }
+        }
+        params.size_ = mark;
+    }
+
+    if (node.wildcard && params.push("*", path)) {
+        return node.wildcard.get();
+    }
+    return nullptr;
+}
+
+Router::Match Router::match(http::verb method, std::string_view target,
+                            const Handler*& handler, PathParams& params) const {
+    const Route* route = nullptr;
+    const auto result = match_route(method, target, route, params);
+    if (result == Match::Found) {
+        handler = &route->handler;
+    }
+    return result;
+}
+
+Router::Match Router::match_route(http::verb method, std::string_view target,
+                                  const Route*& route, PathParams& params) const {
+    auto path = target.substr(0, target.find('?'));
+    if (path.empty() || path.front() != '/') {
+        return Match::NotFound;
+    }
+    path.remove_prefix(1);
+    // "/" leaves nothing to match: hand the root a null view.
+    if (path.empty()) {
+        path = std::string_view{};
+    }
+
+    const Node* node = find(*root_, path, params);
+    if (!node) {
+        return Match::NotFound;
+    }
+    for (const auto& entry : node->handlers) {
+        if (entry.method == method) {
+            route = &entry;
+            return Match::Found;
+        }
+    }
+    return Match::MethodNotAllowed;
+}
+
+const RouteMetrics* Router::dispatch(const Request& req, const Reply& reply) const {
+    PathParams params;
+    const Route* route = nullptr;
+    const auto target = req.target();
+    switch (match_route(req.method(), std::string_view(target.data(), target.size()), route, params)) {
+    case Match::Found:
+        route->handler(req, params, reply);
+        return metrics_ ? &route->metrics : nullptr;
+    case Match::NotFound:
+        reply(Response::text(http::status::not_found, "Not Found\n"));
+        break;
+    case Match::MethodNotAllowed:
+        reply(Response::text(http::status::method_not_allowed, "Method Not Allowed\n"));
+        break;
+    }
+    return metrics_ ? &unmatched_ : nullptr;
+}
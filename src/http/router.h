@@ -0,0 +1,162 @@
+#pragma once
+#include <array>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+#include <boost/asio/buffer.hpp>
+#include <boost/beast/core/error.hpp>
+#include <boost/beast/http.hpp>
+#include "../metrics/metrics.h"
+#include "recycling_allocator.h"
+
+// Header fields of the requests the server parses and the responses it sends.
+// Each field is a small allocation of its own; these come from per-thread free
+// lists rather than the heap.
+using Fields = boost::beast::http::basic_fields<RecyclingAllocator<char>>;
+
+using Request = boost::beast::http::request<boost::beast::http::string_body, Fields>;
+
+// An open-ended body produced outside the session (e.g. live media), written as
+// HTTP chunks for as long as the client stays connected.
+class ChunkStream {
+public:
+    virtual ~ChunkStream() = default;
+    // Starts delivery. `wake` may be called from any thread whenever next() has
+    // data again after having returned an empty buffer.
+    virtual void start(std::function<void()> wake) = 0;
+    // Next chunk to write, or an empty buffer when nothing is queued. The memory
+    // stays valid until release().
+    virtual boost::asio::const_buffer next() = 0;
+    virtual void release() = 0;
+    // Called once when the connection ends.
+    virtual void stop() = 0;
+};
+
+// A response whose body type is picked by the handler, so that large payloads can be
+// sent from memory the handler already owns (span/buffer) or straight from disk (file)
+// instead of being copied into a std::string.
+struct Response {
+    using StringMessage = boost::beast::http::response<boost::beast::http::string_body, Fields>;
+    using SpanMessage = boost::beast::http::response<boost::beast::http::span_body<const char>, Fields>;
+    using BufferMessage = boost::beast::http::response<boost::beast::http::buffer_body, Fields>;
+    using FileMessage = boost::beast::http::response<boost::beast::http::file_body, Fields>;
+
+    std::variant<StringMessage, SpanMessage, BufferMessage, FileMessage> message;
+    // Keeps the memory behind a span or buffer body alive until it has been written.
+    std::shared_ptr<const void> owner;
+    // When set, only the header of `message` is sent and the body comes from here.
+    std::shared_ptr<ChunkStream> stream;
+
+    static Response text(boost::beast::http::status status, std::string body,
+                         std::string_view content_type = "text/plain");
+    static Response span(boost::beast::http::status status, std::string_view data,
+                         std::shared_ptr<const void> owner,
+                         std::string_view content_type = "application/octet-stream");
+    static Response buffer(boost::beast::http::status status, const void* data, std::size_t size,
+                           std::shared_ptr<const void> owner,
+                           std::string_view content_type = "application/octet-stream");
+    static Response chunked(boost::beast::http::status status, std::shared_ptr<ChunkStream> stream,
+                            std::string_view content_type);
+    static Response file(boost::beast::http::status status, const char* path,
+                         std::string_view content_type, boost::beast::error_code& ec);
+
+    boost::beast::http::status result() const;
+    // Sets the fields that depend on the request being answered.
+    void finalize(unsigned version, bool keep_alive);
+};
+
+// Receives the response of a routed request; implemented by Session.
+class ResponseSink {
+public:
+    virtual ~ResponseSink() = default;
+    virtual void send(Response&& response) = 0;
+};
+
+// Handed to every handler. A handler must call it exactly once, either before
+// returning or later from any thread; the request stays valid until then.
+class Reply {
+public:
+    explicit Reply(std::shared_ptr<ResponseSink> sink) : sink_(std::move(sink)) {}
+
+    void operator()(Response&& response) const { sink_->send(std::move(response)); }
+
+private:
+    std::shared_ptr<ResponseSink> sink_;
+};
+
+// Path parameters captured while matching. Names and values are views into the
+// route table and into the request target; nothing is copied.
+class PathParams {
+public:
+    static constexpr std::size_t kMaxParams = 8;
+
+    std::string_view get(std::string_view name) const;
+    std::size_t size() const { return size_; }
+
+private:
+    friend class Router;
+
+    bool push(std::string_view name, std::string_view value);
+
+    std::array<std::pair<std::string_view, std::string_view>, kMaxParams> items_;
+    std::size_t size_ = 0;
+};
+
+using Handler = std::function<void(const Request&, const PathParams&, const Reply&)>;
+
+// Request metrics of one route, recorded by the session once the reply is out.
+struct RouteMetrics {
+    // Seconds from the full request being read to the reply (or, for a chunked
+    // stream, its header) being written.
+    Histogram* latency = nullptr;
+    // Responses per status class, 1xx to 5xx.
+    std::array<Counter*, 5> responses{};
+
+    void record(boost::beast::http::status status, double seconds) const;
+};
+
+// Segment trie built at startup. Patterns are made of literal segments, `{name}`
+// segments that match any single segment, and an optional trailing `*` that
+// matches the rest of the path (exposed as the "*" parameter). Literal segments
+// win over parameters. Routes must all be added before the server starts serving.
+class Router {
+public:
+    enum class Match { Found, NotFound, MethodNotAllowed };
+
+    Router();
+    Router(Router&&) noexcept;
+    Router& operator=(Router&&) noexcept;
+    ~Router();
+
+    // Routes added afterwards are counted and timed in `registry`, labelled with
+    // their method and pattern; requests matching no route under "unmatched",
+    // without a method label.
+    void set_metrics(MetricsRegistry& registry);
+
+    void add(boost::beast::http::verb method, std::string_view pattern, Handler handler);
+
+    // Looks up the handler for `method` and `target` (query string ignored).
+    Match match(boost::beast::http::verb method, std::string_view target,
+                const Handler*& handler, PathParams& params) const;
+
+    // Routes `req`, answering 404 and 405 itself. Returns the metrics to record
+    // the reply into, or nullptr when the router has none.
+    const RouteMetrics* dispatch(const Request& req, const Reply& reply) const;
+
+private:
+    struct Node;
+    struct Route;
+
+    const Node* find(const Node& node, std::string_view path, PathParams& params) const;
+    Match match_route(boost::beast::http::verb method, std::string_view target,
+                      const Route*& route, PathParams& params) const;
+    RouteMetrics make_metrics(std::string_view method, std::string_view route) const;
+
+    std::unique_ptr<Node> root_;
+    MetricsRegistry* metrics_ = nullptr;
+    RouteMetrics unmatched_;
+};
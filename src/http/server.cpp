@@ -1,102 +1,855 @@
 #include "server.h"
+#include "handler_memory.h"
+#include "pipeline_routes.h"
+#include "recycling_allocator.h"
 #include <boost/beast.hpp>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
 #include <memory>
-#include <iostream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../logging/logger.h"
 
 namespace beast = boost::beast;
-namespace http = beast::http;   
+namespace http = beast::http;
 
-class Session : public std::enable_shared_from_this<Session> {
+namespace {
+
+// Sessions run on the io_context that accepted them. Naming its executor type,
+// rather than going through any_io_executor, lets completions run inline
+// instead of being wrapped in a heap-allocated function object.
+using Executor = boost::asio::io_context::executor_type;
+using SessionSocket = boost::asio::basic_stream_socket<tcp, Executor>;
+using SessionTimer = boost::asio::basic_waitable_timer<std::chrono::steady_clock,
+    boost::asio::wait_traits<std::chrono::steady_clock>, Executor>;
+
+} // namespace
+
+class Session;
+
+// Every live session, so that stop() can reach them. A session may be released
+// on any thread (the last Reply can go on the GLib main loop); it unlinks itself
+// first thing in its destructor, under the mutex, so whoever walks the list
+// under the mutex never sees a half-destroyed one.
+//
+// Also counts the connections held open, sessions and rejections alike, for
+// the connection cap.
+struct SessionRegistry {
+    std::mutex mutex;
+    std::condition_variable emptied;
+    Session* head = nullptr;
+    std::size_t size = 0;
+    // Counted when accepted, until the session or rejection is gone.
+    std::atomic<std::size_t> connections{0};
+    // Called, under the mutex, whenever a connection closes.
+    std::function<void()> on_closed;
+    // Charged once per request after the first, which the accept paid for.
+    RateLimiter* limiter = nullptr;
+    Counter* rate_limited = nullptr;
+
+    void add(Session& session);
+    // Also releases the session's connection.
+    void remove(Session& session);
+    // Releases a connection that was not a session.
+    void release();
+    // Sessions running on `ioc`; call on its thread.
+    std::vector<std::shared_ptr<Session>> on(boost::asio::io_context& ioc);
+    // False if sessions are still open at the deadline.
+    bool wait_empty(std::chrono::steady_clock::time_point deadline);
+};
+
+class Session : public ResponseSink, public std::enable_shared_from_this<Session> {
 public:
-    Session(tcp::socket socket) : socket_(std::move(socket)) {
-        std::cout << "[Session] New session started\n";
+    Session(SessionSocket socket, const Router& router, Gauge& open_sessions, SessionRegistry& sessions,
+            std::uint64_t client)
+        : socket_(std::move(socket)), timer_(socket_.get_executor()), router_(router),
+          open_sessions_(open_sessions), sessions_(sessions), client_(client) {
+        sessions_.add(*this);
+        open_sessions_.inc();
+        SLOG_DEBUG("Session", "New session started");
+    }
+
+    ~Session() override {
+        sessions_.remove(*this);
+        if (res_.stream) {
+            res_.stream->stop();
+        }
+        open_sessions_.dec();
     }
 
     void start() {
-        std::cout << "[Session] Starting session\n";
+        SLOG_DEBUG("Session", "Starting session");
         do_read();
     }
 
+    // Handlers may reply from another thread (e.g. the GLib main loop), so the
+    // write is always brought back onto the session's io_context.
+    void send(Response&& response) override {
+        boost::asio::dispatch(socket_.get_executor(),
+            [self = shared_from_this(), response = std::move(response)]() mutable {
+                self->write(std::move(response));
+            });
+    }
+
+    boost::asio::io_context& context() { return socket_.get_executor().context(); }
+
+    // The server is stopping; call on the session's thread. An idle connection
+    // or a stream ends now. A request being read or answered still gets its
+    // reply, after which the connection closes.
+    void drain() {
+        draining_ = true;
+        if (idle_ || res_.stream) {
+            abort();
+        }
+    }
+
+    // Ends the connection whatever it is doing; call on the session's thread.
+    void abort() {
+        draining_ = true;
+        pending_reply_.reset();
+        if (res_.stream) {
+            end_stream(boost::asio::error::operation_aborted);
+            return;
+        }
+        beast::error_code ec;
+        socket_.close(ec);
+    }
+
 private:
+    friend struct SessionRegistry;
+
+    // Time a keep-alive connection may sit idle between two requests.
+    static constexpr std::chrono::seconds kIdleTimeout{30};
+    // Time allowed to receive a full header once its first byte has arrived.
+    static constexpr std::chrono::seconds kHeaderTimeout{5};
+    // Time allowed to receive a request body, or to write a response.
+    static constexpr std::chrono::seconds kTransferTimeout{30};
+    static constexpr std::size_t kReadChunk = 4096;
+    // Holds a full header plus whatever was pipelined behind it; bodies are
+    // moved out of it into the request as they arrive.
+    static constexpr std::size_t kBufferSize = 16 * 1024;
+    static constexpr std::uint32_t kHeaderLimit = 8 * 1024;
+    static constexpr std::uint64_t kBodyLimit = 1024 * 1024;
+
+    // Deadline of the operation about to start: when it passes, the socket is
+    // closed, which aborts that operation. This stands in for beast::tcp_stream's
+    // timeouts, whose internal timer waits cannot be given an allocator.
+    void expires_after(std::chrono::seconds timeout) {
+        timer_.expires_after(timeout);
+        timer_.async_wait(bind_memory(handler_memory_,
+            [self = shared_from_this()](beast::error_code ec) {
+                // A wait that completed just as the deadline moved is stale.
+                if (ec || self->timer_.expiry() > std::chrono::steady_clock::now()) {
+                    return;
+                }
+                self->timed_out_ = true;
+                self->socket_.close(ec);
+            }));
+    }
+
+    // Nothing is pending on the socket any more, or what is pending may wait
+    // forever (an idle stream). Also lets the session go once its last
+    // operation is done.
+    void expires_never() {
+        timer_.expires_at(SessionTimer::time_point::max());
+    }
+
     void do_read() {
+        // Pipelined requests are already sitting in buffer_: parse them straight away.
+        if (buffer_.size() > 0) {
+            read_header();
+            return;
+        }
+
         auto self(shared_from_this());
-        std::cout << "[Session] Waiting to read request\n";
-        http::async_read(socket_, buffer_, request_,
+        SLOG_DEBUG("Session", "Waiting to read request");
+        expires_after(kIdleTimeout);
+        idle_ = true;
+        socket_.async_read_some(buffer_.prepare(kReadChunk), bind_memory(handler_memory_,
             [this, self](beast::error_code ec, std::size_t bytes_transferred) {
-                if (!ec) {
-                    std::cout << "[Session] Request received (" << bytes_transferred << " bytes)\n";
+                idle_ = false;
+                if (ec) {
+                    close("Read", ec);
+                    return;
+                }
+                buffer_.commit(bytes_transferred);
+                read_header();
+            }));
+    }
+
+    void read_header() {
+        // The parser lives inside the session, so starting a new request does not allocate.
+        parser_.emplace();
+        parser_->header_limit(kHeaderLimit);
+        parser_->body_limit(kBodyLimit);
+
+        auto self(shared_from_this());
+        expires_after(kHeaderTimeout);
+        http::async_read_header(socket_, buffer_, *parser_, bind_memory(handler_memory_,
+            [this, self](beast::error_code ec, std::size_t) {
+                if (ec) {
+                    close("Read", ec);
+                    return;
+                }
+                if (parser_->is_done()) {
                     handleRequest();
                 } else {
-                    std::cerr << "[Session] Read error: " << ec.message() << "\n";
+                    read_body();
                 }
-            });
+            }));
+    }
+
+    void read_body() {
+        auto self(shared_from_this());
+        expires_after(kTransferTimeout);
+        http::async_read(socket_, buffer_, *parser_, bind_memory(handler_memory_,
+            [this, self](beast::error_code ec, std::size_t bytes_transferred) {
+                if (ec) {
+                    close("Read", ec);
+                    return;
+                }
+                SLOG_DEBUG("Session", "Request received", "bytes", bytes_transferred);
+                handleRequest();
+            }));
     }
 
     void handleRequest() {
-        std::cout << "[Session] Handling HTTP request\n";
-        // Create a simple "Hello, World!" response
-        http::response<http::string_body> res{
-            http::status::ok, request_.version()};
-        res.set(http::field::server, "Beast");
-        res.set(http::field::content_type, "text/plain");
-        res.body() = "Hello, World!";
-        res.prepare_payload();
+        SLOG_DEBUG("Session", "Handling HTTP request");
+        // The handler may take its time: no deadline until the reply is written.
+        expires_never();
+        const auto& req = parser_->get();
+        version_ = req.version();
+        keep_alive_ = req.keep_alive();
+        request_start_ = std::chrono::steady_clock::now();
+        if (requests_++ > 0 && sessions_.limiter && !sessions_.limiter->try_acquire(client_)) {
+            sessions_.rate_limited->inc();
+            SLOG_DEBUG("Session", "Request rate limited");
+            route_metrics_ = nullptr;
+            auto response = Response::text(http::status::too_many_requests, "Too many requests\n");
+            std::get<Response::StringMessage>(response.message).set(http::field::retry_after, "1");
+            write(std::move(response));
+            return;
+        }
+        // Nothing is pending on the socket until the handler replies, possibly
+        // from another thread: keep the io_context from running out of work.
+        pending_reply_.emplace(socket_.get_executor());
+        // The request stays in parser_ until the reply has been written. Writes
+        // always complete asynchronously, so route_metrics_ is set by then.
+        route_metrics_ = router_.dispatch(req, Reply(shared_from_this()));
+    }
 
-        auto self(shared_from_this());
-        http::async_write(socket_, res,
-            [this, self](beast::error_code ec, std::size_t) {
+    void record_reply() {
+        if (route_metrics_) {
+            route_metrics_->record(res_.result(),
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - request_start_).count());
+            route_metrics_ = nullptr;
+        }
+    }
+
+    void write(Response&& response) {
+        pending_reply_.reset();
+        res_ = std::move(response);
+        // Once the server is stopping, no connection outlives its current reply.
+        keep_alive_ = keep_alive_ && !draining_;
+        res_.finalize(version_, keep_alive_);
+
+        expires_after(kTransferTimeout);
+        if (res_.stream) {
+            write_stream_header();
+            return;
+        }
+        std::visit([this](auto& message) {
+            http::async_write(socket_, message, bind_memory(handler_memory_,
+                [self = shared_from_this()](beast::error_code ec, std::size_t) {
+                    self->on_write(ec);
+                }));
+        }, res_.message);
+    }
+
+    void on_write(beast::error_code ec) {
+        record_reply();
+        // Let go of span/buffer payloads as soon as they are on the wire.
+        res_.owner.reset();
+        if (ec) {
+            close("Write", ec);
+            return;
+        }
+        if (!keep_alive_) {
+            // Gracefully close the socket after response
+            expires_never();
+            socket_.shutdown(tcp::socket::shutdown_send, ec);
+            return;
+        }
+        // Requests are answered strictly one after the other, so pipelined
+        // responses go out in the order their requests came in.
+        do_read();
+    }
+
+    // Streaming responses: the header goes out once, then every chunk the stream
+    // produces until either side goes away. The connection is not reused.
+    void write_stream_header() {
+        header_serializer_.emplace(std::get<Response::StringMessage>(res_.message));
+        http::async_write_header(socket_, *header_serializer_, bind_memory(handler_memory_,
+            [self = shared_from_this()](beast::error_code ec, std::size_t) {
+                self->record_reply();
                 if (ec) {
-                    std::cerr << "[Session] Write error: " << ec.message() << "\n";
+                    self->end_stream(ec);
+                    return;
                 }
-                // Gracefully close the socket after response
-                socket_.shutdown(tcp::socket::shutdown_send, ec);
-            });
+                self->expires_never();
+                self->watch_client();
+                self->res_.stream->start([weak = std::weak_ptr<Session>(self)] {
+                    if (auto session = weak.lock()) {
+                        boost::asio::post(session->socket_.get_executor(),
+                            [session] { session->pump_stream(); });
+                    }
+                });
+                self->pump_stream();
+            }));
+    }
+
+    // The client has nothing more to send: any completion here means it hung up.
+    // This pending read also keeps the session alive while the stream is idle.
+    void watch_client() {
+        socket_.async_wait(tcp::socket::wait_read, bind_memory(handler_memory_,
+            [self = shared_from_this()](beast::error_code ec) {
+                self->end_stream(ec ? ec : beast::error_code(http::error::end_of_stream));
+            }));
     }
 
-    tcp::socket socket_;
-    beast::flat_buffer buffer_;
-    http::request<http::string_body> request_;
+    void pump_stream() {
+        if (!res_.stream || stream_writing_) {
+            return;
+        }
+        const auto chunk = res_.stream->next();
+        if (chunk.size() == 0) {
+            return;
+        }
+        stream_writing_ = true;
+        expires_after(kTransferTimeout);
+        auto on_chunk = bind_memory(handler_memory_, [self = shared_from_this()](beast::error_code ec, std::size_t) {
+            self->stream_writing_ = false;
+            if (!self->res_.stream) {
+                return;
+            }
+            self->res_.stream->release();
+            if (ec) {
+                self->end_stream(ec);
+                return;
+            }
+            // An idle stream is not a stalled one.
+            self->expires_never();
+            self->pump_stream();
+        });
+        if (std::get<Response::StringMessage>(res_.message).chunked()) {
+            boost::asio::async_write(socket_, http::make_chunk(chunk), std::move(on_chunk));
+        } else {
+            boost::asio::async_write(socket_, chunk, std::move(on_chunk));
+        }
+    }
+
+    void end_stream(beast::error_code ec) {
+        if (!res_.stream) {
+            return;
+        }
+        auto stream = std::move(res_.stream);
+        stream->stop();
+        close("Stream", ec);
+        // Closing cancels any chunk write in flight, so its buffer can be let go.
+        socket_.close(ec);
+        stream->release();
+    }
+
+    void close(const char* what, beast::error_code ec) {
+        expires_never();
+        if (timed_out_) {
+            // The operation was aborted by its deadline.
+            ec = beast::error::timeout;
+        }
+        if (draining_ && ec == boost::asio::error::operation_aborted) {
+            SLOG_DEBUG("Session", "Connection closed", "reason", "server stopping");
+        } else if (ec == http::error::end_of_stream || ec == boost::asio::error::eof ||
+                   ec == beast::error::timeout) {
+            // A client closing its end between two requests is the normal way
+            // for a keep-alive connection to end.
+            SLOG_DEBUG("Session", "Connection closed", "reason", ec.message());
+        } else {
+            SLOG_WARN("Session", "Connection error", "during", what, "error", ec.message());
+        }
+        socket_.shutdown(tcp::socket::shutdown_both, ec);
+    }
+
+    // Reused by every asynchronous operation of the session. Declared before the
+    // socket and the timer so that it outlives any operation they still hold.
+    HandlerMemory handler_memory_;
+    SessionSocket socket_;
+    SessionTimer timer_;
+    bool timed_out_ = false;
+    const Router& router_;
+    Gauge& open_sessions_;
+    SessionRegistry& sessions_;
+    const std::uint64_t client_;
+    std::size_t requests_ = 0;
+    // Links in sessions_, guarded by its mutex.
+    Session* prev_ = nullptr;
+    Session* next_ = nullptr;
+    // Waiting for the next request, with nothing of it read yet.
+    bool idle_ = false;
+    bool draining_ = false;
+    std::optional<boost::asio::executor_work_guard<Executor>> pending_reply_;
+    const RouteMetrics* route_metrics_ = nullptr;
+    std::chrono::steady_clock::time_point request_start_;
+    beast::flat_static_buffer<kBufferSize> buffer_;
+    std::optional<http::request_parser<http::string_body, RecyclingAllocator<char>>> parser_;
+    Response res_;
+    std::optional<http::response_serializer<http::string_body, Fields>> header_serializer_;
+    bool stream_writing_ = false;
+    unsigned version_ = 11;
+    bool keep_alive_ = false;
 };
 
+void SessionRegistry::add(Session& session) {
+    std::lock_guard<std::mutex> lock(mutex);
+    session.next_ = head;
+    if (head) {
+        head->prev_ = &session;
+    }
+    head = &session;
+    ++size;
+}
 
-HttpServer::HttpServer(boost::asio::io_context& ioc, tcp::endpoint endpoint, const char* pipeline_description) 
-    : acceptor_(ioc, endpoint) {
-    std::cout << "[HttpServer] Server created, listening on " << endpoint << "\n";
+void SessionRegistry::remove(Session& session) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (session.prev_) {
+        session.prev_->next_ = session.next_;
+    } else {
+        head = session.next_;
+    }
+    if (session.next_) {
+        session.next_->prev_ = session.prev_;
+    }
+    if (--size == 0) {
+        emptied.notify_all();
+    }
+    connections.fetch_sub(1);
+    if (on_closed) {
+        on_closed();
+    }
+}
 
-    std::cout << "[HttpServer] Initializing GStreamer pipeline\n";
-    gst_pipeline_ = std::make_unique<GstPipelineWrapper>(pipeline_description);
-    std::cout << "[HttpServer] Starting GStreamer pipeline\n";
-    gst_pipeline_->start();
+void SessionRegistry::release() {
+    std::lock_guard<std::mutex> lock(mutex);
+    connections.fetch_sub(1);
+    if (on_closed) {
+        on_closed();
+    }
+}
+
+std::vector<std::shared_ptr<Session>> SessionRegistry::on(boost::asio::io_context& ioc) {
+    std::vector<std::shared_ptr<Session>> found;
+    std::lock_guard<std::mutex> lock(mutex);
+    for (Session* session = head; session; session = session->next_) {
+        if (&session->context() == &ioc) {
+            // Null for a session whose destructor is waiting on the mutex.
+            if (auto alive = session->weak_from_this().lock()) {
+                found.push_back(std::move(alive));
+            }
+        }
+    }
+    return found;
+}
+
+bool SessionRegistry::wait_empty(std::chrono::steady_clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(mutex);
+    return emptied.wait_until(lock, deadline, [this] { return size == 0; });
+}
+
+namespace {
+
+// Replies sent from the accept loop, without reading the request.
+constexpr std::string_view kOverloadedReply =
+    "HTTP/1.1 503 Service Unavailable\r\nRetry-After: 1\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+constexpr std::string_view kRateLimitedReply =
+    "HTTP/1.1 429 Too Many Requests\r\nRetry-After: 1\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+// A connection turned away from the accept loop with a canned reply. Whatever
+// the client sends is read and discarded until it closes: closing a socket with
+// unread data resets the connection, and the client could lose the reply.
+class Rejection : public std::enable_shared_from_this<Rejection> {
+public:
+    Rejection(SessionSocket socket, std::shared_ptr<SessionRegistry> sessions)
+        : socket_(std::move(socket)), timer_(socket_.get_executor()), sessions_(std::move(sessions)) {}
+
+    ~Rejection() { sessions_->release(); }
+
+    void start(std::string_view reply) {
+        timer_.expires_after(kLinger);
+        timer_.async_wait(bind_memory(handler_memory_, [self = shared_from_this()](beast::error_code ec) {
+            if (!ec) {
+                self->socket_.close(ec);
+            }
+        }));
+        boost::asio::async_write(socket_, boost::asio::buffer(reply), bind_memory(handler_memory_,
+            [self = shared_from_this()](beast::error_code ec, std::size_t) {
+                if (ec) {
+                    self->timer_.cancel();
+                    return;
+                }
+                self->socket_.shutdown(tcp::socket::shutdown_send, ec);
+                self->discard();
+            }));
+    }
+
+private:
+    // Time a client is given to read the reply and hang up.
+    static constexpr std::chrono::seconds kLinger{1};
+
+    void discard() {
+        socket_.async_read_some(boost::asio::buffer(scratch_), bind_memory(handler_memory_,
+            [self = shared_from_this()](beast::error_code ec, std::size_t) {
+                if (ec) {
+                    self->timer_.cancel();
+                    return;
+                }
+                self->discard();
+            }));
+    }
+
+    HandlerMemory handler_memory_;
+    SessionSocket socket_;
+    SessionTimer timer_;
+    std::shared_ptr<SessionRegistry> sessions_;
+    char scratch_[512];
+};
+
+using reuse_port = boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+
+tcp::acceptor open_acceptor(boost::asio::io_context& ioc, const tcp::endpoint& endpoint, bool share_port) {
+    tcp::acceptor acceptor(ioc);
+    acceptor.open(endpoint.protocol());
+    acceptor.set_option(tcp::acceptor::reuse_address(true));
+    if (share_port) {
+        acceptor.set_option(reuse_port(true));
+    }
+    acceptor.bind(endpoint);
+    acceptor.listen(boost::asio::socket_base::max_listen_connections);
+    return acceptor;
+}
+
+// Every acceptor is opened on an io_context.
+boost::asio::io_context& io_context_of(tcp::acceptor& acceptor) {
+    return static_cast<boost::asio::io_context&>(acceptor.get_executor().context());
+}
+
+// Time given to aborted connections to wind down before stop() moves on.
+constexpr auto kAbortGrace = std::chrono::milliseconds(100);
+
+} // namespace
+
+HttpServer::HttpServer(boost::asio::io_context& ioc, tcp::endpoint endpoint, const char* pipeline_description,
+                       GMainContext* pipeline_context)
+    : sessions_(std::make_shared<SessionRegistry>()) {
+    init_metrics();
+    acceptors_.push_back(open_acceptor(ioc, endpoint, false));
+    accept_paused_.emplace_back(false);
+    const auto local = acceptors_.front().local_endpoint();
+    SLOG_INFO("HttpServer", "Server created", "address", local.address().to_string(), "port", local.port());
+
+    register_default_routes();
+    init_pipeline(pipeline_description, pipeline_context);
     do_accept();
 }
 
+HttpServer::HttpServer(tcp::endpoint endpoint, const char* pipeline_description, std::size_t threads)
+    : sessions_(std::make_shared<SessionRegistry>()) {
+    init_metrics();
+    threads = std::max<std::size_t>(threads, 1);
+    io_contexts_.reserve(threads);
+    acceptors_.reserve(threads);
+    for (std::size_t i = 0; i < threads; ++i) {
+        // Each io_context is only ever run by one thread.
+        io_contexts_.push_back(std::make_unique<boost::asio::io_context>(1));
+        acceptors_.push_back(open_acceptor(*io_contexts_.back(), endpoint, true));
+        accept_paused_.emplace_back(false);
+        // With port 0 the first bind picks the port, the others join it.
+        endpoint.port(acceptors_.front().local_endpoint().port());
+    }
+    SLOG_INFO("HttpServer", "Server created", "address", endpoint.address().to_string(), "port", endpoint.port(),
+              "threads", threads);
+
+    register_default_routes();
+    init_pipeline(pipeline_description, nullptr);
+    do_accept();
+}
+
+HttpServer::~HttpServer() {
+    stop();
+}
+
+void HttpServer::init_metrics() {
+    router_.set_metrics(metrics_);
+    accepted_ = &metrics_.counter("http_connections_accepted_total", "Connections accepted.");
+    accept_errors_ = &metrics_.counter("http_accept_errors_total", "Failed accepts, other than the acceptor closing.");
+    open_sessions_ = &metrics_.gauge("http_sessions_open", "Connections currently open.");
+    const char* rejected_help = "Connections or requests turned away by admission control.";
+    rejected_overloaded_ = &metrics_.counter("http_admission_rejected_total", rejected_help,
+                                             MetricsRegistry::labels({{"reason", "overloaded"}}));
+    rejected_rate_limited_ = &metrics_.counter("http_admission_rejected_total", rejected_help,
+                                               MetricsRegistry::labels({{"reason", "rate_limited"}}));
+    accept_pauses_ = &metrics_.counter("http_accept_pauses_total",
+                                       "Times accepting paused because every connection slot was taken.");
+    sessions_->rate_limited = rejected_rate_limited_;
+    sessions_->on_closed = [this] { resume_accepting(); };
+}
+
+void HttpServer::set_admission(const AdmissionLimits& limits) {
+    admission_ = limits;
+    rate_limiter_.reset();
+    if (limits.requests_per_second > 0) {
+        rate_limiter_ = std::make_unique<RateLimiter>(limits.requests_per_second, limits.burst);
+    }
+    sessions_->limiter = rate_limiter_.get();
+    SLOG_INFO("HttpServer", "Admission limits set", "max_connections", limits.max_connections, "overload_slots",
+              limits.overload_slots, "requests_per_second", limits.requests_per_second, "burst", limits.burst);
+}
+
+void HttpServer::init_pipeline(const char* pipeline_description, GMainContext* context) {
+    if (!pipeline_description) {
+        return;
+    }
+    SLOG_INFO("HttpServer", "Initializing GStreamer pipeline");
+    if (!context) {
+        main_loop_ = std::make_unique<MainLoopThread>();
+        context = main_loop_->context();
+    }
+    gst_pipeline_ = std::make_unique<GstPipelineWrapper>(pipeline_description, context);
+    stream_hub_ = std::make_shared<StreamHub>();
+    bool key_units = false;
+    if (GstElement* encoder = gst_pipeline_->element(kEncoderName)) {
+        gst_object_unref(encoder);
+        KeyUnitRequestConfig key_unit_config;
+        key_unit_config.encoder = kEncoderName;
+        key_units = gst_pipeline_->enable_key_unit_requests(key_unit_config);
+    }
+    if (gst_pipeline_->tap_appsink(kEgressSinkName,
+            [hub = stream_hub_.get()](GstBuffer* buffer) { hub->publish(buffer); })) {
+        register_stream_routes(router_, stream_hub_, key_units ? gst_pipeline_.get() : nullptr);
+    }
+    SLOG_INFO("HttpServer", "Starting GStreamer pipeline");
+    gst_pipeline_->register_metrics(metrics_);
+    gst_pipeline_->start();
+    register_pipeline_routes(router_, *gst_pipeline_);
+}
+
 void HttpServer::start() {
-    std::cout << "[HttpServer] Server started\n";
-    // Implémentation à compléter
+    if (!threads_.empty()) {
+        return;
+    }
+    for (auto& ioc : io_contexts_) {
+        threads_.emplace_back([&ioc] { ioc->run(); });
+    }
+    SLOG_INFO("HttpServer", "Server started");
 }
 
-void HttpServer::stop() {
-    std::cout << "[HttpServer] Server stopped\n";
-    // Implémentation à compléter
+void HttpServer::stop(std::chrono::milliseconds timeout) {
+    if (stopped_) {
+        return;
+    }
+    stopped_ = true;
+    const auto started = std::chrono::steady_clock::now();
+    const auto deadline = started + timeout;
+    SLOG_INFO("HttpServer", "Server stopping", "timeout_ms", timeout.count());
+    {
+        // Connections closing from now on must not reach back into the server.
+        std::lock_guard<std::mutex> lock(sessions_->mutex);
+        sessions_->on_closed = nullptr;
+    }
+
+    on_acceptor_threads([this](tcp::acceptor& acceptor) {
+        beast::error_code ec;
+        acceptor.close(ec);
+        for (const auto& session : sessions_->on(io_context_of(acceptor))) {
+            session->drain();
+        }
+    }, deadline);
+    const bool drained = sessions_->wait_empty(deadline);
+    if (!drained) {
+        SLOG_WARN("HttpServer", "Aborting connections still open at the deadline");
+        on_acceptor_threads([this](tcp::acceptor& acceptor) {
+            for (const auto& session : sessions_->on(io_context_of(acceptor))) {
+                session->abort();
+            }
+        }, deadline + kAbortGrace);
+        // A session whose handler has yet to reply is only let go when it does.
+        sessions_->wait_empty(std::chrono::steady_clock::now() + kAbortGrace);
+    }
+
+    stop_pipeline(deadline);
+
+    for (auto& ioc : io_contexts_) {
+        ioc->stop();
+    }
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+    threads_.clear();
+    SLOG_INFO("HttpServer", "Server stopped", "drained", drained, "elapsed_ms",
+              std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count());
+}
+
+void HttpServer::on_acceptor_threads(const std::function<void(tcp::acceptor&)>& fn,
+                                     std::chrono::steady_clock::time_point deadline) {
+    std::vector<std::future<void>> done;
+    for (auto& acceptor : acceptors_) {
+        auto& ioc = io_context_of(acceptor);
+        // When nothing runs the context (not started, or run() has returned),
+        // no other thread can be using the acceptor or its sessions.
+        const bool running = !ioc.stopped() && (io_contexts_.empty() || !threads_.empty());
+        if (!running) {
+            fn(acceptor);
+            continue;
+        }
+        auto task = std::make_shared<std::packaged_task<void()>>([fn, &acceptor] { fn(acceptor); });
+        done.push_back(task->get_future());
+        boost::asio::post(ioc, [task] { (*task)(); });
+    }
+    for (auto& task : done) {
+        if (task.wait_until(deadline) == std::future_status::timeout) {
+            SLOG_WARN("HttpServer", "Server thread did not answer before the deadline");
+        }
+    }
+}
+
+void HttpServer::stop_pipeline(std::chrono::steady_clock::time_point deadline) {
+    if (!gst_pipeline_) {
+        return;
+    }
+    // Lets encoders and muxers push out what they hold before the teardown.
+    auto eos = gst_pipeline_->send_eos_async();
+    if (eos.wait_until(deadline) == std::future_status::timeout) {
+        SLOG_WARN("HttpServer", "Pipeline did not reach end of stream before the deadline");
+    }
+    gst_pipeline_->stop_async().wait();
+}
+
+unsigned short HttpServer::port() const {
+    beast::error_code ec;
+    return acceptors_.front().local_endpoint(ec).port();
+}
+
+Router& HttpServer::router() {
+    return router_;
+}
+
+MetricsRegistry& HttpServer::metrics() {
+    return metrics_;
 }
 
-void HttpServer::handleRequest(
-    boost::beast::http::request<boost::beast::http::string_body>& req,
-    boost::beast::http::response<boost::beast::http::string_body>& res){
-    std::cout << "[HttpServer] Handling request: " << req.method_string() << " " << req.target() << "\n";
-    // Implémentation à compléter
+GstPipelineWrapper* HttpServer::pipeline() {
+    return gst_pipeline_.get();
+}
+
+void HttpServer::register_default_routes() {
+    router_.add(http::verb::get, "/",
+        [](const Request&, const PathParams&, const Reply& reply) {
+            reply(Response::text(http::status::ok, "Hello, World!"));
+        });
+    router_.add(http::verb::get, "/metrics",
+        [this](const Request&, const PathParams&, const Reply& reply) {
+            reply(Response::text(http::status::ok, metrics_.render(), "text/plain; version=0.0.4"));
+        });
 }
 
 void HttpServer::do_accept() {
-    std::cout << "[HttpServer] Waiting for new connection...\n";
-    acceptor_.async_accept(
-        [this](beast::error_code ec, tcp::socket socket) {
+    for (auto& acceptor : acceptors_) {
+        do_accept(acceptor);
+    }
+}
+
+void HttpServer::do_accept(tcp::acceptor& acceptor) {
+    SLOG_DEBUG("HttpServer", "Waiting for new connection");
+    // The socket is bound to the acceptor's io_context, which pins the session
+    // to the thread that accepted it.
+    acceptor.async_accept(io_context_of(acceptor),
+        [this, &acceptor](beast::error_code ec, SessionSocket socket) {
+            // A connection accepted just before stop() closed the acceptor is
+            // dropped rather than left to outlive the drain.
+            if (ec == boost::asio::error::operation_aborted || !acceptor.is_open()) {
+                return;
+            }
             if (!ec) {
-                std::cout << "[HttpServer] Accepted new connection\n";
-                std::make_shared<Session>(std::move(socket))->start();
+                SLOG_DEBUG("HttpServer", "Accepted new connection");
+                accepted_->inc();
+                beast::error_code remote_ec;
+                std::uint64_t client = 0;
+                const auto reply = admit(socket.remote_endpoint(remote_ec), client);
+                if (!reply.empty()) {
+                    std::allocate_shared<Rejection>(PoolAllocator<Rejection>(), std::move(socket), sessions_)
+                        ->start(reply);
+                } else {
+                    // Sessions come and go with every connection: reuse their memory.
+                    std::allocate_shared<Session>(PoolAllocator<Session>(), std::move(socket), router_,
+                                                  *open_sessions_, *sessions_, client)->start();
+                }
             } else {
-                std::cerr << "[HttpServer] Accept error: " << ec.message() << "\n";
+                accept_errors_->inc();
+                SLOG_WARN("HttpServer", "Accept error", "error", ec.message());
             }
-            do_accept();
+            accept_next(acceptor);
         });
 }
+
+std::string_view HttpServer::admit(const tcp::endpoint& remote, std::uint64_t& client) {
+    const auto open = sessions_->connections.fetch_add(1) + 1;
+    if (open > admission_.max_connections) {
+        rejected_overloaded_->inc();
+        SLOG_DEBUG("HttpServer", "Connection rejected", "reason", "overloaded", "connections", open);
+        return kOverloadedReply;
+    }
+    if (rate_limiter_) {
+        client = RateLimiter::client_key(remote.address());
+        if (!rate_limiter_->try_acquire(client)) {
+            rejected_rate_limited_->inc();
+            SLOG_DEBUG("HttpServer", "Connection rejected", "reason", "rate_limited");
+            return kRateLimitedReply;
+        }
+    }
+    return {};
+}
+
+void HttpServer::accept_next(tcp::acceptor& acceptor) {
+    // Past this, new clients are left in the listen backlog rather than accepted.
+    const auto limit = admission_.max_connections + admission_.overload_slots;
+    auto& paused = accept_paused_[&acceptor - acceptors_.data()];
+    if (sessions_->connections.load() >= limit) {
+        paused.store(true);
+        // A connection closing before the flag was up did not see it: look again.
+        if (sessions_->connections.load() >= limit) {
+            accept_pauses_->inc();
+            SLOG_DEBUG("HttpServer", "Connection slots all taken, accepting paused");
+            return;
+        }
+        if (!paused.exchange(false)) {
+            // resume_accepting() got to it first and has already restarted us.
+            return;
+        }
+    }
+    do_accept(acceptor);
+}
+
+void HttpServer::resume_accepting() {
+    for (std::size_t i = 0; i < acceptors_.size(); ++i) {
+        if (accept_paused_[i].load() && accept_paused_[i].exchange(false)) {
+            SLOG_DEBUG("HttpServer", "Connection slot freed, accepting resumed");
+            boost::asio::post(io_context_of(acceptors_[i]), [this, &acceptor = acceptors_[i]] {
+                do_accept(acceptor);
+            });
+        }
+    }
+}
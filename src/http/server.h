@@ -1,21 +1,121 @@
+#pragma once
 #include <boost/asio.hpp>
 #include <boost/beast.hpp>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "admission.h"
+#include "router.h"
+#include "../metrics/metrics.h"
+#include "stream_hub.h"
 #include "../gstreamer/gst_pipeline.hpp"
+#include "../gstreamer/main_loop_thread.hpp"
 using tcp = boost::asio::ip::tcp;
 
+struct SessionRegistry;
+
 class HttpServer {
 public:
-    HttpServer(boost::asio::io_context& io_context, boost::asio::ip::tcp::endpoint endpoint, const char* pipeline_description);
+    // Serves on the caller's io_context; the caller is responsible for running it.
+    // The pipeline's bus and control calls run on `pipeline_context` when given,
+    // which the caller then iterates too (e.g. AsioGlibLoop::context(), to serve
+    // HTTP and the pipeline from one thread), else on a thread of the server's.
+    HttpServer(boost::asio::io_context& io_context, boost::asio::ip::tcp::endpoint endpoint, const char* pipeline_description,
+               GMainContext* pipeline_context = nullptr);
+    // Serves on `threads` internal threads. Each thread owns its io_context and a
+    // SO_REUSEPORT acceptor bound to the same endpoint, so the kernel balances
+    // connections and a session stays on the thread that accepted it.
+    HttpServer(boost::asio::ip::tcp::endpoint endpoint, const char* pipeline_description, std::size_t threads);
+    ~HttpServer();
 
     void start();
-    void stop();
+
+    // Graceful stop, bounded by `timeout`:
+    // - stops accepting and closes idle keep-alive connections and streams;
+    // - requests already being read or answered get their reply, sent with
+    //   "Connection: close";
+    // - connections still open at the deadline are aborted;
+    // - the pipeline gets an EOS, waited for within what is left of the
+    //   timeout, then goes to NULL.
+    // Returns once the server threads have exited. With a caller-provided
+    // io_context, call it from another thread while that context runs, or once
+    // it has returned; with a caller-provided pipeline context as well, only
+    // while that one runs. Only the first call does anything.
+    void stop(std::chrono::milliseconds timeout = kStopTimeout);
     void do_accept();
 
-private:    
-    tcp::acceptor acceptor_;
+    static constexpr std::chrono::milliseconds kStopTimeout{5000};
+
+    // Name of the appsink that, when present in the pipeline, is served on GET /stream.
+    static constexpr const char* kEgressSinkName = "egress";
+    // Encoder whose keyframe requests go through GstPipelineWrapper's
+    // coalescing service, when present in the pipeline.
+    static constexpr const char* kEncoderName = "encode";
+
+    // Routes must be added before the server starts serving.
+    Router& router();
+
+    // Connection cap and per-client rate limit, see AdmissionLimits. Must be set
+    // before the server starts serving.
+    void set_admission(const AdmissionLimits& limits);
+
+    // Served on GET /metrics. Metrics can be added at any time.
+    MetricsRegistry& metrics();
+
+    // The served pipeline, nullptr when the server was given no description.
+    GstPipelineWrapper* pipeline();
+
+    // Actual listening port, useful when the endpoint asked for port 0.
+    unsigned short port() const;
+
+private:
+    // Outlives the router and the pipeline, which hold metrics from it.
+    MetricsRegistry metrics_;
+    Counter* accepted_ = nullptr;
+    Counter* accept_errors_ = nullptr;
+    Gauge* open_sessions_ = nullptr;
+    Counter* rejected_overloaded_ = nullptr;
+    Counter* rejected_rate_limited_ = nullptr;
+    Counter* accept_pauses_ = nullptr;
+    AdmissionLimits admission_;
+    // Outlive the sessions, which keep a reference to them.
+    std::unique_ptr<RateLimiter> rate_limiter_;
+    Router router_;
+    // Shared with connections turned away, which may outlive the server.
+    std::shared_ptr<SessionRegistry> sessions_;
+    bool stopped_ = false;
+    // Declared before the acceptors so that they are destroyed last.
+    std::vector<std::unique_ptr<boost::asio::io_context>> io_contexts_;
+    std::vector<tcp::acceptor> acceptors_;
+    // One per acceptor, set while it waits for a connection to close before
+    // accepting again.
+    std::deque<std::atomic<bool>> accept_paused_;
+    std::vector<std::thread> threads_;
+    // Outlives the pipeline, whose appsink tap publishes into it.
+    std::shared_ptr<StreamHub> stream_hub_;
     std::unique_ptr<GstPipelineWrapper> gst_pipeline_;
+    // Runs the pipeline's control calls, unless the caller provided a context.
+    // Declared last so that it is joined before the pipeline and the sessions it
+    // may still reply to go away.
+    std::unique_ptr<MainLoopThread> main_loop_;
 
-    void handleRequest(
-        boost::beast::http::request<boost::beast::http::string_body>& req,
-        boost::beast::http::response<boost::beast::http::string_body>& res);
-};
\ No newline at end of file
+    void init_metrics();
+    void init_pipeline(const char* pipeline_description, GMainContext* context);
+    void register_default_routes();
+    void do_accept(tcp::acceptor& acceptor);
+    // Counts a new connection; returns the reply that turns it away, or an
+    // empty view to serve it. Sets `client` when the rate limit is on.
+    std::string_view admit(const tcp::endpoint& remote, std::uint64_t& client);
+    // Accepts the next connection, unless every connection slot is taken.
+    void accept_next(tcp::acceptor& acceptor);
+    // Called whenever a connection closes, from any thread.
+    void resume_accepting();
+    // Runs `fn` on the thread of every acceptor's io_context, or right here
+    // when nothing runs them, and waits for it until `deadline`.
+    void on_acceptor_threads(const std::function<void(tcp::acceptor&)>& fn,
+                             std::chrono::steady_clock::time_point deadline);
+    void stop_pipeline(std::chrono::steady_clock::time_point deadline);
+};
@@ -0,0 +1,134 @@
+#include "stream_hub.h"
+#include <algorithm>
+
+StreamSubscriber::StreamSubscriber(std::shared_ptr<StreamHub> hub, std::size_t max_lag)
+    : hub_(std::move(hub)), reader_(hub_->ring_, max_lag) {}
+
+StreamSubscriber::~StreamSubscriber() {
+    release();
+}
+
+void StreamSubscriber::start(std::function<void()> wake) {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    wake_ = std::move(wake);
+}
+
+boost::asio::const_buffer StreamSubscriber::next() {
+    bool parked = false;
+    while (true) {
+        const std::uint64_t skipped = reader_.skipped();
+        current_ = reader_.next();
+        dropped_.fetch_add(reader_.skipped() - skipped, std::memory_order_relaxed);
+        if (!current_) {
+            if (parked || stopped_) {
+                return {};
+            }
+            // Register for a wake-up, then look again: a buffer published in
+            // between would otherwise find nobody asleep and wake nobody.
+            hub_->sleep(this);
+            parked = true;
+            continue;
+        }
+        // Read-only maps of the same buffer can be held by any number of viewers.
+        if (gst_buffer_map(current_, &current_map_, GST_MAP_READ)) {
+            return boost::asio::const_buffer(current_map_.data, current_map_.size);
+        }
+        gst_buffer_unref(current_);
+        current_ = nullptr;
+    }
+}
+
+void StreamSubscriber::release() {
+    if (current_) {
+        gst_buffer_unmap(current_, &current_map_);
+        gst_buffer_unref(current_);
+        current_ = nullptr;
+    }
+}
+
+void StreamSubscriber::stop() {
+    if (stopped_) {
+        return;
+    }
+    stopped_ = true;
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        wake_ = nullptr;
+    }
+    hub_->subscribers_.fetch_sub(1, std::memory_order_relaxed);
+    // Unlink ourselves (and, harmlessly, every other sleeper) so that the list
+    // drops its reference now rather than at the next publish.
+    hub_->wake_sleepers();
+}
+
+void StreamSubscriber::wake() {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    if (wake_) {
+        wake_();
+    }
+}
+
+StreamHub::StreamHub(std::size_t capacity) : ring_(capacity) {}
+
+std::shared_ptr<StreamSubscriber> StreamHub::subscribe(std::size_t max_lag) {
+    subscribers_.fetch_add(1, std::memory_order_relaxed);
+    return std::make_shared<StreamSubscriber>(shared_from_this(), max_lag);
+}
+
+bool StreamHub::keyframe_within(std::size_t max_lag) const {
+    // Same window as FanoutReader's.
+    const std::uint64_t window = std::min<std::uint64_t>(std::max<std::size_t>(max_lag, 1), ring_.capacity() - 1);
+    const std::uint64_t keyframe = ring_.last_keyframe();
+    return keyframe != FanoutRing::kNone && ring_.head() - keyframe <= window;
+}
+
+void StreamHub::sleep(StreamSubscriber* subscriber) {
+    if (subscriber->sleeping_.exchange(true)) {
+        return;
+    }
+    subscriber->sleeping_self_ = subscriber->shared_from_this();
+    StreamSubscriber* head = sleepers_.load(std::memory_order_relaxed);
+    do {
+        subscriber->next_sleeper_ = head;
+    } while (!sleepers_.compare_exchange_weak(head, subscriber,
+                                              std::memory_order_acq_rel, std::memory_order_relaxed));
+    // Pairs with the fence in publish(): either the producer sees this viewer on
+    // the list, or the viewer's next look at the ring sees the new buffer.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void StreamHub::wake_sleepers() {
+    StreamSubscriber* sleeper = sleepers_.exchange(nullptr, std::memory_order_acq_rel);
+    while (sleeper) {
+        // Take everything out of the node before clearing `sleeping_`: from then
+        // on its owner may link it again.
+        auto self = std::move(sleeper->sleeping_self_);
+        StreamSubscriber* next = sleeper->next_sleeper_;
+        sleeper->sleeping_.store(false);
+        self->wake();
+        sleeper = next;
+    }
+}
+
+void StreamHub::publish(GstBuffer* buffer) {
+    // A buffer spread over several memories would be merged by every viewer's
+    // gst_buffer_map(); merge it once here instead.
+    GstBuffer* contiguous = nullptr;
+    if (gst_buffer_n_memory(buffer) > 1) {
+        contiguous = gst_buffer_new();
+        gst_buffer_copy_into(contiguous, buffer, GST_BUFFER_COPY_METADATA, 0, -1);
+        gst_buffer_append_memory(contiguous, gst_buffer_get_all_memory(buffer));
+        buffer = contiguous;
+    }
+
+    ring_.publish(buffer);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    // Only viewers that ran dry need waking; busy ones pick the buffer up themselves.
+    if (sleepers_.load(std::memory_order_relaxed)) {
+        wake_sleepers();
+    }
+
+    if (contiguous) {
+        gst_buffer_unref(contiguous);
+    }
+}
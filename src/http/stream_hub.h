@@ -0,0 +1,82 @@
+#pragma once
+#include <gst/gst.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include "router.h"
+#include "../gstreamer/fanout_ring.hpp"
+
+class StreamHub;
+
+// One viewer of a StreamHub. Buffers are shared by reference with every other
+// viewer and mapped read-only for the write, so a buffer is never copied per client.
+// The viewer reads the hub's ring at its own pace; one that falls more than
+// `max_lag` buffers behind resumes at the latest keyframe, so the encoder never waits.
+class StreamSubscriber : public ChunkStream, public std::enable_shared_from_this<StreamSubscriber> {
+public:
+    StreamSubscriber(std::shared_ptr<StreamHub> hub, std::size_t max_lag);
+    ~StreamSubscriber() override;
+
+    void start(std::function<void()> wake) override;
+    boost::asio::const_buffer next() override;
+    void release() override;
+    void stop() override;
+
+    // Buffers skipped because this viewer fell behind (or joined mid-GOP).
+    std::uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    friend class StreamHub;
+
+    void wake();
+
+    std::shared_ptr<StreamHub> hub_;
+    FanoutReader reader_;
+
+    std::mutex wake_mutex_;
+    std::function<void()> wake_;
+    // Set while this viewer is on the hub's sleeper list; the list holds
+    // `sleeping_self_` so that a viewer is never freed while linked.
+    std::atomic<bool> sleeping_{false};
+    std::shared_ptr<StreamSubscriber> sleeping_self_;
+    StreamSubscriber* next_sleeper_ = nullptr;
+
+    GstBuffer* current_ = nullptr;
+    GstMapInfo current_map_;
+    std::atomic<std::uint64_t> dropped_{0};
+    bool stopped_ = false;
+};
+
+// Fans the encoded stream out to every connected viewer through a FanoutRing:
+// publishing is one slot write whatever the number of viewers. Viewers that ran
+// dry park themselves on a lock-free list and are woken by the next publish.
+class StreamHub : public std::enable_shared_from_this<StreamHub> {
+public:
+    static constexpr std::size_t kDefaultRingCapacity = 1024;
+    static constexpr std::size_t kDefaultMaxLag = 256;
+
+    explicit StreamHub(std::size_t capacity = kDefaultRingCapacity);
+
+    std::shared_ptr<StreamSubscriber> subscribe(std::size_t max_lag = kDefaultMaxLag);
+
+    // Called for every buffer leaving the encoder tap (streaming thread).
+    void publish(GstBuffer* buffer);
+
+    std::size_t subscribers() const { return subscribers_.load(std::memory_order_relaxed); }
+
+    // Whether a viewer subscribed with `max_lag` now would start by replaying
+    // the current GOP, its keyframe being still in the ring within reach.
+    bool keyframe_within(std::size_t max_lag) const;
+
+private:
+    friend class StreamSubscriber;
+
+    void sleep(StreamSubscriber* subscriber);
+    void wake_sleepers();
+
+    FanoutRing ring_;
+    // Treiber stack of idle viewers, only ever emptied as a whole.
+    std::atomic<StreamSubscriber*> sleepers_{nullptr};
+    std::atomic<std::size_t> subscribers_{0};
+};
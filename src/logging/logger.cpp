@@ -0,0 +1,296 @@
+#include "logger.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Rings are drained this often, or as soon as an error is logged or flush()
+// is called.
+constexpr auto kDrainInterval = std::chrono::milliseconds(10);
+
+const char* level_name(LogLevel level) {
+    switch (level) {
+    case LogLevel::Trace: return "TRACE";
+    case LogLevel::Debug: return "DEBUG";
+    case LogLevel::Info: return "INFO ";
+    case LogLevel::Warn: return "WARN ";
+    case LogLevel::Error: return "ERROR";
+    }
+    return "?    ";
+}
+
+void append_text(std::string& out, std::string_view text) {
+    const bool quote = text.empty() || text.find_first_of(" \"=\\\n\t") != std::string_view::npos;
+    if (!quote) {
+        out += text;
+        return;
+    }
+    out += '"';
+    for (char c : text) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\t': out += "\\t"; break;
+        default: out += c; break;
+        }
+    }
+    out += '"';
+}
+
+// 2026-01-31T12:34:56.789012Z INFO  7 [Tag] Message key=value ...
+void format(std::string& out, const LogRecord& record) {
+    const std::time_t seconds = record.time_ns / 1000000000;
+    std::tm utc{};
+    gmtime_r(&seconds, &utc);
+    char stamp[64];
+    std::size_t len = std::strftime(stamp, sizeof stamp, "%Y-%m-%dT%H:%M:%S", &utc);
+    std::snprintf(stamp + len, sizeof stamp - len, ".%06dZ %s %u ",
+                  static_cast<int>(record.time_ns % 1000000000 / 1000), level_name(record.level), record.thread);
+    out += stamp;
+    out.append("[").append(record.tag).append("]");
+    if (*record.message) {
+        out.append(" ").append(record.message);
+    }
+    char number[32];
+    for (std::size_t i = 0; i < record.field_count; ++i) {
+        const auto& field = record.fields[i];
+        out.append(" ").append(field.key).append("=");
+        switch (field.kind) {
+        case LogRecord::Kind::Int:
+            std::snprintf(number, sizeof number, "%lld", static_cast<long long>(field.i));
+            out += number;
+            break;
+        case LogRecord::Kind::Uint:
+            std::snprintf(number, sizeof number, "%llu", static_cast<unsigned long long>(field.u));
+            out += number;
+            break;
+        case LogRecord::Kind::Double:
+            std::snprintf(number, sizeof number, "%.6g", field.d);
+            out += number;
+            break;
+        case LogRecord::Kind::Bool:
+            out += field.b ? "true" : "false";
+            break;
+        case LogRecord::Kind::Text:
+            append_text(out, std::string_view(record.text + field.offset, field.length));
+            break;
+        }
+    }
+    out += '\n';
+}
+
+} // namespace
+
+struct Logger::ThreadBuffer {
+    explicit ThreadBuffer(std::uint32_t id) : id(id), slots(kThreadRingSize) {}
+
+    const std::uint32_t id;
+    std::vector<LogRecord> slots;
+    // Written by the owning thread only.
+    alignas(64) std::atomic<std::size_t> tail{0};
+    // Written by the writer thread only.
+    alignas(64) std::atomic<std::size_t> head{0};
+    std::atomic<std::uint64_t> dropped{0};
+    // Set when the owning thread exits; the writer frees the ring once drained.
+    std::atomic<bool> retired{false};
+};
+
+struct Logger::Impl {
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable flushed_cv;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    std::uint32_t next_thread = 1;
+    std::uint64_t flush_requested = 0;
+    std::uint64_t flush_done = 0;
+    bool urgent = false;
+    // Held while writing, so that set_sink() never swaps the sink mid-call.
+    std::mutex sink_mutex;
+    Sink sink;
+    std::thread writer;
+
+    // Working storage of drain(), kept across calls so that an idle writer
+    // does not allocate.
+    struct Pending {
+        ThreadBuffer* buffer;
+        std::size_t tail;
+    };
+    std::vector<std::shared_ptr<ThreadBuffer>> snapshot;
+    std::vector<Pending> pending;
+    std::vector<const LogRecord*> records;
+
+    void run();
+    void drain(std::string& out);
+};
+
+namespace {
+
+// Marks the ring of an exiting thread as retired.
+struct ThreadBufferHolder {
+    std::shared_ptr<void> buffer;
+    std::atomic<bool>* retired = nullptr;
+    ~ThreadBufferHolder() {
+        if (retired) {
+            retired->store(true, std::memory_order_release);
+        }
+    }
+};
+
+} // namespace
+
+Logger::Logger() : impl_(new Impl) {
+    impl_->sink = [](std::string_view lines) {
+        std::fwrite(lines.data(), 1, lines.size(), stdout);
+        std::fflush(stdout);
+    };
+    impl_->writer = std::thread([impl = impl_] { impl->run(); });
+    impl_->writer.detach();
+}
+
+Logger& Logger::instance() {
+    // Never destroyed: threads may still log while static destructors run.
+    // Whatever is pending at exit is written out by the atexit handler.
+    static Logger* logger = [] {
+        auto* created = new Logger;
+        std::atexit([] { Logger::instance().flush(); });
+        return created;
+    }();
+    return *logger;
+}
+
+thread_local Logger::ThreadBuffer* Logger::current_ = nullptr;
+
+Logger::ThreadBuffer* Logger::register_thread() {
+    // Keeps the ring alive for the thread's lifetime and retires it on exit.
+    thread_local ThreadBufferHolder holder;
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    auto created = std::make_shared<ThreadBuffer>(impl_->next_thread++);
+    impl_->buffers.push_back(created);
+    holder.retired = &created->retired;
+    holder.buffer = created;
+    return created.get();
+}
+
+LogRecord* Logger::begin() {
+    if (!current_) {
+        current_ = register_thread();
+    }
+    const auto tail = current_->tail.load(std::memory_order_relaxed);
+    if (tail - current_->head.load(std::memory_order_acquire) == kThreadRingSize) {
+        current_->dropped.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    LogRecord& record = current_->slots[tail % kThreadRingSize];
+    record.time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    record.thread = current_->id;
+    record.field_count = 0;
+    record.text_used = 0;
+    return &record;
+}
+
+void Logger::commit(const LogRecord& record) {
+    // Publishes the slot begin() handed out.
+    current_->tail.store(current_->tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    if (record.level >= LogLevel::Error) {
+        // Errors are written right away rather than on the next drain.
+        {
+            std::lock_guard<std::mutex> lock(impl_->mutex);
+            impl_->urgent = true;
+        }
+        impl_->wake.notify_one();
+    }
+}
+
+void Logger::set_sink(Sink sink) {
+    flush();
+    std::lock_guard<std::mutex> lock(impl_->sink_mutex);
+    impl_->sink = std::move(sink);
+}
+
+void Logger::flush() {
+    std::unique_lock<std::mutex> lock(impl_->mutex);
+    const auto ticket = ++impl_->flush_requested;
+    impl_->wake.notify_one();
+    impl_->flushed_cv.wait(lock, [&] { return impl_->flush_done >= ticket; });
+}
+
+void Logger::Impl::run() {
+    std::string out;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait_for(lock, kDrainInterval, [&] { return urgent || flush_done < flush_requested; });
+        urgent = false;
+        // Everything committed before a flush() call is visible once we have
+        // taken the mutex after it.
+        const auto ticket = flush_requested;
+        lock.unlock();
+
+        drain(out);
+        if (!out.empty()) {
+            std::lock_guard<std::mutex> sink_lock(sink_mutex);
+            sink(out);
+            out.clear();
+        }
+
+        lock.lock();
+        flush_done = ticket;
+        flushed_cv.notify_all();
+    }
+}
+
+void Logger::Impl::drain(std::string& out) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        snapshot.assign(buffers.begin(), buffers.end());
+    }
+
+    pending.clear();
+    records.clear();
+    for (const auto& buffer : snapshot) {
+        const auto head = buffer->head.load(std::memory_order_relaxed);
+        const auto tail = buffer->tail.load(std::memory_order_acquire);
+        for (auto i = head; i != tail; ++i) {
+            records.push_back(&buffer->slots[i % kThreadRingSize]);
+        }
+        pending.push_back({buffer.get(), tail});
+    }
+    // Each ring is already in order; merge them into one timeline.
+    if (!records.empty()) {
+        std::stable_sort(records.begin(), records.end(),
+                         [](const LogRecord* a, const LogRecord* b) { return a->time_ns < b->time_ns; });
+    }
+    for (const auto* record : records) {
+        format(out, *record);
+    }
+    for (const auto& [buffer, tail] : pending) {
+        buffer->head.store(tail, std::memory_order_release);
+        if (const auto dropped = buffer->dropped.exchange(0, std::memory_order_relaxed)) {
+            char line[96];
+            std::snprintf(line, sizeof line, "[Logger] Dropped records thread=%u count=%llu\n", buffer->id,
+                          static_cast<unsigned long long>(dropped));
+            out += line;
+        }
+    }
+
+    // Let go of the rings, so that the retired ones removed below are freed now.
+    snapshot.clear();
+    std::lock_guard<std::mutex> lock(mutex);
+    buffers.erase(std::remove_if(buffers.begin(), buffers.end(),
+                                 [](const auto& buffer) {
+                                     return buffer->retired.load(std::memory_order_acquire) &&
+                                            buffer->head.load(std::memory_order_relaxed) ==
+                                                buffer->tail.load(std::memory_order_acquire);
+                                 }),
+                  buffers.end());
+}
@@ -0,0 +1,182 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string_view>
+#include <type_traits>
+
+// Levels below SLOG_ACTIVE_LEVEL are compiled out: the call, its arguments and
+// the level check all disappear. Build with e.g. -DSLOG_ACTIVE_LEVEL=SLOG_LEVEL_DEBUG
+// to keep per-request logs.
+#define SLOG_LEVEL_TRACE 0
+#define SLOG_LEVEL_DEBUG 1
+#define SLOG_LEVEL_INFO 2
+#define SLOG_LEVEL_WARN 3
+#define SLOG_LEVEL_ERROR 4
+#define SLOG_LEVEL_OFF 5
+
+#ifndef SLOG_ACTIVE_LEVEL
+#define SLOG_ACTIVE_LEVEL SLOG_LEVEL_INFO
+#endif
+
+enum class LogLevel : std::uint8_t {
+    Trace = SLOG_LEVEL_TRACE,
+    Debug = SLOG_LEVEL_DEBUG,
+    Info = SLOG_LEVEL_INFO,
+    Warn = SLOG_LEVEL_WARN,
+    Error = SLOG_LEVEL_ERROR,
+};
+
+// One log call as captured on the calling thread: values are stored raw and only
+// formatted by the writer. Tag, message and field keys are not copied and must
+// be string literals; string values are copied, truncated to what fits.
+struct LogRecord {
+    static constexpr std::size_t kMaxFields = 6;
+    static constexpr std::size_t kTextSize = 160;
+
+    enum class Kind : std::uint8_t { Int, Uint, Double, Bool, Text };
+    struct Field {
+        const char* key;
+        Kind kind;
+        std::uint8_t offset;
+        std::uint8_t length;
+        union {
+            std::int64_t i;
+            std::uint64_t u;
+            double d;
+            bool b;
+        };
+    };
+
+    std::int64_t time_ns;
+    const char* tag;
+    const char* message;
+    std::uint32_t thread;
+    LogLevel level;
+    std::uint8_t field_count;
+    std::uint8_t text_used;
+    Field fields[kMaxFields];
+    char text[kTextSize];
+
+    template <typename T>
+    void add(const char* key, const T& value) {
+        Field& field = fields[field_count++];
+        field.key = key;
+        if constexpr (std::is_same_v<T, bool>) {
+            field.kind = Kind::Bool;
+            field.b = value;
+        } else if constexpr (std::is_enum_v<T>) {
+            field.kind = Kind::Int;
+            field.i = static_cast<std::int64_t>(value);
+        } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+            field.kind = Kind::Int;
+            field.i = value;
+        } else if constexpr (std::is_integral_v<T>) {
+            field.kind = Kind::Uint;
+            field.u = value;
+        } else if constexpr (std::is_floating_point_v<T>) {
+            field.kind = Kind::Double;
+            field.d = value;
+        } else {
+            std::string_view text_value;
+            if constexpr (std::is_convertible_v<const T&, const char*>) {
+                // Literals and C strings; nullptr stands for an empty string.
+                const char* c_str = value;
+                text_value = c_str ? c_str : "";
+            } else {
+                static_assert(std::is_convertible_v<const T&, std::string_view>, "unsupported log field type");
+                text_value = value;
+            }
+            field.kind = Kind::Text;
+            field.offset = text_used;
+            field.length = static_cast<std::uint8_t>(std::min(text_value.size(), kTextSize - text_used));
+            std::memcpy(text + text_used, text_value.data(), field.length);
+            text_used += field.length;
+        }
+    }
+};
+
+// Asynchronous logger. Each thread appends records to its own lock-free ring
+// (single producer, single consumer); a background thread drains all rings,
+// orders the batch by time and writes it out. A thread that outruns the writer
+// drops records rather than block, and the writer reports how many.
+class Logger {
+public:
+    using Sink = std::function<void(std::string_view)>;
+
+    // Records a thread can have pending before it starts dropping.
+    static constexpr std::size_t kThreadRingSize = 512;
+
+    static Logger& instance();
+
+    // Runtime filter on top of SLOG_ACTIVE_LEVEL.
+    static bool enabled(LogLevel level) {
+        return static_cast<int>(level) >= runtime_level_.load(std::memory_order_relaxed);
+    }
+    static void set_level(LogLevel level) {
+        runtime_level_.store(static_cast<int>(level), std::memory_order_relaxed);
+    }
+
+    // Fields are key, value pairs: log(LogLevel::Info, "Session", "Closed", "bytes", n).
+    template <typename... Fields>
+    void log(LogLevel level, const char* tag, const char* message, const Fields&... fields) {
+        static_assert(sizeof...(Fields) % 2 == 0, "log fields are key, value pairs");
+        static_assert(sizeof...(Fields) / 2 <= LogRecord::kMaxFields, "too many log fields");
+        LogRecord* record = begin();
+        if (!record) {
+            return;
+        }
+        record->level = level;
+        record->tag = tag;
+        record->message = message;
+        add_fields(*record, fields...);
+        commit(*record);
+    }
+
+    // Replaces where formatted lines go (stdout by default). Called on the
+    // writer thread with one or more complete lines.
+    void set_sink(Sink sink);
+
+    // Returns once every record logged before the call has been written.
+    void flush();
+
+private:
+    struct ThreadBuffer;
+    struct Impl;
+
+    Logger();
+
+    ThreadBuffer* register_thread();
+    LogRecord* begin();
+    void commit(const LogRecord& record);
+
+    static void add_fields(LogRecord&) {}
+    template <typename T, typename... Rest>
+    static void add_fields(LogRecord& record, const char* key, const T& value, const Rest&... rest) {
+        record.add(key, value);
+        add_fields(record, rest...);
+    }
+
+    static inline std::atomic<int> runtime_level_{SLOG_LEVEL_TRACE};
+    // The calling thread's ring, registered on its first record.
+    static thread_local ThreadBuffer* current_;
+    Impl* impl_;
+};
+
+#define SLOG_AT(level, tag, ...)                                              \
+    do {                                                                      \
+        if constexpr (static_cast<int>(level) >= SLOG_ACTIVE_LEVEL) {         \
+            if (Logger::enabled(level)) {                                     \
+                Logger::instance().log(level, tag, __VA_ARGS__);              \
+            }                                                                 \
+        }                                                                     \
+    } while (0)
+
+#define SLOG_TRACE(tag, ...) SLOG_AT(LogLevel::Trace, tag, __VA_ARGS__)
+#define SLOG_DEBUG(tag, ...) SLOG_AT(LogLevel::Debug, tag, __VA_ARGS__)
+#define SLOG_INFO(tag, ...) SLOG_AT(LogLevel::Info, tag, __VA_ARGS__)
+#define SLOG_WARN(tag, ...) SLOG_AT(LogLevel::Warn, tag, __VA_ARGS__)
+#define SLOG_ERROR(tag, ...) SLOG_AT(LogLevel::Error, tag, __VA_ARGS__)
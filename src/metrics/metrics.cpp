@@ -0,0 +1,202 @@
+#include "metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+std::size_t metric_shard() {
+    static std::atomic<std::size_t> next{0};
+    thread_local const std::size_t shard = next.fetch_add(1, std::memory_order_relaxed) % kMetricShards;
+    return shard;
+}
+
+std::uint64_t Counter::value() const {
+    std::uint64_t sum = 0;
+    for (const auto& shard : shards_) {
+        sum += shard.value.load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+std::int64_t Gauge::value() const {
+    std::int64_t sum = 0;
+    for (const auto& shard : shards_) {
+        sum += shard.value.load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+Histogram::Histogram(std::vector<double> bounds) : bounds_(std::move(bounds)) {
+    std::sort(bounds_.begin(), bounds_.end());
+    shards_.reserve(kMetricShards);
+    for (std::size_t i = 0; i < kMetricShards; ++i) {
+        shards_.push_back(std::make_unique<Shard>(bounds_.size() + 1));
+    }
+}
+
+void Histogram::observe(double value) {
+    // Few bounds: a linear scan beats a binary search here.
+    std::size_t bucket = 0;
+    while (bucket < bounds_.size() && value > bounds_[bucket]) {
+        ++bucket;
+    }
+    auto& shard = *shards_[metric_shard()];
+    shard.counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    if (value > 0) {
+        shard.sum_micros.fetch_add(static_cast<std::uint64_t>(std::llround(value * 1e6)), std::memory_order_relaxed);
+    }
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+    Snapshot snap;
+    snap.cumulative.assign(bounds_.size() + 1, 0);
+    std::uint64_t sum_micros = 0;
+    for (const auto& shard : shards_) {
+        for (std::size_t i = 0; i < snap.cumulative.size(); ++i) {
+            snap.cumulative[i] += shard->counts[i].load(std::memory_order_relaxed);
+        }
+        sum_micros += shard->sum_micros.load(std::memory_order_relaxed);
+    }
+    for (std::size_t i = 1; i < snap.cumulative.size(); ++i) {
+        snap.cumulative[i] += snap.cumulative[i - 1];
+    }
+    snap.count = snap.cumulative.back();
+    snap.sum = static_cast<double>(sum_micros) / 1e6;
+    return snap;
+}
+
+std::vector<double> Histogram::latency_bounds() {
+    return {0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10};
+}
+
+std::string MetricsRegistry::labels(std::initializer_list<std::pair<std::string_view, std::string_view>> pairs) {
+    std::string out;
+    for (const auto& [key, value] : pairs) {
+        out += out.empty() ? "{" : ",";
+        out.append(key).append("=\"");
+        for (char c : value) {
+            switch (c) {
+            case '\\': out += "\\\\"; break;
+            case '"': out += "\\\""; break;
+            case '\n': out += "\\n"; break;
+            default: out += c; break;
+            }
+        }
+        out += '"';
+    }
+    if (!out.empty()) {
+        out += '}';
+    }
+    return out;
+}
+
+MetricsRegistry::Family& MetricsRegistry::family(const std::string& name, const std::string& help, const std::string& type) {
+    auto [it, inserted] = families_.try_emplace(name);
+    if (inserted) {
+        it->second.help = help;
+        it->second.type = type;
+    } else if (it->second.type != type) {
+        throw std::invalid_argument("metric " + name + " already registered as a " + it->second.type);
+    }
+    return it->second;
+}
+
+Counter& MetricsRegistry::counter(const std::string& name, const std::string& help, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& slot = family(name, help, "counter").counters[labels];
+    if (!slot) {
+        slot = std::make_unique<Counter>();
+    }
+    return *slot;
+}
+
+Gauge& MetricsRegistry::gauge(const std::string& name, const std::string& help, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& slot = family(name, help, "gauge").gauges[labels];
+    if (!slot) {
+        slot = std::make_unique<Gauge>();
+    }
+    return *slot;
+}
+
+Histogram& MetricsRegistry::histogram(const std::string& name, const std::string& help, const std::string& labels,
+                                      std::vector<double> bounds) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& slot = family(name, help, "histogram").histograms[labels];
+    if (!slot) {
+        slot = std::make_unique<Histogram>(std::move(bounds));
+    }
+    return *slot;
+}
+
+std::size_t MetricsRegistry::collect(const std::string& name, const std::string& help, const std::string& type,
+                                     Collector collector) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto id = next_id_++;
+    family(name, help, type).collectors.emplace_back(id, std::move(collector));
+    return id;
+}
+
+void MetricsRegistry::remove(std::size_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& [name, family] : families_) {
+        auto& collectors = family.collectors;
+        collectors.erase(std::remove_if(collectors.begin(), collectors.end(),
+                                        [id](const auto& entry) { return entry.first == id; }),
+                         collectors.end());
+    }
+}
+
+namespace {
+
+// `labels` with one more pair appended, e.g. {route="/"} + le -> {route="/",le="0.1"}.
+std::string with_label(const std::string& labels, std::string_view key, const std::string& value) {
+    std::string pair = std::string(key) + "=\"" + value + "\"";
+    if (labels.empty()) {
+        return "{" + pair + "}";
+    }
+    return labels.substr(0, labels.size() - 1) + "," + pair + "}";
+}
+
+std::string format_bound(double bound) {
+    std::ostringstream out;
+    out << bound;
+    return out.str();
+}
+
+} // namespace
+
+std::string MetricsRegistry::render() const {
+    std::ostringstream out;
+    out.precision(15);
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& [name, family] : families_) {
+        out << "# HELP " << name << ' ' << family.help << '\n';
+        out << "# TYPE " << name << ' ' << family.type << '\n';
+        for (const auto& [labels, counter] : family.counters) {
+            out << name << labels << ' ' << counter->value() << '\n';
+        }
+        for (const auto& [labels, gauge] : family.gauges) {
+            out << name << labels << ' ' << gauge->value() << '\n';
+        }
+        for (const auto& [labels, histogram] : family.histograms) {
+            const auto snap = histogram->snapshot();
+            const auto& bounds = histogram->bounds();
+            for (std::size_t i = 0; i < bounds.size(); ++i) {
+                out << name << "_bucket" << with_label(labels, "le", format_bound(bounds[i])) << ' '
+                    << snap.cumulative[i] << '\n';
+            }
+            out << name << "_bucket" << with_label(labels, "le", "+Inf") << ' ' << snap.count << '\n';
+            out << name << "_sum" << labels << ' ' << snap.sum << '\n';
+            out << name << "_count" << labels << ' ' << snap.count << '\n';
+        }
+        Samples samples;
+        for (const auto& [id, collector] : family.collectors) {
+            collector(samples);
+        }
+        for (const auto& [labels, value] : samples) {
+            out << name << labels << ' ' << value << '\n';
+        }
+    }
+    return out.str();
+}
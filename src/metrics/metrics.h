@@ -0,0 +1,120 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Counters are split into per-thread shards, each on its own cache line. Hot
+// paths only do a relaxed add on the calling thread's shard; the shards are
+// summed when the registry is scraped.
+constexpr std::size_t kMetricShards = 16;
+
+// Shard of the calling thread, fixed for the thread's lifetime.
+std::size_t metric_shard();
+
+class Counter {
+public:
+    void inc(std::uint64_t n = 1) { shards_[metric_shard()].value.fetch_add(n, std::memory_order_relaxed); }
+    std::uint64_t value() const;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<std::uint64_t> value{0};
+    };
+    std::array<Shard, kMetricShards> shards_;
+};
+
+// A value that goes up and down, e.g. open sessions. Each shard may go
+// negative on its own (a session closed on another thread); the sum is exact.
+class Gauge {
+public:
+    void add(std::int64_t n) { shards_[metric_shard()].value.fetch_add(n, std::memory_order_relaxed); }
+    void inc() { add(1); }
+    void dec() { add(-1); }
+    std::int64_t value() const;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<std::int64_t> value{0};
+    };
+    std::array<Shard, kMetricShards> shards_;
+};
+
+// Cumulative histogram over fixed upper bounds. The sum is kept in millionths
+// of the observed unit (microseconds for durations in seconds).
+class Histogram {
+public:
+    explicit Histogram(std::vector<double> bounds);
+
+    void observe(double value);
+
+    struct Snapshot {
+        // One cumulative count per bound, then the +Inf bucket.
+        std::vector<std::uint64_t> cumulative;
+        double sum = 0;
+        std::uint64_t count = 0;
+    };
+    Snapshot snapshot() const;
+    const std::vector<double>& bounds() const { return bounds_; }
+
+    // Request durations in seconds, from 0.5 ms to 10 s.
+    static std::vector<double> latency_bounds();
+
+private:
+    struct alignas(64) Shard {
+        explicit Shard(std::size_t buckets) : counts(buckets) {}
+        std::vector<std::atomic<std::uint64_t>> counts;
+        std::atomic<std::uint64_t> sum_micros{0};
+    };
+
+    std::vector<double> bounds_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+// Named metrics rendered in the Prometheus text exposition format. Creating a
+// metric takes a lock and should happen at setup; the returned reference stays
+// valid for the registry's lifetime and can be updated from any thread.
+class MetricsRegistry {
+public:
+    // Formats a label set, e.g. {{"route", "/"}} -> {route="/"}, escaping values.
+    static std::string labels(std::initializer_list<std::pair<std::string_view, std::string_view>> pairs);
+
+    // Same name and labels return the same metric.
+    Counter& counter(const std::string& name, const std::string& help, const std::string& labels = {});
+    Gauge& gauge(const std::string& name, const std::string& help, const std::string& labels = {});
+    Histogram& histogram(const std::string& name, const std::string& help, const std::string& labels = {},
+                         std::vector<double> bounds = Histogram::latency_bounds());
+
+    // Samples computed only when scraped, as (labels, value) pairs. `type` is
+    // "counter" or "gauge". Returns an id for remove().
+    using Samples = std::vector<std::pair<std::string, double>>;
+    using Collector = std::function<void(Samples&)>;
+    std::size_t collect(const std::string& name, const std::string& help, const std::string& type, Collector collector);
+    void remove(std::size_t id);
+
+    std::string render() const;
+
+private:
+    struct Family {
+        std::string help;
+        std::string type;
+        std::map<std::string, std::unique_ptr<Counter>> counters;
+        std::map<std::string, std::unique_ptr<Gauge>> gauges;
+        std::map<std::string, std::unique_ptr<Histogram>> histograms;
+        std::vector<std::pair<std::size_t, Collector>> collectors;
+    };
+
+    Family& family(const std::string& name, const std::string& help, const std::string& type);
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Family> families_;
+    std::size_t next_id_ = 1;
+};
@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <boost/asio/ip/address.hpp>
+#include "http/admission.h"
+
+using namespace std::chrono_literals;
+using boost::asio::ip::make_address;
+
+TEST(RateLimiterTest, AllowsBurstThenRefills) {
+    RateLimiter limiter(10, 3);
+    const auto client = RateLimiter::client_key(make_address("192.0.2.1"));
+    const auto t0 = RateLimiter::Clock::now();
+
+    // Le seau plein laisse passer la rafale, puis plus rien
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_TRUE(limiter.try_acquire(client, t0)) << i;
+    }
+    EXPECT_FALSE(limiter.try_acquire(client, t0));
+
+    // Un jeton revient tous les 100 ms
+    EXPECT_FALSE(limiter.try_acquire(client, t0 + 50ms));
+    EXPECT_TRUE(limiter.try_acquire(client, t0 + 100ms));
+    EXPECT_FALSE(limiter.try_acquire(client, t0 + 100ms));
+
+    // Après un long silence, la rafale entière, pas davantage
+    const auto later = t0 + 10s;
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_TRUE(limiter.try_acquire(client, later)) << i;
+    }
+    EXPECT_FALSE(limiter.try_acquire(client, later));
+}
+
+TEST(RateLimiterTest, ClientsHaveTheirOwnBuckets) {
+    RateLimiter limiter(1, 1);
+    const auto t0 = RateLimiter::Clock::now();
+    const auto a = RateLimiter::client_key(make_address("192.0.2.1"));
+    const auto b = RateLimiter::client_key(make_address("192.0.2.2"));
+    EXPECT_TRUE(limiter.try_acquire(a, t0));
+    EXPECT_FALSE(limiter.try_acquire(a, t0));
+    EXPECT_TRUE(limiter.try_acquire(b, t0));
+}
+
+TEST(RateLimiterTest, KeysFollowTheClientAddress) {
+    // IPv4 mappée en IPv6 : même client
+    EXPECT_EQ(RateLimiter::client_key(make_address("192.0.2.1")),
+              RateLimiter::client_key(make_address("::ffff:192.0.2.1")));
+    EXPECT_NE(RateLimiter::client_key(make_address("192.0.2.1")),
+              RateLimiter::client_key(make_address("192.0.2.2")));
+    // IPv6 : un client par préfixe /64
+    EXPECT_EQ(RateLimiter::client_key(make_address("2001:db8:1:2::1")),
+              RateLimiter::client_key(make_address("2001:db8:1:2:ffff::9")));
+    EXPECT_NE(RateLimiter::client_key(make_address("2001:db8:1:2::1")),
+              RateLimiter::client_key(make_address("2001:db8:1:3::1")));
+    EXPECT_NE(RateLimiter::client_key(make_address("0.0.0.0")), 0u);
+}
+
+TEST(RateLimiterTest, QuietClientsGiveUpTheirSlots) {
+    RateLimiter limiter(1, 1);
+    const auto t0 = RateLimiter::Clock::now();
+    // Bien plus de clients que de places : chacun vide son seau
+    constexpr std::uint64_t kClients = RateLimiter::kShards * RateLimiter::kSlotsPerShard * 4;
+    for (std::uint32_t i = 0; i < kClients; ++i) {
+        limiter.try_acquire(RateLimiter::client_key(boost::asio::ip::address_v4(i + 1)), t0);
+    }
+    // Les tables saturées laissent passer sans suivre
+    EXPECT_GT(limiter.untracked(), 0u);
+
+    // Une seconde plus tard, les seaux sont pleins : les places se reprennent
+    const auto untracked = limiter.untracked();
+    const auto late = RateLimiter::client_key(make_address("198.51.100.7"));
+    EXPECT_TRUE(limiter.try_acquire(late, t0 + 2s));
+    EXPECT_FALSE(limiter.try_acquire(late, t0 + 2s));
+    EXPECT_EQ(limiter.untracked(), untracked);
+}
+
+TEST(RateLimiterTest, ConcurrentCallersShareOneBucket) {
+    RateLimiter limiter(1, 100);
+    const auto client = RateLimiter::client_key(make_address("192.0.2.1"));
+    const auto t0 = RateLimiter::Clock::now();
+    std::atomic<int> granted{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 1000; ++i) {
+                if (limiter.try_acquire(client, t0)) {
+                    ++granted;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(granted.load(), 100);
+}
@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include <gst/gst.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <boost/asio.hpp>
+#include <boost/beast.hpp>
+#include "gstreamer/asio_glib_loop.hpp"
+#include "http/server.h"
+#include "utils/pipeline_descriptions.hpp"
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+using tcp = boost::asio::ip::tcp;
+using namespace std::chrono_literals;
+
+TEST(AsioGlibLoopTest, BothLoopsRunOnTheCallingThread) {
+    AsioGlibLoop loop;
+    std::thread::id asio_thread;
+    std::thread::id glib_thread;
+    int fired = 0;
+
+    boost::asio::steady_timer timer(loop.io_context(), 20ms);
+    timer.async_wait([&](boost::system::error_code) {
+        asio_thread = std::this_thread::get_id();
+        if (++fired == 2) {
+            loop.stop();
+        }
+    });
+    struct Fired {
+        AsioGlibLoop* loop;
+        std::thread::id* thread;
+        int* fired;
+    } glib_fired{&loop, &glib_thread, &fired};
+    GSource* timeout = g_timeout_source_new(10);
+    g_source_set_callback(timeout, [](gpointer data) -> gboolean {
+        auto* fired = static_cast<Fired*>(data);
+        *fired->thread = std::this_thread::get_id();
+        if (++*fired->fired == 2) {
+            fired->loop->stop();
+        }
+        return G_SOURCE_REMOVE;
+    }, &glib_fired, nullptr);
+    g_source_attach(timeout, loop.context());
+    g_source_unref(timeout);
+
+    loop.run();
+    EXPECT_EQ(fired, 2);
+    EXPECT_EQ(asio_thread, std::this_thread::get_id());
+    EXPECT_EQ(glib_thread, std::this_thread::get_id());
+}
+
+TEST(AsioGlibLoopTest, CallsFromOtherThreadsWakeGlib) {
+    AsioGlibLoop loop;
+    std::thread::id runner_thread;
+    std::atomic<std::thread::id> called_on{};
+    std::thread runner([&] {
+        runner_thread = std::this_thread::get_id();
+        loop.run();
+    });
+
+    // Le thread dort dans le réacteur Asio : l'appel doit le réveiller
+    std::this_thread::sleep_for(50ms);
+    g_main_context_invoke(loop.context(), [](gpointer data) -> gboolean {
+        static_cast<std::atomic<std::thread::id>*>(data)->store(std::this_thread::get_id());
+        return G_SOURCE_REMOVE;
+    }, &called_on);
+    for (int i = 0; i < 200 && called_on.load() == std::thread::id{}; ++i) {
+        std::this_thread::sleep_for(5ms);
+    }
+
+    loop.stop();
+    runner.join();
+    EXPECT_EQ(called_on.load(), runner_thread);
+}
+
+TEST(AsioGlibLoopTest, ServesHttpAndPipelineFromOneThread) {
+    gst_init(nullptr, nullptr);
+    AsioGlibLoop loop;
+    HttpServer server(loop.io_context(), tcp::endpoint{tcp::v4(), 0}, HEADLESS_PIPELINE_DESC, loop.context());
+    std::thread runner([&loop] { loop.run(); });
+
+    boost::asio::io_context ioc;
+    tcp::resolver resolver(ioc);
+    beast::tcp_stream stream(ioc);
+    stream.connect(resolver.resolve("127.0.0.1", std::to_string(server.port())));
+    beast::flat_buffer buffer;
+
+    // Le contrôle du pipeline passe par le même thread que la session HTTP
+    http::request<http::string_body> req{http::verb::put, "/elements/encode/properties/bitrate", 11};
+    req.set(http::field::host, "127.0.0.1");
+    req.body() = "1500";
+    req.prepare_payload();
+    http::write(stream, req);
+    http::response<http::string_body> res;
+    http::read(stream, buffer, res);
+    EXPECT_EQ(res.result(), http::status::ok);
+    EXPECT_EQ(res.body(), "1500\n");
+
+    http::request<http::string_body> get{http::verb::get, "/", 11};
+    get.set(http::field::host, "127.0.0.1");
+    http::write(stream, get);
+    res = {};
+    http::read(stream, buffer, res);
+    EXPECT_EQ(res.result(), http::status::ok);
+
+    beast::error_code ec;
+    stream.socket().shutdown(tcp::socket::shutdown_both, ec);
+    // L'arrêt attend la fin du flux : la boucle doit encore tourner
+    server.stop();
+    loop.stop();
+    runner.join();
+}
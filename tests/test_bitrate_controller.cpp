@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include "gstreamer/bitrate_controller.hpp"
+
+namespace {
+
+constexpr double kFrameIntervalUs = 1e6 / 30;
+constexpr double kPeriodS = 0.5;
+
+// Modèle de congestion synthétique : une caméra à 30 images/s, un encodeur
+// dont le coût par image croît avec le débit et la lenteur du preset, et un
+// lien de sortie de capacité fixe. Les deux files se remplissent quand le
+// débit d'entrée dépasse celui de sortie.
+struct SyntheticPipeline {
+    double link_kbps = 1e9;
+    // Part d'un cœur laissée à l'encodeur
+    double cpu_share = 1.0;
+
+    double input_frames = 0;
+    double input_capacity = 30;
+    double egress_kbit = 0;
+    double egress_capacity_kbit = 1000;
+
+    CongestionSample step(unsigned bitrate_kbps, int preset) {
+        const double encode_us = 1000.0 * preset * (1.0 + bitrate_kbps / 4000.0) / cpu_share;
+        const double encoded_fps = std::min(30.0 + input_frames / kPeriodS, 1e6 / encode_us);
+        input_frames = std::clamp(input_frames + (30.0 - encoded_fps) * kPeriodS, 0.0, input_capacity);
+        const double sent_kbit = std::min(egress_kbit + bitrate_kbps * kPeriodS, link_kbps * kPeriodS);
+        egress_kbit = std::clamp(egress_kbit + bitrate_kbps * kPeriodS - sent_kbit, 0.0, egress_capacity_kbit);
+        return {input_frames / input_capacity, egress_kbit / egress_capacity_kbit, encode_us, kFrameIntervalUs};
+    }
+
+    // Retard accumulé dans les deux files, en millisecondes
+    double latency_ms() const {
+        return input_frames * kFrameIntervalUs / 1000 + egress_kbit / std::min(link_kbps, 1e6) * 1000;
+    }
+};
+
+} // namespace
+
+TEST(BitrateControllerTest, EgressCongestionSettlesBelowLinkCapacity) {
+    SyntheticPipeline model;
+    model.link_kbps = 1500;
+    model.cpu_share = 4.0;
+    BitrateController controller({}, 4000, 3);
+
+    // Premier palier : 4000 -> 2800, assez grand pour une image clé
+    const BitrateDecision first = controller.update(model.step(4000, 3));
+    EXPECT_EQ(first.reason, "egress");
+    EXPECT_TRUE(first.force_key_unit);
+    EXPECT_LT(first.bitrate_kbps, 4000u);
+
+    double worst_latency = 0;
+    double worst_fill = 0;
+    for (int tick = 0; tick < 200; ++tick) {
+        const CongestionSample sample = model.step(controller.bitrate_kbps(), controller.speed_preset());
+        controller.update(sample);
+        if (tick >= 40) {
+            worst_latency = std::max(worst_latency, model.latency_ms());
+            worst_fill = std::max(worst_fill, sample.egress_fill);
+        }
+    }
+    // Une fois réglé, le débit oscille autour de la capacité du lien sans
+    // que la file ne se remplisse
+    EXPECT_LT(worst_fill, 0.75);
+    EXPECT_LT(worst_latency, 600.0);
+    EXPECT_LE(controller.bitrate_kbps(), 2000u);
+    EXPECT_GE(controller.bitrate_kbps(), 700u);
+    // Le lien était le seul goulot : preset intact
+    EXPECT_EQ(controller.speed_preset(), 3);
+}
+
+TEST(BitrateControllerTest, CpuContentionMovesToFasterPresetAndBack) {
+    SyntheticPipeline model;
+    BitrateController controller({}, 3000, 6);
+
+    for (int tick = 0; tick < 20; ++tick) {
+        controller.update(model.step(controller.bitrate_kbps(), controller.speed_preset()));
+    }
+    EXPECT_EQ(controller.speed_preset(), 6);
+
+    // Trois quarts du CPU pris par un voisin
+    model.cpu_share = 0.25;
+    double worst_latency = 0;
+    for (int tick = 0; tick < 60; ++tick) {
+        const CongestionSample sample = model.step(controller.bitrate_kbps(), controller.speed_preset());
+        controller.update(sample);
+        if (tick >= 20) {
+            worst_latency = std::max(worst_latency, model.latency_ms());
+        }
+    }
+    EXPECT_LT(controller.speed_preset(), 6);
+    // Plus d'images qui s'entassent devant l'encodeur
+    EXPECT_LT(worst_latency, 200.0);
+    EXPECT_LT(model.input_frames, 3.0);
+
+    // Le CPU revient : le preset d'origine d'abord, puis le débit
+    model.cpu_share = 1.0;
+    for (int tick = 0; tick < 200; ++tick) {
+        controller.update(model.step(controller.bitrate_kbps(), controller.speed_preset()));
+    }
+    EXPECT_EQ(controller.speed_preset(), 6);
+    EXPECT_GT(controller.bitrate_kbps(), 3000u);
+}
+
+TEST(BitrateControllerTest, ProbesUpToTheCeilingInSmallSteps) {
+    SyntheticPipeline model;
+    BitrateControllerConfig config;
+    config.max_kbps = 5000;
+    BitrateController controller(config, 2000, 2);
+
+    unsigned previous = controller.bitrate_kbps();
+    for (int tick = 0; tick < 100; ++tick) {
+        const BitrateDecision decision = controller.update(model.step(controller.bitrate_kbps(), controller.speed_preset()));
+        EXPECT_NE(decision.reason, "cpu");
+        EXPECT_NE(decision.reason, "egress");
+        // Des pas de 250 kbit/s : jamais d'image clé forcée
+        EXPECT_FALSE(decision.force_key_unit);
+        EXPECT_LE(decision.bitrate_kbps, previous + config.increase_kbps);
+        previous = decision.bitrate_kbps;
+    }
+    EXPECT_EQ(controller.bitrate_kbps(), 5000u);
+}
+
+TEST(BitrateControllerTest, NeverLeavesTheConfiguredRange) {
+    SyntheticPipeline model;
+    model.link_kbps = 50;
+    BitrateControllerConfig config;
+    config.min_kbps = 300;
+    BitrateController controller(config, 20000, -1);
+    EXPECT_EQ(controller.bitrate_kbps(), config.max_kbps);
+
+    for (int tick = 0; tick < 50; ++tick) {
+        controller.update(model.step(controller.bitrate_kbps(), 3));
+    }
+    EXPECT_EQ(controller.bitrate_kbps(), 300u);
+    // Pas de speed-preset sur cet encodeur : on n'y touche pas
+    EXPECT_EQ(controller.speed_preset(), -1);
+}
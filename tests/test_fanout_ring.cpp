@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+#include <gst/gst.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "gstreamer/fanout_ring.hpp"
+
+namespace {
+
+GstBuffer* make_buffer(bool keyframe, guint64 offset) {
+    GstBuffer* buffer = gst_buffer_new_allocate(nullptr, 188, nullptr);
+    GST_BUFFER_OFFSET(buffer) = offset;
+    if (!keyframe) {
+        GST_BUFFER_FLAG_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+    }
+    return buffer;
+}
+
+void publish(FanoutRing& ring, bool keyframe, guint64 offset) {
+    GstBuffer* buffer = make_buffer(keyframe, offset);
+    ring.publish(buffer);
+    gst_buffer_unref(buffer);
+}
+
+} // namespace
+
+TEST(FanoutRingTest, ReadersKeepTheirOwnCursor) {
+    gst_init(nullptr, nullptr);
+    FanoutRing ring(8);
+    FanoutReader a(ring, 7);
+    publish(ring, true, 0);
+    publish(ring, false, 1);
+    FanoutReader b(ring, 7);
+    publish(ring, false, 2);
+
+    // Les deux lecteurs démarrent sur la même image clé
+    for (guint64 i = 0; i < 3; ++i) {
+        GstBuffer* buffer = a.next();
+        ASSERT_NE(buffer, nullptr);
+        EXPECT_EQ(GST_BUFFER_OFFSET(buffer), i);
+        gst_buffer_unref(buffer);
+    }
+    EXPECT_EQ(a.next(), nullptr);
+
+    GstBuffer* first = b.next();
+    ASSERT_NE(first, nullptr);
+    EXPECT_EQ(GST_BUFFER_OFFSET(first), 0u);
+    gst_buffer_unref(first);
+}
+
+TEST(FanoutRingTest, OverwrittenReaderResumesOnKeyframe) {
+    gst_init(nullptr, nullptr);
+    FanoutRing ring(4);
+    EXPECT_EQ(ring.capacity(), 4u);
+    FanoutReader reader(ring, 3);
+
+    publish(ring, true, 0);
+    for (guint64 i = 1; i < 10; ++i) {
+        publish(ring, i == 7, i);
+    }
+    // Le lecteur a été dépassé : il reprend à l'image clé 7
+    GstBuffer* buffer = reader.next();
+    ASSERT_NE(buffer, nullptr);
+    EXPECT_EQ(GST_BUFFER_OFFSET(buffer), 7u);
+    EXPECT_EQ(reader.skipped(), 7u);
+    gst_buffer_unref(buffer);
+}
+
+TEST(FanoutRingTest, ReleasesOverwrittenBuffers) {
+    gst_init(nullptr, nullptr);
+    GstBuffer* buffer = make_buffer(true, 0);
+    {
+        FanoutRing ring(2);
+        ring.publish(buffer);
+        EXPECT_EQ(GST_MINI_OBJECT_REFCOUNT_VALUE(buffer), 2);
+        publish(ring, false, 1);
+        publish(ring, false, 2);
+        EXPECT_EQ(GST_MINI_OBJECT_REFCOUNT_VALUE(buffer), 1);
+        ring.publish(buffer);
+    }
+    EXPECT_EQ(GST_MINI_OBJECT_REFCOUNT_VALUE(buffer), 1);
+    gst_buffer_unref(buffer);
+}
+
+TEST(FanoutRingTest, ConcurrentReadersNeverSeeFreedBuffers) {
+    gst_init(nullptr, nullptr);
+    FanoutRing ring(16);
+    std::atomic<bool> done{false};
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 4; ++r) {
+        readers.emplace_back([&ring, &done] {
+            FanoutReader reader(ring, 8);
+            guint64 last = 0;
+            bool started = false;
+            while (!done.load()) {
+                if (GstBuffer* buffer = reader.next()) {
+                    // Les offsets ne reculent jamais
+                    if (started) {
+                        EXPECT_GT(GST_BUFFER_OFFSET(buffer), last);
+                    }
+                    last = GST_BUFFER_OFFSET(buffer);
+                    started = true;
+                    gst_buffer_unref(buffer);
+                }
+            }
+        });
+    }
+    for (guint64 i = 0; i < 20000; ++i) {
+        publish(ring, i % 30 == 0, i);
+    }
+    done = true;
+    for (auto& t : readers) {
+        t.join();
+    }
+}
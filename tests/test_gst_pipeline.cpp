@@ -1,15 +1,59 @@
 #include <gtest/gtest.h>
 #include <gst/gst.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <thread>
+#include <vector>
+#include "gstreamer/gst_pipeline.hpp"
+#include "gstreamer/main_loop_thread.hpp"
+#include "utils/buffer_probe.hpp"
+#include "utils/log_capture.hpp"
 #include "utils/pipeline_descriptions.hpp"
 
+namespace {
+
+constexpr auto kLifecycleTimeout = std::chrono::seconds(30);
+
+// Attend un événement du bus sans jamais bloquer au-delà du délai.
+LifecycleEvent await(std::future<LifecycleEvent> future) {
+    if (future.wait_for(kLifecycleTimeout) != std::future_status::ready) {
+        ADD_FAILURE() << "lifecycle event timed out";
+        return {LifecycleEvent::Status::Error, GST_STATE_VOID_PENDING, "timeout"};
+    }
+    return future.get();
+}
+
+// Un rappel perdu fait échouer le test au lieu de bloquer la suite.
+ControlResult await(std::future<ControlResult> future) {
+    if (future.wait_for(kLifecycleTimeout) != std::future_status::ready) {
+        ADD_FAILURE() << "control call timed out";
+        return {ControlResult::Status::Rejected, "timeout"};
+    }
+    return future.get();
+}
+
+ControlResult await(GstPipelineWrapper& pipeline, void (GstPipelineWrapper::*call)(std::string, std::string, std::string, GstPipelineWrapper::ControlCallback),
+                    std::string element, std::string property, std::string value) {
+    auto promise = std::make_shared<std::promise<ControlResult>>();
+    auto future = promise->get_future();
+    (pipeline.*call)(std::move(element), std::move(property), std::move(value),
+                     [promise](ControlResult result) { promise->set_value(std::move(result)); });
+    return await(std::move(future));
+}
+
+} // namespace
+
 
 TEST(MypassthroughTest, PipelineInit) {
     gst_init(nullptr, nullptr);
 
     // Crée un pipeline simple avec mypassthrough
     GstElement *pipeline = gst_parse_launch(
-        "fakesrc num-buffers=1 ! mypassthrough ! fakesink", nullptr);
+        "videotestsrc num-buffers=1 ! mypassthrough ! fakesink", nullptr);
 
     ASSERT_NE(pipeline, nullptr);
 
@@ -31,77 +75,324 @@ TEST(MypassthroughTest, PipelineInit) {
     gst_object_unref(pipeline);
 }
 
-void gstreamer_set_bitrate(GstElement *pipeline, const guint trackIndex, guint bitrate) {
-    GstElement *enc = gst_bin_get_by_name(GST_BIN(pipeline), "encode");
-    guint old_bitrate = 0;
-    if (enc != NULL) {
-        g_object_get(enc, "bitrate", &old_bitrate, NULL);
-        g_object_set(enc, "bitrate", bitrate, NULL);
-        GST_INFO("set bitrate of track %d from %d to %d successfully!", trackIndex, old_bitrate, bitrate);
-        gst_object_unref(enc);
+// Joue `description` jusqu'à EOS et rend le compteur "copies" de l'élément "f".
+guint run_and_count_copies(const char *description) {
+    gst_init(nullptr, nullptr);
+    GstElement *pipeline = gst_parse_launch(description, nullptr);
+    EXPECT_NE(pipeline, nullptr);
+    if (!pipeline) return G_MAXUINT;
+
+    gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    GstBus *bus = gst_element_get_bus(pipeline);
+    GstMessage *msg = gst_bus_timed_pop_filtered(
+        bus, 30 * GST_SECOND, (GstMessageType)(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+    EXPECT_NE(msg, nullptr);
+    if (msg) {
+        EXPECT_EQ(GST_MESSAGE_TYPE(msg), GST_MESSAGE_EOS);
+        gst_message_unref(msg);
+    }
+
+    guint copies = G_MAXUINT;
+    GstElement *filter = gst_bin_get_by_name(GST_BIN(pipeline), "f");
+    if (filter) {
+        g_object_get(filter, "copies", &copies, NULL);
+        gst_object_unref(filter);
     }
+    gst_object_unref(bus);
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    gst_object_unref(pipeline);
+    return copies;
 }
 
-TEST(MypassthroughTest, ChangeBitrate) {
-    gst_init(nullptr, nullptr);
+TEST(MypassthroughTest, InPlaceOn4KDoesNotCopy) {
+    // Le buffer amont n'est référencé que par nous : écriture en place
+    EXPECT_EQ(run_and_count_copies(
+                  "videotestsrc num-buffers=5 ! video/x-raw,format=NV12,width=3840,height=2160 "
+                  "! mypassthrough name=f contrast=1.2 ! fakesink"),
+              0u);
+}
 
-    // Pipeline avec x264enc nommé "encode"
-    GstElement *pipeline = gst_parse_launch(
-        "videotestsrc num-buffers=10 ! videoconvert ! x264enc name=encode tune=zerolatency bitrate=2000 speed-preset=superfast ! fakesink",
-        nullptr);
+TEST(MypassthroughTest, CountsCopiesOfSharedBuffers) {
+    // Derrière un tee, l'appsink garde une référence sur chaque buffer :
+    // il est partagé, on doit le copier avant d'écrire
+    EXPECT_EQ(run_and_count_copies(
+                  "videotestsrc num-buffers=5 ! video/x-raw,format=I420,width=320,height=240 ! tee name=t "
+                  "t. ! queue ! mypassthrough name=f contrast=1.2 ! fakesink "
+                  "t. ! queue ! appsink sync=false wait-on-eos=false"),
+              5u);
+}
 
+TEST(MypassthroughTest, StatsAreReadableWhileStreaming) {
+    gst_init(nullptr, nullptr);
+    GstElement *pipeline = gst_parse_launch(
+        "videotestsrc num-buffers=30 is-live=true ! video/x-raw,format=I420,width=320,height=240,framerate=30/1 "
+        "! mypassthrough name=f measure=true ! fakesink sync=true", nullptr);
     ASSERT_NE(pipeline, nullptr);
-
-    // Met le pipeline en état PLAYING pour s'assurer que tous les éléments sont prêts
+    GstElement *filter = gst_bin_get_by_name(GST_BIN(pipeline), "f");
     gst_element_set_state(pipeline, GST_STATE_PLAYING);
 
-    // Attend que le pipeline atteigne l'état PLAYING
-    GstStateChangeReturn ret = gst_element_get_state(pipeline, NULL, NULL, GST_CLOCK_TIME_NONE);
-    ASSERT_TRUE(ret == GST_STATE_CHANGE_SUCCESS || ret == GST_STATE_CHANGE_ASYNC);
+    // Lecture en boucle pendant le flux : ne doit jamais bloquer le streaming
+    GstBus *bus = gst_element_get_bus(pipeline);
+    GstMessage *msg = nullptr;
+    while (!(msg = gst_bus_timed_pop_filtered(bus, 10 * GST_MSECOND,
+                                              (GstMessageType)(GST_MESSAGE_EOS | GST_MESSAGE_ERROR)))) {
+        GstStructure *stats = nullptr;
+        g_object_get(filter, "stats", &stats, NULL);
+        ASSERT_NE(stats, nullptr);
+        gst_structure_free(stats);
+    }
+    EXPECT_EQ(GST_MESSAGE_TYPE(msg), GST_MESSAGE_EOS);
+    gst_message_unref(msg);
+
+    GstStructure *stats = nullptr;
+    g_object_get(filter, "stats", &stats, NULL);
+    guint64 buffers = 0, lag_samples = 0;
+    gdouble interval = 0;
+    EXPECT_TRUE(gst_structure_get_uint64(stats, "buffers", &buffers));
+    EXPECT_TRUE(gst_structure_get_uint64(stats, "lag-samples", &lag_samples));
+    EXPECT_TRUE(gst_structure_get_double(stats, "interarrival-mean-us", &interval));
+    EXPECT_TRUE(gst_structure_has_field(stats, "size-histogram"));
+    EXPECT_EQ(buffers, 30u);
+    EXPECT_EQ(lag_samples, 30u);
+    // Source live à 30 images/s : environ 33 ms entre deux buffers
+    EXPECT_NEAR(interval, 33333.0, 10000.0);
+    gst_structure_free(stats);
+
+    gst_object_unref(filter);
+    gst_object_unref(bus);
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    gst_object_unref(pipeline);
+}
+
+TEST(MypassthroughTest, ChangeBitrate) {
+    auto loop = std::make_unique<MainLoopThread>();
+    GstPipelineWrapper pipeline(
+        "videotestsrc num-buffers=10 ! videoconvert ! x264enc name=encode tune=zerolatency bitrate=2000 speed-preset=superfast ! fakesink",
+        loop->context());
+
+    // Attend le vrai STATE_CHANGED vers PLAYING, pas un get_state bloquant
+    LifecycleEvent started = await(pipeline.start_async());
+    ASSERT_EQ(started.status, LifecycleEvent::Status::Reached) << started.message;
+    EXPECT_EQ(started.state, GST_STATE_PLAYING);
 
     // Change le bitrate à 1000
-    gstreamer_set_bitrate(pipeline, 0, 1000);
+    ControlResult result = await(pipeline, &GstPipelineWrapper::set_property_async, "encode", "bitrate", "1000");
+    EXPECT_EQ(result.status, ControlResult::Status::Ok);
+    EXPECT_EQ(result.message, "1000");
 
-    GstElement *enc = gst_bin_get_by_name(GST_BIN(pipeline), "encode");
-    ASSERT_NE(enc, nullptr);
-    guint current_bitrate = 0;
-    g_object_get(enc, "bitrate", &current_bitrate, NULL);
-    EXPECT_EQ(current_bitrate, 1000u);
-    gst_object_unref(enc);
+    EXPECT_EQ(await(pipeline.end_of_stream_async()).status, LifecycleEvent::Status::Eos);
+    EXPECT_EQ(await(pipeline.stop_async()).status, LifecycleEvent::Status::Reached);
 
-    // Nettoyage
-    gst_element_set_state(pipeline, GST_STATE_NULL);
-    gst_object_unref(pipeline);
+    // Nettoyage : la boucle s'arrête avant le pipeline
+    loop.reset();
 }
 
-TEST(MypassthroughTest, ChangeBitrateVisual) {
-    gst_init(nullptr, nullptr);
+TEST(MypassthroughTest, LifecycleReportsErrors) {
+    auto loop = std::make_unique<MainLoopThread>();
+    GstPipelineWrapper pipeline("filesrc location=/nonexistent/input.ts ! fakesink", loop->context());
 
-    // Pipeline qui affiche la vidéo encodée/décodée dans une fenêtre
-    GstElement *pipeline = gst_parse_launch(
-    "videotestsrc is-live=false num-buffers=1000 ! video/x-raw,framerate=30/1 ! videoconvert ! x264enc tune=zerolatency bitrate=2000 key-int-max=30 ! mp4mux ! filesink location=output1.mp4",
-        NULL);
+    LifecycleEvent started = await(pipeline.start_async());
+    EXPECT_EQ(started.status, LifecycleEvent::Status::Error);
+    EXPECT_FALSE(started.message.empty());
 
-    ASSERT_NE(pipeline, nullptr);
+    // Une attente de fin posée après coup est résolue tout de suite
+    EXPECT_EQ(await(pipeline.end_of_stream_async()).status, LifecycleEvent::Status::Error);
+    EXPECT_EQ(await(pipeline.stop_async()).status, LifecycleEvent::Status::Reached);
+    loop.reset();
+}
 
-    gst_element_set_state(pipeline, GST_STATE_PLAYING);
+TEST(MypassthroughTest, SendEosEndsLivePipeline) {
+    auto loop = std::make_unique<MainLoopThread>();
+    // Source live : sans EOS explicite, le flux ne s'arrête jamais
+    GstPipelineWrapper pipeline("videotestsrc is-live=true ! mypassthrough ! fakesink sync=false", loop->context());
+
+    ASSERT_EQ(await(pipeline.start_async()).status, LifecycleEvent::Status::Reached);
+    EXPECT_EQ(await(pipeline.send_eos_async()).status, LifecycleEvent::Status::Eos);
+    // Déjà terminé : la réponse est immédiate
+    EXPECT_EQ(await(pipeline.send_eos_async()).status, LifecycleEvent::Status::Eos);
+    EXPECT_EQ(await(pipeline.stop_async()).status, LifecycleEvent::Status::Reached);
+    loop.reset();
+}
 
-    // Attend que le pipeline atteigne l'état PLAYING
-    GstStateChangeReturn ret = gst_element_get_state(pipeline, NULL, NULL, GST_CLOCK_TIME_NONE);
-    ASSERT_TRUE(ret == GST_STATE_CHANGE_SUCCESS || ret == GST_STATE_CHANGE_ASYNC);
+TEST(MypassthroughTest, GstDebugGoesThroughLogger) {
+    LogCapture capture;
+    auto loop = std::make_unique<MainLoopThread>();
+    GstPipelineWrapper pipeline("videotestsrc num-buffers=5 ! mypassthrough ! fakesink sync=false", loop->context());
+    // Comme GST_DEBUG=mypassthrough:4, posé après gst_init
+    gst_debug_set_active(TRUE);
+    gst_debug_set_threshold_for_name("mypassthrough", GST_LEVEL_INFO);
+
+    ASSERT_EQ(await(pipeline.start_async()).status, LifecycleEvent::Status::Reached);
+    EXPECT_EQ(await(pipeline.end_of_stream_async()).status, LifecycleEvent::Status::Eos);
+    EXPECT_EQ(await(pipeline.stop_async()).status, LifecycleEvent::Status::Reached);
+    loop.reset();
+    gst_debug_set_threshold_for_name("mypassthrough", GST_LEVEL_NONE);
+
+    const auto text = capture.text();
+    EXPECT_NE(text.find("[GStreamer] Pipeline state changed from=PAUSED to=PLAYING"), std::string::npos);
+    EXPECT_NE(text.find("[gst] category=mypassthrough object=mypassthrough0"), std::string::npos) << text;
+    EXPECT_NE(text.find("text=\"arrêt après 0 copie(s)\""), std::string::npos) << text;
+}
 
-    // Attend 2 secondes à bitrate 2000
-    g_usleep(2 * G_USEC_PER_SEC);
+TEST(MypassthroughTest, AdaptiveBitrateBacksOffUnderEgressCongestion) {
+    auto loop = std::make_unique<MainLoopThread>();
+    GstPipelineWrapper pipeline(
+        "videotestsrc is-live=true ! video/x-raw,width=320,height=240,framerate=30/1 ! queue name=encqueue "
+        "! x264enc name=encode tune=zerolatency bitrate=4000 key-int-max=300 "
+        "! queue name=egress max-size-buffers=30 max-size-bytes=0 max-size-time=0 ! fakesink name=out sync=false",
+        loop->context());
+
+    // Lien de sortie synthétique à ~500 kbit/s : l'entrée du fakesink dort au
+    // prorata de la taille de chaque buffer
+    GstElement* out = pipeline.element("out");
+    ASSERT_NE(out, nullptr);
+    GstPad* pad = gst_element_get_static_pad(out, "sink");
+    gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, [](GstPad*, GstPadProbeInfo* info, gpointer) {
+        g_usleep(gst_buffer_get_size(GST_PAD_PROBE_INFO_BUFFER(info)) * 8 * G_USEC_PER_SEC / 500000);
+        return GST_PAD_PROBE_OK;
+    }, nullptr, nullptr);
+    gst_object_unref(pad);
+    gst_object_unref(out);
+
+    // Une fois sous 1000 kbit/s, on laisse la file se vider pendant
+    // kSettle décisions puis on observe son remplissage pendant autant
+    constexpr std::size_t kSettle = 10;
+    std::mutex lock;
+    std::vector<BitrateDecision> decisions;
+    std::size_t below_at = 0;
+    double worst_late_fill = 0;
+    std::promise<void> settled;
+    AdaptiveBitrateConfig config;
+    config.input_queues = {"encqueue"};
+    config.egress_queue = "egress";
+    config.interval_ms = 200;
+    config.on_decision = [&](const CongestionSample& sample, const BitrateDecision& decision) {
+        std::lock_guard<std::mutex> guard(lock);
+        decisions.push_back(decision);
+        if (below_at == 0) {
+            if (decision.bitrate_kbps < 1000) {
+                below_at = decisions.size();
+            }
+            return;
+        }
+        if (decisions.size() > below_at + kSettle) {
+            worst_late_fill = std::max(worst_late_fill, sample.egress_fill);
+        }
+        if (decisions.size() == below_at + 2 * kSettle) {
+            settled.set_value();
+        }
+    };
+    ASSERT_TRUE(pipeline.enable_adaptive_bitrate(config));
+
+    ASSERT_EQ(await(pipeline.start_async()).status, LifecycleEvent::Status::Reached);
+    EXPECT_EQ(settled.get_future().wait_for(kLifecycleTimeout), std::future_status::ready)
+        << "le débit n'est pas passé sous 1000 kbit/s";
+    EXPECT_EQ(await(pipeline.stop_async()).status, LifecycleEvent::Status::Reached);
+    loop.reset();
+
+    // Le débit a reculé sous la capacité du lien, une image clé suivant le
+    // premier grand pas, et la file de sortie ne déborde plus
+    auto first_step = std::find_if(decisions.begin(), decisions.end(),
+                                   [](const BitrateDecision& decision) { return decision.bitrate_changed; });
+    ASSERT_NE(first_step, decisions.end());
+    EXPECT_EQ(first_step->reason, "egress");
+    EXPECT_TRUE(first_step->force_key_unit);
+    EXPECT_LT(decisions.back().bitrate_kbps, 1000u);
+    EXPECT_LT(worst_late_fill, 1.0);
+}
 
-    // Change le bitrate à 500 (devrait dégrader la qualité)
-    gstreamer_set_bitrate(pipeline, 0, 500);
+TEST(MypassthroughTest, AdaptiveBitrateRejectsMissingElements) {
+    auto loop = std::make_unique<MainLoopThread>();
+    GstPipelineWrapper pipeline("videotestsrc ! queue name=q ! x264enc name=encode ! fakesink name=sink", loop->context());
+
+    AdaptiveBitrateConfig config;
+    config.encoder = "nope";
+    EXPECT_FALSE(pipeline.enable_adaptive_bitrate(config));
+    config.encoder = "encode";
+    config.egress_queue = "sink";
+    EXPECT_FALSE(pipeline.enable_adaptive_bitrate(config));
+    config.egress_queue = "q";
+    EXPECT_TRUE(pipeline.enable_adaptive_bitrate(config));
+    pipeline.disable_adaptive_bitrate();
+    loop.reset();
+}
 
-    // Attend 3 secondes pour voir l'effet
-    g_usleep(10 * G_USEC_PER_SEC);
+TEST(MypassthroughTest, KeyUnitRequestsAreCoalescedAndRateLimited) {
+    auto loop = std::make_unique<MainLoopThread>();
+    GstPipelineWrapper pipeline(
+        "videotestsrc is-live=true ! video/x-raw,width=320,height=240,framerate=30/1 "
+        "! x264enc name=encode tune=zerolatency key-int-max=600 speed-preset=ultrafast ! fakesink sync=false",
+        loop->context());
+    ASSERT_TRUE(pipeline.enable_key_unit_requests({}));
+
+    // Compte les images clés qui sortent de l'encodeur
+    GstElement* encoder = pipeline.element("encode");
+    ASSERT_NE(encoder, nullptr);
+    std::atomic<int> keyframes{0};
+    GstPad* pad = gst_element_get_static_pad(encoder, "src");
+    gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, [](GstPad*, GstPadProbeInfo* info, gpointer data) {
+        if (!GST_BUFFER_FLAG_IS_SET(GST_PAD_PROBE_INFO_BUFFER(info), GST_BUFFER_FLAG_DELTA_UNIT)) {
+            ++*static_cast<std::atomic<int>*>(data);
+        }
+        return GST_PAD_PROBE_OK;
+    }, &keyframes, nullptr);
+    gst_object_unref(pad);
+
+    auto request = [&pipeline](bool accept_cached) {
+        auto promise = std::make_shared<std::promise<ControlResult>>();
+        pipeline.request_key_unit_async(accept_cached, [promise](ControlResult result) { promise->set_value(std::move(result)); });
+        return promise->get_future();
+    };
+
+    ASSERT_EQ(await(pipeline.start_async()).status, LifecycleEvent::Status::Reached);
+    ASSERT_TRUE(wait_for_buffers(encoder, 10));
+
+    // Un retardataire qui a déjà le GOP en cours en part, sans nouvelle image clé
+    EXPECT_EQ(await(request(true)).message, "cached");
+
+    // Vingt demandes simultanées : une seule image clé, pas avant une seconde
+    // après la première
+    const int before = keyframes.load();
+    const auto burst_start = std::chrono::steady_clock::now();
+    std::vector<std::future<ControlResult>> burst;
+    for (int i = 0; i < 20; ++i) {
+        burst.push_back(request(false));
+    }
+    for (auto& result : burst) {
+        EXPECT_EQ(await(std::move(result)).message, "key unit requested");
+    }
+    EXPECT_GE(std::chrono::steady_clock::now() - burst_start, std::chrono::milliseconds(300));
+
+    // La suivante attend l'intervalle minimal
+    const auto again = std::chrono::steady_clock::now();
+    EXPECT_EQ(await(request(false)).status, ControlResult::Status::Ok);
+    EXPECT_GE(std::chrono::steady_clock::now() - again, std::chrono::milliseconds(900));
+    EXPECT_TRUE(wait_for_buffers(encoder, 10));
+    EXPECT_EQ(keyframes.load() - before, 2);
+
+    gst_object_unref(encoder);
+    EXPECT_EQ(await(pipeline.stop_async()).status, LifecycleEvent::Status::Reached);
+    loop.reset();
+}
+
+TEST(MypassthroughTest, ChangeBitrateVisual) {
+    auto loop = std::make_unique<MainLoopThread>();
+    GstPipelineWrapper pipeline(
+    "videotestsrc is-live=false num-buffers=1000 ! video/x-raw,framerate=30/1 ! videoconvert ! x264enc name=encode tune=zerolatency bitrate=2000 key-int-max=30 ! mp4mux ! filesink location=output1.mp4",
+        loop->context());
+
+    ASSERT_EQ(await(pipeline.start_async()).status, LifecycleEvent::Status::Reached);
+
+    // Change le bitrate à 500 (devrait dégrader la qualité) pendant l'encodage
+    ControlResult result = await(pipeline, &GstPipelineWrapper::set_property_async, "encode", "bitrate", "500");
+    EXPECT_EQ(result.status, ControlResult::Status::Ok);
+
+    // Le fichier est complet à l'EOS, ni avant ni bien après
+    EXPECT_EQ(await(pipeline.end_of_stream_async()).status, LifecycleEvent::Status::Eos);
 
     // Nettoyage
-    gst_element_set_state(pipeline, GST_STATE_NULL);
-    gst_object_unref(pipeline);
+    EXPECT_EQ(await(pipeline.stop_async()).status, LifecycleEvent::Status::Reached);
+    loop.reset();
 }
 
 void run_pipeline_with_bitrate(const char* output_file, int bitrate_kbps) {
@@ -173,22 +464,21 @@ TEST(MypassthroughTest, ChangeBitrateVisual_LiveWindow) {
     // Set pipeline to PLAYING
     gst_element_set_state(pipeline, GST_STATE_PLAYING);
 
-    // Wait until pipeline is playing
-    GstStateChangeReturn ret = gst_element_get_state(pipeline, NULL, NULL, GST_CLOCK_TIME_NONE);
-    ASSERT_TRUE(ret == GST_STATE_CHANGE_SUCCESS || ret == GST_STATE_CHANGE_ASYNC);
+    // Wait for the first encoded frame rather than for the state change
+    ASSERT_TRUE(wait_for_buffers(encoder, 1));
 
     std::cout << "Pipeline running at bitrate 2000..." << std::endl;
 
-    // Let it play at 2000 kbps for 5 seconds
-    g_usleep(5 * G_USEC_PER_SEC);
+    // Let it play at 2000 kbps for two GOPs
+    ASSERT_TRUE(wait_for_buffers(encoder, 60));
 
     std::cout << "Changing bitrate to 500..." << std::endl;
 
     // Change bitrate property
     g_object_set(G_OBJECT(encoder), "bitrate", 500, NULL);
 
-    // Let it play at 500 kbps for 10 seconds
-    g_usleep(10 * G_USEC_PER_SEC);
+    // Let it play at 500 kbps for two GOPs
+    ASSERT_TRUE(wait_for_buffers(encoder, 60));
 
     std::cout << "Test done, stopping pipeline..." << std::endl;
 
@@ -215,9 +505,8 @@ TEST(MypassthroughTest, ChangeBitrateVisual_LiveWindow_Threaded) {
     // Set pipeline to PLAYING
     gst_element_set_state(pipeline, GST_STATE_PLAYING);
 
-    // Wait until pipeline is playing
-    GstStateChangeReturn ret = gst_element_get_state(pipeline, NULL, NULL, GST_CLOCK_TIME_NONE);
-    ASSERT_TRUE(ret == GST_STATE_CHANGE_SUCCESS || ret == GST_STATE_CHANGE_ASYNC);
+    // Wait for the first encoded frame rather than for the state change
+    ASSERT_TRUE(wait_for_buffers(encoder, 1));
 
     std::cout << "Pipeline running at bitrate 6000..." << std::endl;
 
@@ -229,20 +518,20 @@ TEST(MypassthroughTest, ChangeBitrateVisual_LiveWindow_Threaded) {
         g_main_loop_run(loop);
     });
 
-    std::this_thread::sleep_for(std::chrono::seconds(10));
+    ASSERT_TRUE(wait_for_buffers(encoder, 60));
 
     std::cout << "Changing bitrate to 200..." << std::endl;
 
     // Change bitrate property
     g_object_set(G_OBJECT(encoder), "bitrate", 200, NULL);
 
-    std::this_thread::sleep_for(std::chrono::seconds(10));
+    ASSERT_TRUE(wait_for_buffers(encoder, 60));
 
     std::cout << "Changing bitrate to 6000..." << std::endl;
 
     g_object_set(G_OBJECT(encoder), "bitrate", 6000, NULL);
 
-    std::this_thread::sleep_for(std::chrono::seconds(10));
+    EXPECT_TRUE(wait_for_buffers(encoder, 60));
 
     std::cout << "Test done, stopping pipeline..." << std::endl;
 
@@ -260,8 +549,7 @@ TEST(MypassthroughTest, ChangeBitrateVisual_LiveWindow_Threaded) {
 TEST(MypassthroughTest, ChangeBitrateAndForceKeyUnit) {
     gst_init(nullptr, nullptr);
 
-    extern const char* LIVE_WINDOW_PIPELINE_DESC;
-    GstElement *pipeline = gst_parse_launch(LIVE_WINDOW_PIPELINE_DESC, NULL);
+    GstElement *pipeline = gst_parse_launch(LIVE_WINDOW_LONG_GOP_PIPELINE_DESC, NULL);
 
     ASSERT_NE(pipeline, nullptr);
 
@@ -272,20 +560,19 @@ TEST(MypassthroughTest, ChangeBitrateAndForceKeyUnit) {
     // Set pipeline to PLAYING
     gst_element_set_state(pipeline, GST_STATE_PLAYING);
 
-    // Wait until pipeline is playing
-    GstStateChangeReturn ret = gst_element_get_state(pipeline, NULL, NULL, GST_CLOCK_TIME_NONE);
-    ASSERT_TRUE(ret == GST_STATE_CHANGE_SUCCESS || ret == GST_STATE_CHANGE_ASYNC);
+    // Wait for the first encoded frame rather than for the state change
+    ASSERT_TRUE(wait_for_buffers(encoder, 1));
 													
     std::cout << "Pipeline running at bitrate 6000..." << std::endl;
 
-    g_usleep(3 * G_USEC_PER_SEC);
+    ASSERT_TRUE(wait_for_buffers(encoder, 30));
 
     // Change bitrate property
     g_object_set(G_OBJECT(encoder), "bitrate", 200, NULL);
     std::cout << "Changed bitrate to 200." << std::endl;
 
-    // Wait a bit
-    g_usleep(10 * G_USEC_PER_SEC);
+    // Let the encoder settle at the new bitrate
+    ASSERT_TRUE(wait_for_buffers(encoder, 30));
 
     // Send GstForceKeyUnit event on encoder src pad
     GstPad *pad = gst_element_get_static_pad(encoder, "src");
@@ -305,13 +592,15 @@ TEST(MypassthroughTest, ChangeBitrateAndForceKeyUnit) {
     gboolean res = gst_pad_send_event(pad, event);
     EXPECT_TRUE(res);
 
-    g_usleep(2 * G_USEC_PER_SEC);
+    // The forced IDR must show up well before the next natural one: about two
+    // seconds in, with key-int-max=300 that is still eight seconds away
+    EXPECT_TRUE(wait_for_buffers(encoder, 1, true, 900));
 
 
     gst_object_unref(pad);
 
     // Let it play a bit more
-    g_usleep(3 * G_USEC_PER_SEC);
+    EXPECT_TRUE(wait_for_buffers(encoder, 30));
 
     // Cleanup
     gst_element_set_state(pipeline, GST_STATE_NULL);
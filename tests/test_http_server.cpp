@@ -1,9 +1,19 @@
 #include <gtest/gtest.h>
 #include <thread>
 #include <chrono>
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
 #include <boost/asio.hpp>
 #include <boost/beast.hpp>
 #include "../src/http/server.h"
+#include "logging/logger.h"
+#include "utils/alloc_counter.hpp"
+#include "utils/buffer_probe.hpp"
+#include "utils/log_capture.hpp"
 #include "utils/pipeline_descriptions.hpp"
 
 
@@ -13,17 +23,10 @@ using tcp = boost::asio::ip::tcp;
 
 TEST(HttpServerTest, BasicGet) {
     // Lancer le serveur dans un thread séparé
-    std::thread server_thread([]{
-        boost::asio::io_context ioc;
-        tcp::endpoint endpoint{tcp::v4(), 8081};
-        HttpServer server(ioc, endpoint, LIVE_WINDOW_PIPELINE_DESC);
-        std::cout << "[Test] Server started on port 8081" << std::endl;
-        ioc.run();
-    });
-
-    // Attendre que le serveur démarre
-    std::this_thread::sleep_for(std::chrono::milliseconds(2000));
-    std::cout << "[Test] Server should be ready, proceeding with client request" << std::endl;
+    boost::asio::io_context server_ioc;
+    HttpServer server(server_ioc, tcp::endpoint{tcp::v4(), 8081}, LIVE_WINDOW_PIPELINE_DESC);
+    std::thread server_thread([&server_ioc] { server_ioc.run(); });
+    std::cout << "[Test] Server started on port 8081" << std::endl;
 
     // Effectuer une requête HTTP GET
     boost::asio::io_context ioc;
@@ -57,7 +60,617 @@ TEST(HttpServerTest, BasicGet) {
     stream.socket().shutdown(tcp::socket::shutdown_both, ec);
     std::cout << "[Test] Connection closed" << std::endl;
 
-    // Arrêter le serveur (dans un vrai projet, prévoir un mécanisme d'arrêt propre)
-    server_thread.detach(); // ou std::terminate() si besoin
-    std::cout << "[Test] Server thread detached" << std::endl;
-}
\ No newline at end of file
+    // Arrêter le serveur : son io_context n'a plus rien à faire et run() rend la main
+    server.stop();
+    server_thread.join();
+    std::cout << "[Test] Server stopped" << std::endl;
+}
+
+TEST(HttpServerTest, KeepAliveReusesConnection) {
+    boost::asio::io_context server_ioc;
+    HttpServer server(server_ioc, tcp::endpoint{tcp::v4(), 8082}, HEADLESS_PIPELINE_DESC);
+    std::thread server_thread([&server_ioc] { server_ioc.run(); });
+
+    boost::asio::io_context ioc;
+    tcp::resolver resolver(ioc);
+    beast::tcp_stream stream(ioc);
+    stream.connect(resolver.resolve("127.0.0.1", "8082"));
+
+    // Plusieurs requêtes successives sur la même connexion TCP
+    beast::flat_buffer buffer;
+    for (int i = 0; i < 3; ++i) {
+        http::request<http::string_body> req{http::verb::get, "/", 11};
+        req.set(http::field::host, "127.0.0.1");
+        req.keep_alive(true);
+        http::write(stream, req);
+
+        http::response<http::string_body> res;
+        http::read(stream, buffer, res);
+        EXPECT_EQ(res.result(), http::status::ok);
+        EXPECT_TRUE(res.keep_alive());
+        EXPECT_NE(res.body().find("Hello"), std::string::npos);
+    }
+
+    // "Connection: close" : le serveur répond puis ferme
+    http::request<http::string_body> req{http::verb::get, "/", 11};
+    req.set(http::field::host, "127.0.0.1");
+    req.keep_alive(false);
+    http::write(stream, req);
+
+    http::response<http::string_body> res;
+    http::read(stream, buffer, res);
+    EXPECT_FALSE(res.keep_alive());
+
+    beast::error_code ec;
+    http::read(stream, buffer, res, ec);
+    EXPECT_EQ(ec, http::error::end_of_stream);
+
+    server.stop();
+    server_thread.join();
+}
+
+TEST(HttpServerTest, PipelinedRequestsAnsweredInOrder) {
+    boost::asio::io_context server_ioc;
+    HttpServer server(server_ioc, tcp::endpoint{tcp::v4(), 8083}, HEADLESS_PIPELINE_DESC);
+    std::thread server_thread([&server_ioc] { server_ioc.run(); });
+
+    boost::asio::io_context ioc;
+    tcp::resolver resolver(ioc);
+    beast::tcp_stream stream(ioc);
+    stream.connect(resolver.resolve("127.0.0.1", "8083"));
+
+    // Trois requêtes envoyées d'un seul bloc, avant de lire la moindre réponse
+    const std::string pipelined =
+        "GET / HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n"
+        "GET / HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n"
+        "GET / HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n\r\n";
+    boost::asio::write(stream, boost::asio::buffer(pipelined));
+
+    beast::flat_buffer buffer;
+    for (int i = 0; i < 3; ++i) {
+        http::response<http::string_body> res;
+        http::read(stream, buffer, res);
+        EXPECT_EQ(res.result(), http::status::ok);
+        EXPECT_EQ(res.keep_alive(), i < 2);
+    }
+
+    server.stop();
+    server_thread.join();
+}
+
+TEST(HttpServerTest, ThreadPoolServesConcurrentClients) {
+    // Port 0 : le noyau choisit un port, partagé par les 4 acceptors SO_REUSEPORT
+    HttpServer server(tcp::endpoint{tcp::v4(), 0}, nullptr, 4);
+    server.start();
+    const std::string port = std::to_string(server.port());
+    ASSERT_NE(server.port(), 0);
+
+    std::vector<std::thread> clients;
+    std::atomic<int> ok_responses{0};
+    for (int c = 0; c < 8; ++c) {
+        clients.emplace_back([&] {
+            boost::asio::io_context ioc;
+            tcp::resolver resolver(ioc);
+            beast::tcp_stream stream(ioc);
+            stream.connect(resolver.resolve("127.0.0.1", port));
+
+            beast::flat_buffer buffer;
+            for (int i = 0; i < 50; ++i) {
+                http::request<http::string_body> req{http::verb::get, "/", 11};
+                req.set(http::field::host, "127.0.0.1");
+                http::write(stream, req);
+
+                http::response<http::string_body> res;
+                http::read(stream, buffer, res);
+                if (res.result() == http::status::ok) {
+                    ++ok_responses;
+                }
+            }
+            beast::error_code ec;
+            stream.socket().shutdown(tcp::socket::shutdown_both, ec);
+        });
+    }
+    for (auto& client : clients) {
+        client.join();
+    }
+
+    EXPECT_EQ(ok_responses.load(), 8 * 50);
+    server.stop();
+}
+
+TEST(HttpServerTest, SteadyStateRequestsDoNotAllocate) {
+    HttpServer server(tcp::endpoint{tcp::v4(), 0}, nullptr, 1);
+    server.start();
+
+    // Client synchrone sur tampons fixes : lui-même n'alloue rien
+    boost::asio::io_context ioc;
+    tcp::socket socket(ioc);
+    socket.connect(tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), server.port()));
+    const std::string request = "GET / HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+    char response[512];
+    auto round_trip = [&] {
+        boost::asio::write(socket, boost::asio::buffer(request));
+        std::size_t received = 0;
+        const std::string_view end_of_body = "Hello, World!";
+        while (std::string_view(response, received).find(end_of_body) == std::string_view::npos) {
+            received += socket.read_some(boost::asio::buffer(response + received, sizeof response - received));
+        }
+    };
+
+    // Échauffement : listes libres, mémoire des handlers et tampons du logger
+    for (int i = 0; i < 100; ++i) {
+        round_trip();
+    }
+    Logger::instance().flush();
+
+    AllocationCounter allocations;
+    for (int i = 0; i < 1000; ++i) {
+        round_trip();
+    }
+    EXPECT_EQ(allocations.count(), 0u);
+
+    beast::error_code ec;
+    socket.shutdown(tcp::socket::shutdown_both, ec);
+    server.stop();
+}
+
+namespace {
+
+http::response<http::string_body> send_request(beast::tcp_stream& stream, beast::flat_buffer& buffer,
+                                               http::verb method, const char* target, std::string body = {}) {
+    http::request<http::string_body> req{method, target, 11};
+    req.set(http::field::host, "127.0.0.1");
+    req.body() = std::move(body);
+    req.prepare_payload();
+    http::write(stream, req);
+
+    http::response<http::string_body> res;
+    http::read(stream, buffer, res);
+    return res;
+}
+
+} // namespace
+
+TEST(HttpServerTest, ControlPlaneTunesRunningPipeline) {
+    HttpServer server(tcp::endpoint{tcp::v4(), 0}, HEADLESS_PIPELINE_DESC, 1);
+    server.start();
+
+    boost::asio::io_context ioc;
+    tcp::resolver resolver(ioc);
+    beast::tcp_stream stream(ioc);
+    stream.connect(resolver.resolve("127.0.0.1", std::to_string(server.port())));
+    beast::flat_buffer buffer;
+
+    auto res = send_request(stream, buffer, http::verb::put, "/elements/encode/properties/bitrate", "1000\n");
+    EXPECT_EQ(res.result(), http::status::ok);
+    EXPECT_EQ(res.body(), "1000\n");
+
+    res = send_request(stream, buffer, http::verb::get, "/elements/encode/properties/bitrate");
+    EXPECT_EQ(res.result(), http::status::ok);
+    EXPECT_EQ(res.body(), "1000\n");
+
+    res = send_request(stream, buffer, http::verb::post, "/elements/encode/force-key-unit");
+    EXPECT_EQ(res.result(), http::status::ok);
+
+    // Par le service de demandes : répond une fois l'image clé partie
+    res = send_request(stream, buffer, http::verb::post, "/key-unit");
+    EXPECT_EQ(res.result(), http::status::ok);
+    EXPECT_EQ(res.body(), "key unit requested\n");
+
+    res = send_request(stream, buffer, http::verb::put, "/elements/missing/properties/bitrate", "1000");
+    EXPECT_EQ(res.result(), http::status::not_found);
+
+    res = send_request(stream, buffer, http::verb::put, "/elements/encode/properties/bitrate", "fast");
+    EXPECT_EQ(res.result(), http::status::bad_request);
+
+    beast::error_code ec;
+    stream.socket().shutdown(tcp::socket::shutdown_both, ec);
+    server.stop();
+}
+
+TEST(HttpServerTest, MetricsReportRequestsAndPipeline) {
+    HttpServer server(tcp::endpoint{tcp::v4(), 0}, HEADLESS_PIPELINE_DESC, 1);
+    server.start();
+
+    boost::asio::io_context ioc;
+    tcp::resolver resolver(ioc);
+    beast::tcp_stream stream(ioc);
+    stream.connect(resolver.resolve("127.0.0.1", std::to_string(server.port())));
+    beast::flat_buffer buffer;
+
+    EXPECT_EQ(send_request(stream, buffer, http::verb::get, "/").result(), http::status::ok);
+    EXPECT_EQ(send_request(stream, buffer, http::verb::get, "/missing").result(), http::status::not_found);
+    // Quelques images sorties de l'encodeur
+    GstElement* encoder = server.pipeline()->element(HttpServer::kEncoderName);
+    ASSERT_NE(encoder, nullptr);
+    EXPECT_TRUE(wait_for_buffers(encoder, 5));
+    gst_object_unref(encoder);
+
+    auto res = send_request(stream, buffer, http::verb::get, "/metrics");
+    EXPECT_EQ(res.result(), http::status::ok);
+    EXPECT_EQ(res[http::field::content_type], "text/plain; version=0.0.4");
+    const auto& body = res.body();
+    EXPECT_NE(body.find("http_requests_total{method=\"GET\",route=\"/\",code=\"2xx\"} 1\n"), std::string::npos);
+    EXPECT_NE(body.find("http_requests_total{route=\"unmatched\",code=\"4xx\"} 1\n"), std::string::npos);
+    EXPECT_NE(body.find("http_request_duration_seconds_count{method=\"GET\",route=\"/\"} 1\n"), std::string::npos);
+    EXPECT_NE(body.find("http_connections_accepted_total 1\n"), std::string::npos);
+    EXPECT_NE(body.find("http_sessions_open 1\n"), std::string::npos);
+    EXPECT_NE(body.find("gst_pipeline_state{state=\"PLAYING\"} 1\n"), std::string::npos);
+    // Seul l'élément nommé explicitement est suivi
+    EXPECT_NE(body.find("gst_element_buffers_total{element=\"encode\"} "), std::string::npos);
+    EXPECT_EQ(body.find("element=\"videotestsrc0\""), std::string::npos);
+    EXPECT_EQ(body.find("gst_element_buffers_total{element=\"encode\"} 0\n"), std::string::npos);
+
+    beast::error_code ec;
+    stream.socket().shutdown(tcp::socket::shutdown_both, ec);
+    server.stop();
+}
+
+TEST(HttpServerTest, StreamsMpegTsFromAppsink) {
+    HttpServer server(tcp::endpoint{tcp::v4(), 0}, STREAMING_PIPELINE_DESC, 1);
+    server.start();
+
+    boost::asio::io_context ioc;
+    tcp::resolver resolver(ioc);
+    beast::tcp_stream stream(ioc);
+    stream.connect(resolver.resolve("127.0.0.1", std::to_string(server.port())));
+
+    http::request<http::empty_body> req{http::verb::get, "/stream", 11};
+    req.set(http::field::host, "127.0.0.1");
+    http::write(stream, req);
+
+    beast::flat_buffer buffer;
+    http::response_parser<http::buffer_body> parser;
+    http::read_header(stream, buffer, parser);
+    EXPECT_EQ(parser.get().result(), http::status::ok);
+    EXPECT_TRUE(parser.get().chunked());
+    EXPECT_EQ(parser.get()[http::field::content_type], "video/mp2t");
+
+    // Premier paquet TS : octet de synchronisation 0x47
+    unsigned char data[188 * 7];
+    parser.get().body().data = data;
+    parser.get().body().size = sizeof data;
+    beast::error_code ec;
+    http::read(stream, buffer, parser, ec);
+    EXPECT_EQ(ec, http::error::need_buffer);
+    EXPECT_EQ(data[0], 0x47);
+
+    stream.socket().shutdown(tcp::socket::shutdown_both, ec);
+    stream.close();
+    server.stop();
+}
+
+namespace {
+
+// Flux en mémoire : trois morceaux disponibles tout de suite, un quatrième plus tard.
+struct FakeChunkStream : ChunkStream {
+    void start(std::function<void()> wake) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        wake_ = std::move(wake);
+    }
+    boost::asio::const_buffer next() override {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (sent == available) {
+            return {};
+        }
+        const std::string& chunk = chunks[sent++];
+        return boost::asio::buffer(chunk);
+    }
+    void release() override {}
+    void stop() override { stopped = true; }
+
+    void make_available(std::size_t n) {
+        std::lock_guard<std::mutex> lock(mutex);
+        available = n;
+        if (wake_) {
+            wake_();
+        }
+    }
+
+    std::mutex mutex;
+    std::function<void()> wake_;
+    std::vector<std::string> chunks{"one", "two", "three", "four"};
+    std::size_t sent = 0;
+    std::size_t available = 3;
+    std::atomic<bool> stopped{false};
+};
+
+} // namespace
+
+TEST(HttpServerTest, StreamsChunksUntilClientLeaves) {
+    auto chunks = std::make_shared<FakeChunkStream>();
+    HttpServer server(tcp::endpoint{tcp::v4(), 0}, nullptr, 1);
+    server.router().add(http::verb::get, "/chunks",
+        [chunks](const Request&, const PathParams&, const Reply& reply) {
+            reply(Response::chunked(http::status::ok, chunks, "text/plain"));
+        });
+    server.start();
+
+    boost::asio::io_context ioc;
+    tcp::resolver resolver(ioc);
+    beast::tcp_stream stream(ioc);
+    stream.connect(resolver.resolve("127.0.0.1", std::to_string(server.port())));
+
+    http::request<http::empty_body> req{http::verb::get, "/chunks", 11};
+    req.set(http::field::host, "127.0.0.1");
+    http::write(stream, req);
+
+    beast::flat_buffer buffer;
+    http::response_parser<http::buffer_body> parser;
+    http::read_header(stream, buffer, parser);
+    EXPECT_TRUE(parser.get().chunked());
+
+    std::string received;
+    char data[64];
+    auto read_until_size = [&](std::size_t size) {
+        while (received.size() < size) {
+            parser.get().body().data = data;
+            parser.get().body().size = sizeof data;
+            beast::error_code ec;
+            http::read_some(stream, buffer, parser, ec);
+            ASSERT_TRUE(!ec || ec == http::error::need_buffer) << ec.message();
+            received.append(data, sizeof data - parser.get().body().size);
+        }
+    };
+    read_until_size(11);
+    EXPECT_EQ(received, "onetwothree");
+
+    // Le flux était au repos : le réveil doit relancer l'écriture.
+    chunks->make_available(4);
+    read_until_size(15);
+    EXPECT_EQ(received, "onetwothreefour");
+
+    beast::error_code ec;
+    stream.socket().shutdown(tcp::socket::shutdown_both, ec);
+    stream.close();
+    for (int i = 0; i < 100 && !chunks->stopped; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_TRUE(chunks->stopped);
+    server.stop();
+}
+
+TEST(HttpServerTest, StopLetsInFlightRequestsFinish) {
+    HttpServer server(tcp::endpoint{tcp::v4(), 0}, nullptr, 1);
+    std::promise<void> handling;
+    std::thread replier;
+    server.router().add(http::verb::get, "/slow",
+        [&](const Request&, const PathParams&, const Reply& reply) {
+            handling.set_value();
+            replier = std::thread([reply] {
+                std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                reply(Response::text(http::status::ok, "done"));
+            });
+        });
+    server.start();
+    const auto port_number = server.port();
+    const auto port = std::to_string(port_number);
+
+    // Une connexion keep-alive au repos, une autre avec une requête en cours
+    boost::asio::io_context ioc;
+    tcp::resolver resolver(ioc);
+    beast::tcp_stream idle(ioc);
+    idle.connect(resolver.resolve("127.0.0.1", port));
+    beast::flat_buffer idle_buffer;
+    EXPECT_EQ(send_request(idle, idle_buffer, http::verb::get, "/").result(), http::status::ok);
+
+    beast::tcp_stream busy(ioc);
+    busy.connect(resolver.resolve("127.0.0.1", port));
+    http::request<http::empty_body> req{http::verb::get, "/slow", 11};
+    req.set(http::field::host, "127.0.0.1");
+    http::write(busy, req);
+    handling.get_future().wait();
+
+    const auto started = std::chrono::steady_clock::now();
+    auto stopped = std::async(std::launch::async, [&server] { server.stop(); });
+
+    // La connexion au repos est fermée sans attendre
+    http::response<http::string_body> res;
+    beast::error_code ec;
+    http::read(idle, idle_buffer, res, ec);
+    EXPECT_EQ(ec, http::error::end_of_stream);
+
+    // La requête en cours reçoit sa réponse, puis la connexion se ferme
+    beast::flat_buffer buffer;
+    http::read(busy, buffer, res);
+    EXPECT_EQ(res.result(), http::status::ok);
+    EXPECT_EQ(res.body(), "done");
+    EXPECT_FALSE(res.keep_alive());
+    http::read(busy, buffer, res, ec);
+    EXPECT_EQ(ec, http::error::end_of_stream);
+
+    stopped.wait();
+    EXPECT_LT(std::chrono::steady_clock::now() - started, HttpServer::kStopTimeout);
+    replier.join();
+
+    // Plus personne n'écoute
+    tcp::socket late(ioc);
+    late.connect(tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), port_number), ec);
+    EXPECT_EQ(ec, boost::asio::error::connection_refused);
+}
+
+TEST(HttpServerTest, StopAbortsRequestsPastTheDeadline) {
+    HttpServer server(tcp::endpoint{tcp::v4(), 0}, nullptr, 1);
+    std::promise<void> handling;
+    // Le handler garde sa réponse sans jamais l'envoyer
+    std::optional<Reply> held;
+    server.router().add(http::verb::get, "/never",
+        [&](const Request&, const PathParams&, const Reply& reply) {
+            held = reply;
+            handling.set_value();
+        });
+    server.start();
+
+    boost::asio::io_context ioc;
+    tcp::resolver resolver(ioc);
+    beast::tcp_stream stream(ioc);
+    stream.connect(resolver.resolve("127.0.0.1", std::to_string(server.port())));
+    http::request<http::empty_body> req{http::verb::get, "/never", 11};
+    req.set(http::field::host, "127.0.0.1");
+    http::write(stream, req);
+    handling.get_future().wait();
+
+    const auto started = std::chrono::steady_clock::now();
+    server.stop(std::chrono::milliseconds(100));
+    EXPECT_LT(std::chrono::steady_clock::now() - started, std::chrono::seconds(1));
+
+    beast::flat_buffer buffer;
+    http::response<http::string_body> res;
+    beast::error_code ec;
+    http::read(stream, buffer, res, ec);
+    EXPECT_TRUE(ec);
+    held.reset();
+}
+
+TEST(HttpServerTest, StopEndsPipelineWithEos) {
+    LogCapture capture;
+    {
+        HttpServer server(tcp::endpoint{tcp::v4(), 0}, HEADLESS_PIPELINE_DESC, 1);
+        server.start();
+        // Le flux a démarré : l'EOS a des images à pousser devant lui
+        GstElement* encoder = server.pipeline()->element(HttpServer::kEncoderName);
+        ASSERT_NE(encoder, nullptr);
+        EXPECT_TRUE(wait_for_buffers(encoder, 1));
+        gst_object_unref(encoder);
+        server.stop();
+    }
+
+    const auto text = capture.text();
+    const auto eos = text.find("[GStreamer] End of stream reached");
+    const auto null_state = text.find("[GStreamer] Setting pipeline state target=NULL");
+    ASSERT_NE(eos, std::string::npos) << text;
+    ASSERT_NE(null_state, std::string::npos) << text;
+    EXPECT_LT(eos, null_state);
+    EXPECT_NE(text.find("[HttpServer] Server stopped drained=true"), std::string::npos) << text;
+}
+
+TEST(HttpServerTest, ConnectionsOverTheCapGet503) {
+    HttpServer server(tcp::endpoint{tcp::v4(), 0}, nullptr, 1);
+    AdmissionLimits limits;
+    limits.max_connections = 1;
+    limits.overload_slots = 4;
+    server.set_admission(limits);
+    server.start();
+    const auto port = std::to_string(server.port());
+
+    boost::asio::io_context ioc;
+    tcp::resolver resolver(ioc);
+    beast::tcp_stream served(ioc);
+    served.connect(resolver.resolve("127.0.0.1", port));
+    beast::flat_buffer served_buffer;
+    EXPECT_EQ(send_request(served, served_buffer, http::verb::get, "/").result(), http::status::ok);
+
+    // Au-delà du plafond : 503 immédiat, sans lire la requête, puis fermeture
+    {
+        beast::tcp_stream rejected(ioc);
+        rejected.connect(resolver.resolve("127.0.0.1", port));
+        beast::flat_buffer buffer;
+        const auto res = send_request(rejected, buffer, http::verb::get, "/");
+        EXPECT_EQ(res.result(), http::status::service_unavailable);
+        EXPECT_EQ(res[http::field::retry_after], "1");
+        EXPECT_FALSE(res.keep_alive());
+    }
+
+    // La place libérée, un nouveau client est servi
+    beast::error_code ec;
+    served.socket().shutdown(tcp::socket::shutdown_both, ec);
+    served.close();
+    http::status status = http::status::unknown;
+    for (int i = 0; i < 50 && status != http::status::ok; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        beast::tcp_stream next(ioc);
+        next.connect(resolver.resolve("127.0.0.1", port));
+        beast::flat_buffer buffer;
+        status = send_request(next, buffer, http::verb::get, "/").result();
+    }
+    EXPECT_EQ(status, http::status::ok);
+
+    const auto metrics = server.metrics().render();
+    EXPECT_NE(metrics.find("http_admission_rejected_total{reason=\"overloaded\"} "), std::string::npos) << metrics;
+    EXPECT_EQ(metrics.find("http_admission_rejected_total{reason=\"overloaded\"} 0"), std::string::npos) << metrics;
+    server.stop();
+}
+
+TEST(HttpServerTest, AcceptPausesWhileEverySlotIsTaken) {
+    HttpServer server(tcp::endpoint{tcp::v4(), 0}, nullptr, 1);
+    AdmissionLimits limits;
+    limits.max_connections = 1;
+    limits.overload_slots = 0;
+    server.set_admission(limits);
+    server.start();
+    const auto port = std::to_string(server.port());
+
+    boost::asio::io_context ioc;
+    tcp::resolver resolver(ioc);
+    beast::tcp_stream served(ioc);
+    served.connect(resolver.resolve("127.0.0.1", port));
+    beast::flat_buffer served_buffer;
+    EXPECT_EQ(send_request(served, served_buffer, http::verb::get, "/").result(), http::status::ok);
+
+    // Le noyau accepte la connexion dans sa file ; le serveur ne la prend pas
+    tcp::socket waiting(ioc);
+    waiting.connect(tcp::endpoint(boost::asio::ip::make_address("127.0.0.1"), server.port()));
+    const std::string request = "GET / HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+    boost::asio::write(waiting, boost::asio::buffer(request));
+    beast::flat_buffer buffer;
+    http::response<http::string_body> res;
+    bool answered = false;
+    http::async_read(waiting, buffer, res, [&](beast::error_code ec, std::size_t) {
+        EXPECT_FALSE(ec) << ec.message();
+        answered = true;
+    });
+    ioc.run_for(std::chrono::milliseconds(300));
+    EXPECT_FALSE(answered);
+
+    // Une connexion se ferme : l'acceptation reprend et la requête en attente est servie
+    beast::error_code ec;
+    served.socket().shutdown(tcp::socket::shutdown_both, ec);
+    served.close();
+    ioc.restart();
+    ioc.run_for(std::chrono::seconds(5));
+    EXPECT_TRUE(answered);
+    EXPECT_EQ(res.result(), http::status::ok);
+
+    EXPECT_EQ(server.metrics().render().find("http_accept_pauses_total 0"), std::string::npos);
+    waiting.close();
+    server.stop();
+}
+
+TEST(HttpServerTest, RateLimitedClientsGet429) {
+    HttpServer server(tcp::endpoint{tcp::v4(), 0}, nullptr, 1);
+    AdmissionLimits limits;
+    limits.requests_per_second = 0.1;
+    limits.burst = 2;
+    server.set_admission(limits);
+    server.start();
+    const auto port = std::to_string(server.port());
+
+    // La connexion paie la première requête, la seconde vide le seau
+    boost::asio::io_context ioc;
+    tcp::resolver resolver(ioc);
+    beast::tcp_stream stream(ioc);
+    stream.connect(resolver.resolve("127.0.0.1", port));
+    beast::flat_buffer buffer;
+    EXPECT_EQ(send_request(stream, buffer, http::verb::get, "/").result(), http::status::ok);
+    EXPECT_EQ(send_request(stream, buffer, http::verb::get, "/").result(), http::status::ok);
+    auto res = send_request(stream, buffer, http::verb::get, "/");
+    EXPECT_EQ(res.result(), http::status::too_many_requests);
+    EXPECT_EQ(res[http::field::retry_after], "1");
+    // La connexion reste ouverte
+    EXPECT_TRUE(res.keep_alive());
+
+    // Une nouvelle connexion du même client est refusée dès l'acceptation
+    beast::tcp_stream again(ioc);
+    again.connect(resolver.resolve("127.0.0.1", port));
+    beast::flat_buffer again_buffer;
+    res = send_request(again, again_buffer, http::verb::get, "/");
+    EXPECT_EQ(res.result(), http::status::too_many_requests);
+    EXPECT_FALSE(res.keep_alive());
+
+    const auto metrics = server.metrics().render();
+    EXPECT_NE(metrics.find("http_admission_rejected_total{reason=\"rate_limited\"} 2"), std::string::npos)
+        << metrics;
+    beast::error_code ec;
+    stream.socket().shutdown(tcp::socket::shutdown_both, ec);
+    server.stop();
+}
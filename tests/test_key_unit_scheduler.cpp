@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+#include "gstreamer/key_unit_scheduler.hpp"
+
+namespace {
+
+constexpr std::int64_t kMs = 1000;
+
+} // namespace
+
+TEST(KeyUnitSchedulerTest, ConcurrentRequestsShareOneKeyUnit) {
+    KeyUnitScheduler scheduler({});
+
+    // Cinquante spectateurs arrivent dans la même fenêtre
+    EXPECT_EQ(scheduler.request(0, false), KeyUnitAnswer::Scheduled);
+    EXPECT_EQ(scheduler.deadline_us(), 100 * kMs);
+    for (int viewer = 1; viewer < 50; ++viewer) {
+        EXPECT_EQ(scheduler.request(viewer * kMs, false), KeyUnitAnswer::Coalesced);
+    }
+
+    EXPECT_EQ(scheduler.take_due(99 * kMs).requests, 0u);
+    const KeyUnitDue due = scheduler.take_due(100 * kMs);
+    EXPECT_EQ(due.requests, 50u);
+    EXPECT_TRUE(due.send);
+    // Plus rien en attente
+    EXPECT_EQ(scheduler.deadline_us(), -1);
+    EXPECT_EQ(scheduler.take_due(200 * kMs).requests, 0u);
+}
+
+TEST(KeyUnitSchedulerTest, EnforcesMinimumInterval) {
+    KeyUnitScheduler scheduler({});
+    scheduler.request(0, false);
+    ASSERT_TRUE(scheduler.take_due(100 * kMs).send);
+
+    // Envoyée mais pas encore sortie de l'encodeur : compte déjà
+    EXPECT_EQ(scheduler.request(150 * kMs, false), KeyUnitAnswer::Scheduled);
+    EXPECT_EQ(scheduler.deadline_us(), 1100 * kMs);
+    scheduler.on_keyframe(130 * kMs);
+    EXPECT_EQ(scheduler.deadline_us(), 1100 * kMs);
+    EXPECT_EQ(scheduler.take_due(1000 * kMs).requests, 0u);
+    EXPECT_TRUE(scheduler.take_due(1100 * kMs).send);
+
+    // Une image clé naturelle repousse aussi la suivante
+    scheduler.on_keyframe(3000 * kMs);
+    scheduler.request(3500 * kMs, false);
+    EXPECT_EQ(scheduler.deadline_us(), 4000 * kMs);
+}
+
+TEST(KeyUnitSchedulerTest, LateJoinersStartFromTheCachedGop) {
+    KeyUnitScheduler scheduler({});
+    // Pas encore d'image clé : rien en cache
+    EXPECT_EQ(scheduler.request(0, true), KeyUnitAnswer::Scheduled);
+    scheduler.on_keyframe(50 * kMs);
+    EXPECT_EQ(scheduler.request(60 * kMs, true), KeyUnitAnswer::Cached);
+    // Ce retardataire-là ne sait pas partir du cache
+    EXPECT_EQ(scheduler.request(70 * kMs, false), KeyUnitAnswer::Coalesced);
+
+    EXPECT_EQ(scheduler.request(2050 * kMs, true), KeyUnitAnswer::Cached);
+    // GOP trop ancien : une nouvelle image clé
+    EXPECT_EQ(scheduler.request(2051 * kMs, true), KeyUnitAnswer::Coalesced);
+}
+
+TEST(KeyUnitSchedulerTest, NaturalKeyframeAnswersPendingRequests) {
+    KeyUnitScheduler scheduler({});
+    scheduler.request(0, false);
+    scheduler.request(10 * kMs, false);
+    scheduler.on_keyframe(40 * kMs);
+
+    const KeyUnitDue due = scheduler.take_due(100 * kMs);
+    EXPECT_EQ(due.requests, 2u);
+    EXPECT_FALSE(due.send);
+    // Rien n'a été forcé : l'intervalle part de l'image clé naturelle
+    scheduler.request(200 * kMs, false);
+    EXPECT_EQ(scheduler.deadline_us(), 1040 * kMs);
+}
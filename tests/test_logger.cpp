@@ -0,0 +1,144 @@
+// Les traces DEBUG sont compilées dans ce fichier, TRACE reste filtré.
+#define SLOG_ACTIVE_LEVEL SLOG_LEVEL_DEBUG
+#include <gtest/gtest.h>
+#include <atomic>
+#include <future>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "logging/logger.h"
+#include "utils/log_capture.hpp"
+
+namespace {
+
+std::vector<std::string> lines_of(const std::string& text) {
+    std::vector<std::string> lines;
+    std::istringstream in(text);
+    for (std::string line; std::getline(in, line);) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+} // namespace
+
+TEST(LoggerTest, FormatsStructuredFields) {
+    LogCapture capture;
+    const std::string path = "/elements/encode";
+    const char* missing = nullptr;
+    SLOG_INFO("Test", "Request handled", "status", 404, "bytes", 12u, "ratio", 0.5, "keep_alive", true,
+              "path", path, "note", "two words");
+    SLOG_WARN("Test", "", "missing", missing);
+
+    const auto lines = lines_of(capture.text());
+    ASSERT_EQ(lines.size(), 2u);
+    EXPECT_NE(lines[0].find(" INFO  "), std::string::npos) << lines[0];
+    EXPECT_NE(lines[0].find("[Test] Request handled status=404 bytes=12 ratio=0.5 keep_alive=true "
+                            "path=/elements/encode note=\"two words\""), std::string::npos) << lines[0];
+    EXPECT_NE(lines[1].find(" WARN  "), std::string::npos) << lines[1];
+    EXPECT_NE(lines[1].find("[Test] missing=\"\""), std::string::npos) << lines[1];
+}
+
+TEST(LoggerTest, CompiledOutLevelsDoNotEvaluateArguments) {
+    LogCapture capture;
+    int evaluated = 0;
+    SLOG_TRACE("Test", "Never built", "n", ++evaluated);
+    SLOG_DEBUG("Test", "Built", "n", ++evaluated);
+    EXPECT_EQ(evaluated, 1);
+    EXPECT_EQ(capture.text().find("Never built"), std::string::npos);
+}
+
+TEST(LoggerTest, RuntimeLevelFilters) {
+    LogCapture capture;
+    Logger::set_level(LogLevel::Warn);
+    SLOG_INFO("Test", "Filtered");
+    SLOG_ERROR("Test", "Kept");
+    Logger::set_level(LogLevel::Trace);
+
+    const auto text = capture.text();
+    EXPECT_EQ(text.find("Filtered"), std::string::npos);
+    EXPECT_NE(text.find("[Test] Kept"), std::string::npos);
+}
+
+TEST(LoggerTest, TruncatesLongStrings) {
+    LogCapture capture;
+    const std::string long_value(1000, 'x');
+    SLOG_INFO("Test", "Long", "value", long_value);
+    const auto lines = lines_of(capture.text());
+    ASSERT_EQ(lines.size(), 1u);
+    EXPECT_NE(lines[0].find("value=" + std::string(LogRecord::kTextSize, 'x')), std::string::npos);
+    EXPECT_EQ(lines[0].find(std::string(LogRecord::kTextSize + 1, 'x')), std::string::npos);
+}
+
+TEST(LoggerTest, MergesThreadsInTimeOrder) {
+    LogCapture capture;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([t] {
+            for (int i = 0; i < 100; ++i) {
+                SLOG_INFO("Test", "Step", "thread", t, "i", i);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    const auto lines = lines_of(capture.text());
+    ASSERT_EQ(lines.size(), 400u);
+    // Horodatage ISO de largeur fixe : l'ordre lexical est l'ordre du temps
+    for (std::size_t i = 1; i < lines.size(); ++i) {
+        EXPECT_LE(lines[i - 1].substr(0, 27), lines[i].substr(0, 27));
+    }
+    // Chaque thread garde son propre ordre
+    for (int t = 0; t < 4; ++t) {
+        int next = 0;
+        const std::string prefix = "thread=" + std::to_string(t) + " i=";
+        for (const auto& line : lines) {
+            const auto at = line.find(prefix);
+            if (at != std::string::npos) {
+                EXPECT_EQ(std::stoi(line.substr(at + prefix.size())), next++);
+            }
+        }
+        EXPECT_EQ(next, 100);
+    }
+}
+
+TEST(LoggerTest, DropsRatherThanBlocksWhenWriterFallsBehind) {
+    // Remplacée ci-dessous ; rend stdout à la fin du test
+    LogCapture restore_stdout;
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::atomic<bool> writing{false};
+    std::mutex mutex;
+    std::string text;
+    Logger::instance().set_sink([&](std::string_view lines) {
+        writing = true;
+        released.wait();
+        std::lock_guard<std::mutex> lock(mutex);
+        text.append(lines);
+    });
+
+    // Une erreur réveille l'écrivain, qui reste bloqué dans la sortie
+    SLOG_ERROR("Test", "Stall");
+    while (!writing) {
+        std::this_thread::yield();
+    }
+    std::thread([] {
+        for (int i = 0; i < 1000; ++i) {
+            SLOG_INFO("Test", "Burst", "i", i);
+        }
+    }).join();
+    release.set_value();
+    Logger::instance().flush();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const auto kept = Logger::kThreadRingSize;
+        EXPECT_NE(text.find("Burst i=" + std::to_string(kept - 1) + "\n"), std::string::npos);
+        EXPECT_EQ(text.find("Burst i=" + std::to_string(kept) + "\n"), std::string::npos);
+        EXPECT_NE(text.find("[Logger] Dropped records"), std::string::npos);
+        EXPECT_NE(text.find("count=" + std::to_string(1000 - kept) + "\n"), std::string::npos);
+    }
+}
@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "metrics/metrics.h"
+#include "http/router.h"
+
+namespace http = boost::beast::http;
+
+namespace {
+
+struct NullSink : ResponseSink {
+    void send(Response&&) override {}
+};
+
+bool contains(const std::string& text, const std::string& line) {
+    return text.find(line) != std::string::npos;
+}
+
+} // namespace
+
+TEST(MetricsTest, CounterSumsShardsOfAllThreads) {
+    Counter counter;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&counter] {
+            for (int i = 0; i < 10000; ++i) {
+                counter.inc();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(counter.value(), 80000u);
+}
+
+TEST(MetricsTest, GaugeStaysExactAcrossThreads) {
+    Gauge gauge;
+    gauge.inc();
+    gauge.inc();
+    // Décrémentée sur un autre thread : son compteur passe sous zéro
+    std::thread([&gauge] { gauge.dec(); }).join();
+    EXPECT_EQ(gauge.value(), 1);
+}
+
+TEST(MetricsTest, HistogramBucketsAreCumulative) {
+    Histogram histogram({0.1, 1});
+    histogram.observe(0.05);
+    histogram.observe(0.1);
+    histogram.observe(0.5);
+    histogram.observe(3);
+
+    const auto snap = histogram.snapshot();
+    ASSERT_EQ(snap.cumulative.size(), 3u);
+    EXPECT_EQ(snap.cumulative[0], 2u);
+    EXPECT_EQ(snap.cumulative[1], 3u);
+    EXPECT_EQ(snap.cumulative[2], 4u);
+    EXPECT_EQ(snap.count, 4u);
+    EXPECT_DOUBLE_EQ(snap.sum, 3.65);
+}
+
+TEST(MetricsTest, RendersPrometheusText) {
+    MetricsRegistry registry;
+    registry.counter("jobs_total", "Jobs done.", MetricsRegistry::labels({{"queue", "a"}})).inc(3);
+    registry.gauge("workers", "Workers alive.").add(2);
+    registry.histogram("job_seconds", "Job duration.", MetricsRegistry::labels({{"queue", "a"}}), {0.5, 1})
+        .observe(0.25);
+
+    const auto text = registry.render();
+    EXPECT_TRUE(contains(text, "# HELP jobs_total Jobs done.\n# TYPE jobs_total counter\n"));
+    EXPECT_TRUE(contains(text, "jobs_total{queue=\"a\"} 3\n"));
+    EXPECT_TRUE(contains(text, "# TYPE workers gauge\nworkers 2\n"));
+    EXPECT_TRUE(contains(text, "job_seconds_bucket{queue=\"a\",le=\"0.5\"} 1\n"));
+    EXPECT_TRUE(contains(text, "job_seconds_bucket{queue=\"a\",le=\"1\"} 1\n"));
+    EXPECT_TRUE(contains(text, "job_seconds_bucket{queue=\"a\",le=\"+Inf\"} 1\n"));
+    EXPECT_TRUE(contains(text, "job_seconds_sum{queue=\"a\"} 0.25\n"));
+    EXPECT_TRUE(contains(text, "job_seconds_count{queue=\"a\"} 1\n"));
+}
+
+TEST(MetricsTest, EscapesLabelValues) {
+    EXPECT_EQ(MetricsRegistry::labels({{"path", "a\"b\\c\nd"}}), "{path=\"a\\\"b\\\\c\\nd\"}");
+    EXPECT_EQ(MetricsRegistry::labels({}), "");
+}
+
+TEST(MetricsTest, SameNameAndLabelsShareTheMetric) {
+    MetricsRegistry registry;
+    auto& a = registry.counter("hits_total", "Hits.");
+    auto& b = registry.counter("hits_total", "Hits.");
+    EXPECT_EQ(&a, &b);
+    EXPECT_THROW(registry.gauge("hits_total", "Hits."), std::invalid_argument);
+}
+
+TEST(MetricsTest, CollectorsRunOnScrapeUntilRemoved) {
+    MetricsRegistry registry;
+    int scrapes = 0;
+    const auto id = registry.collect("queue_depth", "Items queued.", "gauge",
+        [&scrapes](MetricsRegistry::Samples& samples) {
+            ++scrapes;
+            samples.emplace_back(MetricsRegistry::labels({{"queue", "in"}}), 7);
+        });
+    EXPECT_EQ(scrapes, 0);
+    EXPECT_TRUE(contains(registry.render(), "queue_depth{queue=\"in\"} 7\n"));
+    EXPECT_EQ(scrapes, 1);
+
+    registry.remove(id);
+    EXPECT_FALSE(contains(registry.render(), "queue_depth{"));
+    EXPECT_EQ(scrapes, 1);
+}
+
+TEST(MetricsTest, RouterReturnsMetricsOfTheMatchedRoute) {
+    MetricsRegistry registry;
+    Router router;
+    router.set_metrics(registry);
+    router.add(http::verb::get, "/elements/{name}",
+        [](const Request&, const PathParams&, const Reply& reply) {
+            reply(Response::text(http::status::ok, "ok"));
+        });
+
+    auto sink = std::make_shared<NullSink>();
+    const RouteMetrics* route = router.dispatch(Request{http::verb::get, "/elements/encode", 11}, Reply(sink));
+    ASSERT_NE(route, nullptr);
+    route->record(http::status::ok, 0.002);
+
+    const RouteMetrics* unmatched = router.dispatch(Request{http::verb::get, "/nowhere", 11}, Reply(sink));
+    ASSERT_NE(unmatched, nullptr);
+    EXPECT_NE(unmatched, route);
+    unmatched->record(http::status::not_found, 0.0001);
+
+    // Étiqueté par le motif, pas par le chemin demandé
+    const auto text = registry.render();
+    EXPECT_TRUE(contains(text, "http_requests_total{method=\"GET\",route=\"/elements/{name}\",code=\"2xx\"} 1\n"));
+    EXPECT_TRUE(contains(text, "http_requests_total{method=\"GET\",route=\"/elements/{name}\",code=\"5xx\"} 0\n"));
+    EXPECT_TRUE(contains(text, "http_requests_total{route=\"unmatched\",code=\"4xx\"} 1\n"));
+    EXPECT_TRUE(contains(text, "http_request_duration_seconds_bucket{method=\"GET\",route=\"/elements/{name}\",le=\"0.0025\"} 1\n"));
+    EXPECT_TRUE(contains(text, "http_request_duration_seconds_bucket{method=\"GET\",route=\"/elements/{name}\",le=\"0.001\"} 0\n"));
+}
+
+TEST(MetricsTest, RouterWithoutRegistryRecordsNothing) {
+    Router router;
+    router.add(http::verb::get, "/", [](const Request&, const PathParams&, const Reply& reply) {
+        reply(Response::text(http::status::ok, "ok"));
+    });
+    auto sink = std::make_shared<NullSink>();
+    EXPECT_EQ(router.dispatch(Request{http::verb::get, "/", 11}, Reply(sink)), nullptr);
+}
@@ -0,0 +1,155 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include "mypassthrough_kernels.h"
+#include "mypassthrough_slices.h"
+
+namespace {
+
+const gdouble kIdentity[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+// BT.709
+const gdouble kKr = 0.2126, kKb = 0.0722;
+
+std::vector<guint8> random_row(std::size_t n, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::vector<guint8> row(n);
+    for (auto& b : row) {
+        b = static_cast<guint8>(rng());
+    }
+    return row;
+}
+
+// Applique les quatre noyaux d'une variante sur des copies de `src`.
+struct Outputs {
+    std::vector<guint8> luma, u, v, uv, rgba;
+};
+
+Outputs run(const MyPassKernels* k, const MyPassParams& p, const std::vector<guint8>& src, gint n) {
+    Outputs out{src, src, random_row(src.size(), 7), src, src};
+    k->luma(out.luma.data(), n, &p);
+    k->chroma_planar(out.u.data(), out.v.data(), n, &p);
+    k->chroma_interleaved(out.uv.data(), n / 2, &p);
+    k->rgba(out.rgba.data(), n / 4, &p);
+    return out;
+}
+
+} // namespace
+
+TEST(MypassthroughKernelsTest, IdentityLeavesPixelsUnchanged) {
+    MyPassParams p;
+    my_pass_params_compute(&p, 0.0, 1.0, 1.0, kIdentity, kKr, kKb);
+    EXPECT_TRUE(p.luma_identity);
+    EXPECT_TRUE(p.chroma_identity);
+    EXPECT_TRUE(p.rgb_identity);
+
+    // Même à l'identité, la formule Q16 doit rendre chaque valeur intacte
+    auto src = random_row(1000, 1);
+    Outputs out = run(&my_pass_kernels_scalar, p, src, 1000);
+    EXPECT_EQ(out.luma, src);
+    EXPECT_EQ(out.uv, src);
+    EXPECT_EQ(out.rgba, src);
+}
+
+TEST(MypassthroughKernelsTest, BrightnessContrastOnLuma) {
+    MyPassParams p;
+    my_pass_params_compute(&p, 0.1, 2.0, 1.0, kIdentity, kKr, kKb);
+    EXPECT_FALSE(p.luma_identity);
+
+    guint8 row[4] = {0, 100, 128, 255};
+    my_pass_kernels_scalar.luma(row, 4, &p);
+    // y' = 2 (y - 128) + 128 + 25.5
+    EXPECT_EQ(row[0], 0);
+    EXPECT_EQ(row[1], 98);
+    EXPECT_EQ(row[2], 154);
+    EXPECT_EQ(row[3], 255);
+}
+
+TEST(MypassthroughKernelsTest, DesaturationZeroesChroma) {
+    // Matrice de luminance : chaque canal reçoit la luma, la chroma disparaît
+    const gdouble grey[9] = {kKr, 1 - kKr - kKb, kKb, kKr, 1 - kKr - kKb, kKb, kKr, 1 - kKr - kKb, kKb};
+    MyPassParams p;
+    my_pass_params_compute(&p, 0.0, 1.0, 1.0, grey, kKr, kKb);
+
+    guint8 u[3] = {16, 128, 240}, v[3] = {240, 128, 16};
+    my_pass_kernels_scalar.chroma_planar(u, v, 3, &p);
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_NEAR(u[i], 128, 1);
+        EXPECT_NEAR(v[i], 128, 1);
+    }
+}
+
+TEST(MypassthroughKernelsTest, SimdMatchesScalarBitForBit) {
+    const gdouble hue[9] = {0.7, 0.4, -0.1, -0.2, 1.1, 0.1, 0.3, -0.5, 1.2};
+    for (MyPassKernelKind kind : {MY_PASS_KERNEL_SSE4, MY_PASS_KERNEL_AVX2}) {
+        if (!my_pass_kernels_supported(kind)) {
+            continue;
+        }
+        const MyPassKernels* k = my_pass_kernels_get(kind);
+        for (unsigned seed = 0; seed < 20; ++seed) {
+            MyPassParams p;
+            std::mt19937 rng(seed);
+            std::uniform_real_distribution<double> unit(0.0, 1.0);
+            my_pass_params_compute(&p, unit(rng) * 2 - 1, unit(rng) * 2, unit(rng) * 4,
+                                   seed % 2 ? hue : kIdentity, kKr, kKb);
+            // Longueur impaire : couvre aussi la fin scalaire de chaque noyau
+            const gint n = 1000 + static_cast<gint>(seed);
+            auto src = random_row(n, seed);
+            Outputs ref = run(&my_pass_kernels_scalar, p, src, n);
+            Outputs got = run(k, p, src, n);
+            EXPECT_EQ(got.luma, ref.luma) << k->name << " seed " << seed;
+            EXPECT_EQ(got.u, ref.u) << k->name << " seed " << seed;
+            EXPECT_EQ(got.v, ref.v) << k->name << " seed " << seed;
+            EXPECT_EQ(got.uv, ref.uv) << k->name << " seed " << seed;
+            EXPECT_EQ(got.rgba, ref.rgba) << k->name << " seed " << seed;
+        }
+    }
+}
+
+TEST(MypassthroughKernelsTest, SlicedFrameMatchesSingleThread) {
+    const gdouble hue[9] = {0.7, 0.4, -0.1, -0.2, 1.1, 0.1, 0.3, -0.5, 1.2};
+    MyPassParams p;
+    my_pass_params_compute(&p, 0.05, 1.3, 0.9, hue, kKr, kKb);
+    const MyPassKernels* k = my_pass_kernels_get(MY_PASS_KERNEL_AUTO);
+
+    // Dimensions impaires : les tranches chroma ne tombent pas sur celles de la luma
+    const gint width = 333, height = 97;
+    for (MyPassLayout layout : {MY_PASS_LAYOUT_I420, MY_PASS_LAYOUT_NV12, MY_PASS_LAYOUT_RGBA}) {
+        const gint stride = layout == MY_PASS_LAYOUT_RGBA ? width * 4 : width + 3;
+        const auto src = random_row(static_cast<std::size_t>(stride) * height * 2, 11);
+
+        auto process = [&](std::vector<guint8>& buf, MyPassSlicePool* pool) {
+            MyPassFrame frame{layout, width, height, {}, {}};
+            const gint chroma_stride = layout == MY_PASS_LAYOUT_NV12 ? stride : stride / 2;
+            frame.data[0] = buf.data();
+            frame.data[1] = buf.data() + stride * height;
+            frame.data[2] = frame.data[1] + chroma_stride * ((height + 1) / 2);
+            frame.stride[0] = stride;
+            frame.stride[1] = frame.stride[2] = chroma_stride;
+            struct Job {
+                MyPassFrame frame;
+                const MyPassParams* p;
+                const MyPassKernels* k;
+            } job{frame, &p, k};
+            my_pass_slice_pool_run(pool, [](gpointer data, gint index, gint n) {
+                auto* j = static_cast<Job*>(data);
+                my_pass_process_slice(&j->frame, j->p, j->k, index, n);
+            }, &job);
+        };
+
+        MyPassSlicePool* single = my_pass_slice_pool_new(1);
+        std::vector<guint8> ref = src;
+        process(ref, single);
+        my_pass_slice_pool_free(single);
+
+        for (guint threads : {2u, 3u, 8u}) {
+            MyPassSlicePool* pool = my_pass_slice_pool_new(threads);
+            // Plusieurs frames de suite : le pool est réutilisé, pas recréé
+            for (int frame = 0; frame < 5; ++frame) {
+                std::vector<guint8> got = src;
+                process(got, pool);
+                ASSERT_EQ(got, ref) << "layout " << layout << ", " << threads << " threads";
+            }
+            my_pass_slice_pool_free(pool);
+        }
+    }
+}
@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "mypassthrough_stats.h"
+
+namespace {
+
+struct StatsDeleter {
+    void operator()(MyPassStats* s) const { my_pass_stats_free(s); }
+};
+using StatsPtr = std::unique_ptr<MyPassStats, StatsDeleter>;
+
+} // namespace
+
+TEST(MypassthroughStatsTest, RegularArrivalsHaveNoJitter) {
+    StatsPtr stats(my_pass_stats_new());
+    // 30 images/s, exactement
+    for (gint64 i = 0; i < 10; ++i) {
+        my_pass_stats_record(stats.get(), i * 33'333'000, MY_PASS_STATS_NO_LAG, 1000);
+    }
+
+    MyPassStatsSnapshot snap;
+    my_pass_stats_snapshot(stats.get(), &snap);
+    EXPECT_EQ(snap.buffers, 10u);
+    EXPECT_EQ(snap.bytes, 10'000u);
+    EXPECT_DOUBLE_EQ(snap.interarrival_mean_us, 33'333.0);
+    EXPECT_DOUBLE_EQ(snap.jitter_us, 0.0);
+    EXPECT_EQ(snap.lag_samples, 0u);
+}
+
+TEST(MypassthroughStatsTest, LagAndSizeHistogram) {
+    StatsPtr stats(my_pass_stats_new());
+    my_pass_stats_record(stats.get(), 0, -2'000'000, 1);
+    my_pass_stats_record(stats.get(), 10'000'000, 4'000'000, 1000);
+    my_pass_stats_record(stats.get(), 30'000'000, 7'000'000, 1024);
+
+    MyPassStatsSnapshot snap;
+    my_pass_stats_snapshot(stats.get(), &snap);
+    EXPECT_EQ(snap.lag_samples, 3u);
+    EXPECT_EQ(snap.lag_min_us, -2'000);
+    EXPECT_EQ(snap.lag_max_us, 7'000);
+    EXPECT_DOUBLE_EQ(snap.lag_mean_us, 3'000.0);
+    // Intervalles 10 ms et 20 ms : écart-type 5 ms
+    EXPECT_DOUBLE_EQ(snap.jitter_us, 5'000.0);
+    EXPECT_DOUBLE_EQ(snap.interarrival_max_us, 20'000.0);
+    // 1 -> [1, 2), 1000 -> [512, 1024), 1024 -> [1024, 2048)
+    EXPECT_EQ(snap.size_histogram[1], 1u);
+    EXPECT_EQ(snap.size_histogram[10], 1u);
+    EXPECT_EQ(snap.size_histogram[11], 1u);
+
+    my_pass_stats_reset(stats.get());
+    my_pass_stats_snapshot(stats.get(), &snap);
+    EXPECT_EQ(snap.buffers, 0u);
+    EXPECT_EQ(snap.lag_max_us, 0);
+}
+
+TEST(MypassthroughStatsTest, ConcurrentWritersAndReader) {
+    StatsPtr stats(my_pass_stats_new());
+    constexpr int kThreads = 12, kPerThread = 20'000;
+    std::atomic<bool> done{false};
+
+    // Le lecteur tourne pendant les écritures : jamais bloquant, jamais décroissant
+    std::thread reader([&] {
+        guint64 last = 0;
+        while (!done.load()) {
+            MyPassStatsSnapshot snap;
+            my_pass_stats_snapshot(stats.get(), &snap);
+            EXPECT_GE(snap.buffers, last);
+            last = snap.buffers;
+        }
+    });
+    std::vector<std::thread> writers;
+    for (int t = 0; t < kThreads; ++t) {
+        writers.emplace_back([&, t] {
+            for (int i = 0; i < kPerThread; ++i) {
+                my_pass_stats_record(stats.get(), (t * kPerThread + i) * 1000, 500'000, 4096);
+            }
+        });
+    }
+    for (auto& w : writers) {
+        w.join();
+    }
+    done = true;
+    reader.join();
+
+    MyPassStatsSnapshot snap;
+    my_pass_stats_snapshot(stats.get(), &snap);
+    EXPECT_EQ(snap.buffers, static_cast<guint64>(kThreads) * kPerThread);
+    EXPECT_EQ(snap.size_histogram[13], static_cast<guint64>(kThreads) * kPerThread);
+    EXPECT_EQ(snap.lag_min_us, 500);
+    EXPECT_EQ(snap.lag_max_us, 500);
+}
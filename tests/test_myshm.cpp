@@ -0,0 +1,277 @@
+#include <gtest/gtest.h>
+#include <gst/gst.h>
+#include <string>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "myshm_ring.h"
+#include "utils/buffer_probe.hpp"
+
+namespace {
+
+// Ouvre une seconde vue de l'anneau, comme le ferait le consommateur avec
+// les descripteurs reçus par la socket.
+MyShmRing* attach_copy(MyShmRing* ring) {
+    int fds[MY_SHM_RING_N_FDS];
+    my_shm_ring_get_fds(ring, fds);
+    for (int& fd : fds) {
+        fd = dup(fd);
+    }
+    return my_shm_ring_attach(fds, nullptr);
+}
+
+void publish(MyShmRing* ring, guint slot, const char* text, guint64 pts) {
+    std::strcpy(reinterpret_cast<char*>(my_shm_ring_slot_data(ring, slot)), text);
+    MyShmFrameInfo info{};
+    info.size = std::strlen(text) + 1;
+    info.pts = pts;
+    info.caps_generation = my_shm_ring_caps_generation(ring);
+    my_shm_ring_publish(ring, slot, &info);
+}
+
+} // namespace
+
+TEST(MyShmRingTest, FramesArriveInOrderWithoutCopy) {
+    MyShmRing* producer = my_shm_ring_new(4, 100, nullptr);
+    ASSERT_NE(producer, nullptr);
+    EXPECT_EQ(my_shm_ring_slot_size(producer), 4096u);
+    MyShmRing* consumer = attach_copy(producer);
+    ASSERT_NE(consumer, nullptr);
+
+    const gint a = my_shm_ring_acquire(producer);
+    const gint b = my_shm_ring_acquire(producer);
+    ASSERT_GE(a, 0);
+    ASSERT_GE(b, 0);
+    publish(producer, b, "deux", 2);
+    publish(producer, a, "une", 1);
+
+    MyShmFrameInfo info;
+    guint32 epoch_b;
+    ASSERT_EQ(my_shm_ring_pop(consumer, &info, &epoch_b), b);
+    EXPECT_EQ(info.pts, 2u);
+    // Même mémoire vue par deux mmap : lue sur place
+    EXPECT_STREQ(reinterpret_cast<const char*>(my_shm_ring_slot_data(consumer, b) + info.offset), "deux");
+    guint32 epoch;
+    ASSERT_EQ(my_shm_ring_pop(consumer, &info, &epoch), a);
+    EXPECT_EQ(info.pts, 1u);
+    EXPECT_EQ(my_shm_ring_pop(consumer, &info, &epoch), -1);
+
+    my_shm_ring_release(consumer, b, epoch_b);
+    my_shm_ring_release(consumer, a, epoch);
+    my_shm_ring_unref(consumer);
+    my_shm_ring_unref(producer);
+}
+
+TEST(MyShmRingTest, SlotsStayTakenUntilReleased) {
+    MyShmRing* producer = my_shm_ring_new(2, 64, nullptr);
+    ASSERT_NE(producer, nullptr);
+    MyShmRing* consumer = attach_copy(producer);
+    ASSERT_NE(consumer, nullptr);
+
+    const gint a = my_shm_ring_acquire(producer);
+    const gint b = my_shm_ring_acquire(producer);
+    EXPECT_EQ(my_shm_ring_acquire(producer), -1);
+    // Abandonné sans publication : de nouveau libre
+    my_shm_ring_abandon(producer, b);
+    EXPECT_EQ(my_shm_ring_acquire(producer), b);
+
+    publish(producer, a, "x", 0);
+    publish(producer, b, "y", 0);
+    MyShmFrameInfo info;
+    guint32 epoch;
+    ASSERT_EQ(my_shm_ring_pop(consumer, &info, &epoch), a);
+    // Retirée de la file mais pas libérée : toujours au consommateur
+    EXPECT_EQ(my_shm_ring_acquire(producer), -1);
+    my_shm_ring_release(consumer, a, epoch);
+    EXPECT_EQ(my_shm_ring_acquire(producer), a);
+
+    my_shm_ring_unref(consumer);
+    my_shm_ring_unref(producer);
+}
+
+TEST(MyShmRingTest, ReclaimFreesWhatTheConsumerHeld) {
+    MyShmRing* producer = my_shm_ring_new(2, 64, nullptr);
+    ASSERT_NE(producer, nullptr);
+    MyShmRing* consumer = attach_copy(producer);
+    ASSERT_NE(consumer, nullptr);
+
+    publish(producer, my_shm_ring_acquire(producer), "x", 0);
+    publish(producer, my_shm_ring_acquire(producer), "y", 0);
+    MyShmFrameInfo info;
+    guint32 epoch;
+    ASSERT_GE(my_shm_ring_pop(consumer, &info, &epoch), 0);
+    EXPECT_EQ(my_shm_ring_acquire(producer), -1);
+
+    // Le consommateur est parti : frame tenue et frame en file reviennent
+    my_shm_ring_reclaim(producer);
+    EXPECT_EQ(my_shm_ring_pop(consumer, &info, &epoch), -1);
+    EXPECT_GE(my_shm_ring_acquire(producer), 0);
+    EXPECT_GE(my_shm_ring_acquire(producer), 0);
+
+    my_shm_ring_unref(consumer);
+    my_shm_ring_unref(producer);
+}
+
+TEST(MyShmRingTest, LateReleaseAfterReclaimIsIgnored) {
+    MyShmRing* producer = my_shm_ring_new(1, 64, nullptr);
+    ASSERT_NE(producer, nullptr);
+    MyShmRing* consumer = attach_copy(producer);
+    ASSERT_NE(consumer, nullptr);
+
+    publish(producer, my_shm_ring_acquire(producer), "x", 0);
+    MyShmFrameInfo info;
+    guint32 stale;
+    const gint slot = my_shm_ring_pop(consumer, &info, &stale);
+    ASSERT_EQ(slot, 0);
+
+    // Le consommateur part en laissant la frame tenue en aval ; le
+    // producteur la reprend et réécrit l'emplacement
+    my_shm_ring_reclaim(producer);
+    ASSERT_EQ(my_shm_ring_acquire(producer), slot);
+    my_shm_ring_release(consumer, slot, stale);
+    // Toujours en écriture : pas de second écrivain
+    EXPECT_EQ(my_shm_ring_acquire(producer), -1);
+
+    // Publié pour le consommateur suivant : la vieille libération ne le lui
+    // retire pas non plus
+    publish(producer, slot, "y", 1);
+    my_shm_ring_release(consumer, slot, stale);
+    EXPECT_EQ(my_shm_ring_acquire(producer), -1);
+    guint32 epoch;
+    ASSERT_EQ(my_shm_ring_pop(consumer, &info, &epoch), slot);
+    EXPECT_EQ(info.pts, 1u);
+    EXPECT_NE(epoch, stale);
+    my_shm_ring_release(consumer, slot, epoch);
+    EXPECT_EQ(my_shm_ring_acquire(producer), slot);
+
+    my_shm_ring_unref(consumer);
+    my_shm_ring_unref(producer);
+}
+
+TEST(MyShmRingTest, CapsCarryAGeneration) {
+    MyShmRing* producer = my_shm_ring_new(2, 64, nullptr);
+    ASSERT_NE(producer, nullptr);
+    MyShmRing* consumer = attach_copy(producer);
+    ASSERT_NE(consumer, nullptr);
+
+    guint32 generation = 42;
+    EXPECT_EQ(my_shm_ring_dup_caps(consumer, &generation), nullptr);
+    ASSERT_TRUE(my_shm_ring_set_caps(producer, "video/x-raw, width=(int)320"));
+    gchar* caps = my_shm_ring_dup_caps(consumer, &generation);
+    EXPECT_STREQ(caps, "video/x-raw, width=(int)320");
+    EXPECT_EQ(generation, my_shm_ring_caps_generation(producer));
+    g_free(caps);
+
+    ASSERT_TRUE(my_shm_ring_set_caps(producer, "video/x-raw, width=(int)640"));
+    caps = my_shm_ring_dup_caps(consumer, &generation);
+    EXPECT_STREQ(caps, "video/x-raw, width=(int)640");
+    EXPECT_EQ(generation, my_shm_ring_caps_generation(producer));
+    g_free(caps);
+
+    EXPECT_FALSE(my_shm_ring_set_caps(producer, std::string(MY_SHM_RING_MAX_CAPS, 'c').c_str()));
+    my_shm_ring_unref(consumer);
+    my_shm_ring_unref(producer);
+}
+
+TEST(MyShmRingTest, FramesCrossAProcessBoundary) {
+    MyShmRing* producer = my_shm_ring_new(4, 64, nullptr);
+    ASSERT_NE(producer, nullptr);
+    int sockets[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets), 0);
+
+    const pid_t child = fork();
+    ASSERT_GE(child, 0);
+    if (child == 0) {
+        // Consommateur : reçoit l'anneau, attend 100 frames à la sonnette
+        close(sockets[0]);
+        int fds[MY_SHM_RING_N_FDS];
+        if (!my_shm_recv_fds(sockets[1], fds, MY_SHM_RING_N_FDS, nullptr)) {
+            _exit(2);
+        }
+        MyShmRing* consumer = my_shm_ring_attach(fds, nullptr);
+        if (consumer == nullptr) {
+            _exit(3);
+        }
+        GMainContext* context = g_main_context_new();
+        GSource* ready = my_shm_doorbell_source_new(consumer, MY_SHM_DOORBELL_READY);
+        g_source_attach(ready, context);
+        guint64 expected = 0;
+        while (expected < 100) {
+            MyShmFrameInfo info;
+            guint32 epoch;
+            const gint slot = my_shm_ring_pop(consumer, &info, &epoch);
+            if (slot < 0) {
+                g_main_context_iteration(context, TRUE);
+                continue;
+            }
+            if (info.pts != expected++) {
+                _exit(4);
+            }
+            my_shm_ring_release(consumer, slot, epoch);
+        }
+        _exit(0);
+    }
+
+    close(sockets[1]);
+    int fds[MY_SHM_RING_N_FDS];
+    my_shm_ring_get_fds(producer, fds);
+    ASSERT_TRUE(my_shm_send_fds(sockets[0], fds, MY_SHM_RING_N_FDS, nullptr));
+
+    // Producteur : 100 frames dans 4 emplacements, à la sonnette « libre »
+    GMainContext* context = g_main_context_new();
+    GSource* free_bell = my_shm_doorbell_source_new(producer, MY_SHM_DOORBELL_FREE);
+    g_source_attach(free_bell, context);
+    for (guint64 pts = 0; pts < 100; ++pts) {
+        gint slot;
+        while ((slot = my_shm_ring_acquire(producer)) < 0) {
+            g_main_context_iteration(context, TRUE);
+        }
+        publish(producer, slot, "frame", pts);
+    }
+
+    int status = 0;
+    ASSERT_EQ(waitpid(child, &status, 0), child);
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+
+    g_source_destroy(free_bell);
+    g_source_unref(free_bell);
+    g_main_context_unref(context);
+    close(sockets[0]);
+    my_shm_ring_unref(producer);
+}
+
+TEST(MyShmElementsTest, UpstreamWritesStraightIntoTheRing) {
+    gst_init(nullptr, nullptr);
+    const std::string socket = "/tmp/myshm-test-" + std::to_string(getpid()) + ".sock";
+
+    GstElement* producer = gst_parse_launch(
+        ("videotestsrc is-live=true ! video/x-raw,format=I420,width=320,height=240,framerate=30/1 "
+         "! myshmsink name=sink socket-path=" + socket).c_str(), nullptr);
+    ASSERT_NE(producer, nullptr);
+    ASSERT_NE(gst_element_set_state(producer, GST_STATE_PLAYING), GST_STATE_CHANGE_FAILURE);
+
+    GstElement* consumer = gst_parse_launch(
+        ("myshmsrc name=src socket-path=" + socket + " ! fakesink sync=false").c_str(), nullptr);
+    ASSERT_NE(consumer, nullptr);
+    gst_element_set_state(consumer, GST_STATE_PLAYING);
+
+    GstElement* src = gst_bin_get_by_name(GST_BIN(consumer), "src");
+    EXPECT_TRUE(wait_for_buffers(src, 10));
+    gst_object_unref(src);
+
+    // Les frames ont été écrites par videotestsrc dans les emplacements
+    GstElement* sink = gst_bin_get_by_name(GST_BIN(producer), "sink");
+    guint copies = 1;
+    gboolean connected = FALSE;
+    g_object_get(sink, "copies", &copies, "connected", &connected, nullptr);
+    EXPECT_EQ(copies, 0u);
+    EXPECT_TRUE(connected);
+    gst_object_unref(sink);
+
+    gst_element_set_state(consumer, GST_STATE_NULL);
+    gst_object_unref(consumer);
+    gst_element_set_state(producer, GST_STATE_NULL);
+    gst_object_unref(producer);
+}
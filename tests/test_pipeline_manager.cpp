@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+#include <gst/gst.h>
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+#include "gstreamer/pipeline_manager.hpp"
+
+using namespace std::chrono_literals;
+
+namespace {
+
+const char* LIVE_DESC = "videotestsrc is-live=true ! video/x-raw,width=64,height=48 ! fakesink";
+// Les caps audio ne se négocient jamais avec videotestsrc : ERROR au démarrage
+const char* FAILING_DESC = "videotestsrc ! capsfilter caps=audio/x-raw ! fakesink";
+
+// Attend que le pipeline atteigne `state`.
+bool wait_for_state(PipelineManager& manager, const std::string& name, PipelineStatus::State state) {
+    for (int i = 0; i < 500; ++i) {
+        const auto status = manager.query(name).get();
+        if (status && status->state == state) {
+            return true;
+        }
+        std::this_thread::sleep_for(10ms);
+    }
+    return false;
+}
+
+} // namespace
+
+TEST(PipelineManagerTest, RunsManyPipelinesOnOneThread) {
+    gst_init(nullptr, nullptr);
+    PipelineManager manager;
+
+    constexpr int kPipelines = 16;
+    for (int i = 0; i < kPipelines; ++i) {
+        ASSERT_TRUE(manager.create("live" + std::to_string(i), LIVE_DESC).get()) << i;
+    }
+    for (int i = 0; i < kPipelines; ++i) {
+        EXPECT_EQ(manager.start("live" + std::to_string(i)).get().status, LifecycleEvent::Status::Reached) << i;
+    }
+
+    const auto statuses = manager.list().get();
+    ASSERT_EQ(statuses.size(), static_cast<std::size_t>(kPipelines));
+    for (const auto& status : statuses) {
+        EXPECT_EQ(status.state, PipelineStatus::State::Playing) << status.name;
+        EXPECT_EQ(status.restarts, 0u);
+    }
+
+    EXPECT_EQ(manager.stop("live0").get().status, LifecycleEvent::Status::Reached);
+    EXPECT_EQ(manager.query("live0").get()->state, PipelineStatus::State::Stopped);
+    EXPECT_TRUE(manager.remove("live1").get());
+    EXPECT_FALSE(manager.query("live1").get());
+    EXPECT_EQ(manager.list().get().size(), static_cast<std::size_t>(kPipelines - 1));
+    // Les autres tournent encore : le destructeur les arrête
+}
+
+TEST(PipelineManagerTest, RejectsDuplicatesAndBadDescriptions) {
+    gst_init(nullptr, nullptr);
+    PipelineManager manager;
+
+    EXPECT_TRUE(manager.create("cam", LIVE_DESC).get());
+    EXPECT_FALSE(manager.create("cam", LIVE_DESC).get());
+    EXPECT_FALSE(manager.create("broken", "videotestsrc ! no_such_element_xyz").get());
+    EXPECT_FALSE(manager.query("broken").get());
+
+    EXPECT_EQ(manager.start("missing").get().status, LifecycleEvent::Status::Error);
+    EXPECT_EQ(manager.stop("missing").get().status, LifecycleEvent::Status::Error);
+    EXPECT_FALSE(manager.remove("missing").get());
+
+    std::promise<bool> seen;
+    manager.with_pipeline("cam", [&seen](GstPipelineWrapper* pipeline) { seen.set_value(pipeline != nullptr); });
+    EXPECT_TRUE(seen.get_future().get());
+}
+
+TEST(PipelineManagerTest, RestartsFailingPipelinesThenGivesUp) {
+    gst_init(nullptr, nullptr);
+    RestartPolicy policy;
+    policy.initial_backoff = 10ms;
+    policy.max_backoff = 40ms;
+    policy.max_restarts = 3;
+    PipelineManager manager(policy);
+
+    ASSERT_TRUE(manager.create("flaky", FAILING_DESC).get());
+    manager.start("flaky").get();
+
+    // Chaque échec reconstruit le pipeline, jusqu'à la limite
+    ASSERT_TRUE(wait_for_state(manager, "flaky", PipelineStatus::State::Failed));
+    const auto status = manager.query("flaky").get();
+    EXPECT_EQ(status->restarts, 3u);
+    EXPECT_FALSE(status->last_error.empty());
+
+    // Un start explicite repart de zéro avec une nouvelle reconstruction
+    manager.start("flaky").get();
+    EXPECT_TRUE(wait_for_state(manager, "flaky", PipelineStatus::State::Failed));
+}
+
+TEST(PipelineManagerTest, StopCancelsPendingRestart) {
+    gst_init(nullptr, nullptr);
+    RestartPolicy policy;
+    policy.initial_backoff = 200ms;
+    PipelineManager manager(policy);
+
+    ASSERT_TRUE(manager.create("flaky", FAILING_DESC).get());
+    manager.start("flaky").get();
+    ASSERT_TRUE(wait_for_state(manager, "flaky", PipelineStatus::State::Restarting));
+
+    manager.stop("flaky").get();
+    // Bien après l'échéance du redémarrage : rien n'a été relancé
+    std::this_thread::sleep_for(400ms);
+    const auto status = manager.query("flaky").get();
+    EXPECT_EQ(status->state, PipelineStatus::State::Stopped);
+    EXPECT_EQ(status->restarts, 0u);
+}
+
+TEST(PipelineManagerTest, ReusedNameIgnoresTheRemovedPipeline) {
+    gst_init(nullptr, nullptr);
+    PipelineManager manager;
+
+    ASSERT_TRUE(manager.create("cam", LIVE_DESC).get());
+    ASSERT_EQ(manager.start("cam").get().status, LifecycleEvent::Status::Reached);
+    // L'ancien pipeline est détruit plus tard et signale « pipeline destroyed »
+    // alors que le nouveau porte déjà le même nom
+    EXPECT_TRUE(manager.remove("cam").get());
+    ASSERT_TRUE(manager.create("cam", LIVE_DESC).get());
+    std::this_thread::sleep_for(100ms);
+
+    const auto status = manager.query("cam").get();
+    ASSERT_TRUE(status);
+    EXPECT_EQ(status->state, PipelineStatus::State::Stopped);
+    EXPECT_TRUE(status->last_error.empty());
+}
+
+TEST(PipelineManagerTest, DestroysWantedPipelinesWithoutRestarting) {
+    gst_init(nullptr, nullptr);
+    RestartPolicy policy;
+    policy.initial_backoff = 1ms;
+    auto manager = std::make_unique<PipelineManager>(policy);
+
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(manager->create("live" + std::to_string(i), LIVE_DESC).get());
+        ASSERT_EQ(manager->start("live" + std::to_string(i)).get().status, LifecycleEvent::Status::Reached);
+    }
+    ASSERT_TRUE(manager->remove("live0").get());
+    // Chaque pipeline voulu signale sa destruction comme une erreur : rien ne
+    // doit plus toucher aux entrées ni programmer de redémarrage
+    manager.reset();
+}
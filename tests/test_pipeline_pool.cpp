@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include <gst/gst.h>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <thread>
+#include "gstreamer/main_loop_thread.hpp"
+#include "gstreamer/pipeline_pool.hpp"
+
+namespace {
+
+const char* POOLED_PIPELINE_DESC =
+    "videotestsrc num-buffers=300 ! video/x-raw,width=320,height=240,framerate=30/1 "
+    "! x264enc tune=zerolatency speed-preset=ultrafast "
+    "! appsink name=out sync=false";
+
+// Attend que la réserve contienne `count` pipelines prêts.
+bool wait_for_idle(const PipelinePool& pool, std::size_t count) {
+    for (int i = 0; i < 500; ++i) {
+        if (pool.idle(POOLED_PIPELINE_DESC) >= count) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+// Démarre le pipeline et attend son premier buffer en sortie.
+bool first_buffer(GstPipelineWrapper& pipeline) {
+    auto got = std::make_shared<std::promise<void>>();
+    auto future = got->get_future();
+    auto once = std::make_shared<std::once_flag>();
+    if (!pipeline.tap_appsink("out", [got, once](GstBuffer*) {
+            std::call_once(*once, [&] { got->set_value(); });
+        })) {
+        return false;
+    }
+    if (pipeline.start_async().get().status != LifecycleEvent::Status::Reached) {
+        return false;
+    }
+    return future.wait_for(std::chrono::seconds(10)) == std::future_status::ready;
+}
+
+} // namespace
+
+TEST(PipelinePoolTest, HandsOutPrerolledPipelines) {
+    auto loop = std::make_unique<MainLoopThread>();
+    {
+        PipelinePool pool(loop->context());
+        pool.prewarm(POOLED_PIPELINE_DESC, 2);
+        ASSERT_TRUE(wait_for_idle(pool, 2));
+
+        PipelineLease lease = pool.acquire(POOLED_PIPELINE_DESC);
+        ASSERT_TRUE(lease);
+        EXPECT_TRUE(lease.warm());
+        EXPECT_TRUE(first_buffer(*lease));
+
+        // Une description inconnue n'a pas de réserve : pipeline parsé à la demande
+        PipelineLease cold = pool.acquire("videotestsrc num-buffers=1 ! fakesink");
+        EXPECT_FALSE(cold.warm());
+    }
+    loop.reset();
+}
+
+TEST(PipelinePoolTest, RecyclesReturnedPipelines) {
+    auto loop = std::make_unique<MainLoopThread>();
+    {
+        PipelinePool pool(loop->context());
+        pool.prewarm(POOLED_PIPELINE_DESC, 1);
+        ASSERT_TRUE(wait_for_idle(pool, 1));
+
+        GstPipelineWrapper* first = nullptr;
+        {
+            PipelineLease lease = pool.acquire(POOLED_PIPELINE_DESC);
+            first = lease.get();
+            EXPECT_TRUE(first_buffer(*lease));
+            // Le pipeline a joué jusqu'au bout avant d'être rendu
+            EXPECT_EQ(lease->end_of_stream_async().get().status, LifecycleEvent::Status::Eos);
+        }
+
+        // Rendu au pool : remis à READY puis de nouveau préchargé, pas détruit
+        ASSERT_TRUE(wait_for_idle(pool, 1));
+        PipelineLease again = pool.acquire(POOLED_PIPELINE_DESC);
+        EXPECT_TRUE(again.warm());
+        EXPECT_EQ(again.get(), first);
+        EXPECT_TRUE(first_buffer(*again));
+    }
+    loop.reset();
+}
@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+#include <string>
+#include "http/router.h"
+
+namespace http = boost::beast::http;
+
+namespace {
+
+struct CapturingSink : ResponseSink {
+    void send(Response&& response) override { last = std::move(response); ++count; }
+    Response last;
+    int count = 0;
+};
+
+Request make_request(http::verb method, const char* target) {
+    return Request{method, target, 11};
+}
+
+std::string body_of(const Response& response) {
+    return std::get<Response::StringMessage>(response.message).body();
+}
+
+} // namespace
+
+TEST(RouterTest, MatchesLiteralAndParameterSegments) {
+    Router router;
+    std::string seen;
+    router.add(http::verb::put, "/elements/{name}/properties/{prop}",
+        [&](const Request&, const PathParams& params, const Reply& reply) {
+            seen = std::string(params.get("name")) + "." + std::string(params.get("prop"));
+            reply(Response::text(http::status::ok, "ok"));
+        });
+
+    auto sink = std::make_shared<CapturingSink>();
+    router.dispatch(make_request(http::verb::put, "/elements/encode/properties/bitrate?x=1"), Reply(sink));
+
+    EXPECT_EQ(seen, "encode.bitrate");
+    EXPECT_EQ(sink->count, 1);
+    EXPECT_EQ(sink->last.result(), http::status::ok);
+}
+
+TEST(RouterTest, ParametersAreViewsIntoTheTarget) {
+    Router router;
+    router.add(http::verb::get, "/a/{id}", [](const Request&, const PathParams&, const Reply&) {});
+
+    const std::string target = "/a/1234";
+    const Handler* handler = nullptr;
+    PathParams params;
+    ASSERT_EQ(router.match(http::verb::get, target, handler, params), Router::Match::Found);
+    EXPECT_EQ(params.get("id").data(), target.data() + 3);
+}
+
+TEST(RouterTest, LiteralWinsOverParameter) {
+    Router router;
+    std::string hit;
+    router.add(http::verb::get, "/streams/{id}",
+        [&](const Request&, const PathParams&, const Reply& reply) { hit = "param"; reply(Response::text(http::status::ok, "")); });
+    router.add(http::verb::get, "/streams/live",
+        [&](const Request&, const PathParams&, const Reply& reply) { hit = "literal"; reply(Response::text(http::status::ok, "")); });
+
+    auto sink = std::make_shared<CapturingSink>();
+    router.dispatch(make_request(http::verb::get, "/streams/live"), Reply(sink));
+    EXPECT_EQ(hit, "literal");
+    router.dispatch(make_request(http::verb::get, "/streams/other"), Reply(sink));
+    EXPECT_EQ(hit, "param");
+}
+
+TEST(RouterTest, WildcardCapturesTheRestOfThePath) {
+    Router router;
+    router.add(http::verb::get, "/static/*", [](const Request&, const PathParams&, const Reply&) {});
+
+    const Handler* handler = nullptr;
+    PathParams params;
+    ASSERT_EQ(router.match(http::verb::get, "/static/css/site.css", handler, params), Router::Match::Found);
+    EXPECT_EQ(params.get("*"), "css/site.css");
+}
+
+TEST(RouterTest, AnswersNotFoundAndMethodNotAllowed) {
+    Router router;
+    router.add(http::verb::get, "/", [](const Request&, const PathParams&, const Reply& reply) {
+        reply(Response::text(http::status::ok, "Hello"));
+    });
+
+    auto sink = std::make_shared<CapturingSink>();
+    router.dispatch(make_request(http::verb::get, "/"), Reply(sink));
+    EXPECT_EQ(body_of(sink->last), "Hello");
+    router.dispatch(make_request(http::verb::get, "/missing"), Reply(sink));
+    EXPECT_EQ(sink->last.result(), http::status::not_found);
+    router.dispatch(make_request(http::verb::post, "/"), Reply(sink));
+    EXPECT_EQ(sink->last.result(), http::status::method_not_allowed);
+}
+
+TEST(RouterTest, SpanResponseDoesNotCopyThePayload) {
+    auto payload = std::make_shared<std::string>(1 << 20, 'x');
+    auto response = Response::span(http::status::ok, *payload, payload);
+    response.finalize(11, true);
+
+    const auto& message = std::get<Response::SpanMessage>(response.message);
+    EXPECT_EQ(message.body().data(), payload->data());
+    EXPECT_EQ(message[http::field::content_length], std::to_string(payload->size()));
+}
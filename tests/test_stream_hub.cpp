@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+#include <gst/gst.h>
+#include "http/stream_hub.h"
+
+namespace {
+
+GstBuffer* make_buffer(bool keyframe) {
+    GstBuffer* buffer = gst_buffer_new_allocate(nullptr, 188, nullptr);
+    if (!keyframe) {
+        GST_BUFFER_FLAG_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+    }
+    return buffer;
+}
+
+void publish(StreamHub& hub, bool keyframe) {
+    GstBuffer* buffer = make_buffer(keyframe);
+    hub.publish(buffer);
+    gst_buffer_unref(buffer);
+}
+
+std::size_t drain(StreamSubscriber& subscriber) {
+    std::size_t n = 0;
+    while (subscriber.next().size() > 0) {
+        subscriber.release();
+        ++n;
+    }
+    return n;
+}
+
+} // namespace
+
+TEST(StreamHubTest, NewViewerStartsOnKeyframe) {
+    gst_init(nullptr, nullptr);
+    auto hub = std::make_shared<StreamHub>();
+    auto viewer = hub->subscribe(16);
+
+    publish(*hub, false);
+    publish(*hub, false);
+    publish(*hub, true);
+    publish(*hub, false);
+
+    EXPECT_EQ(drain(*viewer), 2u);
+    EXPECT_EQ(viewer->dropped(), 2u);
+    viewer->stop();
+    EXPECT_EQ(hub->subscribers(), 0u);
+}
+
+TEST(StreamHubTest, LateViewerJoinsTheCurrentGop) {
+    gst_init(nullptr, nullptr);
+    auto hub = std::make_shared<StreamHub>();
+    publish(*hub, true);
+    publish(*hub, false);
+    publish(*hub, false);
+
+    // Le nouveau spectateur n'attend pas la prochaine image clé
+    auto viewer = hub->subscribe();
+    EXPECT_EQ(drain(*viewer), 3u);
+    EXPECT_EQ(viewer->dropped(), 0u);
+    viewer->stop();
+}
+
+TEST(StreamHubTest, TellsWhetherAViewerWouldReplayTheCurrentGop) {
+    gst_init(nullptr, nullptr);
+    auto hub = std::make_shared<StreamHub>();
+    EXPECT_FALSE(hub->keyframe_within(8));
+
+    publish(*hub, true);
+    for (int i = 0; i < 8; ++i) {
+        publish(*hub, false);
+    }
+    EXPECT_TRUE(hub->keyframe_within(9));
+    // Image clé hors de portée : le spectateur attendrait la suivante
+    EXPECT_FALSE(hub->keyframe_within(8));
+    auto viewer = hub->subscribe(8);
+    EXPECT_EQ(drain(*viewer), 0u);
+    viewer->stop();
+}
+
+TEST(StreamHubTest, SlowViewerSkipsToNextKeyframe) {
+    gst_init(nullptr, nullptr);
+    auto hub = std::make_shared<StreamHub>();
+    auto slow = hub->subscribe(4);
+    auto fast = hub->subscribe(64);
+
+    publish(*hub, true);
+    for (int i = 0; i < 9; ++i) {
+        publish(*hub, false);
+    }
+    // The slow viewer overflowed: everything up to the next keyframe is gone.
+    EXPECT_EQ(drain(*slow), 0u);
+    publish(*hub, true);
+    publish(*hub, false);
+    EXPECT_EQ(drain(*slow), 2u);
+    EXPECT_GT(slow->dropped(), 0u);
+
+    // The other viewer and the producer were not affected.
+    EXPECT_EQ(drain(*fast), 12u);
+    EXPECT_EQ(fast->dropped(), 0u);
+
+    slow->stop();
+    fast->stop();
+}
+
+TEST(StreamHubTest, ViewersShareTheSameMemory) {
+    gst_init(nullptr, nullptr);
+    auto hub = std::make_shared<StreamHub>();
+    auto a = hub->subscribe();
+    auto b = hub->subscribe();
+
+    GstBuffer* buffer = make_buffer(true);
+    hub->publish(buffer);
+
+    GstMapInfo map;
+    ASSERT_TRUE(gst_buffer_map(buffer, &map, GST_MAP_READ));
+    EXPECT_EQ(a->next().data(), map.data);
+    EXPECT_EQ(b->next().data(), map.data);
+    gst_buffer_unmap(buffer, &map);
+
+    a->release();
+    b->release();
+    gst_buffer_unref(buffer);
+    a->stop();
+    b->stop();
+}
+
+TEST(StreamHubTest, WakesAnIdleViewerOnce) {
+    gst_init(nullptr, nullptr);
+    auto hub = std::make_shared<StreamHub>();
+    auto viewer = hub->subscribe();
+    int wakes = 0;
+    viewer->start([&wakes] { ++wakes; });
+
+    EXPECT_EQ(viewer->next().size(), 0u);
+    publish(*hub, true);
+    publish(*hub, false);
+    EXPECT_EQ(wakes, 1);
+
+    EXPECT_EQ(drain(*viewer), 2u);
+    publish(*hub, false);
+    EXPECT_EQ(wakes, 2);
+    viewer->stop();
+}
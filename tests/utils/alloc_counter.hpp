@@ -0,0 +1,15 @@
+#pragma once
+#include <cstddef>
+
+// Compte les appels à operator new de tout le processus, tous threads
+// confondus, depuis sa construction. Les opérateurs globaux sont remplacés
+// dans alloc_counter.cpp pour tout l'exécutable de test.
+class AllocationCounter {
+public:
+    AllocationCounter();
+
+    std::size_t count() const;
+
+private:
+    std::size_t start_;
+};
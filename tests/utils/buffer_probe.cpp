@@ -0,0 +1,50 @@
+#include "buffer_probe.hpp"
+#include <chrono>
+#include <future>
+#include <memory>
+
+namespace {
+
+struct ProbeState {
+    guint remaining;
+    bool keyframes_only;
+    std::promise<void> done;
+};
+
+GstPadProbeReturn count_buffer(GstPad*, GstPadProbeInfo* info, gpointer data) {
+    auto& state = *static_cast<std::shared_ptr<ProbeState>*>(data);
+    GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    if (state->keyframes_only && GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT)) {
+        return GST_PAD_PROBE_OK;
+    }
+    if (--state->remaining == 0) {
+        state->done.set_value();
+        return GST_PAD_PROBE_REMOVE;
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+} // namespace
+
+bool wait_for_buffers(GstElement* element, guint count, bool keyframes_only, guint timeout_ms) {
+    if (count == 0) {
+        return true;
+    }
+    GstPad* pad = gst_element_get_static_pad(element, "src");
+    if (!pad) {
+        return false;
+    }
+    // Partagé avec la sonde, qui peut encore tourner si on abandonne sur timeout
+    auto state = std::make_shared<ProbeState>(ProbeState{count, keyframes_only, {}});
+    auto done = state->done.get_future();
+    const gulong id = gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, count_buffer,
+        new std::shared_ptr<ProbeState>(state),
+        [](gpointer data) { delete static_cast<std::shared_ptr<ProbeState>*>(data); });
+
+    const bool reached = done.wait_for(std::chrono::milliseconds(timeout_ms)) == std::future_status::ready;
+    if (!reached) {
+        gst_pad_remove_probe(pad, id);
+    }
+    gst_object_unref(pad);
+    return reached;
+}
@@ -0,0 +1,6 @@
+#pragma once
+#include <gst/gst.h>
+
+// Bloque jusqu'à ce que `count` buffers soient sortis du pad src de `element`
+// (seulement les images clés si `keyframes_only`). Retourne false après `timeout_ms`.
+bool wait_for_buffers(GstElement* element, guint count, bool keyframes_only = false, guint timeout_ms = 30000);
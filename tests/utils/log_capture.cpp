@@ -0,0 +1,23 @@
+#include "log_capture.hpp"
+#include <cstdio>
+#include "logging/logger.h"
+
+LogCapture::LogCapture() {
+    Logger::instance().set_sink([this](std::string_view lines) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        text_.append(lines);
+    });
+}
+
+LogCapture::~LogCapture() {
+    Logger::instance().set_sink([](std::string_view lines) {
+        std::fwrite(lines.data(), 1, lines.size(), stdout);
+        std::fflush(stdout);
+    });
+}
+
+std::string LogCapture::text() {
+    Logger::instance().flush();
+    std::lock_guard<std::mutex> lock(mutex_);
+    return text_;
+}
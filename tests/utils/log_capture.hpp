@@ -0,0 +1,17 @@
+#pragma once
+#include <mutex>
+#include <string>
+
+// Capture la sortie du logger pendant sa durée de vie, puis la rend à stdout.
+class LogCapture {
+public:
+    LogCapture();
+    ~LogCapture();
+
+    // Écrit d'abord tout ce qui a été journalisé avant l'appel.
+    std::string text();
+
+private:
+    std::mutex mutex_;
+    std::string text_;
+};
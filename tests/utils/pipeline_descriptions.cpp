@@ -6,4 +6,27 @@ const char* LIVE_WINDOW_PIPELINE_DESC =
     "! x264enc name=encode tune=zerolatency bitrate=6000 key-int-max=30 "
     "! avdec_h264 "
     "! videoconvert "
-    "! ximagesink";
\ No newline at end of file
+    "! ximagesink";
+
+// Same, with a natural keyframe only every 10 s: a forced one stands out.
+const char* LIVE_WINDOW_LONG_GOP_PIPELINE_DESC =
+    "videotestsrc pattern=smpte is-live=true ! timeoverlay ! video/x-raw,framerate=30/1 "
+    "! videoconvert "
+    "! x264enc name=encode tune=zerolatency bitrate=6000 key-int-max=300 "
+    "! avdec_h264 "
+    "! videoconvert "
+    "! ximagesink";
+
+const char* HEADLESS_PIPELINE_DESC =
+    "videotestsrc is-live=true ! video/x-raw,width=320,height=240,framerate=30/1 "
+    "! videoconvert "
+    "! x264enc name=encode tune=zerolatency bitrate=2000 key-int-max=30 speed-preset=ultrafast "
+    "! fakesink sync=false";
+
+const char* STREAMING_PIPELINE_DESC =
+    "videotestsrc is-live=true ! video/x-raw,width=320,height=240,framerate=30/1 "
+    "! videoconvert "
+    "! x264enc name=encode tune=zerolatency bitrate=1000 key-int-max=30 speed-preset=ultrafast "
+    "! h264parse config-interval=-1 "
+    "! mpegtsmux alignment=7 "
+    "! appsink name=egress sync=false";
@@ -1,4 +1,7 @@
 #pragma once
 #include <string>
 
-extern const char* LIVE_WINDOW_PIPELINE_DESC;
\ No newline at end of file
+extern const char* LIVE_WINDOW_PIPELINE_DESC;
+extern const char* LIVE_WINDOW_LONG_GOP_PIPELINE_DESC;
+extern const char* HEADLESS_PIPELINE_DESC;
+extern const char* STREAMING_PIPELINE_DESC;
\ No newline at end of file